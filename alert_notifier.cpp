@@ -0,0 +1,455 @@
+#include "alert_notifier.h"
+#include <iostream>
+#include <print>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <spawn.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+constexpr int IO_TIMEOUT_SECONDS = 5;
+constexpr int EXEC_TIMEOUT_SECONDS = 30;
+
+void setTimeouts(int fd, int seconds) {
+    timeval timeout{seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+    return true;
+}
+
+void appendJsonString(std::string& out, std::string_view text) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    out += '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            out += "\\u00";
+            out += HEX[c >> 4];
+            out += HEX[c & 0xf];
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+// 同一类变化的摘要：一台主机写出主机名和IP，多台主机写出数量和共同的IPv4网段（至少/8）
+std::string summarizeKind(const std::vector<const AlertEvent*>& events, std::string_view state) {
+    if (events.size() == 1) {
+        return events.front()->hostname + " (" + events.front()->ip + ") " + std::string(state);
+    }
+    std::string text = std::to_string(events.size()) + " hosts " + std::string(state);
+
+    std::uint32_t first = 0;
+    std::uint32_t differing = 0;
+    for (std::size_t i = 0; i < events.size(); i++) {
+        in_addr address;
+        if (inet_pton(AF_INET, events[i]->ip.c_str(), &address) != 1) {
+            return text;
+        }
+        std::uint32_t value = ntohl(address.s_addr);
+        if (i == 0) {
+            first = value;
+        }
+        differing |= value ^ first;
+    }
+    int prefix = std::countl_zero(differing);
+    if (prefix < 8) {
+        return text;
+    }
+    in_addr network;
+    network.s_addr = htonl(prefix == 32 ? first : first & ~(~std::uint32_t{0} >> prefix));
+    char buffer[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &network, buffer, sizeof(buffer));
+    return text + " in " + buffer + "/" + std::to_string(prefix);
+}
+
+// webhook：每条通知建立一个连接，发送一个POST请求
+class WebhookSink : public NotificationSink {
+private:
+    std::string host;
+    std::string port;
+    std::string path;
+
+public:
+    WebhookSink(std::string host, std::string port, std::string path)
+        : host(std::move(host)), port(std::move(port)), path(std::move(path)) {}
+
+    bool send(const std::string& message, const std::string&) override {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+            return false;
+        }
+        int fd = -1;
+        for (addrinfo* address = addresses; address && fd < 0; address = address->ai_next) {
+            fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            setTimeouts(fd, IO_TIMEOUT_SECONDS);
+            if (connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (fd < 0) {
+            return false;
+        }
+
+        std::string request = "POST " + path + " HTTP/1.1\r\nHost: " + host + ":" + port +
+                              "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(message.size()) +
+                              "\r\nConnection: close\r\n\r\n" + message;
+        bool delivered = false;
+        if (writeAll(fd, request)) {
+            // 只需要状态行："HTTP/1.1 200 ..."
+            char status[16] = {};
+            std::size_t received = 0;
+            while (received < 12) {
+                ssize_t count = recv(fd, status + received, 12 - received, 0);
+                if (count < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (count <= 0) {
+                    break;
+                }
+                received += static_cast<std::size_t>(count);
+            }
+            delivered = received == 12 && std::string_view(status, 5) == "HTTP/" && status[9] == '2';
+        }
+        close(fd);
+        return delivered;
+    }
+};
+
+// exec：通过socketpair把通知写入子进程的标准输入，命令不读取输入时不会因SIGPIPE终止本进程
+class ExecSink : public NotificationSink {
+private:
+    std::string command;
+
+public:
+    explicit ExecSink(std::string command) : command(std::move(command)) {}
+
+    bool send(const std::string& message, const std::string& summary) override {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+            return false;
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+
+        std::vector<std::string> variables;
+        for (char** variable = environ; *variable; variable++) {
+            if (!std::string_view(*variable).starts_with("MPING_ALERT_SUMMARY=")) {
+                variables.emplace_back(*variable);
+            }
+        }
+        variables.push_back("MPING_ALERT_SUMMARY=" + summary);
+        std::vector<char*> envp;
+        for (auto& variable : variables) {
+            envp.push_back(variable.data());
+        }
+        envp.push_back(nullptr);
+        std::string shell = "/bin/sh";
+        std::string flag = "-c";
+        char* argv[] = {shell.data(), flag.data(), command.data(), nullptr};
+
+        // 常驻模式在所有线程中屏蔽了SIGINT和SIGTERM，子进程恢复为不屏蔽任何信号
+        posix_spawnattr_t attributes;
+        posix_spawnattr_init(&attributes);
+        sigset_t noSignals;
+        sigemptyset(&noSignals);
+        posix_spawnattr_setsigmask(&attributes, &noSignals);
+        posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK);
+
+        pid_t pid;
+        int spawned = posix_spawn(&pid, "/bin/sh", &actions, &attributes, argv, envp.data());
+        posix_spawnattr_destroy(&attributes);
+        posix_spawn_file_actions_destroy(&actions);
+        close(fds[1]);
+        if (spawned != 0) {
+            close(fds[0]);
+            return false;
+        }
+        setTimeouts(fds[0], IO_TIMEOUT_SECONDS);
+        writeAll(fds[0], message + "\n");
+        close(fds[0]);
+
+        // 命令超时未退出时强制结束
+        int status = 0;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(EXEC_TIMEOUT_SECONDS);
+        while (true) {
+            pid_t waited = waitpid(pid, &status, WNOHANG);
+            if (waited == pid) {
+                break;
+            }
+            if (waited < 0 && errno != EINTR) {
+                return false;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                std::println(std::cerr, "Notification command timed out: {}", command);
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+};
+
+// unix：连接已在监听的套接字，写入一行JSON
+class SocketSink : public NotificationSink {
+private:
+    std::string path;
+
+public:
+    explicit SocketSink(std::string path) : path(std::move(path)) {}
+
+    bool send(const std::string& message, const std::string&) override {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        setTimeouts(fd, IO_TIMEOUT_SECONDS);
+        bool delivered = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 &&
+                         writeAll(fd, message + "\n");
+        close(fd);
+        return delivered;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<NotificationSink> createNotificationSink(const std::string& spec) {
+    std::size_t separator = spec.find(':');
+    if (separator == std::string::npos || separator == 0 || separator + 1 == spec.size()) {
+        std::println(std::cerr, "Invalid notification target '{}' (expected <type>:<target>)", spec);
+        return nullptr;
+    }
+    std::string type = spec.substr(0, separator);
+    std::string target = spec.substr(separator + 1);
+    if (type == "exec") {
+        return std::make_unique<ExecSink>(target);
+    }
+    if (type == "unix") {
+        return std::make_unique<SocketSink>(target);
+    }
+    if (type != "webhook") {
+        std::println(std::cerr, "Unknown notification type '{}'", type);
+        return nullptr;
+    }
+
+    // http://host[:port][/path]，IPv6地址写在方括号中
+    if (!target.starts_with("http://")) {
+        std::println(std::cerr, "Webhook URL must start with http://: {}", target);
+        return nullptr;
+    }
+    std::string rest = target.substr(7);
+    std::size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    std::string path = slash == std::string::npos ? "/" : rest.substr(slash);
+    std::string host = authority;
+    std::string port = "80";
+    std::size_t colon = authority.rfind(':');
+    if (colon != std::string::npos && authority.find(']', colon) == std::string::npos) {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+        int value = 0;
+        auto [end, error] = std::from_chars(port.data(), port.data() + port.size(), value);
+        if (error != std::errc() || end != port.data() + port.size() || value < 1 || value > 65535) {
+            std::println(std::cerr, "Invalid webhook port: {}", target);
+            return nullptr;
+        }
+    }
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    if (host.empty()) {
+        std::println(std::cerr, "Invalid webhook URL: {}", target);
+        return nullptr;
+    }
+    return std::make_unique<WebhookSink>(host, port, path);
+}
+
+AlertNotifier::AlertNotifier(const Options& options) : options(options) {}
+
+AlertNotifier::~AlertNotifier() {
+    close();
+}
+
+void AlertNotifier::add(const std::string& name, std::unique_ptr<NotificationSink> sink) {
+    targets.push_back({name, std::move(sink)});
+}
+
+void AlertNotifier::start() {
+    dispatcher = std::thread([this] { run(); });
+}
+
+void AlertNotifier::submit(const std::vector<AlertEvent>& events) {
+    if (events.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.events += events.size();
+        pending.insert(pending.end(), events.begin(), events.end());
+        if (pending.size() > options.maxPending) {
+            std::size_t excess = pending.size() - options.maxPending;
+            pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(excess));
+            counters.dropped += excess;
+        }
+    }
+    wakeup.notify_one();
+}
+
+bool AlertNotifier::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    wakeup.notify_one();
+    if (dispatcher.joinable()) {
+        dispatcher.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters.failed == 0 && counters.dropped == 0;
+}
+
+AlertNotifier::Stats AlertNotifier::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void AlertNotifier::printStats(std::ostream& out) {
+    Stats current = stats();
+    std::println(out, "Alert notifications: {} transitions in {} messages, {} delivered, {} retries, {} failed, {} dropped",
+                 current.events, current.messages, current.sent, current.retries, current.failed, current.dropped);
+}
+
+void AlertNotifier::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeup.wait(lock, [this] { return !pending.empty() || closing; });
+        if (pending.empty()) {
+            return;
+        }
+        // 第一条变化到达后再等待一个合并窗口，收集同时发生的其他变化；关闭时立即发送
+        wakeup.wait_for(lock, options.coalesceWindow, [this] { return closing; });
+        std::vector<AlertEvent> batch;
+        batch.swap(pending);
+        counters.messages++;
+        lock.unlock();
+        deliver(batch);
+        lock.lock();
+    }
+}
+
+void AlertNotifier::deliver(const std::vector<AlertEvent>& batch) {
+    std::string summary = summarize(batch);
+    std::string message = formatMessage(batch, summary);
+
+    std::vector<Target*> remaining;
+    for (auto& target : targets) {
+        remaining.push_back(&target);
+    }
+    auto backoff = options.initialBackoff;
+    bool lastAttempt = false;
+    for (int attempt = 1;; attempt++) {
+        std::size_t delivered = std::erase_if(remaining, [&](Target* target) {
+            return target->sink->send(message, summary);
+        });
+        std::unique_lock<std::mutex> lock(mutex);
+        counters.sent += delivered;
+        if (remaining.empty() || attempt >= options.maxAttempts || lastAttempt) {
+            break;
+        }
+        // 关闭时不再等待退避间隔，立即做最后一次尝试
+        counters.retries += remaining.size();
+        lastAttempt = wakeup.wait_for(lock, backoff, [this] { return closing; });
+        backoff = std::min(backoff * 2, options.maxBackoff);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.failed += remaining.size();
+    for (Target* target : remaining) {
+        std::println(std::cerr, "Failed to deliver alert notification to {}: {}", target->name, summary);
+    }
+}
+
+std::string AlertNotifier::summarize(const std::vector<AlertEvent>& batch) {
+    std::vector<const AlertEvent*> down;
+    std::vector<const AlertEvent*> up;
+    for (const auto& event : batch) {
+        (event.down ? down : up).push_back(&event);
+    }
+    std::string text;
+    if (!down.empty()) {
+        text = summarizeKind(down, "down");
+    }
+    if (!up.empty()) {
+        text += (text.empty() ? "" : "; ") + summarizeKind(up, "up");
+    }
+    return text;
+}
+
+std::string AlertNotifier::formatMessage(const std::vector<AlertEvent>& batch, const std::string& summary) {
+    std::string message = "{\"summary\":";
+    appendJsonString(message, summary);
+    for (bool down : {true, false}) {
+        message += down ? ",\"down\":[" : "],\"up\":[";
+        bool first = true;
+        for (const auto& event : batch) {
+            if (event.down != down) {
+                continue;
+            }
+            message += first ? "{\"ip\":" : ",{\"ip\":";
+            appendJsonString(message, event.ip);
+            message += ",\"hostname\":";
+            appendJsonString(message, event.hostname);
+            message += ",\"timestamp\":";
+            appendJsonString(message, event.timestamp);
+            message += '}';
+            first = false;
+        }
+    }
+    message += "]}";
+    return message;
+}
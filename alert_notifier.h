@@ -0,0 +1,100 @@
+#ifndef ALERT_NOTIFIER_H
+#define ALERT_NOTIFIER_H
+
+#include "alert_tracker.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+// 通知目标：把一条合并后的通知（一行JSON）送到外部，失败时返回false，由调度线程按退避间隔重试
+class NotificationSink {
+public:
+    virtual ~NotificationSink() = default;
+
+    virtual bool send(const std::string& message, const std::string& summary) = 0;
+};
+
+// 按"类型:参数"创建通知目标，格式错误时返回nullptr
+//   webhook:http://host[:port]/path   以POST发送JSON，2xx响应表示成功（只支持http）
+//   exec:<命令>                      由/bin/sh执行，JSON写入标准输入，摘要放在环境变量MPING_ALERT_SUMMARY中，退出码0表示成功
+//   unix:<路径>                       连接Unix域套接字，写入一行JSON后关闭
+std::unique_ptr<NotificationSink> createNotificationSink(const std::string& spec);
+
+// 告警通知调度：submit只把告警变化放入队列后立即返回，不阻塞探测
+// 调度线程在第一条变化到达后再等待一个合并窗口，把窗口内的全部变化合并为一条通知发给每个目标，
+// 发送失败的目标按指数退避重试，达到次数上限后放弃这条通知
+// 待发送的变化超过上限时丢弃最旧的变化并计数
+class AlertNotifier {
+public:
+    struct Options {
+        std::chrono::milliseconds coalesceWindow{5000};
+        std::chrono::milliseconds initialBackoff{1000};
+        std::chrono::milliseconds maxBackoff{30000};
+        int maxAttempts = 5;
+        std::size_t maxPending = 100000;
+    };
+
+    struct Stats {
+        std::uint64_t events = 0;    // 收到的告警变化
+        std::uint64_t messages = 0;  // 合并后的通知条数
+        std::uint64_t sent = 0;      // 成功送达的（通知, 目标）数
+        std::uint64_t retries = 0;   // 重试次数
+        std::uint64_t failed = 0;    // 重试后仍未送达的（通知, 目标）数
+        std::uint64_t dropped = 0;   // 队列满时丢弃的变化
+    };
+
+private:
+    struct Target {
+        std::string name;
+        std::unique_ptr<NotificationSink> sink;
+    };
+
+    Options options;
+    std::vector<Target> targets;
+    std::thread dispatcher;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::vector<AlertEvent> pending;
+    bool closing = false;
+    Stats counters;
+
+    void run();
+    void deliver(const std::vector<AlertEvent>& batch);
+
+public:
+    explicit AlertNotifier(const Options& options);
+    AlertNotifier() : AlertNotifier(Options{}) {}
+    ~AlertNotifier();
+
+    AlertNotifier(const AlertNotifier&) = delete;
+    AlertNotifier& operator=(const AlertNotifier&) = delete;
+
+    void add(const std::string& name, std::unique_ptr<NotificationSink> sink);
+    std::size_t size() const { return targets.size(); }
+
+    // 启动调度线程，只能在add之后调用一次
+    void start();
+
+    // 把一轮确认的告警变化放入队列，不等待发送
+    void submit(const std::vector<AlertEvent>& events);
+
+    // 立即发送队列中剩余的变化并停止调度线程（可重复调用）；没有发送失败和丢弃时返回true
+    bool close();
+
+    Stats stats();
+    void printStats(std::ostream& out);
+
+    // 合并后的摘要，如 "37 hosts down in 10.2.0.0/16; web (10.0.0.1) up"
+    static std::string summarize(const std::vector<AlertEvent>& batch);
+    // 通知内容：{"summary":..,"down":[{"ip":..,"hostname":..,"timestamp":..}],"up":[..]}
+    static std::string formatMessage(const std::vector<AlertEvent>& batch, const std::string& summary);
+};
+
+#endif // ALERT_NOTIFIER_H
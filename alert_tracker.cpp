@@ -0,0 +1,79 @@
+#include "alert_tracker.h"
+#include <algorithm>
+#include <bit>
+
+AlertTracker::AlertTracker(const AlertPolicy& policy) {
+    setPolicy(policy);
+}
+
+void AlertTracker::setPolicy(const AlertPolicy& newPolicy) {
+    policy = newPolicy;
+    policy.failuresToAlert = std::max(policy.failuresToAlert, 1);
+    policy.successesToRecover = std::max(policy.successesToRecover, 1);
+    policy.flapWindow = std::clamp(policy.flapWindow, 0, MAX_FLAP_WINDOW);
+    windowMask = policy.flapWindow == MAX_FLAP_WINDOW ? ~std::uint64_t{0} : (std::uint64_t{1} << policy.flapWindow) - 1;
+    // 规则改变后已有的计数不再有意义
+    hosts.clear();
+    flappingHosts = 0;
+}
+
+AlertTracker::Transition AlertTracker::observe(const std::string& ip, bool success, bool alerting) {
+    HostState& state = hosts[ip];
+    state.changes = (state.changes << 1) | (state.seen && success != state.lastSuccess ? 1 : 0);
+    state.seen = true;
+    state.lastSuccess = success;
+    if (success) {
+        state.successes += state.successes < UINT32_MAX ? 1 : 0;
+        state.failures = 0;
+    } else {
+        state.failures += state.failures < UINT32_MAX ? 1 : 0;
+        state.successes = 0;
+    }
+
+    // 抖动的进入和退出使用不同的阈值，避免在阈值附近反复切换
+    if (policy.flapWindow > 0) {
+        int changes = std::popcount(state.changes & windowMask);
+        if (!state.flapping && changes >= policy.flapThreshold) {
+            state.flapping = true;
+            flappingHosts++;
+        } else if (state.flapping && changes * 2 < policy.flapThreshold) {
+            state.flapping = false;
+            flappingHosts--;
+        }
+    }
+    if (state.flapping) {
+        return Transition::NONE;
+    }
+
+    if (!alerting && state.failures >= static_cast<std::uint32_t>(policy.failuresToAlert)) {
+        return Transition::RAISE;
+    }
+    if (alerting && state.successes >= static_cast<std::uint32_t>(policy.successesToRecover)) {
+        return Transition::CLEAR;
+    }
+    return Transition::NONE;
+}
+
+bool AlertTracker::isFlapping(const std::string& ip) const {
+    auto it = hosts.find(ip);
+    return it != hosts.end() && it->second.flapping;
+}
+
+std::string formatAlertKey(std::string_view createdTime, std::string_view ip) {
+    std::string key(createdTime);
+    std::replace(key.begin(), key.end(), ' ', 'T');
+    key += ',';
+    key += ip;
+    return key;
+}
+
+bool parseAlertKey(std::string_view key, std::string& createdTime, std::string& ip) {
+    std::size_t separator = key.find(',');
+    if (separator == std::string_view::npos || separator == 0 || separator + 1 == key.size()) {
+        return false;
+    }
+    createdTime = key.substr(0, separator);
+    ip = key.substr(separator + 1);
+    std::replace(createdTime.begin(), createdTime.end(), 'T', ' ');
+    return true;
+}
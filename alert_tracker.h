@@ -0,0 +1,81 @@
+#ifndef ALERT_TRACKER_H
+#define ALERT_TRACKER_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <cstddef>
+
+// 告警的确认规则：默认与原来的规则相同（一次失败产生告警，一次成功解除告警），不检测抖动
+struct AlertPolicy {
+    int failuresToAlert = 1;     // 连续失败多少轮后产生告警
+    int successesToRecover = 1;  // 连续成功多少轮后解除告警
+    int flapWindow = 0;          // 抖动检测统计的最近轮数（最多64），0表示不检测抖动
+    int flapThreshold = 5;       // 窗口内结果改变达到该次数时主机进入抖动状态，降到一半以下时退出
+
+    bool isDefault() const {
+        return failuresToAlert == 1 && successesToRecover == 1 && flapWindow == 0;
+    }
+};
+
+// 一次确认的告警变化，用于通知
+struct AlertEvent {
+    bool down;              // true为产生告警，false为解除告警
+    std::string ip;
+    std::string hostname;
+    std::string timestamp;  // 确认变化的那一轮结果的时间戳
+};
+
+// 常驻模式中确认后处于告警中的主机，随每轮结果交给各存储目标；目标按它同步自己的告警表，
+// 不再各自判断，因此丢弃的轮次或回滚的写入在下一轮写入时即可补齐
+using AlertingHosts = std::unordered_set<std::string>;
+
+// -a的分页键：上一页最后一条告警的 (创建时间, IP)，文本形式为 "<日期>T<时间>,<IP>"，不含空白，
+// 可以直接作为--after参数和查询套接字的after=参数；该告警已解除后下一页仍从同一位置继续
+std::string formatAlertKey(std::string_view createdTime, std::string_view ip);
+// 解析分页键，把创建时间还原为 "<日期> <时间>"；格式错误时返回false
+bool parseAlertKey(std::string_view key, std::string& createdTime, std::string& ip);
+
+// 每台主机的告警状态机：记录连续失败和连续成功的轮数，以及最近flapWindow轮中结果改变的位图
+// 只有达到阈值的状态变化才产生告警或解除告警；主机处于抖动状态时保持当前的告警状态不变，
+// 抖动结束后按连续轮数重新判断
+// 告警是否已经存在由调用者提供（数据库或内存中的告警表），事务回滚重新加载告警后不需要同步本对象
+// 计数只保存在内存中，进程重启后从零开始
+class AlertTracker {
+public:
+    enum class Transition { NONE, RAISE, CLEAR };
+
+    static constexpr int MAX_FLAP_WINDOW = 64;
+
+private:
+    struct HostState {
+        std::uint64_t changes = 0;  // 每轮结果是否与上一轮不同，最低位为最近一轮
+        std::uint32_t failures = 0;
+        std::uint32_t successes = 0;
+        bool seen = false;
+        bool lastSuccess = false;
+        bool flapping = false;
+    };
+
+    AlertPolicy policy;
+    std::uint64_t windowMask = 0;
+    std::unordered_map<std::string, HostState> hosts;
+    std::size_t flappingHosts = 0;
+
+public:
+    explicit AlertTracker(const AlertPolicy& policy = {});
+
+    // 设置规则并清除全部主机的计数
+    void setPolicy(const AlertPolicy& newPolicy);
+    const AlertPolicy& getPolicy() const { return policy; }
+
+    // 记录一台主机本轮的结果，alerting为该主机当前是否有活动告警；返回需要写入的告警变化
+    Transition observe(const std::string& ip, bool success, bool alerting);
+
+    bool isFlapping(const std::string& ip) const;
+    std::size_t flappingCount() const { return flappingHosts; }
+};
+
+#endif // ALERT_TRACKER_H
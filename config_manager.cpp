@@ -4,6 +4,48 @@
 #include <print>
 #include <unistd.h>
 #include <stdexcept>
+#include <regex>
+
+// 仅提供长选项形式的参数
+enum LongOnlyOption {
+    OPT_PARTITION = 1000,
+    OPT_DB_STATS,
+    OPT_SINCE,
+    OPT_UNTIL,
+    OPT_TIER,
+    OPT_STORE,
+    OPT_RING_LOG,
+    OPT_RING_CAPACITY,
+    OPT_MIGRATE,
+    OPT_POOL_SIZE,
+    OPT_SINK,
+    OPT_LIMIT,
+    OPT_AFTER,
+    OPT_EXPORT,
+    OPT_EXPORT_FILE,
+    OPT_HOSTS,
+    OPT_EXPORT_JOBS,
+    OPT_IMPORT,
+    OPT_HISTORY_DEPTH,
+    OPT_SERVE,
+    OPT_INTERVAL,
+    OPT_SOCKET,
+    OPT_HTTP,
+    OPT_OUTPUT,
+    OPT_ALERT_AFTER,
+    OPT_RECOVER_AFTER,
+    OPT_FLAP_WINDOW,
+    OPT_FLAP_THRESHOLD,
+    OPT_NOTIFY,
+    OPT_NOTIFY_WINDOW,
+    OPT_CHUNK_FLUSH,
+};
+
+// 时间范围参数：YYYY-MM-DD 或 YYYY-MM-DD HH:MM[:SS]，与数据库中时间戳的文本格式一致，可直接按字符串比较
+static bool isValidTimeBound(const std::string& value) {
+    static const std::regex pattern(R"(\d{4}-\d{2}-\d{2}( \d{2}:\d{2}(:\d{2})?)?)");
+    return std::regex_match(value, pattern);
+}
 
 ConfigManager::ConfigManager() {}
 
@@ -27,8 +69,39 @@ bool ConfigManager::parseArguments(int argc, char* argv[]) {
         {"count", required_argument, nullptr, 'n'},
         {"timeout", required_argument, nullptr, 't'},
         {"version", no_argument, nullptr, 'v'},
+        {"partition", required_argument, nullptr, OPT_PARTITION},
+        {"db-stats", no_argument, nullptr, OPT_DB_STATS},
+        {"since", required_argument, nullptr, OPT_SINCE},
+        {"until", required_argument, nullptr, OPT_UNTIL},
+        {"tier", required_argument, nullptr, OPT_TIER},
+        {"store", required_argument, nullptr, OPT_STORE},
+        {"chunk-flush", required_argument, nullptr, OPT_CHUNK_FLUSH},
+        {"ring-log", no_argument, nullptr, OPT_RING_LOG},
+        {"ring-capacity", required_argument, nullptr, OPT_RING_CAPACITY},
+        {"sink", required_argument, nullptr, OPT_SINK},
+        {"limit", required_argument, nullptr, OPT_LIMIT},
+        {"after", required_argument, nullptr, OPT_AFTER},
+        {"export", required_argument, nullptr, OPT_EXPORT},
+        {"export-file", required_argument, nullptr, OPT_EXPORT_FILE},
+        {"hosts", required_argument, nullptr, OPT_HOSTS},
+        {"export-jobs", required_argument, nullptr, OPT_EXPORT_JOBS},
+        {"import", required_argument, nullptr, OPT_IMPORT},
+        {"history-depth", required_argument, nullptr, OPT_HISTORY_DEPTH},
+        {"serve", no_argument, nullptr, OPT_SERVE},
+        {"interval", required_argument, nullptr, OPT_INTERVAL},
+        {"socket", required_argument, nullptr, OPT_SOCKET},
+        {"http", required_argument, nullptr, OPT_HTTP},
+        {"output", required_argument, nullptr, OPT_OUTPUT},
+        {"alert-after", required_argument, nullptr, OPT_ALERT_AFTER},
+        {"recover-after", required_argument, nullptr, OPT_RECOVER_AFTER},
+        {"flap-window", required_argument, nullptr, OPT_FLAP_WINDOW},
+        {"flap-threshold", required_argument, nullptr, OPT_FLAP_THRESHOLD},
+        {"notify", required_argument, nullptr, OPT_NOTIFY},
+        {"notify-window", required_argument, nullptr, OPT_NOTIFY_WINDOW},
 #ifdef USE_POSTGRESQL
         {"postgresql", no_argument, nullptr, 'P'},
+        {"migrate", no_argument, nullptr, OPT_MIGRATE},
+        {"pool-size", required_argument, nullptr, OPT_POOL_SIZE},
 #endif
         {nullptr, 0, nullptr, 0}
     };
@@ -117,10 +190,267 @@ bool ConfigManager::parseArguments(int argc, char* argv[]) {
                     return false;
                 }
                 break;
+            case OPT_PARTITION:
+                config.partitionPeriod = optarg;
+                if (config.partitionPeriod != "day" && config.partitionPeriod != "week") {
+                    std::println(std::cerr, "Partition period must be 'day' or 'week'.");
+                    return false;
+                }
+                break;
+            case OPT_DB_STATS:
+                config.showDatabaseStats = true;
+                break;
+            case OPT_SINCE:
+                if (!isValidTimeBound(optarg)) {
+                    std::println(std::cerr, "Invalid value for since: {} (expected YYYY-MM-DD or YYYY-MM-DD HH:MM:SS)", optarg);
+                    return false;
+                }
+                config.querySince = optarg;
+                break;
+            case OPT_UNTIL:
+                if (!isValidTimeBound(optarg)) {
+                    std::println(std::cerr, "Invalid value for until: {} (expected YYYY-MM-DD or YYYY-MM-DD HH:MM:SS)", optarg);
+                    return false;
+                }
+                config.queryUntil = optarg;
+                break;
+            case OPT_TIER:
+                try {
+                    config.tierDays = std::stoi(optarg);
+                    if (config.tierDays < 0) {
+                        std::println(std::cerr, "Tier days must be a non-negative integer.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for tier: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_STORE:
+                config.sampleStore = optarg;
+                if (config.sampleStore != "rows" && config.sampleStore != "chunked") {
+                    std::println(std::cerr, "Sample store must be 'rows' or 'chunked'.");
+                    return false;
+                }
+                break;
+            case OPT_CHUNK_FLUSH:
+                try {
+                    config.chunkFlush = std::stoi(optarg);
+                    if (config.chunkFlush < 1 || config.chunkFlush > 512) {
+                        std::println(std::cerr, "Chunk flush must be between 1 and 512.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for chunk-flush: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_RING_LOG:
+                config.useRingLog = true;
+                break;
+            case OPT_RING_CAPACITY:
+                try {
+                    config.ringCapacity = std::stoll(optarg);
+                    if (config.ringCapacity <= 0) {
+                        std::println(std::cerr, "Ring capacity must be a positive integer.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for ring-capacity: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_SINK:
+                config.sinks.push_back(optarg);
+                break;
+            case OPT_LIMIT:
+                try {
+                    config.queryLimit = std::stoll(optarg);
+                    if (config.queryLimit <= 0) {
+                        std::println(std::cerr, "Limit must be a positive integer.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for limit: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_AFTER:
+                config.queryAfter = optarg;
+                break;
+            case OPT_EXPORT:
+                config.exportFormat = optarg;
+                if (config.exportFormat != "csv" && config.exportFormat != "arrow") {
+                    std::println(std::cerr, "Export format must be 'csv' or 'arrow'.");
+                    return false;
+                }
+                break;
+            case OPT_EXPORT_FILE:
+                config.exportPath = optarg;
+                break;
+            case OPT_HOSTS: {
+                // 逗号分隔的IP列表
+                std::string hosts = optarg;
+                std::size_t start = 0;
+                while (start <= hosts.size()) {
+                    std::size_t end = hosts.find(',', start);
+                    if (end == std::string::npos) {
+                        end = hosts.size();
+                    }
+                    if (end > start) {
+                        config.exportHosts.push_back(hosts.substr(start, end - start));
+                    }
+                    start = end + 1;
+                }
+                break;
+            }
+            case OPT_EXPORT_JOBS:
+                try {
+                    config.exportJobs = std::stoi(optarg);
+                    if (config.exportJobs < 1 || config.exportJobs > 64) {
+                        std::println(std::cerr, "Export jobs must be between 1 and 64.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for export-jobs: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_IMPORT:
+                config.importPath = optarg;
+                break;
+            case OPT_HISTORY_DEPTH:
+                try {
+                    config.historyDepth = std::stoi(optarg);
+                    if (config.historyDepth < 1 || config.historyDepth > 65536) {
+                        std::println(std::cerr, "History depth must be between 1 and 65536.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for history-depth: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_OUTPUT:
+                config.outputFormat = optarg;
+                if (config.outputFormat != "text" && config.outputFormat != "tsv" &&
+                    config.outputFormat != "csv" && config.outputFormat != "jsonl") {
+                    std::println(std::cerr, "Output format must be 'text', 'tsv', 'csv' or 'jsonl'.");
+                    return false;
+                }
+                break;
+            case OPT_SERVE:
+                config.serve = true;
+                break;
+            case OPT_INTERVAL:
+                try {
+                    config.serveInterval = std::stoi(optarg);
+                    if (config.serveInterval <= 0) {
+                        std::println(std::cerr, "Interval must be a positive integer.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for interval: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_SOCKET:
+                config.socketPath = optarg;
+                break;
+            case OPT_HTTP:
+                try {
+                    config.httpPort = std::stoi(optarg);
+                    if (config.httpPort < 1 || config.httpPort > 65535) {
+                        std::println(std::cerr, "HTTP port must be between 1 and 65535.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for http: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_ALERT_AFTER:
+                try {
+                    config.alertAfter = std::stoi(optarg);
+                    if (config.alertAfter < 1) {
+                        std::println(std::cerr, "Alert-after must be a positive integer.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for alert-after: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_RECOVER_AFTER:
+                try {
+                    config.recoverAfter = std::stoi(optarg);
+                    if (config.recoverAfter < 1) {
+                        std::println(std::cerr, "Recover-after must be a positive integer.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for recover-after: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_FLAP_WINDOW:
+                try {
+                    config.flapWindow = std::stoi(optarg);
+                    if (config.flapWindow < 0 || config.flapWindow > 64) {
+                        std::println(std::cerr, "Flap window must be between 0 and 64.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for flap-window: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_FLAP_THRESHOLD:
+                try {
+                    config.flapThreshold = std::stoi(optarg);
+                    if (config.flapThreshold < 2) {
+                        std::println(std::cerr, "Flap threshold must be at least 2.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for flap-threshold: {}", optarg);
+                    return false;
+                }
+                break;
+            case OPT_NOTIFY:
+                config.notifyTargets.push_back(optarg);
+                break;
+            case OPT_NOTIFY_WINDOW:
+                try {
+                    config.notifyWindow = std::stoi(optarg);
+                    if (config.notifyWindow < 0) {
+                        std::println(std::cerr, "Notify window must be a non-negative integer.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for notify-window: {}", optarg);
+                    return false;
+                }
+                break;
 #ifdef USE_POSTGRESQL
             case 'P':
                 config.usePostgreSQL = true;
                 break;
+            case OPT_MIGRATE:
+                config.migrateLegacyTables = true;
+                break;
+            case OPT_POOL_SIZE:
+                try {
+                    config.poolSize = std::stoi(optarg);
+                    if (config.poolSize < 1 || config.poolSize > 64) {
+                        std::println(std::cerr, "Pool size must be between 1 and 64.");
+                        return false;
+                    }
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for pool-size: {}", optarg);
+                    return false;
+                }
+                break;
 #endif
             default:
                 std::println(std::cerr, "Invalid option. Use -h or --help for usage information.");
@@ -129,6 +459,51 @@ bool ConfigManager::parseArguments(int argc, char* argv[]) {
     }
 
     
+    if (config.httpPort > 0 && !config.serve) {
+        std::println(std::cerr, "--http requires --serve.");
+        return false;
+    }
+    // 连续轮数只在一个进程内累计，单次运行只有一轮，达不到大于1的阈值
+    if ((config.alertAfter > 1 || config.recoverAfter > 1 || config.flapWindow > 0) && !config.serve) {
+        std::println(std::cerr, "--alert-after, --recover-after and --flap-window require --serve.");
+        return false;
+    }
+    // 告警变化由存储目标中的告警状态判断
+    if (!config.notifyTargets.empty() && !config.enableDatabase && config.sinks.empty()) {
+        std::println(std::cerr, "--notify requires a database (-d) or a sink (--sink).");
+        return false;
+    }
+    // 数据块只有在一次写入多个样本时才比逐行写入省：单次运行每台主机只有一个样本，
+    // 需要读取并重写数据块，比rows布局更慢；常驻模式按--chunk-flush累积，批量导入按小时累积
+    if (config.sampleStore == "chunked" && !config.serve && config.importPath.empty()) {
+        std::println(std::cerr, "--store chunked requires --serve or --import.");
+        return false;
+    }
+    // 内存尾部只在常驻进程中跨轮保留，单次运行退出时总会写入
+    if (config.chunkFlush > 1 && !config.serve) {
+        std::println(std::cerr, "--chunk-flush requires --serve.");
+        return false;
+    }
+    if (config.flapWindow > 0 && config.flapThreshold > config.flapWindow) {
+        std::println(std::cerr, "Flap threshold cannot exceed the flap window.");
+        return false;
+    }
+    
+#ifdef USE_POSTGRESQL
+    if (config.useRingLog && config.usePostgreSQL) {
+        std::println(std::cerr, "--ring-log and --postgresql cannot be used together.");
+        return false;
+    }
+    if (config.migrateLegacyTables && !config.usePostgreSQL) {
+        std::println(std::cerr, "--migrate requires --postgresql.");
+        return false;
+    }
+    if (config.poolSize > 1 && !config.usePostgreSQL) {
+        std::println(std::cerr, "--pool-size requires --postgresql.");
+        return false;
+    }
+#endif
+    
     // 如果还有剩余的参数，将其视为文件名
     if (optind < argc) {
         config.filename = argv[optind];
@@ -153,10 +528,45 @@ void ConfigManager::printUsage(const char* programName) {
     std::println(std::cout, "  -r, --recovery [n]\tQuery recovery records (requires -d, n: days, default: all)");
     std::println(std::cout, "  -C, --cleanup [n]\tClean up data older than n days (requires -d, default: 30)");
     std::println(std::cout, "  -s, --silent\t\tSilent mode, suppress output");
+    std::println(std::cout, "  --output <f>\t\tStream each result as it completes (f: text|tsv|csv|jsonl, default: text)");
     std::println(std::cout, "  -n, --count <n>\tNumber of ping packets to send (default: 3)");
     std::println(std::cout, "  -t, --timeout <n>\tTimeout for each ping in seconds (default: 3)");
+    std::println(std::cout, "  --limit <n>\t\tShow at most n rows of -a/-r output");
+    std::println(std::cout, "  --after <key>\t\tContinue -a/-r output after this key (alerts) or record ID (recovery)");
+    std::println(std::cout, "  --db-stats\t\tShow database size, free-list and fragmentation statistics (requires -d)");
+    std::println(std::cout, "  --since <time>\tOnly count samples at or after this time in -q statistics or --export");
+    std::println(std::cout, "  --until <time>\tOnly count samples before this time in -q statistics or --export");
+    std::println(std::cout, "  --export <f>\t\tExport all samples to a file (requires -d, f: csv|arrow)");
+    std::println(std::cout, "  --export-file <path>\tExport file path, - for standard output (default: ping_export.<f>)");
+    std::println(std::cout, "  --hosts <ip,...>\tOnly export these hosts (default: all hosts)");
+    std::println(std::cout, "  --export-jobs <n>\tRead samples with n threads in parallel (default: 4)");
+    std::println(std::cout, "  --import <file>\tBulk-load samples from a CSV or Arrow file (requires -d)");
+    std::println(std::cout, "  --history-depth <n>\tRecent results kept in memory per host by --serve (default: 1024)");
+    std::println(std::cout, "  --serve\t\tKeep running: ping every --interval seconds and answer queries from memory");
+    std::println(std::cout, "  --interval <n>\tSeconds between the starts of two --serve cycles (default: 60)");
+    std::println(std::cout, "  --socket <path>\tQuery socket of --serve, also used by -q/-a (default: <database>.sock)");
+    std::println(std::cout, "  --http <port>\t\tAlso answer --serve queries over HTTP on 127.0.0.1:<port>");
+    std::println(std::cout, "  --alert-after <n>\tRaise an alert after n consecutive failed cycles (--serve, default: 1)");
+    std::println(std::cout, "  --recover-after <n>\tClear an alert after n consecutive successful cycles (--serve, default: 1)");
+    std::println(std::cout, "  --flap-window <n>\tCycles examined for flapping, 0 disables (--serve, max 64, default: 0)");
+    std::println(std::cout, "  --flap-threshold <n>\tResult changes within the window that mark a host as flapping (default: 5)");
+    std::println(std::cout, "  --notify <type:target>\tSend alert changes to a notification target, repeatable (type: webhook|exec|unix)");
+    std::println(std::cout, "  --notify-window <n>\tSeconds to collect alert changes into one notification (default: 5)");
+    std::println(std::cout, "  --tier <n>\t\tMove samples older than n days into compressed segment files (requires -d)");
+    std::println(std::cout, "  --partition <p>\tStore SQLite samples in one file per day or week (p: day|week)");
+    std::println(std::cout, "  --store <s>\t\tSQLite sample layout: one row per sample or packed hourly chunks (s: rows|chunked, chunked requires --serve or --import)");
+    std::println(std::cout, "  --chunk-flush <n>\tWrite chunked samples after n cycles per host, kept in memory until then (--serve, default: 1)");
+    std::println(std::cout, "  --ring-log\t\tUse the append-only ring log backend (-d is the log file path)");
+    std::println(std::cout, "  --ring-capacity <n>\tNumber of samples kept by a newly created ring log (default: 1048576)");
+#ifdef USE_POSTGRESQL
+    std::println(std::cout, "  --sink <type:target>\tAlso write each cycle to another store, repeatable (type: sqlite|ring|postgresql)");
+#else
+    std::println(std::cout, "  --sink <type:target>\tAlso write each cycle to another store, repeatable (type: sqlite|ring)");
+#endif
 #ifdef USE_POSTGRESQL
     std::println(std::cout, "  -P, --postgresql\tUse PostgreSQL database (requires -d with connection string)");
+    std::println(std::cout, "  --pool-size <n>\tWrite PostgreSQL samples over n connections in parallel, sharded by host (default: 1)");
+    std::println(std::cout, "  --migrate\t\tMove legacy per-IP ping_* tables into the partitioned samples table (requires -P)");
 #endif
     std::println(std::cout, "Default behavior: If no file specified and database enabled, read hosts from database. Otherwise, read from ip.txt.");
     std::println(std::cout, "Default filename: ip.txt");
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <getopt.h>
 #include "project_info.h"
 
@@ -13,14 +14,45 @@ public:
         bool enableDatabase = false;
         std::string databasePath = "ping_monitor.db";
         bool silentMode = false;
+        std::string outputFormat = "";  // 结果输出格式：text、tsv、csv或jsonl，空表示text（静默模式下不输出）
         std::string queryIP = "";
         int cleanupDays = -1;  // -1表示不执行清理
+        int tierDays = -1;  // -1表示不执行冷数据分层，>=0表示把早于指定天数的样本移入段文件
         int queryAlerts = -1;  // -1表示不查询告警，>=0表示查询指定天数内的告警
         int queryRecoveryRecords = -1;  // -1表示不查询恢复记录，>=0表示查询指定天数内的恢复记录
         int pingCount = 3;  // 默认发送3个包
         int timeoutSeconds = 3;  // 默认超时时间（秒）
+        bool showDatabaseStats = false;  // 显示数据库空间与碎片统计
+        std::string partitionPeriod = "";  // SQLite样本分区周期：day或week，空表示沿用数据库中已保存的设置
+        std::string sampleStore = "";  // SQLite样本布局：rows或chunked，空表示沿用数据库中已保存的设置
+        int chunkFlush = 1;  // chunked布局下每台主机在内存中累积多少个样本后写入数据块
+        bool useRingLog = false;  // 使用环形日志存储后端（-d指定日志文件路径）
+        long long ringCapacity = 0;  // 新建环形日志文件时的样本容量，0表示默认值
+        std::string querySince = "";  // 统计查询的起始时间（包含），空表示不限
+        std::string queryUntil = "";  // 统计查询的结束时间（不包含），空表示不限
+        long long queryLimit = -1;  // -a/-r每页最多输出的行数，-1表示不限
+        std::string queryAfter = "";  // -a/-r从该键之后继续输出（告警为"<创建时间>,<IP>"，恢复记录为ID）
+        std::vector<std::string> sinks;  // 额外的存储目标（类型:参数），与-d指定的数据库同时写入
+        std::string exportFormat = "";  // 导出样本的格式：csv或arrow，空表示不导出
+        std::string exportPath = "";  // 导出文件路径，空表示ping_export.<格式>，-表示标准输出
+        std::vector<std::string> exportHosts;  // 只导出这些主机，空表示全部主机
+        int exportJobs = 4;  // 并行读取样本的线程数
+        std::string importPath = "";  // 批量导入的CSV或Arrow文件，空表示不导入
+        int historyDepth = 1024;  // 每台主机在内存中保留的最近结果个数
+        bool serve = false;  // 常驻模式：按间隔持续探测，并通过套接字回答查询
+        int serveInterval = 60;  // 常驻模式两轮探测开始之间的秒数
+        std::string socketPath = "";  // 查询套接字路径，空表示 <数据库路径>.sock
+        int httpPort = 0;  // 常驻模式同时在127.0.0.1的该端口上提供HTTP查询，0表示不启用
+        int alertAfter = 1;  // 连续失败多少轮后产生告警
+        int recoverAfter = 1;  // 连续成功多少轮后解除告警
+        int flapWindow = 0;  // 抖动检测统计的最近轮数，0表示不检测
+        int flapThreshold = 5;  // 窗口内结果改变达到该次数时视为抖动，抖动期间不改变告警状态
+        std::vector<std::string> notifyTargets;  // 告警通知目标，每项为"类型:参数"（webhook、exec或unix）
+        int notifyWindow = 5;  // 合并告警通知的秒数
 #ifdef USE_POSTGRESQL
         bool usePostgreSQL = false;  // 是否使用PostgreSQL数据库
+        bool migrateLegacyTables = false;  // 把旧版ping_*表迁移到分区表samples
+        int poolSize = 1;  // PostgreSQL写入连接池大小，1表示只使用一个连接
 #endif
     };
 
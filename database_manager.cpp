@@ -9,8 +9,13 @@
 #include <map>
 #include <regex>
 #include <stdexcept>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <optional>
+#include <limits>
 
-DatabaseManager::DatabaseManager(const std::string& path) : dbPath(path), db(nullptr) {
+DatabaseManager::DatabaseManager(const std::string& path) : dbPath(path), db(nullptr), segmentStore(path + ".segments") {
     if (path.empty()) {
         throw std::invalid_argument("Database path cannot be empty");
     }
@@ -18,6 +23,10 @@ DatabaseManager::DatabaseManager(const std::string& path) : dbPath(path), db(nul
 
 DatabaseManager::~DatabaseManager() {
     if (db) {
+        // 写入尚在内存尾部的样本
+        if (!chunkTail.empty()) {
+            flushChunkTail();
+        }
         sqlite3_close(db);
     }
 }
@@ -36,6 +45,105 @@ bool DatabaseManager::isValidIP(const std::string& ip) {
     return std::regex_match(ip, ipPattern);
 }
 
+// 汇总表：表名及其时间桶对应的时间戳前缀长度（YYYY-MM-DD HH:MM / YYYY-MM-DD HH / YYYY-MM-DD）
+static const std::pair<const char*, int> ROLLUP_TABLES[] = {
+    {"rollup_minute", 16},
+    {"rollup_hour", 13},
+    {"rollup_day", 10},
+};
+
+// 小时汇总的保留时间是原始数据保留天数的倍数，天汇总永久保留
+static const int ROLLUP_HOUR_RETENTION_FACTOR = 12;
+
+// 汇总表的累加规则：计数和求和直接相加，最小/最大延迟只统计成功的ping（NULL表示没有成功样本）
+static const char* ROLLUP_UPSERT_CLAUSE = R"(
+    ON CONFLICT(ip, bucket) DO UPDATE SET
+        count = count + excluded.count,
+        successes = successes + excluded.successes,
+        rtt_sum = rtt_sum + excluded.rtt_sum,
+        rtt_min = MIN(COALESCE(rtt_min, excluded.rtt_min), COALESCE(excluded.rtt_min, rtt_min)),
+        rtt_max = MAX(COALESCE(rtt_max, excluded.rtt_max), COALESCE(excluded.rtt_max, rtt_max));
+)";
+
+// 数据块：每个样本固定4字节（小时内的秒偏移12位、成功标志1位、延迟16位），按小端序存放，每块最多CHUNK_CAPACITY个样本
+static const std::size_t CHUNK_CAPACITY = 512;
+static const std::size_t CHUNK_SAMPLE_BYTES = 4;
+
+static std::uint32_t packChunkSample(std::int64_t offset, bool success, short delay) {
+    return static_cast<std::uint32_t>(offset & 0xfff) | (success ? 1u << 12 : 0u) |
+           (static_cast<std::uint32_t>(static_cast<std::uint16_t>(delay)) << 16);
+}
+
+static SegmentStore::Sample unpackChunkSample(std::int64_t bucketStart, const unsigned char* bytes) {
+    std::uint32_t packed = static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8) |
+                           (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+    return {bucketStart + (packed & 0xfff), static_cast<short>(static_cast<std::uint16_t>(packed >> 16)), ((packed >> 12) & 1) != 0};
+}
+
+// 把写入数据块的打包样本还原为结果元组，供汇总表累加；主机名不参与汇总，留空
+static void expandChunkSamples(const std::string& ip, const std::string& bucket, const std::vector<std::uint32_t>& packed,
+                               std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& samples) {
+    for (std::uint32_t value : packed) {
+        unsigned offset = value & 0xfff;
+        char minuteSecond[8];
+        std::snprintf(minuteSecond, sizeof(minuteSecond), ":%02u:%02u", offset / 60, offset % 60);
+        samples.emplace_back(ip, "", static_cast<short>(static_cast<std::uint16_t>(value >> 16)), ((value >> 12) & 1) != 0,
+                             bucket + minuteSecond);
+    }
+}
+
+// 清理结束时一次最多回收的空闲页数，其余的交给后续ping周期增量回收
+static const int CLEANUP_VACUUM_PAGES = 1024;
+
+// 数据库模式版本，保存在主数据库和每个分区文件的PRAGMA user_version中
+// 版本一致时initialize跳过全部建表语句；修改建表语句或样本表索引时递增
+static const int SCHEMA_VERSION = 2;
+
+// 解析时间戳（YYYY-MM-DD HH:MM:SS）中的日期部分
+static std::optional<std::chrono::sys_days> parseTimestampDate(const std::string& timestamp) {
+    int year = 0;
+    unsigned month = 0, day = 0;
+    if (std::sscanf(timestamp.c_str(), "%d-%u-%u", &year, &month, &day) != 3) {
+        return std::nullopt;
+    }
+    std::chrono::year_month_day ymd{std::chrono::year{year}, std::chrono::month{month}, std::chrono::day{day}};
+    if (!ymd.ok()) {
+        return std::nullopt;
+    }
+    return std::chrono::sys_days{ymd};
+}
+
+// 格式化日期，separator为空时生成YYYYMMDD
+static std::string formatDate(std::chrono::sys_days date, const char* separator) {
+    std::chrono::year_month_day ymd{date};
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04d%s%02u%s%02u", int(ymd.year()), separator,
+                  unsigned(ymd.month()), separator, unsigned(ymd.day()));
+    return buffer;
+}
+
+// 本地时间的当前日期（样本时间戳使用本地时间）
+static std::chrono::sys_days localToday() {
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    return std::chrono::sys_days{std::chrono::year{local.tm_year + 1900} / (local.tm_mon + 1) / local.tm_mday};
+}
+
+// 根据分区周期计算某一天所属分区的信息，分区文件名形如day-2024-01-01.db或week-2024-01-01.db
+static DatabaseManager::Partition makePartition(const std::string& directory, const std::string& period, std::chrono::sys_days date) {
+    DatabaseManager::Partition partition;
+    partition.start = date;
+    partition.end = date + std::chrono::days{1};
+    if (period == "week") {
+        // 周分区从周一开始
+        partition.start = date - (std::chrono::weekday{date} - std::chrono::Monday);
+        partition.end = partition.start + std::chrono::days{7};
+    }
+    partition.path = directory + "/" + period + "-" + formatDate(partition.start, "-") + ".db";
+    partition.schema = "p_" + period + "_" + formatDate(partition.start, "");
+    return partition;
+}
+
 bool DatabaseManager::initialize() {
     int rc = sqlite3_open(dbPath.c_str(), &db);
     if (rc) {
@@ -54,6 +162,46 @@ bool DatabaseManager::initialize() {
         return false;
     }
     
+    // 导出时多个连接并行读取，与写入进程同时访问时遇到锁先等待而不是立即失败
+    sqlite3_busy_timeout(db, 5000);
+    
+    // 模式版本与当前版本一致时跳过全部建表语句，只在新数据库或升级时执行一次
+    if (queryPragma("user_version") < SCHEMA_VERSION) {
+        if (!createSchema()) {
+            return false;
+        }
+    }
+    
+    // 读取已保存的分区周期和样本布局
+    sqlite3_stmt* settingStmt;
+    rc = sqlite3_prepare_v2(db, "SELECT key, value FROM settings WHERE key IN ('partition_period', 'sample_store');", -1, &settingStmt, 0);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare settings query statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    while (sqlite3_step(settingStmt) == SQLITE_ROW) {
+        std::string key = (const char*)sqlite3_column_text(settingStmt, 0);
+        const char* value = (const char*)sqlite3_column_text(settingStmt, 1);
+        if (key == "partition_period") {
+            partitionPeriod = value ? value : "";
+        } else if (value) {
+            sampleStore = value;
+        }
+    }
+    sqlite3_finalize(settingStmt);
+    
+    // 已存在的样本表无需在每轮写入时重复建表
+    loadProvisionedTables("main");
+    
+    return true;
+}
+
+// 创建主数据库中的全部表，升级已有的样本表索引，最后记录模式版本
+bool DatabaseManager::createSchema() {
+    int rc;
+    // 新数据库启用增量auto_vacuum（只在创建第一张表之前生效，已有数据库在执行-C清理时转换）
+    sqlite3_exec(db, "PRAGMA auto_vacuum = INCREMENTAL;", 0, 0, 0);
+    
     // 创建hosts表，用于存储IP地址与主机名的映射关系
     const char* createHostsTableSQL = R"(
         CREATE TABLE IF NOT EXISTS hosts (
@@ -96,39 +244,781 @@ bool DatabaseManager::initialize() {
         } else {
             errorMsg += "Unknown error";
         }
-        std::println(std::cerr, "{}", errorMsg);
-        return false;
+        std::println(std::cerr, "{}", errorMsg);
+        return false;
+    }
+    
+    // 创建recovery_records表，用于存储已恢复主机的记录
+    const char* createRecoveryTableSQL = R"(
+        CREATE TABLE IF NOT EXISTS recovery_records (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            ip TEXT,
+            hostname TEXT,
+            alert_time TEXT,
+            recovery_time TEXT DEFAULT CURRENT_TIMESTAMP
+        );
+    )";
+    
+    rc = sqlite3_exec(db, createRecoveryTableSQL, 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::string errorMsg = "SQL error creating recovery_records table: ";
+        if (errMsg) {
+            errorMsg += errMsg;
+            sqlite3_free(errMsg);
+        } else {
+            errorMsg += "Unknown error";
+        }
+        std::cerr << errorMsg << std::endl;
+        return false;
+    }
+    
+    // 告警和恢复记录的时间索引：按天数过滤时走索引范围扫描，游标查询直接按索引顺序读取
+    // recovery_records的id是rowid，已隐含在索引中
+    const char* createTimeIndexesSQL = R"(
+        CREATE INDEX IF NOT EXISTS idx_alerts_created ON alerts (created_time, ip);
+        CREATE INDEX IF NOT EXISTS idx_recovery_records_time ON recovery_records (recovery_time);
+    )";
+    
+    rc = sqlite3_exec(db, createTimeIndexesSQL, 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "SQL error creating alert time indexes: " << (errMsg ? errMsg : "Unknown error") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    
+    // 创建settings表，用于保存样本分区周期等持久化设置
+    const char* createSettingsTableSQL = R"(
+        CREATE TABLE IF NOT EXISTS settings (
+            key TEXT PRIMARY KEY,
+            value TEXT
+        );
+    )";
+    
+    rc = sqlite3_exec(db, createSettingsTableSQL, 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "SQL error creating settings table: " << (errMsg ? errMsg : "Unknown error") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    
+    // 创建sample_chunks表：chunked布局下每行保存一台主机一小时内的一段打包样本
+    const char* createChunksTableSQL = R"(
+        CREATE TABLE IF NOT EXISTS sample_chunks (
+            id INTEGER PRIMARY KEY,
+            ip TEXT NOT NULL,
+            bucket TEXT NOT NULL,
+            seq INTEGER NOT NULL,
+            count INTEGER NOT NULL,
+            data BLOB NOT NULL,
+            UNIQUE (ip, bucket, seq)
+        );
+    )";
+    
+    rc = sqlite3_exec(db, createChunksTableSQL, 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "SQL error creating sample_chunks table: " << (errMsg ? errMsg : "Unknown error") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    
+    // 创建分钟、小时、天三级汇总表
+    if (!createRollupTables()) {
+        return false;
+    }
+    
+    return upgradeSampleTables("main");
+}
+
+void DatabaseManager::SampleStatistics::merge(long long count, long long successCount, double sum, int maxValue, int minValue) {
+    total += count;
+    delaySum += sum;
+    if (successCount > 0) {
+        maxDelay = (successes == 0) ? maxValue : std::max(maxDelay, maxValue);
+        minDelay = (successes == 0) ? minValue : std::min(minDelay, minValue);
+    }
+    successes += successCount;
+}
+
+// 创建汇总表；首次创建时用已有的原始数据回填小时和天汇总
+bool DatabaseManager::createRollupTables() {
+    bool needsBackfill = !tableExists("main", "rollup_day");
+    
+    for (const auto& [rollupTable, prefixLength] : ROLLUP_TABLES) {
+        std::ostringstream createSQLStream;
+        createSQLStream << "CREATE TABLE IF NOT EXISTS " << rollupTable << " ("
+                        << "ip TEXT,"
+                        << "bucket TEXT,"
+                        << "count INTEGER,"
+                        << "successes INTEGER,"
+                        << "rtt_sum INTEGER,"
+                        << "rtt_min INTEGER,"
+                        << "rtt_max INTEGER,"
+                        << "PRIMARY KEY (ip, bucket)"
+                        << ") WITHOUT ROWID;"
+                        << "CREATE INDEX IF NOT EXISTS idx_" << rollupTable << "_bucket ON " << rollupTable << " (bucket);";
+        
+        char* errMsg = 0;
+        int rc = sqlite3_exec(db, createSQLStream.str().c_str(), 0, 0, &errMsg);
+        if (rc != SQLITE_OK) {
+            std::cerr << "SQL error creating " << rollupTable << " table: " << (errMsg ? errMsg : "Unknown error") << std::endl;
+            sqlite3_free(errMsg);
+            return false;
+        }
+    }
+    
+    return !needsBackfill || backfillRollups();
+}
+
+// 用已有的原始样本回填小时和天汇总（分钟汇总只从启用后开始维护）
+bool DatabaseManager::backfillRollups() {
+    const char* selectHostsSQL = "SELECT ip FROM hosts;";
+    sqlite3_stmt* hostsStmt;
+    if (sqlite3_prepare_v2(db, selectHostsSQL, -1, &hostsStmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to prepare hosts query statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    std::vector<std::string> hostIPs;
+    while (sqlite3_step(hostsStmt) == SQLITE_ROW) {
+        const char* ip = (const char*)sqlite3_column_text(hostsStmt, 0);
+        if (ip) {
+            hostIPs.push_back(ip);
+        }
+    }
+    sqlite3_finalize(hostsStmt);
+    
+    if (hostIPs.empty()) {
+        return true;
+    }
+    
+    std::cout << "Building rollup tables from existing ping records..." << std::endl;
+    
+    // 回填过程中需要ATTACH分区，因此每个来源单独执行，不放在同一个事务中
+    bool success = true;
+    for (const auto& ip : hostIPs) {
+        std::string tableName = ipToTableName(ip);
+        forEachSampleSource(tableName, [&](const std::string& schema) {
+            for (const auto& [rollupTable, prefixLength] : ROLLUP_TABLES) {
+                if (std::string(rollupTable) == "rollup_minute") {
+                    continue;
+                }
+                std::ostringstream backfillSQLStream;
+                backfillSQLStream << "INSERT INTO " << rollupTable << " (ip, bucket, count, successes, rtt_sum, rtt_min, rtt_max) "
+                                  << "SELECT ?, substr(timestamp, 1, " << prefixLength << "), COUNT(*), SUM(success = 1), "
+                                  << "SUM(CASE WHEN success = 1 THEN delay ELSE 0 END), "
+                                  << "MIN(CASE WHEN success = 1 THEN delay END), "
+                                  << "MAX(CASE WHEN success = 1 THEN delay END) "
+                                  << "FROM " << schema << "." << tableName << " WHERE true GROUP BY 2"
+                                  << ROLLUP_UPSERT_CLAUSE;
+                
+                sqlite3_stmt* stmt;
+                if (sqlite3_prepare_v2(db, backfillSQLStream.str().c_str(), -1, &stmt, 0) != SQLITE_OK) {
+                    std::cerr << "Failed to prepare rollup backfill statement: " << sqlite3_errmsg(db) << std::endl;
+                    success = false;
+                    return false;
+                }
+                sqlite3_bind_text(stmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+                if (sqlite3_step(stmt) != SQLITE_DONE) {
+                    std::cerr << "Failed to backfill rollups for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+                    success = false;
+                }
+                sqlite3_finalize(stmt);
+                if (!success) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        if (!success) {
+            break;
+        }
+    }
+    
+    return success;
+}
+
+// 辅助函数：在写入样本的同一事务中累加分钟、小时、天汇总
+bool DatabaseManager::updateRollups(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    bool success = true;
+    
+    for (const auto& [rollupTable, prefixLength] : ROLLUP_TABLES) {
+        std::ostringstream upsertSQLStream;
+        upsertSQLStream << "INSERT INTO " << rollupTable << " (ip, bucket, count, successes, rtt_sum, rtt_min, rtt_max) "
+                        << "VALUES (?, substr(?, 1, " << prefixLength << "), ?, ?, ?, ?, ?)"
+                        << ROLLUP_UPSERT_CLAUSE;
+        
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, upsertSQLStream.str().c_str(), -1, &stmt, 0) != SQLITE_OK) {
+            std::cerr << "Failed to prepare rollup statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        
+        // 连续落在同一主机同一时间桶的样本先在内存中合并，再执行一次累加（批量导入时按主机和时间排序，合并效果最好）
+        std::size_t index = 0;
+        while (index < results.size()) {
+            const auto& [ip, hostname, delay, successFlag, timestamp] = results[index];
+            std::string_view bucket = std::string_view(timestamp).substr(0, prefixLength);
+            SampleStatistics merged;
+            std::size_t next = index;
+            for (; next < results.size(); next++) {
+                const auto& [nextIP, nextHostname, nextDelay, nextSuccess, nextTimestamp] = results[next];
+                if (nextIP != ip || std::string_view(nextTimestamp).substr(0, prefixLength) != bucket) {
+                    break;
+                }
+                merged.merge(1, nextSuccess ? 1 : 0, nextSuccess ? nextDelay : 0, nextDelay, nextDelay);
+            }
+            
+            sqlite3_bind_text(stmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, timestamp.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 3, merged.total);
+            sqlite3_bind_int64(stmt, 4, merged.successes);
+            sqlite3_bind_int64(stmt, 5, static_cast<long long>(merged.delaySum));
+            if (merged.successes > 0) {
+                sqlite3_bind_int(stmt, 6, merged.minDelay);
+                sqlite3_bind_int(stmt, 7, merged.maxDelay);
+            } else {
+                sqlite3_bind_null(stmt, 6);
+                sqlite3_bind_null(stmt, 7);
+            }
+            
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                std::cerr << "Failed to update " << rollupTable << " for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+                success = false;
+                break;
+            }
+            sqlite3_reset(stmt);
+            index = next;
+        }
+        sqlite3_finalize(stmt);
+        
+        if (!success) {
+            break;
+        }
+    }
+    
+    return success;
+}
+
+// 从天汇总表累加全部历史的统计，代价与天数成正比，而不是与样本数成正比；firstDay为汇总覆盖的第一天
+bool DatabaseManager::collectRollupStatistics(const std::string& ip, SampleStatistics& stats, std::string& firstDay) {
+    const char* rollupSQL = R"(
+        SELECT SUM(count), SUM(successes), SUM(rtt_sum), MAX(rtt_max), MIN(rtt_min), MIN(bucket)
+        FROM rollup_day WHERE ip = ?;
+    )";
+    
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, rollupSQL, -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to prepare rollup statistics statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        stats.merge(sqlite3_column_int64(stmt, 0), sqlite3_column_int64(stmt, 1), sqlite3_column_double(stmt, 2),
+                    sqlite3_column_int(stmt, 3), sqlite3_column_int(stmt, 4));
+        const char* firstText = (const char*)sqlite3_column_text(stmt, 5);
+        firstDay = firstText ? firstText : "";
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+// 设置样本分区周期并保存到settings表，之后的写入都会按该周期分区
+bool DatabaseManager::setPartitionPeriod(const std::string& period) {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    
+    if (period != "day" && period != "week") {
+        std::cerr << "Invalid partition period: " << period << std::endl;
+        return false;
+    }
+    
+    if (!saveSetting("partition_period", period)) {
+        return false;
+    }
+    
+    partitionPeriod = period;
+    return true;
+}
+
+bool DatabaseManager::setSampleStore(const std::string& store) {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    
+    if (store != "rows" && store != "chunked") {
+        std::cerr << "Invalid sample store: " << store << std::endl;
+        return false;
+    }
+    
+    if (!saveSetting("sample_store", store)) {
+        return false;
+    }
+    
+    sampleStore = store;
+    return true;
+}
+
+void DatabaseManager::setChunkFlushThreshold(std::size_t samples) {
+    chunkFlushThreshold = std::max<std::size_t>(samples, 1);
+}
+
+// 保存一项持久化设置
+bool DatabaseManager::saveSetting(const std::string& key, const std::string& value) {
+    const char* upsertSettingSQL = R"(
+        INSERT INTO settings (key, value) VALUES (?, ?)
+        ON CONFLICT(key) DO UPDATE SET value = excluded.value;
+    )";
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, upsertSettingSQL, -1, &stmt, 0);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare settings statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, value.c_str(), -1, SQLITE_STATIC);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to save setting " << key << ": " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string DatabaseManager::partitionDirectory() const {
+    return dbPath + ".partitions";
+}
+
+// 列出磁盘上所有的分区文件，按起始日期排序
+std::vector<DatabaseManager::Partition> DatabaseManager::listPartitions() {
+    std::vector<Partition> partitions;
+    
+    std::error_code ec;
+    std::filesystem::directory_iterator it(partitionDirectory(), ec);
+    if (ec) {
+        return partitions;  // 尚未创建任何分区
+    }
+    
+    std::regex namePattern(R"(^(day|week)-(\d{4}-\d{2}-\d{2})\.db$)");
+    for (const auto& entry : it) {
+        std::string name = entry.path().filename().string();
+        std::smatch match;
+        if (!std::regex_match(name, match, namePattern)) {
+            continue;
+        }
+        auto date = parseTimestampDate(match[2].str());
+        if (date) {
+            partitions.push_back(makePartition(partitionDirectory(), match[1].str(), *date));
+        }
+    }
+    
+    std::sort(partitions.begin(), partitions.end(),
+              [](const Partition& a, const Partition& b) { return a.start < b.start; });
+    return partitions;
+}
+
+bool DatabaseManager::attachPartition(const Partition& partition) {
+    if (attachedPartitions.contains(partition.schema)) {
+        return true;
+    }
+    
+    bool isNewFile = !std::filesystem::exists(partition.path);
+    
+    std::string attachSQL = "ATTACH DATABASE ? AS " + partition.schema + ";";
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, attachSQL.c_str(), -1, &stmt, 0);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare attach statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, partition.path.c_str(), -1, SQLITE_STATIC);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to attach partition " << partition.path << ": " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    
+    attachedPartitions.insert(partition.schema);
+    
+    if (isNewFile) {
+        std::string pragmaSQL = "PRAGMA " + partition.schema + ".auto_vacuum = INCREMENTAL;"
+                                "PRAGMA " + partition.schema + ".user_version = " + std::to_string(SCHEMA_VERSION) + ";";
+        sqlite3_exec(db, pragmaSQL.c_str(), 0, 0, 0);
+    } else if (queryPragma(partition.schema + ".user_version") < SCHEMA_VERSION) {
+        upgradeSampleTables(partition.schema);
+    }
+    loadProvisionedTables(partition.schema);
+    return true;
+}
+
+bool DatabaseManager::detachPartition(const std::string& schema) {
+    if (!attachedPartitions.contains(schema)) {
+        return true;
+    }
+    
+    // 分区DETACH之后无法再访问，先为其中批量导入新建的表补建索引
+    buildDeferredIndexes(schema);
+    
+    std::string detachSQL = "DETACH DATABASE " + schema + ";";
+    char* errMsg = 0;
+    int rc = sqlite3_exec(db, detachSQL.c_str(), 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to detach partition " << schema << ": " << (errMsg ? errMsg : "Unknown error") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    
+    attachedPartitions.erase(schema);
+    std::erase_if(provisionedTables, [&](const std::string& key) { return key.starts_with(schema + "."); });
+    return true;
+}
+
+bool DatabaseManager::tableExists(const std::string& schema, const std::string& tableName) {
+    std::string selectSQL = "SELECT 1 FROM " + schema + ".sqlite_master WHERE type = 'table' AND name = ?;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, selectSQL.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, tableName.c_str(), -1, SQLITE_STATIC);
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+// 列出schema中的全部样本表（ip_前缀）
+std::vector<std::string> DatabaseManager::listSampleTables(const std::string& schema) {
+    std::vector<std::string> tables;
+    std::string selectSQL = "SELECT name FROM " + schema + ".sqlite_master WHERE type = 'table' AND name LIKE 'ip\\_%' ESCAPE '\\';";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, selectSQL.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+        return tables;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        tables.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+    }
+    sqlite3_finalize(stmt);
+    return tables;
+}
+
+// 为旧版本创建的样本表补建覆盖索引并删除旧索引，完成后记录当前模式版本
+bool DatabaseManager::upgradeSampleTables(const std::string& schema) {
+    for (const auto& tableName : listSampleTables(schema)) {
+        if (!createSampleIndex(schema, tableName)) {
+            return false;
+        }
+    }
+    
+    std::string versionSQL = "PRAGMA " + schema + ".user_version = " + std::to_string(SCHEMA_VERSION) + ";";
+    char* errMsg = 0;
+    if (sqlite3_exec(db, versionSQL.c_str(), 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "Failed to record schema version for " << schema << ": " << (errMsg ? errMsg : "Unknown error") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// 把schema中已存在的样本表登记到缓存，之后的写入不再为这些主机执行建表语句
+void DatabaseManager::loadProvisionedTables(const std::string& schema) {
+    for (const auto& tableName : listSampleTables(schema)) {
+        provisionedTables.insert(schema + "." + tableName);
+    }
+}
+
+// 查询路由：依次访问主数据库和每个分区文件中该表所在的schema
+// 分区文件在访问期间临时ATTACH，访问结束后恢复原来的ATTACH状态
+// 给出since/until时跳过整个分区都落在范围之外的分区文件
+bool DatabaseManager::forEachSampleSource(const std::string& tableName, const std::function<bool(const std::string&)>& visit,
+                                          const std::string& since, const std::string& until) {
+    if (tableExists("main", tableName) && !visit("main")) {
+        return false;
+    }
+    
+    auto sinceDate = parseTimestampDate(since);
+    auto untilDate = parseTimestampDate(until);
+    
+    for (const auto& partition : listPartitions()) {
+        if ((sinceDate && partition.end <= *sinceDate) || (untilDate && partition.start > *untilDate)) {
+            continue;
+        }
+        bool wasAttached = attachedPartitions.contains(partition.schema);
+        if (!attachPartition(partition)) {
+            continue;
+        }
+        bool keepGoing = !tableExists(partition.schema, tableName) || visit(partition.schema);
+        if (!wasAttached) {
+            detachPartition(partition.schema);
+        }
+        if (!keepGoing) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 删除整个分区文件（连同日志文件）；删除前先DETACH
+bool DatabaseManager::dropPartitionFile(const Partition& partition) {
+    if (!detachPartition(partition.schema)) {
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::remove(partition.path, ec);
+    if (ec) {
+        std::cerr << "Failed to remove partition " << partition.path << ": " << ec.message() << std::endl;
+        return false;
+    }
+    for (const char* suffix : {"-journal", "-wal", "-shm"}) {
+        std::filesystem::remove(partition.path + suffix, ec);
+    }
+    std::cout << "Dropped partition " << partition.path << std::endl;
+    return true;
+}
+
+// 样本所在的schema：未启用分区时为main，否则为该时间戳所属的分区
+std::string DatabaseManager::sampleSchemaFor(const std::string& timestamp) {
+    if (partitionPeriod.empty()) {
+        return "main";
+    }
+    auto date = parseTimestampDate(timestamp);
+    if (!date) {
+        return "main";
+    }
+    return makePartition(partitionDirectory(), partitionPeriod, *date).schema;
+}
+
+// 写入前准备分区：ATTACH本批次样本所需的分区文件，并DETACH不再需要的分区
+// ATTACH/DETACH不能在事务中执行，因此必须在开始事务之前调用
+bool DatabaseManager::prepareWrite(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    
+    // chunked布局的样本只写入主数据库
+    if (partitionPeriod.empty() || sampleStore == "chunked") {
+        return true;
+    }
+    
+    std::map<std::string, Partition> needed;
+    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        auto date = parseTimestampDate(timestamp);
+        if (date) {
+            Partition partition = makePartition(partitionDirectory(), partitionPeriod, *date);
+            needed.emplace(partition.schema, partition);
+        }
+    }
+    
+    std::vector<std::string> stale;
+    for (const auto& schema : attachedPartitions) {
+        if (!needed.contains(schema)) {
+            stale.push_back(schema);
+        }
+    }
+    for (const auto& schema : stale) {
+        detachPartition(schema);
+    }
+    
+    std::error_code ec;
+    std::filesystem::create_directories(partitionDirectory(), ec);
+    if (ec) {
+        std::cerr << "Failed to create partition directory " << partitionDirectory() << ": " << ec.message() << std::endl;
+        return false;
+    }
+    
+    for (const auto& [schema, partition] : needed) {
+        if (!attachPartition(partition)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// 辅助函数：执行BEGIN/COMMIT/ROLLBACK等事务语句
+bool DatabaseManager::executeTransactionStatement(const char* sql, const char* action) {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    
+    char* errMsg = 0;
+    int rc = sqlite3_exec(db, sql, 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to " << action << " transaction: " << (errMsg ? errMsg : "Unknown error") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::beginTransaction() {
+    if (!executeTransactionStatement("BEGIN TRANSACTION;", "begin")) {
+        return false;
+    }
+    committedTail = chunkTail;
+    return true;
+}
+
+bool DatabaseManager::commitTransaction() {
+    if (!executeTransactionStatement("COMMIT;", "commit")) {
+        return false;
+    }
+    pendingTables.clear();
+    committedTail.reset();
+    return true;
+}
+
+// 回滚会撤销本事务中新建的样本表，将它们移出缓存，下次写入时重新建表；
+// 内存尾部恢复到事务开始时的样子，本事务中写入数据块的样本重新回到尾部，本事务追加的样本被丢弃
+bool DatabaseManager::rollbackTransaction() {
+    for (const auto& key : pendingTables) {
+        provisionedTables.erase(key);
+        deferredIndexTables.erase(key);
+    }
+    pendingTables.clear();
+    if (committedTail) {
+        chunkTail = std::move(*committedTail);
+        committedTail.reset();
+    }
+    lastChunks.clear();
+    return executeTransactionStatement("ROLLBACK;", "rollback");
+}
+
+// 辅助函数：读取整数类型的PRAGMA值，pragma可带schema前缀（如p_day_20240101.freelist_count）
+long long DatabaseManager::queryPragma(const std::string& pragma) {
+    std::string pragmaSQL = "PRAGMA " + pragma + ";";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, pragmaSQL.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+        return -1;
+    }
+    long long value = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// 将未启用auto_vacuum的已有数据库转换为增量模式，需要执行一次完整的VACUUM
+bool DatabaseManager::convertToIncrementalVacuum() {
+    if (queryPragma("auto_vacuum") != 0) {
+        return true;
+    }
+    
+    std::cout << "Converting database to incremental auto_vacuum (one-time full VACUUM)..." << std::endl;
+    char* errMsg = 0;
+    int rc = sqlite3_exec(db, "PRAGMA auto_vacuum = INCREMENTAL; VACUUM;", 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to convert database to incremental auto_vacuum: " << (errMsg ? errMsg : "Unknown error") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// 增量回收空闲页：每次最多回收maxPages页，可与正常的ping周期交替执行
+bool DatabaseManager::reclaimFreePages(int maxPages) {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    
+    // 仅在增量模式（auto_vacuum = 2）下有空闲页时执行
+    if (queryPragma("auto_vacuum") != 2 || queryPragma("freelist_count") <= 0) {
+        return true;
+    }
+    
+    std::string vacuumSQL = "PRAGMA incremental_vacuum(" + std::to_string(maxPages) + ");";
+    char* errMsg = 0;
+    int rc = sqlite3_exec(db, vacuumSQL.c_str(), 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to run incremental vacuum: " << (errMsg ? errMsg : "Unknown error") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+void DatabaseManager::printDatabaseStats() {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return;
+    }
+    
+    static const char* vacuumModes[] = {"none", "full", "incremental"};
+    long long autoVacuum = queryPragma("auto_vacuum");
+    long long pageSize = queryPragma("page_size");
+    long long pageCount = queryPragma("page_count");
+    long long freePages = queryPragma("freelist_count");
+    double freeRatio = (pageCount > 0) ? (double)freePages / pageCount * 100 : 0;
+    
+    std::cout << "Database statistics: " << dbPath << std::endl;
+    std::cout << "=========================================================" << std::endl;
+    std::cout << "Auto vacuum: " << ((autoVacuum >= 0 && autoVacuum <= 2) ? vacuumModes[autoVacuum] : "unknown") << std::endl;
+    std::cout << "Page size: " << pageSize << " bytes" << std::endl;
+    std::cout << "Page count: " << pageCount << std::endl;
+    std::cout << "Database size: " << pageSize * pageCount << " bytes" << std::endl;
+    std::cout << "Free pages: " << freePages << " (" << std::fixed << std::setprecision(2) << freeRatio << "%)" << std::endl;
+    std::cout << "Reclaimable space: " << pageSize * freePages << " bytes" << std::endl;
+    
+    // 碎片统计：已使用页中未使用字节的比例（需要SQLite编译时启用dbstat虚拟表）
+    sqlite3_stmt* stmt;
+    const char* dbstatSQL = "SELECT SUM(unused), SUM(pgsize) FROM dbstat WHERE schema = 'main';";
+    if (sqlite3_prepare_v2(db, dbstatSQL, -1, &stmt, 0) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            long long unused = sqlite3_column_int64(stmt, 0);
+            long long total = sqlite3_column_int64(stmt, 1);
+            double fragmentation = (total > 0) ? (double)unused / total * 100 : 0;
+            std::cout << "Unused bytes in used pages: " << unused << " (" << std::fixed << std::setprecision(2) << fragmentation << "%)" << std::endl;
+        }
+        sqlite3_finalize(stmt);
+    } else {
+        std::cout << "Unused bytes in used pages: unavailable (dbstat not compiled in)" << std::endl;
+    }
+    
+    auto partitions = listPartitions();
+    if (!partitions.empty()) {
+        std::cout << "\nPartitions: " << partitions.size() << std::endl;
+        std::cout << "File\t\t\t\tSize\t\tFree pages" << std::endl;
+        std::cout << "--------------------------------------------------------" << std::endl;
+        for (const auto& partition : partitions) {
+            bool wasAttached = attachedPartitions.contains(partition.schema);
+            if (!attachPartition(partition)) {
+                continue;
+            }
+            long long partSize = queryPragma(partition.schema + ".page_size") * queryPragma(partition.schema + ".page_count");
+            long long partFree = queryPragma(partition.schema + ".freelist_count");
+            if (!wasAttached) {
+                detachPartition(partition.schema);
+            }
+            std::cout << std::filesystem::path(partition.path).filename().string() << "\t" << partSize << " bytes\t" << partFree << std::endl;
+        }
     }
     
-    // 创建recovery_records表，用于存储已恢复主机的记录
-    const char* createRecoveryTableSQL = R"(
-        CREATE TABLE IF NOT EXISTS recovery_records (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            ip TEXT,
-            hostname TEXT,
-            alert_time TEXT,
-            recovery_time TEXT DEFAULT CURRENT_TIMESTAMP
-        );
-    )";
-    
-    rc = sqlite3_exec(db, createRecoveryTableSQL, 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        std::string errorMsg = "SQL error creating recovery_records table: ";
-        if (errMsg) {
-            errorMsg += errMsg;
-            sqlite3_free(errMsg);
-        } else {
-            errorMsg += "Unknown error";
+    std::cout << "\nSample store: " << sampleStore << std::endl;
+    const char* chunkStatsSQL = "SELECT COUNT(*), COALESCE(SUM(count), 0), COALESCE(SUM(length(data)), 0) FROM sample_chunks;";
+    if (sqlite3_prepare_v2(db, chunkStatsSQL, -1, &stmt, 0) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 0) > 0) {
+            std::cout << "Sample chunks: " << sqlite3_column_int64(stmt, 0) << " (" << sqlite3_column_int64(stmt, 1)
+                      << " samples, " << sqlite3_column_int64(stmt, 2) << " payload bytes)" << std::endl;
         }
-        std::cerr << errorMsg << std::endl;
-        return false;
+        sqlite3_finalize(stmt);
     }
     
-    return true;
+    auto [segmentBytes, segmentFiles] = segmentStore.diskUsage();
+    if (segmentFiles > 0) {
+        std::cout << "\nSegment files: " << segmentFiles << " (" << segmentBytes << " bytes in " << segmentStore.getDirectory() << ")" << std::endl;
+    }
 }
 
-// 为特定IP地址创建表
-bool DatabaseManager::createIPTable(const std::string& ip) {
+// 为特定IP地址在指定schema（主数据库或分区文件）中创建表
+bool DatabaseManager::createIPTable(const std::string& ip, const std::string& schema) {
     if (!db) {
         std::cerr << "Database not initialized" << std::endl;
         return false;
@@ -138,7 +1028,7 @@ bool DatabaseManager::createIPTable(const std::string& ip) {
     
     // 创建特定IP的表
     std::ostringstream createTableSQLStream;
-    createTableSQLStream << "CREATE TABLE IF NOT EXISTS " << tableName << " ("
+    createTableSQLStream << "CREATE TABLE IF NOT EXISTS " << schema << "." << tableName << " ("
                          << "id INTEGER PRIMARY KEY AUTOINCREMENT,"
                          << "delay INTEGER,"
                          << "success BOOLEAN,"
@@ -155,23 +1045,66 @@ bool DatabaseManager::createIPTable(const std::string& ip) {
         return false;
     }
     
-    // 为timestamp列创建索引以提高查询性能
-    std::ostringstream createIndexSQLStream;
-    createIndexSQLStream << "CREATE INDEX IF NOT EXISTS idx_" << tableName << "_timestamp "
-                         << "ON " << tableName << " (timestamp);";
-    
-    std::string createIndexSQL = createIndexSQLStream.str();
-    
-    rc = sqlite3_exec(db, createIndexSQL.c_str(), 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error creating index for IP " << ip << ": " << errMsg << std::endl;
+    // 批量导入期间新建的表先不建索引，导入结束后一次性排序建索引，比逐行维护索引快得多
+    if (bulkLoading) {
+        deferredIndexTables.insert(schema + "." + tableName);
+        return true;
+    }
+    return createSampleIndex(schema, tableName);
+}
+
+// 覆盖索引：统计查询只需读取索引即可完成，时间范围条件走索引范围扫描
+// 旧版本的单列timestamp索引是它的前缀，创建覆盖索引后删除
+bool DatabaseManager::createSampleIndex(const std::string& schema, const std::string& tableName) {
+    std::string indexSQL = "CREATE INDEX IF NOT EXISTS " + schema + ".idx_" + tableName + "_ts_cover "
+                           "ON " + tableName + " (timestamp, success, delay);"
+                           "DROP INDEX IF EXISTS " + schema + ".idx_" + tableName + "_timestamp;";
+    char* errMsg = 0;
+    if (sqlite3_exec(db, indexSQL.c_str(), 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL error creating index for " << schema << "." << tableName << ": " << (errMsg ? errMsg : "Unknown error") << std::endl;
         sqlite3_free(errMsg);
         return false;
     }
-    
     return true;
 }
 
+// 为批量导入中新建的表补建索引；schema为空时处理全部schema
+bool DatabaseManager::buildDeferredIndexes(const std::string& schema) {
+    bool success = true;
+    for (auto it = deferredIndexTables.begin(); it != deferredIndexTables.end();) {
+        auto dot = it->find('.');
+        std::string tableSchema = it->substr(0, dot);
+        if (!schema.empty() && tableSchema != schema) {
+            ++it;
+            continue;
+        }
+        success = createSampleIndex(tableSchema, it->substr(dot + 1)) && success;
+        it = deferredIndexTables.erase(it);
+    }
+    return success;
+}
+
+bool DatabaseManager::beginBulkLoad() {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    bulkLoading = true;
+    savedCacheSize = queryPragma("cache_size");
+    sqlite3_exec(db, ("PRAGMA cache_size = " + std::to_string(BULK_LOAD_CACHE_KIB) + ";").c_str(), 0, 0, 0);
+    return true;
+}
+
+bool DatabaseManager::endBulkLoad() {
+    if (!db || !bulkLoading) {
+        return true;
+    }
+    bulkLoading = false;
+    bool success = buildDeferredIndexes("");
+    sqlite3_exec(db, ("PRAGMA cache_size = " + std::to_string(savedCacheSize) + ";").c_str(), 0, 0, 0);
+    return success;
+}
+
 bool DatabaseManager::insertPingResult(const std::string& ip, const std::string& hostname, short delay, bool success, const std::string& timestamp) {
     // 验证IP地址格式
     if (!isValidIP(ip)) {
@@ -187,19 +1120,46 @@ bool DatabaseManager::insertPingResult(const std::string& ip, const std::string&
 
 // 辅助函数：验证IP地址格式并创建表
 bool DatabaseManager::validateAndPrepareIPs(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
-    // 验证所有IP地址格式
+    // 验证所有IP地址格式；批量导入的样本按主机排序，与上一行相同的IP不再重复匹配正则
+    const std::string* previousIP = nullptr;
     for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        if (previousIP && *previousIP == ip) {
+            continue;
+        }
         if (!isValidIP(ip)) {
             std::cerr << "Invalid IP address format: " << ip << std::endl;
             return false;
         }
+        previousIP = &ip;
     }
     
-    // 为所有IP地址创建表（如果尚未创建）
+    // chunked布局的样本都写入sample_chunks表，无需为每个IP建表
+    if (sampleStore == "chunked") {
+        return true;
+    }
+    
+    // 只为缓存中没有的主机在样本所属的schema中建表，已知主机不再执行建表语句
+    // 分区只取决于日期，与上一行主机和日期都相同的样本跳过查找
+    previousIP = nullptr;
+    std::string_view previousDay;
     for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
-        if (!createIPTable(ip)) {
+        std::string_view day = std::string_view(timestamp).substr(0, 10);
+        if (previousIP && *previousIP == ip && previousDay == day) {
+            continue;
+        }
+        previousIP = &ip;
+        previousDay = day;
+        
+        std::string schema = sampleSchemaFor(timestamp);
+        std::string key = schema + "." + ipToTableName(ip);
+        if (provisionedTables.contains(key)) {
+            continue;
+        }
+        if (!createIPTable(ip, schema)) {
             return false;
         }
+        provisionedTables.insert(key);
+        pendingTables.push_back(std::move(key));
     }
     
     return true;
@@ -223,8 +1183,16 @@ bool DatabaseManager::upsertHosts(const std::vector<std::tuple<std::string, std:
     }
     
     bool success = true;
-    // 为每个结果执行主机信息插入/更新
+    // 为每个结果执行主机信息插入/更新，连续的同一主机只写一次
+    const std::string* previousIP = nullptr;
+    const std::string* previousHostname = nullptr;
     for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        if (previousIP && *previousIP == ip && *previousHostname == hostname) {
+            continue;
+        }
+        previousIP = &ip;
+        previousHostname = &hostname;
+        
         sqlite3_bind_text(hostStmt, 1, ip.c_str(), -1, SQLITE_STATIC);
         sqlite3_bind_text(hostStmt, 2, hostname.c_str(), -1, SQLITE_STATIC);
         
@@ -249,11 +1217,30 @@ bool DatabaseManager::insertPingResultsBatch(const std::vector<std::tuple<std::s
     std::map<std::string, sqlite3_stmt*> pingStmts;
     bool success = true;
     
+    // 与上一行主机和日期都相同的样本写入同一张表，直接复用上一条语句
+    const std::string* previousIP = nullptr;
+    std::string_view previousDay;
+    sqlite3_stmt* previousStmt = nullptr;
+    
     for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
-        std::string tableName = ipToTableName(ip);
+        std::string_view day = std::string_view(timestamp).substr(0, 10);
+        if (previousStmt && *previousIP == ip && previousDay == day) {
+            sqlite3_bind_int64(previousStmt, 1, delay);
+            sqlite3_bind_int(previousStmt, 2, successFlag ? 1 : 0);
+            sqlite3_bind_text(previousStmt, 3, timestamp.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(previousStmt) != SQLITE_DONE) {
+                std::cerr << "Failed to execute ping statement for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+                success = false;
+                break;
+            }
+            sqlite3_reset(previousStmt);
+            continue;
+        }
         
-        // 如果还没有为这个IP创建语句，创建一个
-        if (pingStmts.find(ip) == pingStmts.end()) {
+        std::string tableName = sampleSchemaFor(timestamp) + "." + ipToTableName(ip);
+        
+        // 如果还没有为这个表创建语句，创建一个
+        if (pingStmts.find(tableName) == pingStmts.end()) {
             std::ostringstream insertSQLStream;
             insertSQLStream << "INSERT INTO " << tableName << " (delay, success, timestamp)"
                             << "VALUES (?, ?, ?);";
@@ -268,12 +1255,12 @@ bool DatabaseManager::insertPingResultsBatch(const std::vector<std::tuple<std::s
                 break;
             }
             
-            pingStmts[ip] = pingStmt;
+            pingStmts[tableName] = pingStmt;
         }
         
         // 绑定参数并执行插入
         if (success) {
-            sqlite3_stmt* pingStmt = pingStmts[ip];
+            sqlite3_stmt* pingStmt = pingStmts[tableName];
             sqlite3_bind_int64(pingStmt, 1, delay);
             sqlite3_bind_int(pingStmt, 2, successFlag ? 1 : 0);
             sqlite3_bind_text(pingStmt, 3, timestamp.c_str(), -1, SQLITE_STATIC);
@@ -287,17 +1274,226 @@ bool DatabaseManager::insertPingResultsBatch(const std::vector<std::tuple<std::s
             
             // 重置语句以供下一次使用
             sqlite3_reset(pingStmt);
+            previousIP = &ip;
+            previousDay = day;
+            previousStmt = pingStmt;
         }
     }
     
     // 释放所有语句
-    for (auto& [ip, stmt] : pingStmts) {
+    for (auto& [tableName, stmt] : pingStmts) {
         sqlite3_finalize(stmt);
     }
     
     return success;
 }
 
+// chunked布局：样本先追加到内存尾部，某台主机的尾部达到阈值或进入新的小时后再写入数据块，
+// 写入的样本同时累加到汇总表，仍在尾部的样本不计入汇总，进程意外退出丢失尾部时汇总与数据块保持一致
+bool DatabaseManager::appendChunkSamples(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    std::map<std::string, std::string> newestBucket;
+    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        auto seconds = SegmentStore::parseTimestamp(timestamp);
+        if (!seconds) {
+            std::cerr << "Invalid timestamp for IP " << ip << ": " << timestamp << std::endl;
+            return false;
+        }
+        std::string bucket = timestamp.substr(0, 13);
+        chunkTail[{ip, bucket}].push_back(packChunkSample(*seconds % 3600, successFlag, delay));
+        
+        std::string& newest = newestBucket[ip];
+        newest = std::max(newest, bucket);
+    }
+    
+    std::vector<std::tuple<std::string, std::string, short, bool, std::string>> written;
+    for (auto it = chunkTail.begin(); it != chunkTail.end();) {
+        const auto& [key, packed] = *it;
+        const auto& [ip, bucket] = key;
+        auto newest = newestBucket.find(ip);
+        bool hourClosed = newest != newestBucket.end() && bucket < newest->second;
+        if (packed.size() < chunkFlushThreshold && !hourClosed) {
+            ++it;
+            continue;
+        }
+        if (!writeChunkSamples(ip, bucket, packed)) {
+            return false;
+        }
+        expandChunkSamples(ip, bucket, packed, written);
+        it = chunkTail.erase(it);
+    }
+    return written.empty() || updateRollups(written);
+}
+
+// 写入内存尾部中的全部样本；不在事务中时自行开启一个事务
+bool DatabaseManager::flushChunkTail() {
+    if (!db || chunkTail.empty()) {
+        return true;
+    }
+    
+    bool ownsTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownsTransaction && !beginTransaction()) {
+        return false;
+    }
+    
+    bool success = true;
+    std::vector<std::tuple<std::string, std::string, short, bool, std::string>> written;
+    for (const auto& [key, packed] : chunkTail) {
+        if (!writeChunkSamples(key.first, key.second, packed)) {
+            success = false;
+            break;
+        }
+        expandChunkSamples(key.first, key.second, packed, written);
+    }
+    if (success) {
+        success = updateRollups(written);
+    }
+    
+    if (ownsTransaction) {
+        if (success) {
+            success = commitTransaction();
+        } else {
+            rollbackTransaction();
+        }
+    }
+    if (success) {
+        chunkTail.clear();
+    }
+    return success;
+}
+
+// 把打包样本追加到该小时的最后一个数据块，块满后依次新建数据块
+bool DatabaseManager::writeChunkSamples(const std::string& ip, const std::string& bucket, const std::vector<std::uint32_t>& packed) {
+    const char* lastChunkSQL = "SELECT seq, count FROM sample_chunks WHERE ip = ? AND bucket = ? ORDER BY seq DESC LIMIT 1;";
+    const char* appendChunkSQL = "UPDATE sample_chunks SET count = count + ?, data = CAST(data || ? AS BLOB) WHERE ip = ? AND bucket = ? AND seq = ?;";
+    const char* insertChunkSQL = "INSERT INTO sample_chunks (ip, bucket, seq, count, data) VALUES (?, ?, ?, ?, ?);";
+    
+    // 每台主机最近写入的数据块缓存在内存中，同一小时的后续写入不再查询
+    long long nextSeq = 0;
+    std::size_t lastCount = CHUNK_CAPACITY;
+    auto cached = lastChunks.find(ip);
+    if (cached != lastChunks.end() && std::get<0>(cached->second) == bucket) {
+        nextSeq = std::get<1>(cached->second) + 1;
+        lastCount = std::get<2>(cached->second);
+    } else {
+        sqlite3_stmt* lastStmt;
+        if (sqlite3_prepare_v2(db, lastChunkSQL, -1, &lastStmt, 0) != SQLITE_OK) {
+            std::cerr << "Failed to prepare chunk query statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        sqlite3_bind_text(lastStmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(lastStmt, 2, bucket.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(lastStmt) == SQLITE_ROW) {
+            nextSeq = sqlite3_column_int64(lastStmt, 0) + 1;
+            lastCount = static_cast<std::size_t>(sqlite3_column_int64(lastStmt, 1));
+        }
+        sqlite3_finalize(lastStmt);
+    }
+    
+    // 按小端序序列化
+    std::vector<unsigned char> bytes;
+    bytes.reserve(packed.size() * CHUNK_SAMPLE_BYTES);
+    for (std::uint32_t value : packed) {
+        for (std::size_t i = 0; i < CHUNK_SAMPLE_BYTES; ++i) {
+            bytes.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
+    
+    std::size_t position = 0;
+    bool success = true;
+    
+    if (lastCount < CHUNK_CAPACITY) {
+        std::size_t n = std::min(CHUNK_CAPACITY - lastCount, packed.size());
+        sqlite3_stmt* appendStmt;
+        if (sqlite3_prepare_v2(db, appendChunkSQL, -1, &appendStmt, 0) != SQLITE_OK) {
+            std::cerr << "Failed to prepare chunk append statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        sqlite3_bind_int64(appendStmt, 1, static_cast<sqlite3_int64>(n));
+        sqlite3_bind_blob(appendStmt, 2, bytes.data(), static_cast<int>(n * CHUNK_SAMPLE_BYTES), SQLITE_STATIC);
+        sqlite3_bind_text(appendStmt, 3, ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(appendStmt, 4, bucket.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(appendStmt, 5, nextSeq - 1);
+        if (sqlite3_step(appendStmt) != SQLITE_DONE) {
+            std::cerr << "Failed to append chunk for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+            success = false;
+        }
+        bool appended = sqlite3_changes(db) > 0;
+        sqlite3_finalize(appendStmt);
+        // 缓存的数据块已被其他进程删除（例如--tier 0）时重新查询
+        if (success && !appended && cached != lastChunks.end()) {
+            lastChunks.erase(cached);
+            return writeChunkSamples(ip, bucket, packed);
+        }
+        position = n;
+        lastCount += n;
+    }
+    
+    if (success && position < packed.size()) {
+        sqlite3_stmt* insertStmt;
+        if (sqlite3_prepare_v2(db, insertChunkSQL, -1, &insertStmt, 0) != SQLITE_OK) {
+            std::cerr << "Failed to prepare chunk insert statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        while (position < packed.size()) {
+            std::size_t n = std::min(CHUNK_CAPACITY, packed.size() - position);
+            sqlite3_bind_text(insertStmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(insertStmt, 2, bucket.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(insertStmt, 3, nextSeq++);
+            sqlite3_bind_int64(insertStmt, 4, static_cast<sqlite3_int64>(n));
+            sqlite3_bind_blob(insertStmt, 5, bytes.data() + position * CHUNK_SAMPLE_BYTES,
+                              static_cast<int>(n * CHUNK_SAMPLE_BYTES), SQLITE_STATIC);
+            if (sqlite3_step(insertStmt) != SQLITE_DONE) {
+                std::cerr << "Failed to insert chunk for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+                success = false;
+                break;
+            }
+            sqlite3_reset(insertStmt);
+            position += n;
+            lastCount = n;
+        }
+        sqlite3_finalize(insertStmt);
+    }
+    
+    if (success) {
+        lastChunks[ip] = {bucket, nextSeq - 1, lastCount};
+    }
+    return success;
+}
+
+// 按时间顺序（或倒序）解码[fromBucket, toBucket]范围内的数据块，toBucket为空表示不限；visit返回false时停止
+bool DatabaseManager::readChunkSamples(const std::string& ip, const std::string& fromBucket, const std::string& toBucket, bool newestFirst,
+                                       const std::function<bool(const SegmentStore::Sample&)>& visit) {
+    std::string selectSQL = newestFirst
+        ? "SELECT bucket, data FROM sample_chunks WHERE ip = ? AND bucket >= ? AND bucket <= ? ORDER BY bucket DESC, seq DESC;"
+        : "SELECT bucket, data FROM sample_chunks WHERE ip = ? AND bucket >= ? AND bucket <= ? ORDER BY bucket, seq;";
+    
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, selectSQL.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to prepare chunk read statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, fromBucket.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, toBucket.empty() ? "~" : toBucket.c_str(), -1, SQLITE_STATIC);
+    
+    bool keepGoing = true;
+    while (keepGoing && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* bucket = (const char*)sqlite3_column_text(stmt, 0);
+        auto bucketStart = SegmentStore::parseTimestamp(std::string(bucket ? bucket : "") + ":00");
+        const unsigned char* data = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 1));
+        std::size_t count = static_cast<std::size_t>(sqlite3_column_bytes(stmt, 1)) / CHUNK_SAMPLE_BYTES;
+        if (!bucketStart) {
+            continue;
+        }
+        for (std::size_t i = 0; keepGoing && i < count; ++i) {
+            std::size_t index = newestFirst ? count - 1 - i : i;
+            keepGoing = visit(unpackChunkSample(*bucketStart, data + index * CHUNK_SAMPLE_BYTES));
+        }
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
 bool DatabaseManager::insertPingResults(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
     if (!db) {
         std::cerr << "Database not initialized" << std::endl;
@@ -308,12 +1504,9 @@ bool DatabaseManager::insertPingResults(const std::vector<std::tuple<std::string
         return true; // 没有结果需要插入，视为成功
     }
     
-    // 开始事务以提高性能
-    char* errMsg = 0;
-    int rc = sqlite3_exec(db, "BEGIN TRANSACTION;", 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to begin transaction: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
+    // 开始事务以提高性能；如果调用方（StorageSession）已开启事务，则直接加入该事务
+    bool ownsTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownsTransaction && (!prepareWrite(results) || !beginTransaction())) {
         return false;
     }
     
@@ -329,31 +1522,25 @@ bool DatabaseManager::insertPingResults(const std::vector<std::tuple<std::string
         success = upsertHosts(results);
     }
     
-    // 批量插入ping结果
+    // 批量插入ping结果，并在同一事务中累加汇总表；chunked布局只累加本次实际写入数据块的样本
     if (success) {
-        success = insertPingResultsBatch(results);
+        success = (sampleStore == "chunked") ? appendChunkSamples(results)
+                                             : insertPingResultsBatch(results) && updateRollups(results);
     }
     
-    // 提交或回滚事务
-    if (success) {
-        rc = sqlite3_exec(db, "COMMIT;", 0, 0, &errMsg);
-        if (rc != SQLITE_OK) {
-            std::cerr << "Failed to commit transaction: " << errMsg << std::endl;
-            sqlite3_free(errMsg);
-            success = false;
-        }
-    } else {
-        rc = sqlite3_exec(db, "ROLLBACK;", 0, 0, &errMsg);
-        if (rc != SQLITE_OK) {
-            std::cerr << "Failed to rollback transaction: " << errMsg << std::endl;
-            sqlite3_free(errMsg);
+    // 提交或回滚事务（外部事务由调用方负责结束）
+    if (ownsTransaction) {
+        if (success) {
+            success = commitTransaction();
+        } else {
+            rollbackTransaction();
         }
     }
     
     return success;
 }
 
-void DatabaseManager::queryIPStatistics(const std::string& ip) {
+void DatabaseManager::queryIPStatistics(const std::string& ip, const std::string& since, const std::string& until, bool showRecent) {
     if (!db) {
         std::cerr << "Database not initialized" << std::endl;
         return;
@@ -376,134 +1563,503 @@ void DatabaseManager::queryIPStatistics(const std::string& ip) {
             hostname = hostText;
         }
     }
-    sqlite3_finalize(hostStmt);
-    
-    std::cout << "Statistics for IP: " << ip << " (" << hostname << ")" << std::endl;
-    std::cout << "=========================================================" << std::endl;
-    
-    // 查询特定IP的表
+    sqlite3_finalize(hostStmt);
+    
+    std::cout << "Statistics for IP: " << ip << " (" << hostname << ")" << std::endl;
+    if (!since.empty() || !until.empty()) {
+        std::cout << "Time range: [" << (since.empty() ? "-" : since) << ", " << (until.empty() ? "-" : until) << ")" << std::endl;
+    }
+    std::cout << "=========================================================" << std::endl;
+    
+    SampleStatistics stats;
+    std::vector<std::tuple<std::string, int, int>> recentRecords;  // (timestamp, delay, success)
+    
+    if (!since.empty() || !until.empty()) {
+        // 指定时间范围时直接在原始样本上用覆盖索引做范围扫描，已分层的部分从段文件读取
+        if (!collectRawStatistics(ip, &stats, recentRecords, since, until) ||
+            !collectChunkStatistics(ip, &stats, recentRecords, since, until) ||
+            !collectSegmentStatistics(ip, &stats, recentRecords, since, until)) {
+            return;
+        }
+    } else {
+        // 全部历史的统计来自天汇总表，包括-C已删除的样本；最近的记录来自原始样本表
+        std::string firstDay;
+        if (!collectRollupStatistics(ip, stats, firstDay)) {
+            return;
+        }
+        
+        // 汇总表中没有数据（例如外部直接写入原始表）时退回到原始样本和段文件的全量统计
+        bool fromSamples = stats.total == 0;
+        if (!fromSamples) {
+            std::cout << "Totals from daily rollups since " << firstDay << " (kept after -C removes the samples)" << std::endl;
+        }
+        if (!collectRawStatistics(ip, fromSamples ? &stats : nullptr, recentRecords) ||
+            !collectChunkStatistics(ip, fromSamples ? &stats : nullptr, recentRecords) ||
+            !collectSegmentStatistics(ip, fromSamples ? &stats : nullptr, recentRecords)) {
+            return;
+        }
+    }
+    
+    long long totalRecords = stats.total;
+    long long successCount = stats.successes;
+    
+    std::cout << "Total ping records: " << totalRecords << std::endl;
+    
+    if (totalRecords == 0) {
+        std::cout << "No ping records found for this IP." << std::endl;
+        return;
+    }
+    
+    long long failureCount = totalRecords - successCount;
+    double successRate = (totalRecords > 0) ? (double)successCount / totalRecords * 100 : 0;
+    double failureRate = (totalRecords > 0) ? (double)failureCount / totalRecords * 100 : 0;
+    double avgDelay = (successCount > 0) ? stats.delaySum / successCount : 0;
+    
+    std::cout << "Successful pings: " << successCount << std::endl;
+    std::cout << "Failed pings: " << failureCount << std::endl;
+    std::cout << "Success rate: " << std::fixed << std::setprecision(2) << successRate << "%" << std::endl;
+    std::cout << "Failure rate: " << std::fixed << std::setprecision(2) << failureRate << "%" << std::endl;
+    std::cout << "Average delay (successful pings): " << std::fixed << std::setprecision(2) << avgDelay << "ms" << std::endl;
+    std::cout << "Maximum delay (successful pings): " << stats.maxDelay << "ms" << std::endl;
+    std::cout << "Minimum delay (successful pings): " << stats.minDelay << "ms" << std::endl;
+    if (!showRecent) {
+        return;
+    }
+    
+    // 显示最近的10条记录
+    std::cout << "\nRecent ping records (last 10):" << std::endl;
+    std::cout << "Timestamp           \tDelay\tStatus" << std::endl;
+    std::cout << "--------------------------------------------------------" << std::endl;
+    
+    for (const auto& [timestamp, delay, success] : recentRecords) {
+        std::cout << timestamp << "\t" 
+                  << delay << "ms\t" 
+                  << (success ? "Success" : "Failed") << std::endl;
+    }
+}
+
+// 从原始样本表统计：样本可能分布在主数据库和多个分区文件中，逐个统计后合并
+// stats为空时只读取最近的记录，不做全表聚合；since/until非空时只统计[since, until)范围内的样本
+bool DatabaseManager::collectRawStatistics(const std::string& ip, SampleStatistics* stats,
+                                           std::vector<std::tuple<std::string, int, int>>& recentRecords,
+                                           const std::string& since, const std::string& until) {
+    std::string tableName = ipToTableName(ip);
+    
+    // 时间戳以文本存储，按字符串比较即可得到时间顺序，条件可直接使用覆盖索引
+    std::string rangeClause = " WHERE timestamp >= ?1 AND timestamp < ?2";
+    auto bindRange = [&](sqlite3_stmt* stmt) {
+        sqlite3_bind_text(stmt, 1, since.c_str(), -1, SQLITE_STATIC);
+        if (until.empty()) {
+            sqlite3_bind_text(stmt, 2, "~", -1, SQLITE_STATIC);  // 比任何时间戳都大
+        } else {
+            sqlite3_bind_text(stmt, 2, until.c_str(), -1, SQLITE_STATIC);
+        }
+    };
+    bool ranged = !since.empty() || !until.empty();
+    
+    bool queryOK = forEachSampleSource(tableName, [&](const std::string& schema) {
+        int rc;
+        if (stats) {
+            // 一次聚合得到总数、成功数和延迟统计
+            std::ostringstream statsSQLStream;
+            statsSQLStream << "SELECT COUNT(*), "
+                           << "SUM(success = 1), "
+                           << "SUM(CASE WHEN success = 1 THEN delay END), "
+                           << "MAX(CASE WHEN success = 1 THEN delay END), "
+                           << "MIN(CASE WHEN success = 1 THEN delay END) "
+                           << "FROM " << schema << "." << tableName << (ranged ? rangeClause : "") << ";";
+            std::string statsSQL = statsSQLStream.str();
+            
+            sqlite3_stmt* statsStmt;
+            rc = sqlite3_prepare_v2(db, statsSQL.c_str(), -1, &statsStmt, 0);
+            if (rc != SQLITE_OK) {
+                std::cerr << "Failed to prepare statistics statement: " << sqlite3_errmsg(db) << std::endl;
+                return false;
+            }
+            if (ranged) {
+                bindRange(statsStmt);
+            }
+            
+            if (sqlite3_step(statsStmt) == SQLITE_ROW) {
+                stats->merge(sqlite3_column_int64(statsStmt, 0), sqlite3_column_int64(statsStmt, 1),
+                             sqlite3_column_double(statsStmt, 2), sqlite3_column_int(statsStmt, 3),
+                             sqlite3_column_int(statsStmt, 4));
+            }
+            sqlite3_finalize(statsStmt);
+        }
+        
+        // 每个来源取最近的10条记录
+        std::ostringstream recentSQLStream;
+        recentSQLStream << "SELECT delay, success, timestamp FROM " << schema << "." << tableName
+                        << (ranged ? rangeClause : "") << " ORDER BY timestamp DESC LIMIT 10;";
+        std::string recentSQL = recentSQLStream.str();
+        
+        sqlite3_stmt* recentStmt;
+        rc = sqlite3_prepare_v2(db, recentSQL.c_str(), -1, &recentStmt, 0);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare recent records statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        if (ranged) {
+            bindRange(recentStmt);
+        }
+        
+        while (sqlite3_step(recentStmt) == SQLITE_ROW) {
+            const char* timestamp = (const char*)sqlite3_column_text(recentStmt, 2);
+            recentRecords.emplace_back(timestamp ? timestamp : "N/A",
+                                       sqlite3_column_int(recentStmt, 0),
+                                       sqlite3_column_int(recentStmt, 1));
+        }
+        sqlite3_finalize(recentStmt);
+        return true;
+    }, since, until);
+    
+    // 合并后取全局最近的10条
+    std::sort(recentRecords.begin(), recentRecords.end(),
+              [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+    if (recentRecords.size() > 10) {
+        recentRecords.resize(10);
+    }
+    
+    return queryOK;
+}
+
+// 从数据块统计chunked布局的样本；stats为空时只倒序读取最近的记录
+bool DatabaseManager::collectChunkStatistics(const std::string& ip, SampleStatistics* stats,
+                                             std::vector<std::tuple<std::string, int, int>>& recentRecords,
+                                             const std::string& since, const std::string& until) {
+    if (!stats && recentRecords.size() >= 10) {
+        return true;
+    }
+    
+    std::int64_t sinceTime;
+    std::int64_t untilTime;
+    if (!SegmentStore::parseTimeRange(since, until, sinceTime, untilTime)) {
+        return false;
+    }
+    auto inRange = [&](const SegmentStore::Sample& sample) { return sample.time >= sinceTime && sample.time < untilTime; };
+    std::string fromBucket = since.substr(0, 13);
+    std::string toBucket = until.substr(0, 13);
+    
+    std::vector<SegmentStore::Sample> recent;
+    bool queryOK;
+    if (stats) {
+        // 顺序读取全部数据块，同时保留最后的10个样本
+        SegmentStore::Summary summary;
+        queryOK = readChunkSamples(ip, fromBucket, toBucket, false, [&](const SegmentStore::Sample& sample) {
+            if (inRange(sample)) {
+                summary.add(sample);
+                if (recent.size() == 10) {
+                    recent.erase(recent.begin());
+                }
+                recent.push_back(sample);
+            }
+            return true;
+        });
+        stats->merge(summary.total, summary.successes, summary.delaySum, summary.maxDelay, summary.minDelay);
+    } else {
+        queryOK = readChunkSamples(ip, fromBucket, toBucket, true, [&](const SegmentStore::Sample& sample) {
+            if (inRange(sample)) {
+                recent.push_back(sample);
+            }
+            return recent.size() < 10;
+        });
+    }
+    
+    for (const auto& sample : recent) {
+        recentRecords.emplace_back(SegmentStore::formatTimestamp(sample.time), sample.delay, sample.success ? 1 : 0);
+    }
+    std::sort(recentRecords.begin(), recentRecords.end(),
+              [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+    if (recentRecords.size() > 10) {
+        recentRecords.resize(10);
+    }
+    return queryOK;
+}
+
+// 从段文件统计已分层的冷数据；stats为空且原始样本已提供足够的最近记录时无需读取
+bool DatabaseManager::collectSegmentStatistics(const std::string& ip, SampleStatistics* stats,
+                                               std::vector<std::tuple<std::string, int, int>>& recentRecords,
+                                               const std::string& since, const std::string& until) {
+    if (!stats && recentRecords.size() >= 10) {
+        return true;
+    }
+    
+    SegmentStore::Summary summary;
+    if (!segmentStore.summarize(ip, since, until, summary, recentRecords)) {
+        return false;
+    }
+    if (stats) {
+        stats->merge(summary.total, summary.successes, summary.delaySum, summary.maxDelay, summary.minDelay);
+    }
+    
+    std::sort(recentRecords.begin(), recentRecords.end(),
+              [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+    if (recentRecords.size() > 10) {
+        recentRecords.resize(10);
+    }
+    return true;
+}
+
+// 依次遍历段文件中的冷数据、主数据库和各分区中的原始样本以及数据块，每个来源内部按时间顺序
+// 原始样本的时间在SQL中转换为秒数，沿覆盖索引读取，不经过时间戳文本
+bool DatabaseManager::forEachSample(const std::string& ip, const std::string& since, const std::string& until,
+                                    const std::function<bool(const SegmentStore::Sample&)>& visit) {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+
+    std::int64_t sinceTime;
+    std::int64_t untilTime;
+    if (!SegmentStore::parseTimeRange(since, until, sinceTime, untilTime)) {
+        return false;
+    }
+
+    bool keepGoing = true;
+    if (!segmentStore.forEachSample(ip, sinceTime, untilTime, [&](const SegmentStore::Sample& sample) {
+            return keepGoing = visit(sample);
+        })) {
+        return false;
+    }
+
+    bool failed = false;
     std::string tableName = ipToTableName(ip);
-    
-    // 获取总记录数
-    std::ostringstream countSQLStream;
-    countSQLStream << "SELECT COUNT(*) FROM " << tableName << ";";
-    std::string countSQL = countSQLStream.str();
-    
-    sqlite3_stmt* countStmt;
-    rc = sqlite3_prepare_v2(db, countSQL.c_str(), -1, &countStmt, 0);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare count statement: " << sqlite3_errmsg(db) << std::endl;
-        return;
+    if (keepGoing) {
+        forEachSampleSource(tableName, [&](const std::string& schema) {
+            std::string selectSQL = "SELECT CAST(strftime('%s', timestamp) AS INTEGER), delay, success FROM " + schema + "." + tableName +
+                                    " WHERE timestamp >= ?1 AND timestamp < ?2 ORDER BY timestamp;";
+            sqlite3_stmt* stmt;
+            if (sqlite3_prepare_v2(db, selectSQL.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+                std::cerr << "Failed to prepare sample export statement: " << sqlite3_errmsg(db) << std::endl;
+                failed = true;
+                return false;
+            }
+            sqlite3_bind_text(stmt, 1, since.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, until.empty() ? "~" : until.c_str(), -1, SQLITE_STATIC);
+
+            int rc = SQLITE_DONE;
+            while (keepGoing && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                if (sqlite3_column_type(stmt, 0) == SQLITE_NULL) {
+                    continue;  // 无法解析的时间戳
+                }
+                keepGoing = visit({sqlite3_column_int64(stmt, 0), static_cast<short>(sqlite3_column_int(stmt, 1)),
+                                   sqlite3_column_int(stmt, 2) != 0});
+            }
+            if (keepGoing && rc != SQLITE_DONE) {
+                std::cerr << "Failed to read samples for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+                failed = true;
+            }
+            sqlite3_finalize(stmt);
+            return keepGoing && !failed;
+        }, since, until);
     }
-    
-    int totalRecords = 0;
-    if (sqlite3_step(countStmt) == SQLITE_ROW) {
-        totalRecords = sqlite3_column_int(countStmt, 0);
+    if (failed) {
+        return false;
     }
-    sqlite3_finalize(countStmt);
-    
-    std::cout << "Total ping records: " << totalRecords << std::endl;
-    
-    if (totalRecords == 0) {
-        std::cout << "No ping records found for this IP." << std::endl;
-        return;
+
+    if (keepGoing) {
+        return readChunkSamples(ip, since.substr(0, 13), until.substr(0, 13), false, [&](const SegmentStore::Sample& sample) {
+            if (sample.time < sinceTime || sample.time >= untilTime) {
+                return true;
+            }
+            return keepGoing = visit(sample);
+        });
     }
-    
-    // 获取成功和失败的次数
-    std::ostringstream successSQLStream;
-    successSQLStream << "SELECT COUNT(*) FROM " << tableName << " WHERE success = 1;";
-    std::string successSQL = successSQLStream.str();
-    
-    sqlite3_stmt* successStmt;
-    rc = sqlite3_prepare_v2(db, successSQL.c_str(), -1, &successStmt, 0);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare success count statement: " << sqlite3_errmsg(db) << std::endl;
+    return true;
+}
+
+void DatabaseManager::tierColdData(int days) {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
         return;
     }
     
-    int successCount = 0;
-    if (sqlite3_step(successStmt) == SQLITE_ROW) {
-        successCount = sqlite3_column_int(successStmt, 0);
-    }
-    sqlite3_finalize(successStmt);
-    
-    int failureCount = totalRecords - successCount;
-    double successRate = (totalRecords > 0) ? (double)successCount / totalRecords * 100 : 0;
-    double failureRate = (totalRecords > 0) ? (double)failureCount / totalRecords * 100 : 0;
-    
-    std::cout << "Successful pings: " << successCount << std::endl;
-    std::cout << "Failed pings: " << failureCount << std::endl;
-    std::cout << "Success rate: " << std::fixed << std::setprecision(2) << successRate << "%" << std::endl;
-    std::cout << "Failure rate: " << std::fixed << std::setprecision(2) << failureRate << "%" << std::endl;
-    
-    // 获取平均延迟
-    std::ostringstream avgDelaySQLStream;
-    avgDelaySQLStream << "SELECT AVG(delay) FROM " << tableName << " WHERE success = 1;";
-    std::string avgDelaySQL = avgDelaySQLStream.str();
+    std::chrono::sys_days cutoff = localToday() - std::chrono::days{days};
+    std::string cutoffText = formatDate(cutoff, "-");
+    std::cout << "Moving samples before " << cutoffText << " to segment files in " << segmentStore.getDirectory() << "..." << std::endl;
     
-    sqlite3_stmt* avgDelayStmt;
-    rc = sqlite3_prepare_v2(db, avgDelaySQL.c_str(), -1, &avgDelayStmt, 0);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare average delay statement: " << sqlite3_errmsg(db) << std::endl;
+    const char* selectHostsSQL = "SELECT ip FROM hosts;";
+    sqlite3_stmt* hostsStmt;
+    if (sqlite3_prepare_v2(db, selectHostsSQL, -1, &hostsStmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to prepare hosts query statement: " << sqlite3_errmsg(db) << std::endl;
         return;
     }
-    
-    double avgDelay = 0;
-    if (sqlite3_step(avgDelayStmt) == SQLITE_ROW) {
-        avgDelay = sqlite3_column_double(avgDelayStmt, 0);
+    std::vector<std::string> hostIPs;
+    while (sqlite3_step(hostsStmt) == SQLITE_ROW) {
+        const char* ip = (const char*)sqlite3_column_text(hostsStmt, 0);
+        if (ip) {
+            hostIPs.push_back(ip);
+        }
     }
-    sqlite3_finalize(avgDelayStmt);
-    
-    std::cout << "Average delay (successful pings): " << std::fixed << std::setprecision(2) << avgDelay << "ms" << std::endl;
+    sqlite3_finalize(hostsStmt);
     
-    // 获取最大和最小延迟
-    std::ostringstream maxMinDelaySQLStream;
-    maxMinDelaySQLStream << "SELECT MAX(delay), MIN(delay) FROM " << tableName << " WHERE success = 1;";
-    std::string maxMinDelaySQL = maxMinDelaySQLStream.str();
+    long long movedSamples = 0;
+    int writtenSegments = 0;
+    std::set<std::string> incompleteSchemas;  // 有样本未能移出的来源，其分区文件不能删除
     
-    sqlite3_stmt* maxMinDelayStmt;
-    rc = sqlite3_prepare_v2(db, maxMinDelaySQL.c_str(), -1, &maxMinDelayStmt, 0);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare max/min delay statement: " << sqlite3_errmsg(db) << std::endl;
-        return;
+    for (const auto& ip : hostIPs) {
+        std::string tableName = ipToTableName(ip);
+        
+        // 逐天处理：每天的样本写成段文件并落盘后再从样本表删除，内存占用以一天为上限
+        forEachSampleSource(tableName, [&](const std::string& schema) {
+            std::string source = schema + "." + tableName;
+            std::vector<std::string> dayTexts;
+            
+            std::string daysSQL = "SELECT DISTINCT substr(timestamp, 1, 10) FROM " + source + " WHERE timestamp < ? ORDER BY 1;";
+            sqlite3_stmt* daysStmt;
+            if (sqlite3_prepare_v2(db, daysSQL.c_str(), -1, &daysStmt, 0) != SQLITE_OK) {
+                std::cerr << "Failed to prepare tiering statement: " << sqlite3_errmsg(db) << std::endl;
+                incompleteSchemas.insert(schema);
+                return true;
+            }
+            sqlite3_bind_text(daysStmt, 1, cutoffText.c_str(), -1, SQLITE_STATIC);
+            while (sqlite3_step(daysStmt) == SQLITE_ROW) {
+                const char* dayText = (const char*)sqlite3_column_text(daysStmt, 0);
+                if (dayText) {
+                    dayTexts.push_back(dayText);
+                }
+            }
+            sqlite3_finalize(daysStmt);
+            
+            std::string selectSQL = "SELECT timestamp, delay, success FROM " + source + " WHERE timestamp >= ? AND timestamp < ?;";
+            std::string deleteSQL = "DELETE FROM " + source + " WHERE timestamp >= ? AND timestamp < ?;";
+            
+            for (const auto& dayText : dayTexts) {
+                auto day = parseTimestampDate(dayText);
+                if (!day) {
+                    std::cerr << "Skipping samples with unparsable timestamp " << dayText << " for IP " << ip << std::endl;
+                    incompleteSchemas.insert(schema);
+                    continue;
+                }
+                std::string nextDayText = formatDate(*day + std::chrono::days{1}, "-");
+                
+                sqlite3_stmt* selectStmt;
+                if (sqlite3_prepare_v2(db, selectSQL.c_str(), -1, &selectStmt, 0) != SQLITE_OK) {
+                    std::cerr << "Failed to prepare tiering statement: " << sqlite3_errmsg(db) << std::endl;
+                    incompleteSchemas.insert(schema);
+                    return true;
+                }
+                sqlite3_bind_text(selectStmt, 1, dayText.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_text(selectStmt, 2, nextDayText.c_str(), -1, SQLITE_STATIC);
+                
+                std::vector<SegmentStore::Sample> samples;
+                bool parsed = true;
+                while (sqlite3_step(selectStmt) == SQLITE_ROW) {
+                    const char* timestamp = (const char*)sqlite3_column_text(selectStmt, 0);
+                    auto seconds = SegmentStore::parseTimestamp(timestamp ? timestamp : "");
+                    if (!seconds) {
+                        parsed = false;
+                        break;
+                    }
+                    samples.push_back({*seconds, static_cast<short>(sqlite3_column_int(selectStmt, 1)),
+                                       sqlite3_column_int(selectStmt, 2) != 0});
+                }
+                sqlite3_finalize(selectStmt);
+                
+                // 无法解析的样本留在数据库中，不删除这一天
+                if (!parsed) {
+                    std::cerr << "Skipping samples with unparsable timestamp on " << dayText << " for IP " << ip << std::endl;
+                    incompleteSchemas.insert(schema);
+                    continue;
+                }
+                if (!segmentStore.writeDay(ip, *day, std::move(samples))) {
+                    incompleteSchemas.insert(schema);
+                    continue;
+                }
+                writtenSegments++;
+                
+                sqlite3_stmt* deleteStmt;
+                if (sqlite3_prepare_v2(db, deleteSQL.c_str(), -1, &deleteStmt, 0) != SQLITE_OK) {
+                    std::cerr << "Failed to prepare tiering delete statement: " << sqlite3_errmsg(db) << std::endl;
+                    incompleteSchemas.insert(schema);
+                    return true;
+                }
+                sqlite3_bind_text(deleteStmt, 1, dayText.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_text(deleteStmt, 2, nextDayText.c_str(), -1, SQLITE_STATIC);
+                if (sqlite3_step(deleteStmt) == SQLITE_DONE) {
+                    movedSamples += sqlite3_changes(db);
+                } else {
+                    std::cerr << "Failed to delete tiered samples for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+                    incompleteSchemas.insert(schema);
+                }
+                sqlite3_finalize(deleteStmt);
+            }
+            return true;
+        }, "", cutoffText);
+        
+        // chunked布局的数据块同样逐天解码写成段文件后删除
+        std::vector<std::string> chunkDays;
+        const char* chunkDaysSQL = "SELECT DISTINCT substr(bucket, 1, 10) FROM sample_chunks WHERE ip = ? AND bucket < ? ORDER BY 1;";
+        sqlite3_stmt* chunkDaysStmt;
+        if (sqlite3_prepare_v2(db, chunkDaysSQL, -1, &chunkDaysStmt, 0) != SQLITE_OK) {
+            std::cerr << "Failed to prepare chunk tiering statement: " << sqlite3_errmsg(db) << std::endl;
+            continue;
+        }
+        sqlite3_bind_text(chunkDaysStmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(chunkDaysStmt, 2, cutoffText.c_str(), -1, SQLITE_STATIC);
+        while (sqlite3_step(chunkDaysStmt) == SQLITE_ROW) {
+            const char* dayText = (const char*)sqlite3_column_text(chunkDaysStmt, 0);
+            if (dayText) {
+                chunkDays.push_back(dayText);
+            }
+        }
+        sqlite3_finalize(chunkDaysStmt);
+        
+        for (const auto& dayText : chunkDays) {
+            auto day = parseTimestampDate(dayText);
+            if (!day) {
+                std::cerr << "Skipping chunks with unparsable bucket " << dayText << " for IP " << ip << std::endl;
+                continue;
+            }
+            std::vector<SegmentStore::Sample> samples;
+            if (!readChunkSamples(ip, dayText, dayText + " 23", false, [&](const SegmentStore::Sample& sample) {
+                    samples.push_back(sample);
+                    return true;
+                })) {
+                continue;
+            }
+            std::size_t sampleCount = samples.size();
+            if (!segmentStore.writeDay(ip, *day, std::move(samples))) {
+                continue;
+            }
+            writtenSegments++;
+            
+            std::string nextDayText = formatDate(*day + std::chrono::days{1}, "-");
+            const char* deleteChunksSQL = "DELETE FROM sample_chunks WHERE ip = ? AND bucket >= ? AND bucket < ?;";
+            lastChunks.erase(ip);
+            sqlite3_stmt* deleteStmt;
+            if (sqlite3_prepare_v2(db, deleteChunksSQL, -1, &deleteStmt, 0) != SQLITE_OK) {
+                std::cerr << "Failed to prepare chunk delete statement: " << sqlite3_errmsg(db) << std::endl;
+                break;
+            }
+            sqlite3_bind_text(deleteStmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(deleteStmt, 2, dayText.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(deleteStmt, 3, nextDayText.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(deleteStmt) == SQLITE_DONE) {
+                movedSamples += static_cast<long long>(sampleCount);
+            } else {
+                std::cerr << "Failed to delete tiered chunks for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+            }
+            sqlite3_finalize(deleteStmt);
+        }
     }
     
-    int maxDelay = 0, minDelay = 0;
-    if (sqlite3_step(maxMinDelayStmt) == SQLITE_ROW) {
-        maxDelay = sqlite3_column_int(maxMinDelayStmt, 0);
-        minDelay = sqlite3_column_int(maxMinDelayStmt, 1);
+    // 整个周期都已分层的分区文件不再包含数据，直接删除
+    for (const auto& partition : listPartitions()) {
+        if (partition.end <= cutoff && !incompleteSchemas.contains(partition.schema)) {
+            dropPartitionFile(partition);
+        }
     }
-    sqlite3_finalize(maxMinDelayStmt);
-    
-    std::cout << "Maximum delay (successful pings): " << maxDelay << "ms" << std::endl;
-    std::cout << "Minimum delay (successful pings): " << minDelay << "ms" << std::endl;
     
-    // 显示最近的10条记录
-    std::ostringstream recentSQLStream;
-    recentSQLStream << "SELECT delay, success, timestamp FROM " << tableName << " ORDER BY timestamp DESC LIMIT 10;";
-    std::string recentSQL = recentSQLStream.str();
-    
-    sqlite3_stmt* recentStmt;
-    rc = sqlite3_prepare_v2(db, recentSQL.c_str(), -1, &recentStmt, 0);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare recent records statement: " << sqlite3_errmsg(db) << std::endl;
-        return;
+    // 删除样本留下的空闲页分批回收
+    if (convertToIncrementalVacuum()) {
+        reclaimFreePages(CLEANUP_VACUUM_PAGES);
     }
     
-    std::cout << "\nRecent ping records (last 10):" << std::endl;
-    std::cout << "Timestamp           \tDelay\tStatus" << std::endl;
-    std::cout << "--------------------------------------------------------" << std::endl;
-    
-    while (sqlite3_step(recentStmt) == SQLITE_ROW) {
-        const char* timestamp = (const char*)sqlite3_column_text(recentStmt, 2);
-        int delay = sqlite3_column_int(recentStmt, 0);
-        int success = sqlite3_column_int(recentStmt, 1);
-        
-        std::cout << (timestamp ? timestamp : "N/A") << "\t" 
-                  << delay << "ms\t" 
-                  << (success ? "Success" : "Failed") << std::endl;
-    }
-    sqlite3_finalize(recentStmt);
+    auto [segmentBytes, segmentFiles] = segmentStore.diskUsage();
+    std::cout << "Moved " << movedSamples << " samples into " << writtenSegments << " segment files" << std::endl;
+    std::cout << "Segment store: " << segmentFiles << " files, " << segmentBytes << " bytes" << std::endl;
 }
 
 void DatabaseManager::cleanupOldData(int days) {
@@ -514,7 +2070,21 @@ void DatabaseManager::cleanupOldData(int days) {
     
     std::cout << "Cleaning up data older than " << days << " days..." << std::endl;
     
-    // 获取所有IP地址
+    // 分区文件：整个分区都早于截止日期时直接删除文件，无需逐行DELETE，也不会占用主数据库的写锁
+    // 原始行、分区、数据块、段文件和分钟汇总都使用同一个截止日，截止日当天的数据全部保留
+    std::chrono::sys_days cutoff = localToday() - std::chrono::days{days};
+    std::string cutoffText = formatDate(cutoff, "-");
+    int droppedPartitions = 0;
+    for (const auto& partition : listPartitions()) {
+        if (partition.end <= cutoff && dropPartitionFile(partition)) {
+            droppedPartitions++;
+        }
+    }
+    
+    // 段文件同样按天整体删除
+    int removedSegments = segmentStore.removeBefore(cutoff);
+    
+    // 主数据库中未分区的历史数据仍按行删除
     const char* selectHostsSQL = "SELECT ip FROM hosts;";
     sqlite3_stmt* hostsStmt;
     int rc = sqlite3_prepare_v2(db, selectHostsSQL, -1, &hostsStmt, 0);
@@ -523,59 +2093,143 @@ void DatabaseManager::cleanupOldData(int days) {
         return;
     }
     
-    int totalDeleted = 0;
-    
+    std::vector<std::string> hostIPs;
     while (sqlite3_step(hostsStmt) == SQLITE_ROW) {
         const char* ip = (const char*)sqlite3_column_text(hostsStmt, 0);
-        
         if (ip) {
-            std::string ipStr = ip;
-            std::string tableName = ipToTableName(ipStr);
-            
-            // 删除指定天数之前的数据
-            std::ostringstream deleteSQLStream;
-            deleteSQLStream << "DELETE FROM " << tableName << " WHERE timestamp < datetime('now', '-" << days << " days');";
-            std::string deleteSQL = deleteSQLStream.str();
-            
-            char* errMsg = 0;
-            rc = sqlite3_exec(db, deleteSQL.c_str(), 0, 0, &errMsg);
-            if (rc != SQLITE_OK) {
-                std::cerr << "SQL error deleting old data for IP " << ipStr << ": " << errMsg << std::endl;
-                sqlite3_free(errMsg);
-                continue;
-            }
-            
-            int deletedRows = sqlite3_changes(db);
-            totalDeleted += deletedRows;
-            
-            if (deletedRows > 0) {
-                std::cout << "Deleted " << deletedRows << " old records for IP " << ipStr << std::endl;
-            }
+            hostIPs.push_back(ip);
         }
     }
-    
     sqlite3_finalize(hostsStmt);
     
-    // 清理hosts表中没有关联数据的IP记录
-    const char* cleanHostsSQL = R"(
-        DELETE FROM hosts WHERE ip NOT IN (
-            SELECT DISTINCT substr(name, 4) FROM sqlite_master 
-            WHERE type = 'table' AND name LIKE 'ip_%'
-        );
-    )";
+    int totalDeleted = 0;
     
-    char* errMsg = 0;
-    rc = sqlite3_exec(db, cleanHostsSQL, 0, 0, &errMsg);
+    for (const auto& ipStr : hostIPs) {
+        std::string tableName = ipToTableName(ipStr);
+        if (!tableExists("main", tableName)) {
+            continue;
+        }
+        
+        // 删除截止日之前的数据："YYYY-MM-DD"按字符串比较小于当天的全部时间戳
+        std::string deleteSQL = "DELETE FROM " + tableName + " WHERE timestamp < ?;";
+        sqlite3_stmt* deleteStmt;
+        if (sqlite3_prepare_v2(db, deleteSQL.c_str(), -1, &deleteStmt, 0) != SQLITE_OK) {
+            std::cerr << "Failed to prepare delete statement for IP " << ipStr << ": " << sqlite3_errmsg(db) << std::endl;
+            continue;
+        }
+        sqlite3_bind_text(deleteStmt, 1, cutoffText.c_str(), -1, SQLITE_STATIC);
+        rc = sqlite3_step(deleteStmt);
+        sqlite3_finalize(deleteStmt);
+        if (rc != SQLITE_DONE) {
+            std::cerr << "SQL error deleting old data for IP " << ipStr << ": " << sqlite3_errmsg(db) << std::endl;
+            continue;
+        }
+        
+        int deletedRows = sqlite3_changes(db);
+        totalDeleted += deletedRows;
+        
+        if (deletedRows > 0) {
+            std::cout << "Deleted " << deletedRows << " old records for IP " << ipStr << std::endl;
+        }
+    }
+    
+    // chunked布局的数据块按小时桶删除
+    {
+        sqlite3_stmt* deleteChunksStmt;
+        lastChunks.clear();
+        if (sqlite3_prepare_v2(db, "DELETE FROM sample_chunks WHERE bucket < ?;", -1, &deleteChunksStmt, 0) != SQLITE_OK) {
+            std::cerr << "Failed to prepare chunk delete statement: " << sqlite3_errmsg(db) << std::endl;
+        } else {
+            sqlite3_bind_text(deleteChunksStmt, 1, cutoffText.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(deleteChunksStmt) == SQLITE_DONE) {
+                if (sqlite3_changes(db) > 0) {
+                    std::cout << "Deleted " << sqlite3_changes(db) << " old sample chunks" << std::endl;
+                }
+            } else {
+                std::cerr << "SQL error deleting old sample chunks: " << sqlite3_errmsg(db) << std::endl;
+            }
+            sqlite3_finalize(deleteChunksStmt);
+        }
+    }
+    
+    // 清理hosts表中在主数据库、剩余分区、数据块和段文件中都没有数据的IP记录
+    sqlite3_stmt* chunkExistsStmt = nullptr;
+    sqlite3_prepare_v2(db, "SELECT 1 FROM sample_chunks WHERE ip = ? LIMIT 1;", -1, &chunkExistsStmt, 0);
+    const char* deleteHostSQL = "DELETE FROM hosts WHERE ip = ?;";
+    sqlite3_stmt* deleteHostStmt;
+    rc = sqlite3_prepare_v2(db, deleteHostSQL, -1, &deleteHostStmt, 0);
     if (rc != SQLITE_OK) {
-        std::cerr << "SQL error cleaning hosts table: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
+        std::cerr << "Failed to prepare host delete statement: " << sqlite3_errmsg(db) << std::endl;
     } else {
-        int deletedHosts = sqlite3_changes(db);
+        int deletedHosts = 0;
+        for (const auto& ipStr : hostIPs) {
+            bool hasData = false;
+            forEachSampleSource(ipToTableName(ipStr), [&](const std::string&) {
+                hasData = true;
+                return false;  // 找到一个来源即可停止
+            });
+            if (!hasData && chunkExistsStmt) {
+                sqlite3_bind_text(chunkExistsStmt, 1, ipStr.c_str(), -1, SQLITE_STATIC);
+                hasData = sqlite3_step(chunkExistsStmt) == SQLITE_ROW;
+                sqlite3_reset(chunkExistsStmt);
+            }
+            if (hasData || segmentStore.hasHost(ipStr)) {
+                continue;
+            }
+            sqlite3_bind_text(deleteHostStmt, 1, ipStr.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(deleteHostStmt) == SQLITE_DONE) {
+                deletedHosts += sqlite3_changes(db);
+            } else {
+                std::cerr << "SQL error cleaning hosts table: " << sqlite3_errmsg(db) << std::endl;
+            }
+            sqlite3_reset(deleteHostStmt);
+        }
+        sqlite3_finalize(deleteHostStmt);
+        
         if (deletedHosts > 0) {
             std::cout << "Deleted " << deletedHosts << " unused host records" << std::endl;
         }
     }
+    sqlite3_finalize(chunkExistsStmt);
+    
+    // 汇总表：分钟汇总随原始数据一起过期，小时汇总保留更长时间，天汇总永久保留，-q的总计在-C之后仍然可用
+    {
+        std::string hourCutoffText = formatDate(localToday() - std::chrono::days{days * ROLLUP_HOUR_RETENTION_FACTOR}, "-");
+        for (const auto& [rollupTable, rollupCutoff] : {std::pair<const char*, const std::string*>{"rollup_minute", &cutoffText},
+                                                        std::pair<const char*, const std::string*>{"rollup_hour", &hourCutoffText}}) {
+            sqlite3_stmt* deleteRollupStmt;
+            std::string deleteSQL = "DELETE FROM " + std::string(rollupTable) + " WHERE bucket < ?;";
+            if (sqlite3_prepare_v2(db, deleteSQL.c_str(), -1, &deleteRollupStmt, 0) != SQLITE_OK) {
+                std::cerr << "Failed to prepare rollup delete statement: " << sqlite3_errmsg(db) << std::endl;
+                continue;
+            }
+            sqlite3_bind_text(deleteRollupStmt, 1, rollupCutoff->c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(deleteRollupStmt) != SQLITE_DONE) {
+                std::cerr << "SQL error deleting old rollups from " << rollupTable << ": " << sqlite3_errmsg(db) << std::endl;
+            } else if (sqlite3_changes(db) > 0) {
+                std::cout << "Deleted " << sqlite3_changes(db) << " old rows from " << rollupTable << std::endl;
+            }
+            sqlite3_finalize(deleteRollupStmt);
+        }
+    }
     
+    // 已有数据库首次清理时转换为增量auto_vacuum；之后空闲页分批回收，剩余部分在后续的ping周期中逐步回收
+    if (convertToIncrementalVacuum()) {
+        long long freeBefore = queryPragma("freelist_count");
+        reclaimFreePages(CLEANUP_VACUUM_PAGES);
+        long long freeAfter = queryPragma("freelist_count");
+        if (freeBefore > 0) {
+            std::cout << "Reclaimed " << (freeBefore - freeAfter) << " free pages, " << freeAfter
+                      << " left for incremental reclamation" << std::endl;
+        }
+    }
+    
+    if (droppedPartitions > 0) {
+        std::cout << "Dropped partitions: " << droppedPartitions << std::endl;
+    }
+    if (removedSegments > 0) {
+        std::cout << "Removed segment files: " << removedSegments << std::endl;
+    }
     std::cout << "Total deleted records: " << totalDeleted << std::endl;
     std::cout << "Cleanup completed." << std::endl;
 }
@@ -649,6 +2303,10 @@ bool DatabaseManager::addAlert(const std::string& ip, const std::string& hostnam
         return false;
     }
     
+    if (alertStateLoaded) {
+        activeAlerts.insert(ip);
+    }
+    
     return true;
 }
 
@@ -735,94 +2393,226 @@ bool DatabaseManager::removeAlert(const std::string& ip) {
         }
     }
     
+    activeAlerts.erase(ip);
+    
     return true;
 }
 
-std::vector<std::tuple<std::string, std::string, std::string>> DatabaseManager::getActiveAlerts(int days) {
-    std::vector<std::tuple<std::string, std::string, std::string>> alerts;
+bool DatabaseManager::loadAlertState() {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, "SELECT ip FROM alerts;", -1, &stmt, 0);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare alert state query statement: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    
+    activeAlerts.clear();
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* ip = (const char*)sqlite3_column_text(stmt, 0);
+        if (ip) {
+            activeAlerts.insert(ip);
+        }
+    }
+    sqlite3_finalize(stmt);
+    
+    alertStateLoaded = true;
+    return true;
+}
+
+bool DatabaseManager::isAlertActive(const std::string& ip) const {
+    return activeAlerts.contains(ip);
+}
+
+// 批量写入告警状态变化：新告警插入alerts表，已恢复的告警移入recovery_records表
+// 每类语句只准备一次并在循环中重复绑定执行，与调用方的事务一起提交
+bool DatabaseManager::applyAlertTransitions(const std::vector<std::pair<std::string, std::string>>& newlyDown,
+                                            const std::vector<std::string>& newlyUp) {
+    if (!db) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    
+    if (newlyDown.empty() && newlyUp.empty()) {
+        return true;
+    }
+    
+    const char* insertAlertSQL = R"(
+        INSERT INTO alerts (ip, hostname, created_time)
+        VALUES (?, ?, datetime('now', 'localtime'))
+        ON CONFLICT(ip) DO NOTHING;
+    )";
+    const char* insertRecoverySQL = R"(
+        INSERT INTO recovery_records (ip, hostname, alert_time, recovery_time)
+        SELECT ip, hostname, created_time, datetime('now', 'localtime') FROM alerts WHERE ip = ?;
+    )";
+    const char* deleteAlertSQL = "DELETE FROM alerts WHERE ip = ?;";
+    
+    sqlite3_stmt* insertAlertStmt = nullptr;
+    sqlite3_stmt* insertRecoveryStmt = nullptr;
+    sqlite3_stmt* deleteAlertStmt = nullptr;
+    
+    bool success = sqlite3_prepare_v2(db, insertAlertSQL, -1, &insertAlertStmt, 0) == SQLITE_OK
+        && sqlite3_prepare_v2(db, insertRecoverySQL, -1, &insertRecoveryStmt, 0) == SQLITE_OK
+        && sqlite3_prepare_v2(db, deleteAlertSQL, -1, &deleteAlertStmt, 0) == SQLITE_OK;
+    if (!success) {
+        std::cerr << "Failed to prepare alert transition statements: " << sqlite3_errmsg(db) << std::endl;
+    }
+    
+    // 新出现的告警
+    for (const auto& [ip, hostname] : newlyDown) {
+        if (!success) {
+            break;
+        }
+        sqlite3_bind_text(insertAlertStmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertAlertStmt, 2, hostname.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(insertAlertStmt) != SQLITE_DONE) {
+            std::cerr << "Failed to insert alert for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+            success = false;
+        }
+        sqlite3_reset(insertAlertStmt);
+    }
+    
+    // 已恢复的主机：先写入恢复记录，再删除告警
+    for (const auto& ip : newlyUp) {
+        if (!success) {
+            break;
+        }
+        sqlite3_bind_text(insertRecoveryStmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(deleteAlertStmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(insertRecoveryStmt) != SQLITE_DONE || sqlite3_step(deleteAlertStmt) != SQLITE_DONE) {
+            std::cerr << "Failed to resolve alert for IP " << ip << ": " << sqlite3_errmsg(db) << std::endl;
+            success = false;
+        }
+        sqlite3_reset(insertRecoveryStmt);
+        sqlite3_reset(deleteAlertStmt);
+    }
+    
+    sqlite3_finalize(insertAlertStmt);
+    sqlite3_finalize(insertRecoveryStmt);
+    sqlite3_finalize(deleteAlertStmt);
+    
+    if (success) {
+        for (const auto& [ip, hostname] : newlyDown) {
+            activeAlerts.insert(ip);
+        }
+        for (const auto& ip : newlyUp) {
+            activeAlerts.erase(ip);
+        }
+    }
     
+    return success;
+}
+
+// 辅助函数：读取可能为NULL的文本列
+static std::string_view columnText(sqlite3_stmt* stmt, int column) {
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    return text ? std::string_view(text, sqlite3_column_bytes(stmt, column)) : std::string_view();
+}
+
+// 按(created_time, ip)顺序逐行读取告警，直接走idx_alerts_created索引，结果不在内存中累积
+bool DatabaseManager::forEachActiveAlert(int days, const std::string& afterTime, const std::string& afterIP, long long limit,
+                                         const AlertVisitor& visit) {
     if (!db) {
         std::cerr << "Database not initialized" << std::endl;
-        return alerts;
+        return false;
     }
     
-    // 查询活动告警
-    std::string selectAlertsSQL;
+    // 键集分页：从上一页最后一行的(创建时间, IP)之后继续，该告警已解除时也不受影响
+    std::string selectAlertsSQL = "SELECT ip, hostname, created_time FROM alerts WHERE ip IS NOT NULL";
     if (days >= 0) {
-        // 查询指定天数内的告警
-        std::ostringstream sqlStream;
-        sqlStream << "SELECT ip, hostname, created_time FROM alerts WHERE created_time >= datetime('now', '-" << days << " days');";
-        selectAlertsSQL = sqlStream.str();
-    } else {
-        // 查询所有告警
-        selectAlertsSQL = "SELECT ip, hostname, created_time FROM alerts;";
+        selectAlertsSQL += " AND created_time >= datetime('now', ?1)";
     }
+    if (!afterTime.empty()) {
+        selectAlertsSQL += " AND (created_time, ip) > (?2, ?4)";
+    }
+    selectAlertsSQL += " ORDER BY created_time, ip LIMIT ?3;";
     
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, selectAlertsSQL.c_str(), -1, &stmt, 0);
     if (rc != SQLITE_OK) {
         std::cerr << "Failed to prepare alerts query statement: " << sqlite3_errmsg(db) << std::endl;
-        return alerts;
+        return false;
     }
+    std::string interval = "-" + std::to_string(days) + " days";
+    sqlite3_bind_text(stmt, 1, interval.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, afterTime.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 3, limit);  // 负数表示不限行数
+    sqlite3_bind_text(stmt, 4, afterIP.c_str(), -1, SQLITE_STATIC);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char* ip = (const char*)sqlite3_column_text(stmt, 0);
-        const char* hostname = (const char*)sqlite3_column_text(stmt, 1);
-        const char* created_time = (const char*)sqlite3_column_text(stmt, 2);
-        
-        if (ip) {
-            std::string ipStr = ip ? ip : "";
-            std::string hostnameStr = hostname ? hostname : "";
-            std::string timeStr = created_time ? created_time : "";
-            alerts.emplace_back(ipStr, hostnameStr, timeStr);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (!visit(columnText(stmt, 0), columnText(stmt, 1), columnText(stmt, 2))) {
+            rc = SQLITE_DONE;
+            break;
         }
     }
-    
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to read alerts: " << sqlite3_errmsg(db) << std::endl;
+    }
     sqlite3_finalize(stmt);
-    return alerts;
+    return rc == SQLITE_DONE;
 }
-std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> DatabaseManager::getRecoveryRecords(int days) {
-    std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> records;
-    
+
+// 按(recovery_time, id)顺序逐行读取恢复记录，直接走idx_recovery_records_time索引
+bool DatabaseManager::forEachRecoveryRecord(int days, long long afterId, long long limit, const RecoveryVisitor& visit) {
     if (!db) {
         std::cerr << "Database not initialized" << std::endl;
-        return records;
+        return false;
     }
     
-    // 查询恢复记录
-    std::string selectRecordsSQL;
+    // 键集分页：从上一页最后一条记录之后继续；该记录已被清理时它早于全部剩余记录，从头开始
+    std::string selectRecordsSQL = "SELECT id, ip, hostname, alert_time, recovery_time FROM recovery_records WHERE 1";
     if (days >= 0) {
-        // 查询指定天数内的恢复记录
-        std::ostringstream sqlStream;
-        sqlStream << "SELECT id, ip, hostname, alert_time, recovery_time FROM recovery_records WHERE recovery_time >= datetime('now', '-" << days << " days');";
-        selectRecordsSQL = sqlStream.str();
-    } else {
-        // 查询所有恢复记录
-        selectRecordsSQL = "SELECT id, ip, hostname, alert_time, recovery_time FROM recovery_records;";
+        selectRecordsSQL += " AND recovery_time >= datetime('now', ?1)";
+    }
+    if (afterId > 0) {
+        selectRecordsSQL += " AND (recovery_time, id) > (COALESCE((SELECT recovery_time FROM recovery_records WHERE id = ?2), ''), ?2)";
     }
+    selectRecordsSQL += " ORDER BY recovery_time, id LIMIT ?3;";
     
     sqlite3_stmt* stmt;
     int rc = sqlite3_prepare_v2(db, selectRecordsSQL.c_str(), -1, &stmt, 0);
     if (rc != SQLITE_OK) {
         std::cerr << "Failed to prepare recovery records query statement: " << sqlite3_errmsg(db) << std::endl;
-        return records;
+        return false;
     }
+    std::string interval = "-" + std::to_string(days) + " days";
+    sqlite3_bind_text(stmt, 1, interval.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, afterId);
+    sqlite3_bind_int64(stmt, 3, limit);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int id = sqlite3_column_int(stmt, 0);
-        const char* ip = (const char*)sqlite3_column_text(stmt, 1);
-        const char* hostname = (const char*)sqlite3_column_text(stmt, 2);
-        const char* alert_time = (const char*)sqlite3_column_text(stmt, 3);
-        const char* recovery_time = (const char*)sqlite3_column_text(stmt, 4);
-        
-        std::string ipStr = ip ? ip : "";
-        std::string hostnameStr = hostname ? hostname : "";
-        std::string alertTimeStr = alert_time ? alert_time : "";
-        std::string recoveryTimeStr = recovery_time ? recovery_time : "";
-        
-        records.emplace_back(id, ipStr, hostnameStr, alertTimeStr, recoveryTimeStr);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (!visit(sqlite3_column_int64(stmt, 0), columnText(stmt, 1), columnText(stmt, 2), columnText(stmt, 3), columnText(stmt, 4))) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to read recovery records: " << sqlite3_errmsg(db) << std::endl;
     }
-    
     sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+std::vector<std::tuple<std::string, std::string, std::string>> DatabaseManager::getActiveAlerts(int days) {
+    std::vector<std::tuple<std::string, std::string, std::string>> alerts;
+    forEachActiveAlert(days, "", "", -1, [&](std::string_view ip, std::string_view hostname, std::string_view createdTime) {
+        alerts.emplace_back(ip, hostname, createdTime);
+        return true;
+    });
+    return alerts;
+}
+
+std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> DatabaseManager::getRecoveryRecords(int days) {
+    std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> records;
+    forEachRecoveryRecord(days, 0, -1, [&](long long id, std::string_view ip, std::string_view hostname,
+                                           std::string_view alertTime, std::string_view recoveryTime) {
+        records.emplace_back(static_cast<int>(id), ip, hostname, alertTime, recoveryTime);
+        return true;
+    });
     return records;
 }
\ No newline at end of file
@@ -2,44 +2,172 @@
 #define DATABASE_MANAGER_H
 
 #include <string>
+#include <string_view>
 #include <sqlite3.h>
 #include <vector>
 #include <tuple>
 #include <map>
+#include <optional>
+#include <unordered_set>
+#include <set>
+#include <chrono>
+#include <functional>
 #include <regex>
+#include <cstdint>
+#include "segment_store.h"
 
 class DatabaseManager {
+public:
+    // 样本分区文件信息：每个分区是一个独立的SQLite文件，按需ATTACH到主连接
+    struct Partition {
+        std::string path;
+        std::string schema;
+        std::chrono::sys_days start;
+        std::chrono::sys_days end;
+    };
+    
+    // 样本统计：可由原始样本表或汇总表累加得到
+    struct SampleStatistics {
+        long long total = 0;
+        long long successes = 0;
+        double delaySum = 0;
+        int maxDelay = 0;
+        int minDelay = 0;
+        
+        void merge(long long count, long long successCount, double sum, int maxValue, int minValue);
+    };
+    
+    // 逐行查询的回调：(IP, 主机名, 告警时间) 和 (ID, IP, 主机名, 告警时间, 恢复时间)
+    using AlertVisitor = std::function<bool(std::string_view, std::string_view, std::string_view)>;
+    using RecoveryVisitor = std::function<bool(long long, std::string_view, std::string_view, std::string_view, std::string_view)>;
+
 private:
     sqlite3* db;
     std::string dbPath;
+    std::unordered_set<std::string> activeAlerts;  // 处于告警中的主机IP
+    bool alertStateLoaded = false;
+    std::string partitionPeriod;  // day或week，空表示样本写入主数据库
+    std::set<std::string> attachedPartitions;  // 当前已ATTACH的分区schema
+    std::unordered_set<std::string> provisionedTables;  // 已建好的样本表，键为"schema.表名"
+    std::vector<std::string> pendingTables;  // 当前事务中新建的样本表，回滚时从缓存中移除
+    SegmentStore segmentStore;  // 冷数据段文件，位于 <数据库路径>.segments
+    std::string sampleStore = "rows";  // 样本布局：rows为每个样本一行，chunked为按小时打包的数据块
+    std::size_t chunkFlushThreshold = 1;  // 每台主机内存中累积多少个样本后写入数据块
+    std::map<std::pair<std::string, std::string>, std::vector<std::uint32_t>> chunkTail;  // (ip, 小时) -> 尚未写入的打包样本
+    std::optional<decltype(chunkTail)> committedTail;  // 当前事务开始时的尾部，回滚时恢复
+    std::map<std::string, std::tuple<std::string, long long, std::size_t>> lastChunks;  // ip -> 最近写入的数据块 (小时, seq, 样本数)
+    bool bulkLoading = false;  // 批量导入中：新建的样本表推迟建索引
+    std::set<std::string> deferredIndexTables;  // 尚未建索引的样本表，键为"schema.表名"
+    long long savedCacheSize = 0;  // 批量导入前的cache_size，结束后恢复
+    
+    static constexpr long long BULK_LOAD_CACHE_KIB = -262144;  // 批量导入期间的页缓存：256 MiB（负数表示KiB）
 
 public:
     DatabaseManager(const std::string& path);
     ~DatabaseManager();
     
     bool initialize();
+    
+    // 事务控制：供StorageSession将一轮的全部写入合并为一个事务
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+    
+    // 样本分区：设置并持久化分区周期，写入前ATTACH本批次所需的分区文件
+    bool setPartitionPeriod(const std::string& period);
+    bool prepareWrite(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    std::vector<Partition> listPartitions();
+    
+    // 样本布局：设置并持久化rows/chunked；chunked模式下样本先进入内存尾部，累积到阈值后追加到数据块
+    bool setSampleStore(const std::string& store);
+    void setChunkFlushThreshold(std::size_t samples);
+    bool flushChunkTail();
+    
+    // 批量导入：期间新建的样本表推迟到endBulkLoad（或分区DETACH前）再建索引，并临时增大页缓存
+    bool beginBulkLoad();
+    bool endBulkLoad();
+    
     bool insertPingResult(const std::string& ip, const std::string& hostname, short delay, bool success, const std::string& timestamp);
     bool insertPingResults(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
-    void queryIPStatistics(const std::string& ip);
+    // 查询统计；since/until非空时只统计[since, until)范围内的原始样本
+    // showRecent为false时只输出总计，不输出最近的记录（由运行中的实例提供）
+    void queryIPStatistics(const std::string& ip, const std::string& since = "", const std::string& until = "", bool showRecent = true);
     void cleanupOldData(int days = 30);
+    
+    // 冷数据分层：把早于指定天数的样本移入段文件，并从样本表中删除
+    void tierColdData(int days);
+    
+    // 空间回收：每次最多回收maxPages个空闲页，以及打印空间与碎片统计
+    bool reclaimFreePages(int maxPages);
+    void printDatabaseStats();
     std::map<std::string, std::string> getAllHosts();
     
     // 告警表相关方法
     bool addAlert(const std::string& ip, const std::string& hostname);
     bool removeAlert(const std::string& ip);
+    
+    // 告警状态缓存：一次性加载处于告警中的主机，之后每轮只写入状态变化
+    bool loadAlertState();
+    bool isAlertActive(const std::string& ip) const;
+    bool applyAlertTransitions(const std::vector<std::pair<std::string, std::string>>& newlyDown,  // (ip, hostname)
+                               const std::vector<std::string>& newlyUp);
     std::vector<std::tuple<std::string, std::string, std::string>> getActiveAlerts(int days = -1);  // 返回指定天数内的告警，-1表示获取所有告警
     
     // 恢复记录相关方法
     std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> getRecoveryRecords(int days = -1);  // 返回指定天数内的恢复记录，-1表示获取所有恢复记录
     
+    // 游标式查询：按时间顺序逐行回调，不在内存中保存整个结果，回调返回false时停止
+    // 键集分页：(afterTime, afterIP)/afterId为上一页最后一行的键，afterTime为空时从头开始，limit<0表示不限行数
+    bool forEachActiveAlert(int days, const std::string& afterTime, const std::string& afterIP, long long limit, const AlertVisitor& visit);
+    bool forEachRecoveryRecord(int days, long long afterId, long long limit, const RecoveryVisitor& visit);
+
+    // 导出：遍历一台主机在[since, until)范围内的全部样本（空字符串表示不限），visit返回false时停止
+    bool forEachSample(const std::string& ip, const std::string& since, const std::string& until,
+                       const std::function<bool(const SegmentStore::Sample&)>& visit);
+
 private:
     // 辅助方法
     bool validateAndPrepareIPs(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
     bool upsertHosts(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
     bool insertPingResultsBatch(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
-    bool createIPTable(const std::string& ip);
+    bool appendChunkSamples(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    bool writeChunkSamples(const std::string& ip, const std::string& bucket, const std::vector<std::uint32_t>& packed);
+    bool readChunkSamples(const std::string& ip, const std::string& fromBucket, const std::string& toBucket, bool newestFirst,
+                          const std::function<bool(const SegmentStore::Sample&)>& visit);
+    bool createIPTable(const std::string& ip, const std::string& schema = "main");
+    bool createSampleIndex(const std::string& schema, const std::string& tableName);
+    bool buildDeferredIndexes(const std::string& schema);
+    std::string sampleSchemaFor(const std::string& timestamp);
+    std::string partitionDirectory() const;
+    bool attachPartition(const Partition& partition);
+    bool detachPartition(const std::string& schema);
+    bool dropPartitionFile(const Partition& partition);
+    bool tableExists(const std::string& schema, const std::string& tableName);
+    std::vector<std::string> listSampleTables(const std::string& schema);
+    bool upgradeSampleTables(const std::string& schema);
+    void loadProvisionedTables(const std::string& schema);
+    bool forEachSampleSource(const std::string& tableName, const std::function<bool(const std::string&)>& visit,
+                             const std::string& since = "", const std::string& until = "");
     std::string ipToTableName(const std::string& ip);
     bool isValidIP(const std::string& ip);
+    bool executeTransactionStatement(const char* sql, const char* action);
+    bool saveSetting(const std::string& key, const std::string& value);
+    bool createSchema();
+    bool createRollupTables();
+    bool backfillRollups();
+    bool updateRollups(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    bool collectRollupStatistics(const std::string& ip, SampleStatistics& stats, std::string& firstDay);
+    bool collectRawStatistics(const std::string& ip, SampleStatistics* stats,
+                              std::vector<std::tuple<std::string, int, int>>& recentRecords,
+                              const std::string& since = "", const std::string& until = "");
+    bool collectChunkStatistics(const std::string& ip, SampleStatistics* stats,
+                                std::vector<std::tuple<std::string, int, int>>& recentRecords,
+                                const std::string& since = "", const std::string& until = "");
+    bool collectSegmentStatistics(const std::string& ip, SampleStatistics* stats,
+                                  std::vector<std::tuple<std::string, int, int>>& recentRecords,
+                                  const std::string& since = "", const std::string& until = "");
+    long long queryPragma(const std::string& pragma);
+    bool convertToIncrementalVacuum();
 };
 
 #endif // DATABASE_MANAGER_H
\ No newline at end of file
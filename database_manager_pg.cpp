@@ -6,11 +6,189 @@
 #include <cctype>
 #include <iomanip>
 #include <map>
+#include <set>
 #include <regex>
 #include <stdexcept>
 #include <cstring>
+#include <ctime>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <thread>
+#include <functional>
+#include <limits>
 
-DatabaseManagerPG::DatabaseManagerPG(const std::string& connectionInfo) : connInfo(connectionInfo), conn(nullptr) {
+// 汇总表：表名及date_trunc使用的时间粒度
+static const std::pair<const char*, const char*> ROLLUP_TABLES[] = {
+    {"rollup_minute", "minute"},
+    {"rollup_hour", "hour"},
+    {"rollup_day", "day"},
+};
+
+// 小时汇总的保留时间是原始数据保留天数的倍数，天汇总永久保留
+static const int ROLLUP_HOUR_RETENTION_FACTOR = 12;
+
+// 本地时间的今天，样本时间戳按写入端的本地时间保存
+static std::chrono::sys_days localToday() {
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    return std::chrono::sys_days{std::chrono::year{local.tm_year + 1900} / (local.tm_mon + 1) / local.tm_mday};
+}
+
+static std::string formatDate(std::chrono::sys_days date) {
+    std::chrono::year_month_day ymd{date};
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", static_cast<int>(ymd.year()),
+                  static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()));
+    return buffer;
+}
+
+// 数据库模式版本，保存在schema_version表中；版本一致时initialize跳过全部建表语句
+// 修改建表语句或索引时递增
+static const int SCHEMA_VERSION = 3;
+
+// 样本分区：samples按天分区，分区名为samples_YYYYMMDD；提前创建今后若干天的分区
+static const int SAMPLE_PARTITION_DAYS_AHEAD = 7;
+
+static std::string samplePartitionName(std::chrono::sys_days date) {
+    std::string dateText = formatDate(date);
+    dateText.erase(std::remove(dateText.begin(), dateText.end(), '-'), dateText.end());
+    return "samples_" + dateText;
+}
+
+static std::string samplePartitionSQL(std::chrono::sys_days date) {
+    return "CREATE TABLE IF NOT EXISTS " + samplePartitionName(date) + " PARTITION OF samples FOR VALUES FROM ('" +
+           formatDate(date) + "') TO ('" + formatDate(date + std::chrono::days{1}) + "')";
+}
+
+// 旧版本每个IP一张ping_*表，迁移前仍可清理和分层
+static const char* LEGACY_TABLES_SQL =
+    "SELECT h.ip, t.tablename FROM hosts h "
+    "JOIN pg_tables t ON t.tablename = 'ping_' || replace(h.ip, '.', '_') AND t.schemaname = current_schema();";
+
+// 已挂载到samples的分区及其起始日期，按日期排序
+static const char* SAMPLE_PARTITIONS_SQL =
+    "SELECT c.relname, to_char(to_date(substr(c.relname, 9), 'YYYYMMDD'), 'YYYY-MM-DD') FROM pg_inherits i "
+    "JOIN pg_class c ON c.oid = i.inhrelid JOIN pg_class p ON p.oid = i.inhparent "
+    "WHERE p.relname = 'samples' AND p.relnamespace = to_regnamespace(current_schema()) ORDER BY 1;";
+
+// COPY二进制格式：文件头为签名、标志位和扩展区长度，每行以字段数开头，每个字段为长度加网络字节序的值
+static const char COPY_BINARY_SIGNATURE[] = "PGCOPY\n\377\r\n";
+// PostgreSQL的timestamp以2000-01-01为起点的微秒数保存
+static const std::int64_t POSTGRES_EPOCH_OFFSET = 946684800;
+
+static void appendInt16(std::string& buffer, std::int16_t value) {
+    std::uint16_t networkValue = htons(static_cast<std::uint16_t>(value));
+    buffer.append(reinterpret_cast<const char*>(&networkValue), sizeof(networkValue));
+}
+
+static void appendInt32(std::string& buffer, std::int32_t value) {
+    std::uint32_t networkValue = htonl(static_cast<std::uint32_t>(value));
+    buffer.append(reinterpret_cast<const char*>(&networkValue), sizeof(networkValue));
+}
+
+static void appendInt64(std::string& buffer, std::int64_t value) {
+    appendInt32(buffer, static_cast<std::int32_t>(static_cast<std::uint64_t>(value) >> 32));
+    appendInt32(buffer, static_cast<std::int32_t>(static_cast<std::uint64_t>(value) & 0xFFFFFFFF));
+}
+
+static void appendTextField(std::string& buffer, const std::string& value) {
+    appendInt32(buffer, static_cast<std::int32_t>(value.size()));
+    buffer.append(value);
+}
+
+static std::int16_t readInt16(const char* data) {
+    std::uint16_t networkValue;
+    std::memcpy(&networkValue, data, sizeof(networkValue));
+    return static_cast<std::int16_t>(ntohs(networkValue));
+}
+
+static std::int32_t readInt32(const char* data) {
+    std::uint32_t networkValue;
+    std::memcpy(&networkValue, data, sizeof(networkValue));
+    return static_cast<std::int32_t>(ntohl(networkValue));
+}
+
+static std::int64_t readInt64(const char* data) {
+    std::uint64_t high = static_cast<std::uint32_t>(readInt32(data));
+    std::uint64_t low = static_cast<std::uint32_t>(readInt32(data + 4));
+    return static_cast<std::int64_t>((high << 32) | low);
+}
+
+// 服务器端预编译语句：在initialize中一次性准备，之后只传参数
+static const std::pair<const char*, const char*> PREPARED_STATEMENTS[] = {
+    {"add_alert", "INSERT INTO alerts (ip, hostname, created_time) VALUES ($1, $2, NOW()) ON CONFLICT (ip) DO NOTHING"},
+    {"resolve_alert", "WITH resolved AS (DELETE FROM alerts WHERE ip = $1 RETURNING ip, hostname, created_time) "
+                      "INSERT INTO recovery_records (ip, hostname, alert_time, recovery_time) "
+                      "SELECT ip, hostname, created_time, NOW() FROM resolved"},
+    {"host_name", "SELECT hostname FROM hosts WHERE ip = $1"},
+    {"rollup_stats", "SELECT COALESCE(SUM(count), 0), COALESCE(SUM(successes), 0), COALESCE(SUM(rtt_sum), 0), "
+                     "COALESCE(MAX(rtt_max), 0), COALESCE(MIN(rtt_min), 0), to_char(MIN(bucket), 'YYYY-MM-DD') "
+                     "FROM rollup_day WHERE ip = $1"},
+};
+
+// 管道模式下每批最多发送的语句数，每批一次往返；限制批大小避免双方的套接字缓冲区同时写满
+static const size_t PIPELINE_BATCH = 512;
+
+// 汇总表的累加规则：LEAST/GREATEST会忽略NULL（没有成功样本的时间桶）
+static std::string rollupUpsertClause(const std::string& rollupTable) {
+    return " ON CONFLICT (ip, bucket) DO UPDATE SET "
+           "count = " + rollupTable + ".count + EXCLUDED.count, "
+           "successes = " + rollupTable + ".successes + EXCLUDED.successes, "
+           "rtt_sum = " + rollupTable + ".rtt_sum + EXCLUDED.rtt_sum, "
+           "rtt_min = LEAST(" + rollupTable + ".rtt_min, EXCLUDED.rtt_min), "
+           "rtt_max = GREATEST(" + rollupTable + ".rtt_max, EXCLUDED.rtt_max)";
+}
+
+// 从incoming_samples写入hosts、samples和各级汇总表的语句，同步写入和异步写入共用
+static const char* UPSERT_HOSTS_SQL =
+    "INSERT INTO hosts (ip, hostname, last_seen) "
+    "SELECT DISTINCT ON (ip) ip, hostname, NOW() FROM incoming_samples ORDER BY ip "
+    "ON CONFLICT (ip) DO UPDATE SET hostname = EXCLUDED.hostname, last_seen = EXCLUDED.last_seen";
+static const char* INSERT_SAMPLES_SQL =
+    "INSERT INTO samples (ip, delay, success, timestamp) SELECT ip, delay, success, ts FROM incoming_samples";
+
+static std::string rollupUpdateSQL() {
+    std::ostringstream rollupSQLStream;
+    rollupSQLStream << "WITH samples AS (SELECT ip, delay, success, ts FROM incoming_samples)";
+    
+    for (size_t i = 0; i < std::size(ROLLUP_TABLES); i++) {
+        const auto& [rollupTable, precision] = ROLLUP_TABLES[i];
+        bool last = (i + 1 == std::size(ROLLUP_TABLES));
+        rollupSQLStream << (last ? " " : ", " + std::string(rollupTable) + "_update AS (")
+                        << "INSERT INTO " << rollupTable << " (ip, bucket, count, successes, rtt_sum, rtt_min, rtt_max) "
+                        << "SELECT ip, date_trunc('" << precision << "', ts), COUNT(*), "
+                        << "COUNT(*) FILTER (WHERE success), COALESCE(SUM(delay) FILTER (WHERE success), 0), "
+                        << "MIN(delay) FILTER (WHERE success), MAX(delay) FILTER (WHERE success) "
+                        << "FROM samples GROUP BY 1, 2"
+                        << rollupUpsertClause(rollupTable)
+                        << (last ? "" : ")");
+    }
+    return rollupSQLStream.str();
+}
+
+// 异步写入不能使用COPY（管道模式不支持），样本以数组参数一次展开写入incoming_samples
+static const char* LOAD_INCOMING_SQL =
+    "INSERT INTO incoming_samples (ip, hostname, delay, success, ts) "
+    "SELECT * FROM unnest($1::text[], $2::text[], $3::integer[], $4::boolean[], $5::timestamp[])";
+
+// 数组文本格式的元素：加双引号，转义其中的双引号和反斜杠
+static void appendArrayElement(std::string& array, const std::string& value) {
+    array.push_back(array.empty() ? '{' : ',');
+    array.push_back('"');
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            array.push_back('\\');
+        }
+        array.push_back(c);
+    }
+    array.push_back('"');
+}
+
+DatabaseManagerPG::DatabaseManagerPG(const std::string& connectionInfo)
+    : connInfo(connectionInfo), conn(nullptr), segmentStore("") {
     if (connectionInfo.empty()) {
         throw std::invalid_argument("Database connection info cannot be empty");
     }
@@ -43,13 +221,37 @@ std::string DatabaseManagerPG::escapeString(const std::string& str) {
     return result;
 }
 
-bool DatabaseManagerPG::executeQuery(const std::string& query) {
+bool DatabaseManagerPG::executePrepared(const char* name, const std::vector<std::string>& params) {
     if (!conn) {
         std::println(std::cerr, "Database not initialized");
         return false;
     }
     
-    PGresult* res = PQexec(conn, query.c_str());
+    std::vector<const char*> values;
+    for (const auto& param : params) {
+        values.push_back(param.c_str());
+    }
+    PGresult* res = PQexecPrepared(conn, name, static_cast<int>(values.size()), values.data(), nullptr, nullptr, 0);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK && PQresultStatus(res) != PGRES_TUPLES_OK) {
+        std::println(std::cerr, "Query failed: {}", PQresultErrorMessage(res));
+        PQclear(res);
+        return false;
+    }
+    PQclear(res);
+    return true;
+}
+
+bool DatabaseManagerPG::executeQuery(const std::string& query) {
+    return executeQuery(conn, query);
+}
+
+bool DatabaseManagerPG::executeQuery(PGconn* connection, const std::string& query) {
+    if (!connection) {
+        std::println(std::cerr, "Database not initialized");
+        return false;
+    }
+    
+    PGresult* res = PQexec(connection, query.c_str());
     if (PQresultStatus(res) != PGRES_COMMAND_OK && PQresultStatus(res) != PGRES_TUPLES_OK) {
         std::println(std::cerr, "Query failed: {}", PQresultErrorMessage(res));
         PQclear(res);
@@ -59,6 +261,87 @@ bool DatabaseManagerPG::executeQuery(const std::string& query) {
     return true;
 }
 
+// 以管道模式发送一组互相独立的语句，每PIPELINE_BATCH条同步一次；
+// results不为空时按发送顺序返回全部结果（由调用方PQclear），否则直接释放
+bool DatabaseManagerPG::runPipeline(const std::vector<PipelineStatement>& statements, std::vector<PGresult*>* results) {
+    if (!conn) {
+        std::println(std::cerr, "Database not initialized");
+        return false;
+    }
+    
+    if (PQenterPipelineMode(conn) != 1) {
+        std::println(std::cerr, "Failed to enter pipeline mode: {}", PQerrorMessage(conn));
+        return false;
+    }
+    
+    bool success = true;
+    for (size_t batchStart = 0; batchStart < statements.size(); batchStart += PIPELINE_BATCH) {
+        size_t batchEnd = std::min(statements.size(), batchStart + PIPELINE_BATCH);
+        size_t sent = 0;
+        for (size_t i = batchStart; i < batchEnd; i++) {
+            const auto& statement = statements[i];
+            std::vector<const char*> values;
+            values.reserve(statement.params.size());
+            for (const auto& param : statement.params) {
+                values.push_back(param.c_str());
+            }
+            int nParams = static_cast<int>(values.size());
+            int queued = statement.prepared
+                ? PQsendQueryPrepared(conn, statement.sql.c_str(), nParams, values.data(), nullptr, nullptr, 0)
+                : PQsendQueryParams(conn, statement.sql.c_str(), nParams, nullptr, values.data(), nullptr, nullptr, 0);
+            if (queued != 1) {
+                std::println(std::cerr, "Failed to queue statement: {}", PQerrorMessage(conn));
+                success = false;
+                break;
+            }
+            sent++;
+        }
+        
+        if (PQpipelineSync(conn) != 1) {
+            std::println(std::cerr, "Failed to sync pipeline: {}", PQerrorMessage(conn));
+            success = false;
+        }
+        
+        // 每条语句返回一个结果和一个结束标记（nullptr），最后是同步点
+        for (size_t i = 0; i < sent; i++) {
+            PGresult* res = PQgetResult(conn);
+            ExecStatusType status = PQresultStatus(res);
+            if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+                if (success) {
+                    std::println(std::cerr, "Query failed: {}", PQresultErrorMessage(res));
+                }
+                success = false;
+            }
+            if (results) {
+                results->push_back(res);
+            } else {
+                PQclear(res);
+            }
+            while ((res = PQgetResult(conn)) != nullptr) {
+                PQclear(res);
+            }
+        }
+        PGresult* syncRes;
+        while ((syncRes = PQgetResult(conn)) != nullptr) {
+            bool reachedSync = PQresultStatus(syncRes) == PGRES_PIPELINE_SYNC;
+            PQclear(syncRes);
+            if (reachedSync) {
+                break;
+            }
+        }
+        
+        if (!success) {
+            break;
+        }
+    }
+    
+    if (PQexitPipelineMode(conn) != 1) {
+        std::println(std::cerr, "Failed to exit pipeline mode: {}", PQerrorMessage(conn));
+        success = false;
+    }
+    return success;
+}
+
 PGresult* DatabaseManagerPG::executeQueryWithResult(const std::string& query) {
     if (!conn) {
         std::println(std::cerr, "Database not initialized");
@@ -82,18 +365,88 @@ bool DatabaseManagerPG::initialize() {
         return false;
     }
     
-    // 设置client_min_messages参数以抑制NOTICE消息
-    // 检查连接字符串中是否包含client_min_messages参数
-    if (connInfo.find("client_min_messages") == std::string::npos) {
-        PGresult* res = PQexec(conn, "SET client_min_messages TO WARNING;");
-        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-            std::println(std::cerr, "Failed to set client_min_messages: {}", PQresultErrorMessage(res));
-            PQclear(res);
+    if (!suppressNotices(conn)) {
+        return false;
+    }
+    
+    // 段文件目录按连接实际使用的数据库名确定，与SQLite按数据库路径加.segments的规则对应，
+    // 不同的数据库不会共用同一个目录
+    segmentStore.setDirectory(std::string(PQdb(conn)) + ".segments");
+    
+    // 模式版本与当前版本一致时跳过全部建表语句，只在新数据库或升级时执行一次
+    int version = querySchemaVersion();
+    if (version < 0) {
+        return false;
+    }
+    if (version < SCHEMA_VERSION && !createSchema()) {
+        return false;
+    }
+    
+    // 分区会随日期推移而新增或被清理删除，每次启动都重新加载
+    if (!loadSamplePartitions()) {
+        return false;
+    }
+    
+    if (!prepareSession(conn)) {
+        return false;
+    }
+    
+    // 上次运行在两阶段提交中途退出时留下的分片事务
+    if (!resolvePreparedCycles()) {
+        return false;
+    }
+    
+    // 写入连接池：每个连接同样抑制NOTICE并准备会话级的临时表和预编译语句
+    // 分片与主连接以两阶段提交一起生效，服务器需要为每个分片保留一个预备事务
+    if (poolSize > 1) {
+        PGresult* limitRes = executeQueryWithResult("SHOW max_prepared_transactions;");
+        if (!limitRes) {
             return false;
         }
-        PQclear(res);
+        int preparedLimit = atoi(PQgetvalue(limitRes, 0, 0));
+        PQclear(limitRes);
+        if (preparedLimit < static_cast<int>(poolSize)) {
+            std::println(std::cerr, "--pool-size {} needs max_prepared_transactions >= {} on the server (currently {})",
+                         poolSize, poolSize, preparedLimit);
+            return false;
+        }
+        preparedPrefix = "mping_" + std::to_string(getpid()) + "_" +
+                         std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::system_clock::now().time_since_epoch()).count());
+        pool = std::make_unique<PgConnectionPool>(connInfo, poolSize, [this](PGconn* connection) {
+            return suppressNotices(connection) && prepareSession(connection);
+        });
+        if (!pool->open()) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// 读取数据库中记录的模式版本，尚未记录时返回0，查询失败返回-1
+int DatabaseManagerPG::querySchemaVersion() {
+    PGresult* res = executeQueryWithResult("SELECT to_regclass('schema_version') IS NOT NULL;");
+    if (!res) {
+        return -1;
+    }
+    bool recorded = std::strcmp(PQgetvalue(res, 0, 0), "t") == 0;
+    PQclear(res);
+    if (!recorded) {
+        return 0;
     }
     
+    res = executeQueryWithResult("SELECT COALESCE(MAX(version), 0) FROM schema_version;");
+    if (!res) {
+        return -1;
+    }
+    int version = atoi(PQgetvalue(res, 0, 0));
+    PQclear(res);
+    return version;
+}
+
+// 创建全部表和索引，最后记录模式版本
+bool DatabaseManagerPG::createSchema() {
     // 创建hosts表，用于存储IP地址与主机名的映射关系
     const char* createHostsTableSQL = R"(
         CREATE TABLE IF NOT EXISTS hosts (
@@ -139,184 +492,880 @@ bool DatabaseManagerPG::initialize() {
         return false;
     }
     
-    return true;
-}
-
-bool DatabaseManagerPG::insertPingResult(const std::string& ip, const std::string& hostname, short delay, bool success, const std::string& timestamp) {
-    // 验证IP地址格式
-    if (!isValidIP(ip)) {
-        std::cerr << "Invalid IP address format: " << ip << std::endl;
+    // 告警和恢复记录的时间索引：按天数过滤时走索引范围扫描，游标查询直接按索引顺序读取
+    const char* createTimeIndexesSQL = R"(
+        CREATE INDEX IF NOT EXISTS idx_alerts_created ON alerts (created_time, ip);
+        CREATE INDEX IF NOT EXISTS idx_recovery_records_time ON recovery_records (recovery_time, id);
+    )";
+    
+    if (!executeQuery(createTimeIndexesSQL)) {
+        std::println(std::cerr, "Failed to create alert time indexes");
         return false;
     }
     
-    // 创建一个包含单个结果的向量并调用批量插入函数
-    std::vector<std::tuple<std::string, std::string, short, bool, std::string>> results;
-    results.emplace_back(ip, hostname, delay, success, timestamp);
-    return insertPingResults(results);
-}
-
-// 辅助函数：验证IP地址格式
-bool DatabaseManagerPG::validateIPs(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
-    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
-        if (!isValidIP(ip)) {
-            std::cerr << "Invalid IP address format: " << ip << std::endl;
-            return false;
-        }
+    // 创建分钟、小时、天三级汇总表
+    if (!createRollupTables()) {
+        std::println(std::cerr, "Failed to create rollup tables");
+        return false;
+    }
+    
+    // 按天分区的样本表，所有主机共用
+    if (!createSamplesTable()) {
+        std::println(std::cerr, "Failed to create samples table");
+        return false;
+    }
+    
+    // 连接池两阶段提交的决定记录：主事务提交时写入本轮的事务标识，各分片随后COMMIT PREPARED
+    const char* createCommittedCyclesTableSQL = R"(
+        CREATE TABLE IF NOT EXISTS committed_cycles (
+            gid TEXT PRIMARY KEY,
+            committed_time TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+        );
+    )";
+    
+    if (!executeQuery(createCommittedCyclesTableSQL)) {
+        std::println(std::cerr, "Failed to create committed_cycles table");
+        return false;
+    }
+    
+    // 最后记录模式版本，中途失败时下次启动会重新执行全部建表语句
+    std::string versionSQL = "CREATE TABLE IF NOT EXISTS schema_version (version INTEGER NOT NULL);"
+                             "DELETE FROM schema_version;"
+                             "INSERT INTO schema_version VALUES (" + std::to_string(SCHEMA_VERSION) + ");";
+    if (!executeQuery(versionSQL)) {
+        std::println(std::cerr, "Failed to record schema version");
+        return false;
     }
+    
     return true;
 }
 
-// 辅助函数：创建IP表和索引
-bool DatabaseManagerPG::createIPTables(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
-    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
-        // 创建特定IP的表
-        std::ostringstream createTableSQLStream;
-        createTableSQLStream << "CREATE TABLE IF NOT EXISTS ping_" << std::regex_replace(ip, std::regex(R"(\.)"), "_") << " ("
-                             << "id SERIAL PRIMARY KEY,"
-                             << "delay INTEGER,"
-                             << "success BOOLEAN,"
-                             << "timestamp TIMESTAMP"
-                             << ");";
-        
-        if (!executeQuery(createTableSQLStream.str())) {
-            std::cerr << "Failed to create table for IP " << ip << std::endl;
-            return false;
-        }
-        
-        // 为timestamp列创建索引以提高查询性能
-        std::ostringstream createIndexSQLStream;
-        createIndexSQLStream << "CREATE INDEX IF NOT EXISTS idx_ping_" << std::regex_replace(ip, std::regex(R"(\.)"), "_") << "_timestamp "
-                             << "ON ping_" << std::regex_replace(ip, std::regex(R"(\.)"), "_") << " (timestamp);";
-        
-        if (!executeQuery(createIndexSQLStream.str())) {
-            std::cerr << "Failed to create index for IP " << ip << std::endl;
+// 设置client_min_messages参数以抑制NOTICE消息（连接字符串中已指定时不覆盖）
+bool DatabaseManagerPG::suppressNotices(PGconn* connection) {
+    if (connInfo.find("client_min_messages") == std::string::npos) {
+        PGresult* res = PQexec(connection, "SET client_min_messages TO WARNING;");
+        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+            std::println(std::cerr, "Failed to set client_min_messages: {}", PQresultErrorMessage(res));
+            PQclear(res);
             return false;
         }
+        PQclear(res);
     }
     return true;
 }
 
-// 辅助函数：批量插入主机信息
-bool DatabaseManagerPG::insertHostsBatch(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
-    std::ostringstream hostSQLStream;
-    hostSQLStream << "INSERT INTO hosts (ip, hostname, last_seen) VALUES ";
+// 会话级的准备工作，每个连接（包括重连后）执行一次
+bool DatabaseManagerPG::prepareSession(PGconn* connection) {
+    // 会话级临时表：每轮的样本以二进制COPY写入，再在服务器端分发到各个表，提交时自动清空
+    const char* createIncomingTableSQL = R"(
+        CREATE TEMP TABLE IF NOT EXISTS incoming_samples (
+            ip TEXT,
+            hostname TEXT,
+            delay INTEGER,
+            success BOOLEAN,
+            ts TIMESTAMP
+        ) ON COMMIT DELETE ROWS;
+    )";
     
-    bool first = true;
-    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
-        if (!first) hostSQLStream << ", ";
-        hostSQLStream << "(" << escapeString(ip) << ", " << escapeString(hostname) << ", NOW())";
-        first = false;
+    if (!executeQuery(connection, createIncomingTableSQL)) {
+        std::println(std::cerr, "Failed to create incoming_samples table");
+        return false;
     }
     
-    hostSQLStream << " ON CONFLICT (ip) DO UPDATE SET "
-                  << "hostname = EXCLUDED.hostname, "
-                  << "last_seen = EXCLUDED.last_seen;";
-    
-    return executeQuery(hostSQLStream.str());
-}
-
-// 辅助函数：批量插入ping结果
-bool DatabaseManagerPG::insertPingResultsBatch(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
-    // 构建批量插入语句
-    std::map<std::string, std::vector<std::string>> batchInserts;
-    
-    // 将结果按IP分组
-    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
-        std::string tableName = "ping_" + std::regex_replace(ip, std::regex(R"(\.)"), "_");
-        std::ostringstream insertSQLStream;
-        insertSQLStream << "(" << delay << ", " << (successFlag ? "true" : "false") << ", " << escapeString(timestamp) << ")";
-        batchInserts[tableName].push_back(insertSQLStream.str());
+    // 在一次往返中准备全部预编译语句
+    if (PQenterPipelineMode(connection) != 1) {
+        std::println(std::cerr, "Failed to enter pipeline mode: {}", PQerrorMessage(connection));
+        return false;
     }
-    
-    // 为每个表执行批量插入
-    for (const auto& [tableName, values] : batchInserts) {
-        std::ostringstream batchInsertSQLStream;
-        batchInsertSQLStream << "INSERT INTO " << tableName << " (delay, success, timestamp) VALUES ";
-        
-        bool first = true;
-        for (const auto& value : values) {
-            if (!first) batchInsertSQLStream << ", ";
-            batchInsertSQLStream << value;
-            first = false;
+    bool prepared = true;
+    for (const auto& [name, sql] : PREPARED_STATEMENTS) {
+        prepared = prepared && PQsendPrepare(connection, name, sql, 0, nullptr) == 1;
+    }
+    prepared = PQpipelineSync(connection) == 1 && prepared;
+    PGresult* res;
+    for (size_t i = 0; prepared && i < std::size(PREPARED_STATEMENTS); i++) {
+        res = PQgetResult(connection);
+        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+            std::println(std::cerr, "Failed to prepare statement {}: {}", PREPARED_STATEMENTS[i].first, PQresultErrorMessage(res));
+            prepared = false;
         }
-        batchInsertSQLStream << ";";
-        
-        if (!executeQuery(batchInsertSQLStream.str())) {
-            std::cerr << "Failed to insert ping results for table " << tableName << std::endl;
-            return false;
+        PQclear(res);
+        while ((res = PQgetResult(connection)) != nullptr) {
+            PQclear(res);
+        }
+    }
+    while ((res = PQgetResult(connection)) != nullptr) {
+        bool reachedSync = PQresultStatus(res) == PGRES_PIPELINE_SYNC;
+        PQclear(res);
+        if (reachedSync) {
+            break;
         }
     }
+    if (PQexitPipelineMode(connection) != 1 || !prepared) {
+        std::println(std::cerr, "Failed to prepare statements");
+        return false;
+    }
     
     return true;
 }
 
-bool DatabaseManagerPG::insertPingResults(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
-    if (!conn) {
-        std::cerr << "Database not initialized" << std::endl;
+// 创建汇总表；首次创建时用已有的原始数据回填小时和天汇总
+bool DatabaseManagerPG::createRollupTables() {
+    PGresult* existsRes = executeQueryWithResult("SELECT to_regclass('rollup_day') IS NULL;");
+    if (!existsRes) {
         return false;
     }
-    
-    if (results.empty()) {
-        return true; // 没有结果需要插入，视为成功
+    bool needsBackfill = strcmp(PQgetvalue(existsRes, 0, 0), "t") == 0;
+    PQclear(existsRes);
+    
+    for (const auto& [rollupTable, precision] : ROLLUP_TABLES) {
+        std::ostringstream createSQLStream;
+        createSQLStream << "CREATE TABLE IF NOT EXISTS " << rollupTable << " ("
+                        << "ip TEXT,"
+                        << "bucket TIMESTAMP,"
+                        << "count BIGINT,"
+                        << "successes BIGINT,"
+                        << "rtt_sum BIGINT,"
+                        << "rtt_min INTEGER,"
+                        << "rtt_max INTEGER,"
+                        << "PRIMARY KEY (ip, bucket)"
+                        << ");"
+                        << "CREATE INDEX IF NOT EXISTS idx_" << rollupTable << "_bucket ON " << rollupTable << " (bucket);";
+        
+        if (!executeQuery(createSQLStream.str())) {
+            return false;
+        }
     }
     
-    // 开始事务以提高性能
-    if (!executeQuery("BEGIN;")) {
-        std::cerr << "Failed to begin transaction" << std::endl;
+    return !needsBackfill || backfillRollups();
+}
+
+// 用已有的ping_*表回填小时和天汇总（分钟汇总只从启用后开始维护）
+bool DatabaseManagerPG::backfillRollups() {
+    PGresult* tablesRes = executeQueryWithResult(
+        "SELECT h.ip, t.tablename FROM hosts h "
+        "JOIN pg_tables t ON t.tablename = 'ping_' || replace(h.ip, '.', '_') AND t.schemaname = current_schema();");
+    if (!tablesRes) {
         return false;
     }
     
-    bool success = true;
-    
-    // 验证所有IP地址格式
-    if (success) {
-        success = validateIPs(results);
-    }
-    
-    // 为所有IP地址创建表（如果尚未创建）
-    if (success) {
-        success = createIPTables(results);
+    if (PQntuples(tablesRes) > 0) {
+        std::cout << "Building rollup tables from existing ping records..." << std::endl;
     }
     
-    // 在hosts表中批量插入或更新IP与主机名的映射关系
-    if (success) {
-        success = insertHostsBatch(results);
+    bool success = true;
+    for (int row = 0; row < PQntuples(tablesRes) && success; row++) {
+        std::string ip = PQgetvalue(tablesRes, row, 0);
+        std::string tableName = PQgetvalue(tablesRes, row, 1);
+        for (const auto& [rollupTable, precision] : ROLLUP_TABLES) {
+            if (std::string(precision) == "minute") {
+                continue;
+            }
+            std::ostringstream backfillSQLStream;
+            backfillSQLStream << "INSERT INTO " << rollupTable << " (ip, bucket, count, successes, rtt_sum, rtt_min, rtt_max) "
+                              << "SELECT " << escapeString(ip) << ", date_trunc('" << precision << "', timestamp), COUNT(*), "
+                              << "COUNT(*) FILTER (WHERE success), COALESCE(SUM(delay) FILTER (WHERE success), 0), "
+                              << "MIN(delay) FILTER (WHERE success), MAX(delay) FILTER (WHERE success) "
+                              << "FROM " << tableName << " GROUP BY 2"
+                              << rollupUpsertClause(rollupTable) << ";";
+            if (!executeQuery(backfillSQLStream.str())) {
+                std::cerr << "Failed to backfill rollups for IP " << ip << std::endl;
+                success = false;
+                break;
+            }
+        }
     }
+    PQclear(tablesRes);
     
-    // 批量插入ping结果
-    if (success) {
-        success = insertPingResultsBatch(results);
+    return success;
+}
+
+// 辅助函数：用一条语句（数据修改CTE）同时从incoming_samples累加分钟、小时、天汇总
+bool DatabaseManagerPG::updateRollups(PGconn* connection) {
+    if (!executeQuery(connection, rollupUpdateSQL())) {
+        std::cerr << "Failed to update rollup tables" << std::endl;
+        return false;
     }
-    
-    // 提交或回滚事务
-    if (success) {
-        if (!executeQuery("COMMIT;")) {
-            std::cerr << "Failed to commit transaction" << std::endl;
-            success = false;
+    return true;
+}
+
+bool DatabaseManagerPG::beginTransaction() {
+    // 主连接断开（例如服务器重启）时按原参数重连，并重新准备会话
+    if (conn && PQstatus(conn) != CONNECTION_OK) {
+        PQreset(conn);
+        if (PQstatus(conn) != CONNECTION_OK || !suppressNotices(conn) || !prepareSession(conn)) {
+            std::cerr << "Failed to reconnect to database: " << PQerrorMessage(conn) << std::endl;
+            return false;
         }
-    } else {
-        executeQuery("ROLLBACK;");
     }
     
-    return success;
+    if (!executeQuery("BEGIN;")) {
+        std::cerr << "Failed to begin transaction" << std::endl;
+        return false;
+    }
+    return true;
 }
 
-void DatabaseManagerPG::queryIPStatistics(const std::string& ip) {
-    if (!conn) {
-        std::cerr << "Database not initialized" << std::endl;
-        return;
+bool DatabaseManagerPG::commitTransaction() {
+    if (!shardLeases.empty()) {
+        return commitShards();
     }
     
-    // 获取主机名
-    std::ostringstream hostQueryStream;
-    hostQueryStream << "SELECT hostname FROM hosts WHERE ip = " << escapeString(ip) << ";";
-    
-    PGresult* hostRes = executeQueryWithResult(hostQueryStream.str());
-    if (!hostRes) {
-        std::cerr << "Failed to query host information" << std::endl;
-        return;
+    if (!executeQuery("COMMIT;")) {
+        std::cerr << "Failed to commit transaction" << std::endl;
+        return false;
     }
-    
+    return true;
+}
+
+bool DatabaseManagerPG::rollbackTransaction() {
+    bool shardsRolledBack = shardLeases.empty() || finishShards(false);
+    return executeQuery("ROLLBACK;") && shardsRolledBack;
+}
+
+void DatabaseManagerPG::setPoolSize(std::size_t size) {
+    poolSize = std::max<std::size_t>(size, 1);
+}
+
+void DatabaseManagerPG::printPoolStats(std::ostream& out) const {
+    if (pool) {
+        pool->printStats(out);
+    }
+}
+
+bool DatabaseManagerPG::prepareWrite(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    if (!conn) {
+        return false;
+    }
+    
+    // 通常只涉及今天，已在initialize中创建；补写历史数据或跨过提前量时按需创建
+    std::set<std::chrono::sys_days> days;
+    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        auto seconds = SegmentStore::parseTimestamp(timestamp);
+        if (seconds) {
+            days.insert(std::chrono::sys_days{std::chrono::days{*seconds / 86400}});
+        }
+    }
+    for (const auto& day : days) {
+        if (!ensureSamplePartitions(day, day)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 批量导入的样本已经走二进制COPY，这里只关闭主连接的同步提交：
+// 崩溃时最多丢失最近提交的几个导入事务，重新导入即可，不会破坏数据一致性
+bool DatabaseManagerPG::beginBulkLoad() {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    return executeQuery("SET synchronous_commit = off;");
+}
+
+bool DatabaseManagerPG::endBulkLoad() {
+    if (!conn) {
+        return true;
+    }
+    return executeQuery("RESET synchronous_commit;");
+}
+
+bool DatabaseManagerPG::insertPingResult(const std::string& ip, const std::string& hostname, short delay, bool success, const std::string& timestamp) {
+    // 验证IP地址格式
+    if (!isValidIP(ip)) {
+        std::cerr << "Invalid IP address format: " << ip << std::endl;
+        return false;
+    }
+    
+    // 创建一个包含单个结果的向量并调用批量插入函数
+    std::vector<std::tuple<std::string, std::string, short, bool, std::string>> results;
+    results.emplace_back(ip, hostname, delay, success, timestamp);
+    return insertPingResults(results);
+}
+
+// 辅助函数：验证IP地址格式
+bool DatabaseManagerPG::validateIPs(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    // 批量导入的样本按主机排序，与上一行相同的IP不再重复匹配正则
+    const std::string* previousIP = nullptr;
+    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        if (previousIP && *previousIP == ip) {
+            continue;
+        }
+        if (!isValidIP(ip)) {
+            std::cerr << "Invalid IP address format: " << ip << std::endl;
+            return false;
+        }
+        previousIP = &ip;
+    }
+    return true;
+}
+
+// 创建按天范围分区的样本表及提前量范围内的分区，并统计尚未迁移的旧版ping_*表
+// 分区索引以(ip, timestamp)开头并包含统计所需的列，单主机查询可以只扫描索引
+bool DatabaseManagerPG::createSamplesTable() {
+    const char* createSamplesTableSQL = R"(
+        CREATE TABLE IF NOT EXISTS samples (
+            ip TEXT NOT NULL,
+            delay INTEGER,
+            success BOOLEAN,
+            timestamp TIMESTAMP NOT NULL
+        ) PARTITION BY RANGE (timestamp);
+        CREATE INDEX IF NOT EXISTS idx_samples_ip_ts ON samples (ip, timestamp) INCLUDE (success, delay);
+    )";
+    
+    return executeQuery(createSamplesTableSQL);
+}
+
+// 加载现有分区，补建昨天到未来几天的分区，并统计尚未迁移的旧版每IP表
+bool DatabaseManagerPG::loadSamplePartitions() {
+    PGresult* partitionsRes = executeQueryWithResult(SAMPLE_PARTITIONS_SQL);
+    if (!partitionsRes) {
+        return false;
+    }
+    samplePartitions.clear();
+    for (int row = 0; row < PQntuples(partitionsRes); row++) {
+        samplePartitions.insert(PQgetvalue(partitionsRes, row, 0));
+    }
+    PQclear(partitionsRes);
+    
+    std::chrono::sys_days today = localToday();
+    if (!ensureSamplePartitions(today - std::chrono::days{1}, today + std::chrono::days{SAMPLE_PARTITION_DAYS_AHEAD})) {
+        return false;
+    }
+    
+    PGresult* legacyRes = executeQueryWithResult(LEGACY_TABLES_SQL);
+    if (!legacyRes) {
+        return false;
+    }
+    legacyTableCount = PQntuples(legacyRes);
+    PQclear(legacyRes);
+    return true;
+}
+
+// 创建[first, last]范围内尚不存在的日分区，全部DDL在一次往返中发送
+bool DatabaseManagerPG::ensureSamplePartitions(std::chrono::sys_days first, std::chrono::sys_days last) {
+    std::ostringstream createSQLStream;
+    std::vector<std::string> created;
+    for (std::chrono::sys_days day = first; day <= last; day += std::chrono::days{1}) {
+        std::string partitionName = samplePartitionName(day);
+        if (samplePartitions.contains(partitionName)) {
+            continue;
+        }
+        createSQLStream << samplePartitionSQL(day) << ";";
+        created.push_back(partitionName);
+    }
+    
+    if (created.empty()) {
+        return true;
+    }
+    if (!executeQuery(createSQLStream.str())) {
+        std::cerr << "Failed to create sample partitions" << std::endl;
+        return false;
+    }
+    samplePartitions.insert(created.begin(), created.end());
+    return true;
+}
+
+// 查询数据库中现有的分区及其日期（其他进程可能已创建或删除分区）
+std::vector<std::pair<std::string, std::chrono::sys_days>> DatabaseManagerPG::listSamplePartitions() {
+    std::vector<std::pair<std::string, std::chrono::sys_days>> partitions;
+    PGresult* partitionsRes = executeQueryWithResult(SAMPLE_PARTITIONS_SQL);
+    if (!partitionsRes) {
+        return partitions;
+    }
+    for (int row = 0; row < PQntuples(partitionsRes); row++) {
+        auto dayStart = SegmentStore::parseTimestamp(PQgetvalue(partitionsRes, row, 1));
+        if (dayStart) {
+            partitions.emplace_back(PQgetvalue(partitionsRes, row, 0), std::chrono::sys_days{std::chrono::days{*dayStart / 86400}});
+        }
+    }
+    PQclear(partitionsRes);
+    return partitions;
+}
+
+// 辅助函数：以二进制COPY把本轮样本写入incoming_samples，值按二进制编码，无需转义和服务器端解析
+bool DatabaseManagerPG::copyIncomingSamples(PGconn* connection, const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    // 二进制timestamp为64位整数微秒数（PostgreSQL 10起的唯一格式）
+    const char* integerDatetimes = PQparameterStatus(connection, "integer_datetimes");
+    if (!integerDatetimes || std::strcmp(integerDatetimes, "on") != 0) {
+        std::cerr << "Binary COPY requires a server with integer_datetimes enabled" << std::endl;
+        return false;
+    }
+    
+    std::string buffer;
+    buffer.reserve(19 + results.size() * 64 + 2);
+    buffer.append(COPY_BINARY_SIGNATURE, sizeof(COPY_BINARY_SIGNATURE));
+    appendInt32(buffer, 0);  // 标志位
+    appendInt32(buffer, 0);  // 扩展区长度
+    
+    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        auto seconds = SegmentStore::parseTimestamp(timestamp);
+        if (!seconds) {
+            std::cerr << "Invalid timestamp for IP " << ip << ": " << timestamp << std::endl;
+            return false;
+        }
+        appendInt16(buffer, 5);
+        appendTextField(buffer, ip);
+        appendTextField(buffer, hostname);
+        appendInt32(buffer, 4);
+        appendInt32(buffer, delay);
+        appendInt32(buffer, 1);
+        buffer.push_back(successFlag ? 1 : 0);
+        appendInt32(buffer, 8);
+        appendInt64(buffer, (*seconds - POSTGRES_EPOCH_OFFSET) * 1000000);
+    }
+    appendInt16(buffer, -1);  // 结束标记
+    
+    PGresult* res = PQexec(connection, "COPY incoming_samples (ip, hostname, delay, success, ts) FROM STDIN (FORMAT binary);");
+    if (PQresultStatus(res) != PGRES_COPY_IN) {
+        std::cerr << "Failed to start COPY: " << PQresultErrorMessage(res) << std::endl;
+        PQclear(res);
+        return false;
+    }
+    PQclear(res);
+    
+    if (PQputCopyData(connection, buffer.data(), static_cast<int>(buffer.size())) != 1 || PQputCopyEnd(connection, nullptr) != 1) {
+        std::cerr << "Failed to send COPY data: " << PQerrorMessage(connection) << std::endl;
+    }
+    
+    bool success = true;
+    while ((res = PQgetResult(connection)) != nullptr) {
+        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+            std::cerr << "COPY failed: " << PQresultErrorMessage(res) << std::endl;
+            success = false;
+        }
+        PQclear(res);
+    }
+    return success;
+}
+
+// 辅助函数：从incoming_samples批量插入或更新主机信息，同一主机有多个样本时只取一行
+bool DatabaseManagerPG::insertHostsBatch(PGconn* connection) {
+    return executeQuery(connection, UPSERT_HOSTS_SQL);
+}
+
+// 辅助函数：把incoming_samples中的样本插入分区表，由服务器按时间路由到对应的日分区
+bool DatabaseManagerPG::insertPingResultsBatch(PGconn* connection) {
+    if (!executeQuery(connection, INSERT_SAMPLES_SQL)) {
+        std::cerr << "Failed to insert ping results" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 辅助函数：在一个连接上写入一批样本：二进制COPY到incoming_samples，之后的写入都在服务器端从中读取
+bool DatabaseManagerPG::writeSamples(PGconn* connection, const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    return copyIncomingSamples(connection, results) &&
+           insertHostsBatch(connection) &&  // 在hosts表中批量插入或更新IP与主机名的映射关系
+           insertPingResultsBatch(connection) &&
+           updateRollups(connection);  // 在同一事务中累加汇总表
+}
+
+// 辅助函数：按IP哈希把样本分到连接池的各个连接，每个分片在自己的连接和事务中并行写入
+// 同一主机总是落在同一分片，各分片更新的hosts行和汇总表行互不相交，服务器端的多个后端进程之间没有锁等待
+// 分片事务保持打开，由commitTransaction/rollbackTransaction与主连接上的告警变更一起结束
+bool DatabaseManagerPG::writeShards(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    std::size_t shardCount = pool->size();
+    std::vector<std::vector<std::tuple<std::string, std::string, short, bool, std::string>>> shards(shardCount);
+    for (const auto& result : results) {
+        shards[std::hash<std::string>{}(std::get<0>(result)) % shardCount].push_back(result);
+    }
+    
+    std::vector<PgConnectionPool::Lease> leases(shardCount);
+    std::vector<char> written(shardCount, 1);
+    std::vector<std::thread> writers;
+    for (std::size_t i = 0; i < shardCount; i++) {
+        if (shards[i].empty()) {
+            continue;
+        }
+        writers.emplace_back([this, i, &shards, &leases, &written] {
+            leases[i] = pool->acquire(i);
+            PGconn* connection = leases[i].get();
+            auto start = std::chrono::steady_clock::now();
+            written[i] = connection && executeQuery(connection, "BEGIN;") && writeSamples(connection, shards[i]);
+            pool->recordBatch(i, shards[i].size(), std::chrono::steady_clock::now() - start);
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    
+    bool success = true;
+    for (std::size_t i = 0; i < shardCount; i++) {
+        if (leases[i]) {
+            shardLeases.push_back(std::move(leases[i]));
+        }
+        success = success && written[i];
+    }
+    if (!success) {
+        finishShards(false);
+    }
+    return success;
+}
+
+// 辅助函数：在每个分片连接上并行执行一条语句，返回各分片是否成功
+std::vector<char> DatabaseManagerPG::runOnShards(const std::function<std::string(std::size_t)>& statement) {
+    std::vector<char> succeeded(shardLeases.size(), 1);
+    std::vector<std::thread> runners;
+    for (std::size_t i = 0; i < shardLeases.size(); i++) {
+        runners.emplace_back([this, i, &statement, &succeeded] {
+            succeeded[i] = executeQuery(shardLeases[i].get(), statement(i));
+        });
+    }
+    for (auto& runner : runners) {
+        runner.join();
+    }
+    return succeeded;
+}
+
+// 辅助函数：并行提交或回滚所有打开的分片事务并归还连接
+bool DatabaseManagerPG::finishShards(bool commit) {
+    auto finished = runOnShards([commit](std::size_t) { return std::string(commit ? "COMMIT;" : "ROLLBACK;"); });
+    shardLeases.clear();
+    return std::all_of(finished.begin(), finished.end(), [](char ok) { return ok; });
+}
+
+// 两阶段提交分片上的样本和主连接上的告警变更：
+// 1. 各分片PREPARE TRANSACTION，任一失败则全部回滚；
+// 2. 主事务写入本轮的事务标识并提交，这一步决定整轮是否生效；
+// 3. 各分片COMMIT PREPARED。
+// 第2步之后中断时已准备的分片事务留在服务器上，由下次启动的resolvePreparedCycles按决定记录提交或回滚
+bool DatabaseManagerPG::commitShards() {
+    std::string gid = preparedPrefix + "_" + std::to_string(++preparedCycles);
+    auto shardGid = [&gid](std::size_t i) { return gid + "_" + std::to_string(i); };
+    
+    auto prepared = runOnShards([&](std::size_t i) { return "PREPARE TRANSACTION '" + shardGid(i) + "';"; });
+    bool allPrepared = std::all_of(prepared.begin(), prepared.end(), [](char ok) { return ok; });
+    auto rollbackPrepared = [&] {
+        // PREPARE失败的分片事务已由服务器回滚，只需回滚已准备的分片
+        runOnShards([&](std::size_t i) {
+            return prepared[i] ? "ROLLBACK PREPARED '" + shardGid(i) + "';" : std::string("SELECT 1;");
+        });
+        shardLeases.clear();
+    };
+    if (!allPrepared) {
+        rollbackPrepared();
+        executeQuery("ROLLBACK;");
+        std::cerr << "Failed to prepare sharded samples" << std::endl;
+        return false;
+    }
+    
+    if (!executeQuery("INSERT INTO committed_cycles (gid) VALUES ('" + gid + "');")) {
+        rollbackPrepared();
+        executeQuery("ROLLBACK;");
+        std::cerr << "Failed to record the commit decision" << std::endl;
+        return false;
+    }
+    if (!executeQuery("COMMIT;")) {
+        // 连接仍然正常时提交确定没有生效；连接断开时结果未知，留给下次启动按决定记录处理
+        if (PQstatus(conn) == CONNECTION_OK) {
+            rollbackPrepared();
+        } else {
+            shardLeases.clear();
+        }
+        std::cerr << "Failed to commit transaction" << std::endl;
+        return false;
+    }
+    
+    // 决定已经提交，COMMIT PREPARED失败的分片由下次启动完成，本轮视为成功
+    auto committed = runOnShards([&](std::size_t i) { return "COMMIT PREPARED '" + shardGid(i) + "';"; });
+    shardLeases.clear();
+    if (std::all_of(committed.begin(), committed.end(), [](char ok) { return ok; })) {
+        executeQuery("DELETE FROM committed_cycles WHERE gid = '" + gid + "';");
+    } else {
+        std::cerr << "Some sharded samples stay prepared until the next start" << std::endl;
+    }
+    return true;
+}
+
+// 完成上次运行在两阶段提交中途留下的分片事务：主事务已记录决定的提交，其余回滚
+// 只处理准备超过一分钟的事务，不干扰同时写入同一数据库的其他实例
+bool DatabaseManagerPG::resolvePreparedCycles() {
+    PGresult* res = executeQueryWithResult(
+        "SELECT x.gid, EXISTS (SELECT 1 FROM committed_cycles c WHERE left(x.gid, length(c.gid) + 1) = c.gid || '_') "
+        "FROM pg_prepared_xacts x WHERE x.database = current_database() AND left(x.gid, 6) = 'mping_' "
+        "AND x.prepared < NOW() - INTERVAL '1 minute';");
+    if (!res) {
+        return false;
+    }
+    int resolved = 0;
+    for (int row = 0; row < PQntuples(res); row++) {
+        std::string gid = PQgetvalue(res, row, 0);
+        bool decided = std::strcmp(PQgetvalue(res, row, 1), "t") == 0;
+        if (executeQuery((decided ? "COMMIT PREPARED '" : "ROLLBACK PREPARED '") + gid + "';")) {
+            resolved++;
+        }
+    }
+    PQclear(res);
+    if (resolved > 0) {
+        std::cout << "Resolved " << resolved << " interrupted shard transactions" << std::endl;
+    }
+    
+    // 没有剩余分片事务的决定记录不再需要
+    return executeQuery("DELETE FROM committed_cycles c WHERE c.committed_time < NOW() - INTERVAL '1 minute' "
+                        "AND NOT EXISTS (SELECT 1 FROM pg_prepared_xacts x WHERE left(x.gid, length(c.gid) + 1) = c.gid || '_');");
+}
+
+bool DatabaseManagerPG::insertPingResults(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    
+    if (results.empty()) {
+        return true; // 没有结果需要插入，视为成功
+    }
+    
+    // 开始事务以提高性能；如果调用方（StorageSession）已开启事务，则直接加入该事务
+    // 自行开启事务时先在事务外创建所需的分区，回滚不会使已记录的分区失效
+    bool ownsTransaction = PQtransactionStatus(conn) == PQTRANS_IDLE;
+    if (ownsTransaction && (!prepareWrite(results) || !beginTransaction())) {
+        return false;
+    }
+    
+    bool success = true;
+    
+    // 验证所有IP地址格式
+    if (success) {
+        success = validateIPs(results);
+    }
+    
+    // 写入样本、主机信息和汇总表；启用连接池时按主机分片，在多个连接上并行写入
+    if (success) {
+        success = pool ? writeShards(results) : writeSamples(conn, results);
+    }
+    
+    // 提交或回滚事务（外部事务由调用方负责结束）
+    if (ownsTransaction) {
+        if (success) {
+            success = commitTransaction();
+        } else {
+            rollbackTransaction();
+        }
+    }
+    
+    return success;
+}
+
+int DatabaseManagerPG::socket() const {
+    return conn ? PQsocket(conn) : -1;
+}
+
+bool DatabaseManagerPG::startAsyncCycle(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results,
+                                        const std::vector<std::pair<std::string, std::string>>& newlyDown,
+                                        const std::vector<std::string>& newlyUp) {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    if (asyncPending || PQtransactionStatus(conn) != PQTRANS_IDLE) {
+        std::cerr << "Another database operation is in progress" << std::endl;
+        return false;
+    }
+    if (!validateIPs(results)) {
+        return false;
+    }
+    
+    // 各列组成数组参数；缺少的日分区在同一个管道中创建
+    std::string ips, hostnames, delays, successes, timestamps;
+    std::set<std::chrono::sys_days> days;
+    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        auto seconds = SegmentStore::parseTimestamp(timestamp);
+        if (!seconds) {
+            std::cerr << "Invalid timestamp for IP " << ip << ": " << timestamp << std::endl;
+            return false;
+        }
+        days.insert(std::chrono::sys_days{std::chrono::days{*seconds / 86400}});
+        appendArrayElement(ips, ip);
+        appendArrayElement(hostnames, hostname);
+        appendArrayElement(delays, std::to_string(delay));
+        appendArrayElement(successes, successFlag ? "t" : "f");
+        appendArrayElement(timestamps, timestamp);
+    }
+    
+    std::vector<PipelineStatement> statements;
+    asyncPartitions.clear();
+    for (const auto& day : days) {
+        std::string partitionName = samplePartitionName(day);
+        if (!samplePartitions.contains(partitionName)) {
+            statements.push_back({samplePartitionSQL(day), {}});
+            asyncPartitions.push_back(partitionName);
+        }
+    }
+    if (!results.empty()) {
+        statements.push_back({LOAD_INCOMING_SQL, {ips + "}", hostnames + "}", delays + "}", successes + "}", timestamps + "}"}});
+        statements.push_back({UPSERT_HOSTS_SQL, {}});
+        statements.push_back({INSERT_SAMPLES_SQL, {}});
+        statements.push_back({rollupUpdateSQL(), {}});
+    }
+    for (const auto& [ip, hostname] : newlyDown) {
+        statements.push_back({"add_alert", {ip, hostname}, true});
+    }
+    for (const auto& ip : newlyUp) {
+        statements.push_back({"resolve_alert", {ip}, true});
+    }
+    
+    if (PQsetnonblocking(conn, 1) != 0 || PQenterPipelineMode(conn) != 1) {
+        std::cerr << "Failed to enter non-blocking pipeline mode: " << PQerrorMessage(conn) << std::endl;
+        PQsetnonblocking(conn, 0);
+        return false;
+    }
+    
+    // 同步点之前的全部语句构成一个隐式事务，任一语句失败时整轮写入回滚；
+    // 排队失败时仍发送同步点，由processAsync收回已发送语句的结果
+    bool queued = true;
+    for (const auto& statement : statements) {
+        std::vector<const char*> values;
+        for (const auto& param : statement.params) {
+            values.push_back(param.c_str());
+        }
+        int nParams = static_cast<int>(values.size());
+        queued = statement.prepared
+            ? PQsendQueryPrepared(conn, statement.sql.c_str(), nParams, values.data(), nullptr, nullptr, 0) == 1
+            : PQsendQueryParams(conn, statement.sql.c_str(), nParams, nullptr, values.data(), nullptr, nullptr, 0) == 1;
+        if (!queued) {
+            std::cerr << "Failed to queue statement: " << PQerrorMessage(conn) << std::endl;
+            break;
+        }
+    }
+    
+    asyncPending = true;
+    asyncFailed = !queued;
+    asyncDown = newlyDown;
+    asyncUp = newlyUp;
+    if (PQpipelineSync(conn) != 1) {
+        std::cerr << "Failed to sync pipeline: " << PQerrorMessage(conn) << std::endl;
+        finishAsync();
+        return false;
+    }
+    
+    // 非阻塞模式下发送缓冲区可能没有一次写完，剩余部分在套接字可写时由processAsync继续发送
+    int flushed = PQflush(conn);
+    if (flushed < 0) {
+        std::cerr << "Failed to send statements: " << PQerrorMessage(conn) << std::endl;
+        finishAsync();
+        return false;
+    }
+    asyncFlushPending = flushed == 1;
+    return true;
+}
+
+bool DatabaseManagerPG::wantsWrite() const {
+    return asyncPending && asyncFlushPending;
+}
+
+// 套接字可读或可写时调用：继续发送、读取已到达的数据并处理所有不会阻塞的结果
+DatabaseManagerPG::AsyncStatus DatabaseManagerPG::processAsync() {
+    if (!asyncPending) {
+        return AsyncStatus::Idle;
+    }
+    
+    if (asyncFlushPending) {
+        int flushed = PQflush(conn);
+        if (flushed < 0) {
+            std::cerr << "Failed to send statements: " << PQerrorMessage(conn) << std::endl;
+            asyncFailed = true;
+            return finishAsync();
+        }
+        asyncFlushPending = flushed == 1;
+    }
+    
+    if (PQconsumeInput(conn) != 1) {
+        std::cerr << "Failed to read from database: " << PQerrorMessage(conn) << std::endl;
+        asyncFailed = true;
+        return finishAsync();
+    }
+    
+    // 每条语句返回一个结果和一个结束标记（nullptr），最后是同步点
+    while (!PQisBusy(conn)) {
+        PGresult* res = PQgetResult(conn);
+        if (!res) {
+            continue;
+        }
+        ExecStatusType status = PQresultStatus(res);
+        if (status == PGRES_PIPELINE_SYNC) {
+            PQclear(res);
+            return finishAsync();
+        }
+        if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+            // 第一条失败语句之后的语句都以PGRES_PIPELINE_ABORTED结束，只报告第一个错误
+            if (status != PGRES_PIPELINE_ABORTED) {
+                std::cerr << "Query failed: " << PQresultErrorMessage(res) << std::endl;
+            }
+            asyncFailed = true;
+        }
+        PQclear(res);
+    }
+    return AsyncStatus::Pending;
+}
+
+// 结束异步写入，恢复阻塞模式；成功时把本轮的分区和告警变化记入缓存
+DatabaseManagerPG::AsyncStatus DatabaseManagerPG::finishAsync() {
+    asyncPending = false;
+    asyncFlushPending = false;
+    if (PQexitPipelineMode(conn) != 1) {
+        asyncFailed = true;
+    }
+    PQsetnonblocking(conn, 0);
+    
+    if (asyncFailed) {
+        return AsyncStatus::Failed;
+    }
+    samplePartitions.insert(asyncPartitions.begin(), asyncPartitions.end());
+    for (const auto& [ip, hostname] : asyncDown) {
+        activeAlerts.insert(ip);
+    }
+    for (const auto& ip : asyncUp) {
+        activeAlerts.erase(ip);
+    }
+    return AsyncStatus::Done;
+}
+
+void DatabaseManagerPG::queryIPStatistics(const std::string& ip, const std::string& since, const std::string& until, bool showRecent) {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
+        return;
+    }
+    
+    // 主机和时间范围条件都以参数传递：时间范围使规划器只扫描相关的日分区，分区内走(ip, timestamp)索引
+    std::string rangeClause;
+    std::vector<std::string> sampleParams = {ip};
+    if (!since.empty()) {
+        sampleParams.push_back(since);
+        rangeClause += " AND timestamp >= $" + std::to_string(sampleParams.size()) + "::timestamp";
+    }
+    if (!until.empty()) {
+        sampleParams.push_back(until);
+        rangeClause += " AND timestamp < $" + std::to_string(sampleParams.size()) + "::timestamp";
+    }
+    
+    // 一次聚合得到总数、成功数和延迟统计
+    std::string rawStatsSQL = "SELECT COUNT(*), COUNT(*) FILTER (WHERE success), COALESCE(SUM(delay) FILTER (WHERE success), 0), "
+                              "COALESCE(MAX(delay) FILTER (WHERE success), 0), COALESCE(MIN(delay) FILTER (WHERE success), 0) "
+                              "FROM samples WHERE ip = $1" + rangeClause;
+    std::string recentSQL = "SELECT delay, success, timestamp FROM samples WHERE ip = $1" + rangeClause + " ORDER BY timestamp DESC LIMIT 10";
+    
+    // 主机名、统计和最近记录互相独立，通过管道在一次往返中查询；
+    // 不限时间范围时统计来自天汇总表，代价与天数成正比
+    bool fromRollup = since.empty() && until.empty();
+    std::vector<PipelineStatement> statements = {
+        {"host_name", {ip}, true},
+        fromRollup ? PipelineStatement{"rollup_stats", {ip}, true} : PipelineStatement{rawStatsSQL, sampleParams},
+        {recentSQL, sampleParams},
+    };
+    std::vector<PGresult*> results;
+    if (!runPipeline(statements, &results)) {
+        for (PGresult* res : results) {
+            PQclear(res);
+        }
+        std::cerr << "Failed to query statistics" << std::endl;
+        return;
+    }
+    PGresult* hostRes = results[0];
+    PGresult* statsRes = results[1];
+    PGresult* recentRes = results[2];
+    
     std::string hostname = "";
     if (PQntuples(hostRes) > 0) {
         char* hostText = PQgetvalue(hostRes, 0, 0);
@@ -324,185 +1373,501 @@ void DatabaseManagerPG::queryIPStatistics(const std::string& ip) {
             hostname = hostText;
         }
     }
-    PQclear(hostRes);
-    
-    std::cout << "Statistics for IP: " << ip << " (" << hostname << ")" << std::endl;
-    std::cout << "=========================================================" << std::endl;
+    PQclear(hostRes);
+    
+    std::cout << "Statistics for IP: " << ip << " (" << hostname << ")" << std::endl;
+    if (!since.empty() || !until.empty()) {
+        std::cout << "Time range: [" << (since.empty() ? "-" : since) << ", " << (until.empty() ? "-" : until) << ")" << std::endl;
+    }
+    std::cout << "=========================================================" << std::endl;
+    if (legacyTableCount > 0) {
+        std::cout << "Note: " << legacyTableCount << " legacy ping_* tables have not been migrated, run with --migrate" << std::endl;
+    }
+    
+    // 汇总表中没有数据时退回到原始样本表；否则总计覆盖天汇总的全部时间，包括-C已删除的样本
+    if (fromRollup && atoll(PQgetvalue(statsRes, 0, 0)) > 0) {
+        std::cout << "Totals from daily rollups since " << PQgetvalue(statsRes, 0, 5) << " (kept after -C removes the samples)" << std::endl;
+    }
+    if (fromRollup && atoll(PQgetvalue(statsRes, 0, 0)) == 0) {
+        PQclear(statsRes);
+        fromRollup = false;
+        std::vector<PGresult*> rawResults;
+        if (!runPipeline({{rawStatsSQL, sampleParams}}, &rawResults)) {
+            for (PGresult* res : rawResults) {
+                PQclear(res);
+            }
+            PQclear(recentRes);
+            std::cerr << "Failed to query statistics" << std::endl;
+            return;
+        }
+        statsRes = rawResults[0];
+    }
+    
+    // 统计来自原始样本表时（指定时间范围或汇总表为空）需要加上已分层到段文件中的样本
+    SegmentStore::Summary summary;
+    summary.total = atoll(PQgetvalue(statsRes, 0, 0));
+    summary.successes = atoll(PQgetvalue(statsRes, 0, 1));
+    summary.delaySum = atof(PQgetvalue(statsRes, 0, 2));
+    summary.maxDelay = atoi(PQgetvalue(statsRes, 0, 3));
+    summary.minDelay = atoi(PQgetvalue(statsRes, 0, 4));
+    PQclear(statsRes);
+    
+    std::vector<std::tuple<std::string, int, int>> segmentRecent;  // (timestamp, delay, success)
+    bool segmentsRead = false;
+    if (!fromRollup) {
+        SegmentStore::Summary segmentSummary;
+        if (!segmentStore.summarize(ip, since, until, segmentSummary, segmentRecent)) {
+            PQclear(recentRes);
+            return;
+        }
+        summary.merge(segmentSummary);
+        segmentsRead = true;
+    }
+    
+    long long totalRecords = summary.total;
+    long long successCount = summary.successes;
+    double delaySum = summary.delaySum;
+    int maxDelay = summary.maxDelay;
+    int minDelay = summary.minDelay;
+    
+    std::cout << "Total ping records: " << totalRecords << std::endl;
+    
+    if (totalRecords == 0) {
+        std::cout << "No ping records found for this IP." << std::endl;
+        PQclear(recentRes);
+        return;
+    }
+    
+    long long failureCount = totalRecords - successCount;
+    double successRate = (totalRecords > 0) ? (double)successCount / totalRecords * 100 : 0;
+    double failureRate = (totalRecords > 0) ? (double)failureCount / totalRecords * 100 : 0;
+    double avgDelay = (successCount > 0) ? delaySum / successCount : 0;
+    
+    std::cout << "Successful pings: " << successCount << std::endl;
+    std::cout << "Failed pings: " << failureCount << std::endl;
+    std::cout << "Success rate: " << std::fixed << std::setprecision(2) << successRate << "%" << std::endl;
+    std::cout << "Failure rate: " << std::fixed << std::setprecision(2) << failureRate << "%" << std::endl;
+    std::cout << "Average delay (successful pings): " << std::fixed << std::setprecision(2) << avgDelay << "ms" << std::endl;
+    std::cout << "Maximum delay (successful pings): " << maxDelay << "ms" << std::endl;
+    std::cout << "Minimum delay (successful pings): " << minDelay << "ms" << std::endl;
+    if (!showRecent) {
+        PQclear(recentRes);
+        return;
+    }
+    
+    // 显示最近的10条记录
+    std::vector<std::tuple<std::string, int, int>> recentRecords;
+    for (int i = 0; i < PQntuples(recentRes); i++) {
+        char* timestamp = PQgetvalue(recentRes, i, 2);
+        char* success = PQgetvalue(recentRes, i, 1);
+        recentRecords.emplace_back(timestamp ? timestamp : "N/A", atoi(PQgetvalue(recentRes, i, 0)),
+                                   (success && strcmp(success, "t") == 0) ? 1 : 0);
+    }
+    PQclear(recentRes);
+    
+    // 样本表中的记录不足10条时用段文件中最新的记录补足
+    if (recentRecords.size() < 10) {
+        if (!segmentsRead) {
+            SegmentStore::Summary unused;
+            if (!segmentStore.summarize(ip, since, until, unused, segmentRecent)) {
+                return;
+            }
+        }
+        recentRecords.insert(recentRecords.end(), segmentRecent.begin(), segmentRecent.end());
+        std::sort(recentRecords.begin(), recentRecords.end(),
+                  [](const auto& a, const auto& b) { return std::get<0>(a) > std::get<0>(b); });
+        if (recentRecords.size() > 10) {
+            recentRecords.resize(10);
+        }
+    }
+    
+    std::cout << "\nRecent ping records (last 10):" << std::endl;
+    std::cout << "Timestamp           \tDelay\tStatus" << std::endl;
+    std::cout << "--------------------------------------------------------" << std::endl;
+    
+    for (const auto& [timestamp, delay, success] : recentRecords) {
+        std::cout << timestamp << "\t" 
+                  << delay << "ms\t" 
+                  << (success ? "Success" : "Failed") << std::endl;
+    }
+}
+
+void DatabaseManagerPG::cleanupOldData(int days) {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
+        return;
+    }
     
-    // 查询特定IP的表
-    std::string tableName = "ping_" + std::regex_replace(ip, std::regex(R"(\.)"), "_");
-    
-    // 获取总记录数
-    std::ostringstream countSQLStream;
-    countSQLStream << "SELECT COUNT(*) FROM " << tableName << ";";
+    std::cout << "Cleaning up data older than " << days << " days..." << std::endl;
     
-    PGresult* countRes = executeQueryWithResult(countSQLStream.str());
-    if (!countRes) {
-        std::cerr << "Failed to query count" << std::endl;
+    // 过期的日分区整体删除：只删除元数据和文件，不产生死元组，也不需要VACUUM
+    // 保留粒度为整天，截止日当天的分区保留到下一天
+    // 分区、旧版表中的行和分钟汇总使用同一个截止日，与小时汇总在一个事务中删除
+    std::chrono::sys_days cutoff = localToday() - std::chrono::days{days};
+    std::string cutoffText = formatDate(cutoff);
+    PGresult* tablesRes = executeQueryWithResult(LEGACY_TABLES_SQL);
+    if (!tablesRes) {
+        std::cerr << "Failed to query legacy tables" << std::endl;
         return;
     }
-    
-    int totalRecords = 0;
-    if (PQntuples(countRes) > 0) {
-        totalRecords = atoi(PQgetvalue(countRes, 0, 0));
+    if (!beginTransaction()) {
+        PQclear(tablesRes);
+        return;
     }
-    PQclear(countRes);
     
-    std::cout << "Total ping records: " << totalRecords << std::endl;
-    
-    if (totalRecords == 0) {
-        std::cout << "No ping records found for this IP." << std::endl;
-        return;
+    bool expired = true;
+    std::vector<std::string> droppedPartitions;
+    for (const auto& [partitionName, day] : listSamplePartitions()) {
+        if (day >= cutoff) {
+            break;
+        }
+        if (!executeQuery("DROP TABLE IF EXISTS " + partitionName + ";")) {
+            std::cerr << "Failed to drop partition " << partitionName << std::endl;
+            expired = false;
+            break;
+        }
+        droppedPartitions.push_back(partitionName);
     }
     
-    // 获取成功和失败的次数
-    std::ostringstream successSQLStream;
-    successSQLStream << "SELECT COUNT(*) FROM " << tableName << " WHERE success = true;";
+    // 尚未迁移的旧版ping_*表仍按行删除
+    int totalDeleted = 0;
+    for (int row = 0; expired && row < PQntuples(tablesRes); row++) {
+        std::string ipStr = PQgetvalue(tablesRes, row, 0);
+        std::string tableName = PQgetvalue(tablesRes, row, 1);
+        
+        // 删除指定天数之前的数据
+        std::ostringstream deleteSQLStream;
+        deleteSQLStream << "DELETE FROM " << tableName << " WHERE timestamp < '" << cutoffText << "';";
+        
+        PGresult* deleteRes = PQexec(conn, deleteSQLStream.str().c_str());
+        if (PQresultStatus(deleteRes) != PGRES_COMMAND_OK) {
+            std::cerr << "Failed to delete old data for IP " << ipStr << ": " << PQresultErrorMessage(deleteRes) << std::endl;
+            PQclear(deleteRes);
+            expired = false;
+            break;
+        }
+        
+        int deletedRows = atoi(PQcmdTuples(deleteRes));
+        totalDeleted += deletedRows;
+        PQclear(deleteRes);
+        
+        if (deletedRows > 0) {
+            std::cout << "Deleted " << deletedRows << " old records for IP " << ipStr << std::endl;
+        }
+    }
+    PQclear(tablesRes);
+    
+    // 汇总表：分钟汇总随原始数据一起过期，小时汇总保留更长时间，天汇总永久保留，-q的总计在-C之后仍然可用
+    std::string hourCutoffText = formatDate(localToday() - std::chrono::days{days * ROLLUP_HOUR_RETENTION_FACTOR});
+    for (const auto& [rollupTable, rollupCutoff] : {std::pair<const char*, const std::string*>{"rollup_minute", &cutoffText},
+                                                    std::pair<const char*, const std::string*>{"rollup_hour", &hourCutoffText}}) {
+        if (!expired) {
+            break;
+        }
+        if (!executeQuery("DELETE FROM " + std::string(rollupTable) + " WHERE bucket < '" + *rollupCutoff + "';")) {
+            std::cerr << "Failed to delete old rollups from " << rollupTable << std::endl;
+            expired = false;
+        }
+    }
     
-    PGresult* successRes = executeQueryWithResult(successSQLStream.str());
-    if (!successRes) {
-        std::cerr << "Failed to query success count" << std::endl;
+    if (!expired || !commitTransaction()) {
+        rollbackTransaction();
+        std::cerr << "Cleanup rolled back, no data was deleted" << std::endl;
         return;
     }
-    
-    int successCount = 0;
-    if (PQntuples(successRes) > 0) {
-        successCount = atoi(PQgetvalue(successRes, 0, 0));
+    for (const auto& partitionName : droppedPartitions) {
+        samplePartitions.erase(partitionName);
+    }
+    if (!droppedPartitions.empty()) {
+        std::cout << "Dropped sample partitions: " << droppedPartitions.size() << std::endl;
     }
-    PQclear(successRes);
-    
-    int failureCount = totalRecords - successCount;
-    double successRate = (totalRecords > 0) ? (double)successCount / totalRecords * 100 : 0;
-    double failureRate = (totalRecords > 0) ? (double)failureCount / totalRecords * 100 : 0;
-    
-    std::cout << "Successful pings: " << successCount << std::endl;
-    std::cout << "Failed pings: " << failureCount << std::endl;
-    std::cout << "Success rate: " << std::fixed << std::setprecision(2) << successRate << "%" << std::endl;
-    std::cout << "Failure rate: " << std::fixed << std::setprecision(2) << failureRate << "%" << std::endl;
-    
-    // 获取平均延迟
-    std::ostringstream avgDelaySQLStream;
-    avgDelaySQLStream << "SELECT AVG(delay) FROM " << tableName << " WHERE success = true;";
     
-    PGresult* avgDelayRes = executeQueryWithResult(avgDelaySQLStream.str());
-    if (!avgDelayRes) {
-        std::cerr << "Failed to query average delay" << std::endl;
-        return;
+    // 段文件按天整体删除
+    int removedSegments = segmentStore.removeBefore(cutoff);
+    if (removedSegments > 0) {
+        std::cout << "Removed segment files: " << removedSegments << std::endl;
     }
     
-    double avgDelay = 0;
-    if (PQntuples(avgDelayRes) > 0) {
-        char* avgText = PQgetvalue(avgDelayRes, 0, 0);
-        if (avgText) {
-            avgDelay = atof(avgText);
+    // 清理hosts表中没有样本、旧版表、告警和段文件的IP记录
+    PGresult* unusedRes = executeQueryWithResult(
+        "SELECT h.ip FROM hosts h WHERE NOT EXISTS (SELECT 1 FROM samples s WHERE s.ip = h.ip) "
+        "AND NOT EXISTS (SELECT 1 FROM alerts a WHERE a.ip = h.ip) "
+        "AND to_regclass('ping_' || replace(h.ip, '.', '_')) IS NULL;");
+    if (unusedRes) {
+        int removedHosts = 0;
+        for (int row = 0; row < PQntuples(unusedRes); row++) {
+            std::string ip = PQgetvalue(unusedRes, row, 0);
+            if (segmentStore.hasHost(ip)) {
+                continue;
+            }
+            const char* values[] = {ip.c_str()};
+            PGresult* deleteRes = PQexecParams(conn, "DELETE FROM hosts WHERE ip = $1;", 1, nullptr, values, nullptr, nullptr, 0);
+            if (PQresultStatus(deleteRes) == PGRES_COMMAND_OK) {
+                removedHosts++;
+            }
+            PQclear(deleteRes);
+        }
+        PQclear(unusedRes);
+        if (removedHosts > 0) {
+            std::cout << "Removed unused host records: " << removedHosts << std::endl;
         }
     }
-    PQclear(avgDelayRes);
     
-    std::cout << "Average delay (successful pings): " << std::fixed << std::setprecision(2) << avgDelay << "ms" << std::endl;
-    
-    // 获取最大和最小延迟
-    std::ostringstream maxMinDelaySQLStream;
-    maxMinDelaySQLStream << "SELECT MAX(delay), MIN(delay) FROM " << tableName << " WHERE success = true;";
-    
-    PGresult* maxMinDelayRes = executeQueryWithResult(maxMinDelaySQLStream.str());
-    if (!maxMinDelayRes) {
-        std::cerr << "Failed to query max/min delay" << std::endl;
+    std::cout << "Total deleted records: " << totalDeleted << std::endl;
+    std::cout << "Cleanup completed." << std::endl;
+}
+
+// PostgreSQL的空间回收由autovacuum负责，这里无需额外操作
+bool DatabaseManagerPG::reclaimFreePages(int) {
+    return conn != nullptr;
+}
+
+void DatabaseManagerPG::printDatabaseStats() {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
         return;
     }
     
-    int maxDelay = 0, minDelay = 0;
-    if (PQntuples(maxMinDelayRes) > 0) {
-        char* maxText = PQgetvalue(maxMinDelayRes, 0, 0);
-        char* minText = PQgetvalue(maxMinDelayRes, 0, 1);
-        if (maxText) maxDelay = atoi(maxText);
-        if (minText) minDelay = atoi(minText);
+    PGresult* sizeRes = executeQueryWithResult("SELECT pg_database_size(current_database()), current_database();");
+    if (!sizeRes) {
+        std::cerr << "Failed to query database size" << std::endl;
+        return;
     }
-    PQclear(maxMinDelayRes);
+    std::string databaseSize = PQgetvalue(sizeRes, 0, 0);
+    std::string databaseName = PQgetvalue(sizeRes, 0, 1);
+    PQclear(sizeRes);
+    
+    PGresult* tupleRes = executeQueryWithResult(
+        "SELECT COALESCE(SUM(n_live_tup), 0), COALESCE(SUM(n_dead_tup), 0) FROM pg_stat_user_tables;");
+    if (!tupleRes) {
+        std::cerr << "Failed to query tuple statistics" << std::endl;
+        return;
+    }
+    long long liveTuples = atoll(PQgetvalue(tupleRes, 0, 0));
+    long long deadTuples = atoll(PQgetvalue(tupleRes, 0, 1));
+    PQclear(tupleRes);
     
-    std::cout << "Maximum delay (successful pings): " << maxDelay << "ms" << std::endl;
-    std::cout << "Minimum delay (successful pings): " << minDelay << "ms" << std::endl;
+    double deadRatio = (liveTuples + deadTuples > 0) ? (double)deadTuples / (liveTuples + deadTuples) * 100 : 0;
     
-    // 显示最近的10条记录
-    std::ostringstream recentSQLStream;
-    recentSQLStream << "SELECT delay, success, timestamp FROM " << tableName << " ORDER BY timestamp DESC LIMIT 10;";
+    std::cout << "Database statistics: " << databaseName << std::endl;
+    std::cout << "=========================================================" << std::endl;
+    std::cout << "Database size: " << databaseSize << " bytes" << std::endl;
+    std::cout << "Live tuples: " << liveTuples << std::endl;
+    std::cout << "Dead tuples: " << deadTuples << " (" << std::fixed << std::setprecision(2) << deadRatio << "%)" << std::endl;
+    
+    auto partitions = listSamplePartitions();
+    if (!partitions.empty()) {
+        std::cout << "\nSample partitions: " << partitions.size() << " (" << formatDate(partitions.front().second)
+                  << " to " << formatDate(partitions.back().second) << ")" << std::endl;
+    }
+    if (legacyTableCount > 0) {
+        std::cout << "Legacy ping_* tables: " << legacyTableCount << " (run with --migrate)" << std::endl;
+    }
     
-    PGresult* recentRes = executeQueryWithResult(recentSQLStream.str());
-    if (!recentRes) {
-        std::cerr << "Failed to query recent records" << std::endl;
-        return;
+    auto [segmentBytes, segmentFiles] = segmentStore.diskUsage();
+    if (segmentFiles > 0) {
+        std::cout << "\nSegment files: " << segmentFiles << " (" << segmentBytes << " bytes in " << segmentStore.getDirectory() << ")" << std::endl;
+    }
+}
+
+bool DatabaseManagerPG::migrateLegacyTables() {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
     }
     
-    std::cout << "\nRecent ping records (last 10):" << std::endl;
-    std::cout << "Timestamp           \tDelay\tStatus" << std::endl;
-    std::cout << "--------------------------------------------------------" << std::endl;
+    PGresult* tablesRes = executeQueryWithResult(LEGACY_TABLES_SQL);
+    if (!tablesRes) {
+        return false;
+    }
+    std::vector<std::pair<std::string, std::string>> tables;  // (ip, tablename)
+    for (int row = 0; row < PQntuples(tablesRes); row++) {
+        tables.emplace_back(PQgetvalue(tablesRes, row, 0), PQgetvalue(tablesRes, row, 1));
+    }
+    PQclear(tablesRes);
     
-    for (int i = 0; i < PQntuples(recentRes); i++) {
-        char* timestamp = PQgetvalue(recentRes, i, 2);
-        char* delay = PQgetvalue(recentRes, i, 0);
-        char* success = PQgetvalue(recentRes, i, 1);
+    if (tables.empty()) {
+        std::cout << "No legacy ping_* tables to migrate." << std::endl;
+        return true;
+    }
+    std::cout << "Migrating " << tables.size() << " legacy ping_* tables into samples..." << std::endl;
+    
+    // 汇总表已包含这些样本，迁移只移动原始数据；中断后重新运行会从未迁移的表继续
+    bool success = true;
+    long long migratedSamples = 0;
+    for (const auto& [ip, tableName] : tables) {
+        PGresult* rangeRes = executeQueryWithResult(
+            "SELECT to_char(MIN(timestamp), 'YYYY-MM-DD'), to_char(MAX(timestamp), 'YYYY-MM-DD') FROM " + tableName + ";");
+        if (!rangeRes) {
+            success = false;
+            continue;
+        }
+        auto first = SegmentStore::parseTimestamp(PQgetvalue(rangeRes, 0, 0));
+        auto last = SegmentStore::parseTimestamp(PQgetvalue(rangeRes, 0, 1));
+        PQclear(rangeRes);
+        
+        // 分区在事务外创建，空表直接删除
+        if (first && last &&
+            !ensureSamplePartitions(std::chrono::sys_days{std::chrono::days{*first / 86400}},
+                                    std::chrono::sys_days{std::chrono::days{*last / 86400}})) {
+            success = false;
+            continue;
+        }
         
-        std::cout << (timestamp ? timestamp : "N/A") << "\t" 
-                  << (delay ? delay : "N/A") << "ms\t" 
-                  << (success && strcmp(success, "t") == 0 ? "Success" : "Failed") << std::endl;
+        if (!beginTransaction()) {
+            return false;
+        }
+        PGresult* insertRes = PQexec(conn, ("INSERT INTO samples (ip, delay, success, timestamp) SELECT " + escapeString(ip) +
+                                            ", delay, success, timestamp FROM " + tableName + " WHERE timestamp IS NOT NULL;").c_str());
+        bool moved = PQresultStatus(insertRes) == PGRES_COMMAND_OK;
+        long long rows = moved ? atoll(PQcmdTuples(insertRes)) : 0;
+        if (!moved) {
+            std::cerr << "Failed to migrate " << tableName << ": " << PQresultErrorMessage(insertRes) << std::endl;
+        }
+        PQclear(insertRes);
+        
+        if (moved && executeQuery("DROP TABLE " + tableName + ";") && commitTransaction()) {
+            migratedSamples += rows;
+            legacyTableCount--;
+            std::cout << "Migrated " << rows << " records for IP " << ip << std::endl;
+        } else {
+            rollbackTransaction();
+            success = false;
+        }
     }
-    PQclear(recentRes);
+    
+    std::cout << "Total migrated records: " << migratedSamples << std::endl;
+    return success;
 }
 
-void DatabaseManagerPG::cleanupOldData(int days) {
+void DatabaseManagerPG::tierColdData(int days) {
     if (!conn) {
         std::cerr << "Database not initialized" << std::endl;
         return;
     }
     
-    std::cout << "Cleaning up data older than " << days << " days..." << std::endl;
+    std::chrono::sys_days cutoff = localToday() - std::chrono::days{days};
+    std::string cutoffText = formatDate(cutoff);
+    std::cout << "Moving samples before " << cutoffText << " to segment files in " << segmentStore.getDirectory() << "..." << std::endl;
     
-    // 获取所有IP地址
-    PGresult* hostsRes = executeQueryWithResult("SELECT ip FROM hosts;");
-    if (!hostsRes) {
-        std::cerr << "Failed to query hosts" << std::endl;
-        return;
+    long long movedSamples = 0;
+    int writtenSegments = 0;
+    
+    // 读取一个主机一天的样本写成段文件，写入并落盘后才允许删除原始数据
+    auto writeSegment = [&](const std::string& ip, std::chrono::sys_days day, const std::string& selectSQL,
+                            const std::vector<std::string>& params) {
+        std::vector<PGresult*> results;
+        if (!runPipeline({{selectSQL, params}}, &results)) {
+            for (PGresult* res : results) {
+                PQclear(res);
+            }
+            return false;
+        }
+        PGresult* samplesRes = results[0];
+        std::vector<SegmentStore::Sample> samples;
+        samples.reserve(PQntuples(samplesRes));
+        bool parsed = true;
+        for (int i = 0; i < PQntuples(samplesRes); i++) {
+            auto seconds = SegmentStore::parseTimestamp(PQgetvalue(samplesRes, i, 0));
+            if (!seconds) {
+                parsed = false;
+                break;
+            }
+            samples.push_back({*seconds, static_cast<short>(atoi(PQgetvalue(samplesRes, i, 1))),
+                               strcmp(PQgetvalue(samplesRes, i, 2), "t") == 0});
+        }
+        PQclear(samplesRes);
+        
+        if (!parsed || !segmentStore.writeDay(ip, day, std::move(samples))) {
+            std::cerr << "Skipping " << formatDate(day) << " for IP " << ip << std::endl;
+            return false;
+        }
+        writtenSegments++;
+        return true;
+    };
+    
+    // 分区表：早于截止日期的日分区逐个处理，所有主机都写成段文件后整体删除分区
+    for (const auto& [partitionName, day] : listSamplePartitions()) {
+        if (day >= cutoff) {
+            break;
+        }
+        PGresult* ipsRes = executeQueryWithResult("SELECT ip, COUNT(*) FROM " + partitionName + " GROUP BY ip;");
+        if (!ipsRes) {
+            continue;
+        }
+        bool allWritten = true;
+        long long partitionSamples = 0;
+        for (int row = 0; row < PQntuples(ipsRes); row++) {
+            std::string ip = PQgetvalue(ipsRes, row, 0);
+            partitionSamples += atoll(PQgetvalue(ipsRes, row, 1));
+            allWritten = writeSegment(ip, day, "SELECT to_char(timestamp, 'YYYY-MM-DD HH24:MI:SS'), delay, success FROM " +
+                                      partitionName + " WHERE ip = $1;", {ip}) && allWritten;
+        }
+        PQclear(ipsRes);
+        
+        if (!allWritten) {
+            continue;
+        }
+        if (executeQuery("DROP TABLE " + partitionName + ";")) {
+            samplePartitions.erase(partitionName);
+            movedSamples += partitionSamples;
+        } else {
+            std::cerr << "Failed to drop tiered partition " << partitionName << std::endl;
+        }
     }
     
-    int totalDeleted = 0;
+    // 尚未迁移的旧版ping_*表：逐天写段文件后按行删除
+    PGresult* tablesRes = executeQueryWithResult(LEGACY_TABLES_SQL);
+    if (!tablesRes) {
+        return;
+    }
     
-    for (int row = 0; row < PQntuples(hostsRes); row++) {
-        char* ip = PQgetvalue(hostsRes, row, 0);
+    for (int row = 0; row < PQntuples(tablesRes); row++) {
+        std::string ip = PQgetvalue(tablesRes, row, 0);
+        std::string tableName = PQgetvalue(tablesRes, row, 1);
         
-        if (ip) {
-            std::string ipStr = ip;
-            std::string tableName = "ping_" + std::regex_replace(ipStr, std::regex(R"(\.)"), "_");
-            
-            // 删除指定天数之前的数据
-            std::ostringstream deleteSQLStream;
-            deleteSQLStream << "DELETE FROM " << tableName << " WHERE timestamp < NOW() - INTERVAL '" << days << " days';";
-            
-            PGresult* deleteRes = PQexec(conn, deleteSQLStream.str().c_str());
-            if (PQresultStatus(deleteRes) != PGRES_COMMAND_OK) {
-                std::cerr << "Failed to delete old data for IP " << ipStr << ": " << PQresultErrorMessage(deleteRes) << std::endl;
-                PQclear(deleteRes);
+        std::ostringstream daysSQLStream;
+        daysSQLStream << "SELECT DISTINCT to_char(timestamp, 'YYYY-MM-DD') FROM " << tableName
+                      << " WHERE timestamp < " << escapeString(cutoffText) << "::timestamp ORDER BY 1;";
+        PGresult* daysRes = executeQueryWithResult(daysSQLStream.str());
+        if (!daysRes) {
+            continue;
+        }
+        std::vector<std::string> dayTexts;
+        for (int i = 0; i < PQntuples(daysRes); i++) {
+            dayTexts.push_back(PQgetvalue(daysRes, i, 0));
+        }
+        PQclear(daysRes);
+        
+        // 逐天处理：每天的样本写成段文件并落盘后再从样本表删除，内存占用以一天为上限
+        for (const auto& dayText : dayTexts) {
+            auto dayStart = SegmentStore::parseTimestamp(dayText);
+            if (!dayStart) {
                 continue;
             }
+            std::chrono::sys_days day{std::chrono::days{*dayStart / 86400}};
+            std::string rangeCondition = " WHERE timestamp >= " + escapeString(dayText) + "::timestamp AND timestamp < " +
+                                         escapeString(formatDate(day + std::chrono::days{1})) + "::timestamp";
             
-            int deletedRows = atoi(PQcmdTuples(deleteRes));
-            totalDeleted += deletedRows;
-            PQclear(deleteRes);
+            if (!writeSegment(ip, day, "SELECT to_char(timestamp, 'YYYY-MM-DD HH24:MI:SS'), delay, success FROM " +
+                              tableName + rangeCondition + ";", {})) {
+                continue;
+            }
             
-            if (deletedRows > 0) {
-                std::cout << "Deleted " << deletedRows << " old records for IP " << ipStr << std::endl;
+            PGresult* deleteRes = PQexec(conn, ("DELETE FROM " + tableName + rangeCondition + ";").c_str());
+            if (PQresultStatus(deleteRes) == PGRES_COMMAND_OK) {
+                movedSamples += atoll(PQcmdTuples(deleteRes));
+            } else {
+                std::cerr << "Failed to delete tiered samples for IP " << ip << ": " << PQresultErrorMessage(deleteRes) << std::endl;
             }
+            PQclear(deleteRes);
         }
     }
+    PQclear(tablesRes);
     
-    PQclear(hostsRes);
-    
-    // 清理hosts表中没有关联数据的IP记录
-    // 注意：这在PostgreSQL中需要特殊处理，因为表名不能直接在查询中参数化
-    // 这里简化处理，仅输出提示信息
-    std::cout << "Note: Cleaning unused host records is not implemented in this PostgreSQL version." << std::endl;
-    
-    std::cout << "Total deleted records: " << totalDeleted << std::endl;
-    std::cout << "Cleanup completed." << std::endl;
+    auto [segmentBytes, segmentFiles] = segmentStore.diskUsage();
+    std::cout << "Moved " << movedSamples << " samples into " << writtenSegments << " segment files" << std::endl;
+    std::cout << "Segment store: " << segmentFiles << " files, " << segmentBytes << " bytes" << std::endl;
 }
 
 std::map<std::string, std::string> DatabaseManagerPG::getAllHosts() {
@@ -547,13 +1912,15 @@ bool DatabaseManagerPG::addAlert(const std::string& ip, const std::string& hostn
         return false;
     }
     
-    // 插入或更新告警记录
-    std::ostringstream alertSQLStream;
-    alertSQLStream << "INSERT INTO alerts (ip, hostname, created_time) VALUES (" 
-                   << escapeString(ip) << ", " << escapeString(hostname) << ", NOW())"
-                   << " ON CONFLICT (ip) DO NOTHING;";
+    // 插入告警记录（已存在时保持原告警时间）
+    if (!executePrepared("add_alert", {ip, hostname})) {
+        return false;
+    }
     
-    return executeQuery(alertSQLStream.str());
+    if (alertStateLoaded) {
+        activeAlerts.insert(ip);
+    }
+    return true;
 }
 
 bool DatabaseManagerPG::removeAlert(const std::string& ip) {
@@ -568,48 +1935,71 @@ bool DatabaseManagerPG::removeAlert(const std::string& ip) {
         return false;
     }
     
-    // 获取告警信息，用于写入恢复记录
-    std::ostringstream selectAlertSQLStream;
-    selectAlertSQLStream << "SELECT hostname, created_time FROM alerts WHERE ip = " << escapeString(ip) << ";";
+    // 在一条语句中删除告警并把它写入恢复记录表（没有告警时不写入）
+    if (!executePrepared("resolve_alert", {ip})) {
+        std::cerr << "Failed to resolve alert for IP: " << ip << std::endl;
+        return false;
+    }
+    
+    activeAlerts.erase(ip);
+    
+    return true;
+}
+
+bool DatabaseManagerPG::loadAlertState() {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
     
-    PGresult* selectRes = executeQueryWithResult(selectAlertSQLStream.str());
-    if (!selectRes) {
-        std::cerr << "Failed to query alert information for IP: " << ip << std::endl;
+    PGresult* res = executeQueryWithResult("SELECT ip FROM alerts;");
+    if (!res) {
+        std::cerr << "Failed to query alert state" << std::endl;
         return false;
     }
     
-    std::string hostname, alertTime;
-    if (PQntuples(selectRes) > 0) {
-        char* hostText = PQgetvalue(selectRes, 0, 0);
-        char* timeText = PQgetvalue(selectRes, 0, 1);
-        if (hostText) {
-            hostname = hostText;
-        }
-        if (timeText) {
-            alertTime = timeText;
-        }
+    activeAlerts.clear();
+    for (int row = 0; row < PQntuples(res); row++) {
+        activeAlerts.insert(PQgetvalue(res, row, 0));
+    }
+    PQclear(res);
+    
+    alertStateLoaded = true;
+    return true;
+}
+
+bool DatabaseManagerPG::isAlertActive(const std::string& ip) const {
+    return activeAlerts.contains(ip);
+}
+
+// 批量写入告警状态变化：每台主机执行一次预编译的add_alert或resolve_alert，
+// 全部语句通过管道发送，每PIPELINE_BATCH台主机只需一次网络往返
+bool DatabaseManagerPG::applyAlertTransitions(const std::vector<std::pair<std::string, std::string>>& newlyDown,
+                                              const std::vector<std::string>& newlyUp) {
+    if (!conn) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
     }
-    PQclear(selectRes);
     
-    // 从告警表中删除记录
-    std::ostringstream alertSQLStream;
-    alertSQLStream << "DELETE FROM alerts WHERE ip = " << escapeString(ip) << ";";
+    std::vector<PipelineStatement> statements;
+    statements.reserve(newlyDown.size() + newlyUp.size());
+    for (const auto& [ip, hostname] : newlyDown) {
+        statements.push_back({"add_alert", {ip, hostname}, true});
+    }
+    for (const auto& ip : newlyUp) {
+        statements.push_back({"resolve_alert", {ip}, true});
+    }
     
-    if (!executeQuery(alertSQLStream.str())) {
+    if (!statements.empty() && !runPipeline(statements)) {
+        std::cerr << "Failed to apply alert transitions" << std::endl;
         return false;
     }
     
-    // 如果找到了告警记录，将其写入恢复记录表
-    if (!hostname.empty() && !alertTime.empty()) {
-        std::ostringstream insertRecoverySQLStream;
-        insertRecoverySQLStream << "INSERT INTO recovery_records (ip, hostname, alert_time, recovery_time) VALUES ("
-                                << escapeString(ip) << ", " << escapeString(hostname) << ", " 
-                                << escapeString(alertTime) << ", NOW());";
-        
-        if (!executeQuery(insertRecoverySQLStream.str())) {
-            std::cerr << "Failed to insert recovery record for IP: " << ip << std::endl;
-            return false;
-        }
+    for (const auto& [ip, hostname] : newlyDown) {
+        activeAlerts.insert(ip);
+    }
+    for (const auto& ip : newlyUp) {
+        activeAlerts.erase(ip);
     }
     
     return true;
@@ -619,93 +2009,242 @@ std::vector<std::tuple<std::string, std::string, std::string>> DatabaseManagerPG
     return getActiveAlerts(-1);  // -1表示获取所有告警
 }
 
-std::vector<std::tuple<std::string, std::string, std::string>> DatabaseManagerPG::getActiveAlerts(int days) {
-    std::vector<std::tuple<std::string, std::string, std::string>> alerts;
-    
+// 以单行模式执行查询：服务器返回的每一行单独交给visitRow，客户端不缓存整个结果集
+// visitRow返回false时取消查询并丢弃剩余的结果
+bool DatabaseManagerPG::streamQuery(const std::string& query, const std::vector<const char*>& params,
+                                    const std::function<bool(PGresult*)>& visitRow) {
     if (!conn) {
-        std::cerr << "Database not initialized" << std::endl;
-        return alerts;
+        std::println(std::cerr, "Database not initialized");
+        return false;
     }
     
-    // 查询活动告警
-    std::string selectAlertsSQL;
-    if (days >= 0) {
-        // 查询指定天数内的告警
-        std::ostringstream sqlStream;
-        sqlStream << "SELECT ip, hostname, created_time FROM alerts WHERE created_time >= NOW() - INTERVAL '" << days << " days';";
-        selectAlertsSQL = sqlStream.str();
-    } else {
-        // 查询所有告警
-        selectAlertsSQL = "SELECT ip, hostname, created_time FROM alerts;";
+    bool success = PQsendQueryParams(conn, query.c_str(), static_cast<int>(params.size()), nullptr, params.data(), nullptr, nullptr, 0) == 1 &&
+                   PQsetSingleRowMode(conn) == 1;
+    if (!success) {
+        std::println(std::cerr, "Failed to send query: {}", PQerrorMessage(conn));
     }
     
-    PGresult* res = executeQueryWithResult(selectAlertsSQL);
-    if (!res) {
-        std::cerr << "Failed to query alerts" << std::endl;
-        return alerts;
+    bool stopped = false;
+    PGresult* res;
+    while ((res = PQgetResult(conn)) != nullptr) {
+        ExecStatusType status = PQresultStatus(res);
+        if (status == PGRES_SINGLE_TUPLE) {
+            if (!stopped && !visitRow(res)) {
+                stopped = true;
+                if (PGcancel* cancel = PQgetCancel(conn)) {
+                    char errbuf[256];
+                    PQcancel(cancel, errbuf, sizeof(errbuf));
+                    PQfreeCancel(cancel);
+                }
+            }
+        } else if (status != PGRES_TUPLES_OK && !stopped && success) {
+            std::println(std::cerr, "Query failed: {}", PQresultErrorMessage(res));
+            success = false;
+        }
+        PQclear(res);
+    }
+    return success;
+}
+
+// 按(created_time, ip)顺序逐行读取告警，走idx_alerts_created索引，结果不在内存中累积
+bool DatabaseManagerPG::forEachActiveAlert(int days, const std::string& afterTime, const std::string& afterIP, long long limit,
+                                           const AlertVisitor& visit) {
+    std::vector<std::string> values;
+    auto param = [&](std::string value) {
+        values.push_back(std::move(value));
+        return "$" + std::to_string(values.size());
+    };
+    
+    // 键集分页：从上一页最后一行的(创建时间, IP)之后继续，该告警已解除时也不受影响
+    std::string selectAlertsSQL = "SELECT ip, hostname, created_time FROM alerts WHERE ip IS NOT NULL";
+    if (days >= 0) {
+        selectAlertsSQL += " AND created_time >= NOW() - make_interval(days => " + param(std::to_string(days)) + "::integer)";
+    }
+    if (!afterTime.empty()) {
+        selectAlertsSQL += " AND (created_time, ip) > (" + param(afterTime) + "::timestamp, " + param(afterIP) + ")";
+    }
+    selectAlertsSQL += " ORDER BY created_time, ip";
+    if (limit >= 0) {
+        selectAlertsSQL += " LIMIT " + param(std::to_string(limit)) + "::bigint";
     }
     
-    for (int row = 0; row < PQntuples(res); row++) {
-        char* ip = PQgetvalue(res, row, 0);
-        char* hostname = PQgetvalue(res, row, 1);
-        char* created_time = PQgetvalue(res, row, 2);
-        
-        if (ip) {
-            std::string ipStr = ip ? ip : "";
-            std::string hostnameStr = hostname ? hostname : "";
-            std::string timeStr = created_time ? created_time : "";
-            alerts.emplace_back(ipStr, hostnameStr, timeStr);
-        }
+    std::vector<const char*> params;
+    for (const auto& value : values) {
+        params.push_back(value.c_str());
+    }
+    return streamQuery(selectAlertsSQL, params, [&](PGresult* res) {
+        return visit(PQgetvalue(res, 0, 0), PQgetvalue(res, 0, 1), PQgetvalue(res, 0, 2));
+    });
+}
+
+// 按(recovery_time, id)顺序逐行读取恢复记录，走idx_recovery_records_time索引
+bool DatabaseManagerPG::forEachRecoveryRecord(int days, long long afterId, long long limit, const RecoveryVisitor& visit) {
+    std::vector<std::string> values;
+    auto param = [&](std::string value) {
+        values.push_back(std::move(value));
+        return "$" + std::to_string(values.size());
+    };
+    
+    // 键集分页：从上一页最后一条记录之后继续；该记录已被清理时它早于全部剩余记录，从头开始
+    std::string selectRecordsSQL = "SELECT id, ip, hostname, alert_time, recovery_time FROM recovery_records WHERE TRUE";
+    if (days >= 0) {
+        selectRecordsSQL += " AND recovery_time >= NOW() - make_interval(days => " + param(std::to_string(days)) + "::integer)";
+    }
+    if (afterId > 0) {
+        std::string after = param(std::to_string(afterId)) + "::integer";
+        selectRecordsSQL += " AND (recovery_time, id) > (COALESCE((SELECT recovery_time FROM recovery_records WHERE id = " + after + "), '-infinity'), " + after + ")";
+    }
+    selectRecordsSQL += " ORDER BY recovery_time, id";
+    if (limit >= 0) {
+        selectRecordsSQL += " LIMIT " + param(std::to_string(limit)) + "::bigint";
     }
     
-    PQclear(res);
+    std::vector<const char*> params;
+    for (const auto& value : values) {
+        params.push_back(value.c_str());
+    }
+    return streamQuery(selectRecordsSQL, params, [&](PGresult* res) {
+        return visit(atoll(PQgetvalue(res, 0, 0)), PQgetvalue(res, 0, 1), PQgetvalue(res, 0, 2),
+                     PQgetvalue(res, 0, 3), PQgetvalue(res, 0, 4));
+    });
+}
+
+std::vector<std::tuple<std::string, std::string, std::string>> DatabaseManagerPG::getActiveAlerts(int days) {
+    std::vector<std::tuple<std::string, std::string, std::string>> alerts;
+    forEachActiveAlert(days, "", "", -1, [&](std::string_view ip, std::string_view hostname, std::string_view createdTime) {
+        alerts.emplace_back(ip, hostname, createdTime);
+        return true;
+    });
     return alerts;
 }
+
 std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> DatabaseManagerPG::getRecoveryRecords() {
     return getRecoveryRecords(-1);  // -1表示获取所有恢复记录
 }
 
 std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> DatabaseManagerPG::getRecoveryRecords(int days) {
     std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> records;
-    
+    forEachRecoveryRecord(days, 0, -1, [&](long long id, std::string_view ip, std::string_view hostname,
+                                           std::string_view alertTime, std::string_view recoveryTime) {
+        records.emplace_back(static_cast<int>(id), ip, hostname, alertTime, recoveryTime);
+        return true;
+    });
+    return records;
+}
+// 依次遍历段文件中的冷数据和samples表中的样本；样本以二进制COPY逐行读出，时间由微秒数直接换算为秒数，
+// 不经过时间戳文本，客户端也不缓存结果集；尚未迁移的旧版ping_*表不在遍历范围内
+bool DatabaseManagerPG::forEachSample(const std::string& ip, const std::string& since, const std::string& until,
+                                      const std::function<bool(const SegmentStore::Sample&)>& visit) {
     if (!conn) {
-        std::cerr << "Database not initialized" << std::endl;
-        return records;
+        std::println(std::cerr, "Database not initialized");
+        return false;
+    }
+    if (!isValidIP(ip)) {
+        std::println(std::cerr, "Invalid IP address: {}", ip);
+        return false;
     }
     
-    // 查询恢复记录
-    std::string selectRecordsSQL;
-    if (days >= 0) {
-        // 查询指定天数内的恢复记录
-        std::ostringstream sqlStream;
-        sqlStream << "SELECT id, ip, hostname, alert_time, recovery_time FROM recovery_records WHERE recovery_time >= NOW() - INTERVAL '" << days << " days';";
-        selectRecordsSQL = sqlStream.str();
-    } else {
-        // 查询所有恢复记录
-        selectRecordsSQL = "SELECT id, ip, hostname, alert_time, recovery_time FROM recovery_records;";
+    std::int64_t sinceTime;
+    std::int64_t untilTime;
+    if (!SegmentStore::parseTimeRange(since, until, sinceTime, untilTime)) {
+        return false;
+    }
+    bool keepGoing = true;
+    if (!segmentStore.forEachSample(ip, sinceTime, untilTime, [&](const SegmentStore::Sample& sample) {
+            return keepGoing = visit(sample);
+        })) {
+        return false;
+    }
+    if (!keepGoing) {
+        return true;
     }
     
-    PGresult* res = executeQueryWithResult(selectRecordsSQL);
-    if (!res) {
-        std::cerr << "Failed to query recovery records" << std::endl;
-        return records;
+    const char* integerDatetimes = PQparameterStatus(conn, "integer_datetimes");
+    if (!integerDatetimes || std::strcmp(integerDatetimes, "on") != 0) {
+        std::println(std::cerr, "Binary COPY requires a server with integer_datetimes enabled");
+        return false;
     }
     
-    for (int row = 0; row < PQntuples(res); row++) {
-        int id = atoi(PQgetvalue(res, row, 0));
-        char* ip = PQgetvalue(res, row, 1);
-        char* hostname = PQgetvalue(res, row, 2);
-        char* alert_time = PQgetvalue(res, row, 3);
-        char* recovery_time = PQgetvalue(res, row, 4);
-        
-        std::string ipStr = ip ? ip : "";
-        std::string hostnameStr = hostname ? hostname : "";
-        std::string alertTimeStr = alert_time ? alert_time : "";
-        std::string recoveryTimeStr = recovery_time ? recovery_time : "";
-        
-        records.emplace_back(id, ipStr, hostnameStr, alertTimeStr, recoveryTimeStr);
+    // COPY不接受参数，范围以转义后的字面量写入；走idx_samples_ip_ts索引，按时间顺序输出
+    std::string copySQL = "COPY (SELECT timestamp, delay, success FROM samples WHERE ip = " + escapeString(ip);
+    if (!since.empty()) {
+        copySQL += " AND timestamp >= " + escapeString(since);
     }
+    if (!until.empty()) {
+        copySQL += " AND timestamp < " + escapeString(until);
+    }
+    copySQL += " ORDER BY timestamp) TO STDOUT (FORMAT binary);";
     
+    PGresult* res = PQexec(conn, copySQL.c_str());
+    if (PQresultStatus(res) != PGRES_COPY_OUT) {
+        std::println(std::cerr, "Failed to start COPY: {}", PQresultErrorMessage(res));
+        PQclear(res);
+        return false;
+    }
     PQclear(res);
-    return records;
-}
\ No newline at end of file
+    
+    // 每条CopyData消息是一行，文件头和第一行在同一条消息中，结束标记为字段数-1
+    bool success = true;
+    bool headerRead = false;
+    char* row;
+    int length;
+    while ((length = PQgetCopyData(conn, &row, 0)) > 0) {
+        const char* cursor = row;
+        const char* end = row + length;
+        if (!headerRead) {
+            headerRead = true;
+            if (length < 19 || std::memcmp(row, COPY_BINARY_SIGNATURE, sizeof(COPY_BINARY_SIGNATURE)) != 0) {
+                std::println(std::cerr, "Unexpected COPY header for IP {}", ip);
+                success = false;
+            } else {
+                cursor += 19 + readInt32(row + 15);
+            }
+        }
+        
+        if (success && keepGoing && cursor + 2 <= end && readInt16(cursor) == 3) {
+            cursor += 2;
+            std::int32_t lengths[3] = {};
+            const char* values[3] = {};
+            int fields = 0;
+            for (; fields < 3 && cursor + 4 <= end; fields++) {
+                lengths[fields] = readInt32(cursor);
+                values[fields] = cursor + 4;
+                cursor += 4 + std::max(lengths[fields], 0);
+            }
+            // 截断的行（字段不足三个或字段越过消息末尾）按协议错误处理
+            if (fields < 3 || cursor > end || lengths[0] != 8) {
+                std::println(std::cerr, "Malformed COPY row for IP {}", ip);
+                success = false;
+            } else {
+                std::int64_t microseconds = readInt64(values[0]);
+                std::int64_t seconds = microseconds / 1000000 - (microseconds % 1000000 < 0 ? 1 : 0);
+                keepGoing = visit({seconds + POSTGRES_EPOCH_OFFSET,
+                                   static_cast<short>(lengths[1] == 4 ? readInt32(values[1]) : 0),
+                                   lengths[2] == 1 && values[2][0] != 0});
+            }
+            
+            // 提前停止时取消COPY，剩余的行只读取不解析
+            if (!keepGoing || !success) {
+                if (PGcancel* cancel = PQgetCancel(conn)) {
+                    char errbuf[256];
+                    PQcancel(cancel, errbuf, sizeof(errbuf));
+                    PQfreeCancel(cancel);
+                }
+            }
+        }
+        PQfreemem(row);
+    }
+    if (length == -2) {
+        std::println(std::cerr, "Failed to read COPY data: {}", PQerrorMessage(conn));
+        success = false;
+    }
+    
+    while ((res = PQgetResult(conn)) != nullptr) {
+        if (PQresultStatus(res) != PGRES_COMMAND_OK && keepGoing && success) {
+            std::println(std::cerr, "COPY failed: {}", PQresultErrorMessage(res));
+            success = false;
+        }
+        PQclear(res);
+    }
+    return success;
+}
@@ -2,31 +2,120 @@
 #define DATABASE_MANAGER_PG_H
 
 #include <string>
+#include <ostream>
+#include <string_view>
+#include <functional>
 #include <vector>
 #include <tuple>
 #include <map>
+#include <unordered_set>
+#include <set>
+#include <chrono>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
 #include <libpq-fe.h>
 #include <regex>
+#include "segment_store.h"
+#include "pg_connection_pool.h"
 
 class DatabaseManagerPG {
+public:
+    // 管道中的一条语句：prepared为true时sql是预编译语句名，否则是带$n参数的SQL文本
+    struct PipelineStatement {
+        std::string sql;
+        std::vector<std::string> params;
+        bool prepared = false;
+    };
+    
+    // 异步写入的状态
+    enum class AsyncStatus { Idle, Pending, Done, Failed };
+    
+    // 逐行查询的回调：(IP, 主机名, 告警时间) 和 (ID, IP, 主机名, 告警时间, 恢复时间)
+    using AlertVisitor = std::function<bool(std::string_view, std::string_view, std::string_view)>;
+    using RecoveryVisitor = std::function<bool(long long, std::string_view, std::string_view, std::string_view, std::string_view)>;
+
 private:
     std::string connInfo;
     PGconn* conn;
+    std::unordered_set<std::string> activeAlerts;  // 处于告警中的主机IP
+    bool alertStateLoaded = false;
+    SegmentStore segmentStore;  // 冷数据段文件，位于 <数据库名>.segments，连接后确定
+    std::set<std::string> samplePartitions;  // 已创建的samples分区名
+    int legacyTableCount = 0;  // 尚未迁移的旧版ping_*表数量
+    std::size_t poolSize = 1;  // 写入连接池的大小，1表示所有写入都在主连接上进行
+    std::unique_ptr<PgConnectionPool> pool;
+    std::vector<PgConnectionPool::Lease> shardLeases;  // 本轮已写入、尚未提交的分片事务
+    std::string preparedPrefix;  // 本进程两阶段提交的事务标识前缀 mping_<进程号>_<启动毫秒数>
+    std::uint64_t preparedCycles = 0;  // 已使用两阶段提交的轮数，用于生成事务标识
+    
+    // 进行中的异步写入：成功后才更新分区集合和告警状态缓存
+    bool asyncPending = false;
+    bool asyncFlushPending = false;
+    bool asyncFailed = false;
+    std::vector<std::string> asyncPartitions;
+    std::vector<std::pair<std::string, std::string>> asyncDown;
+    std::vector<std::string> asyncUp;
 
 public:
     DatabaseManagerPG(const std::string& connectionInfo);
     ~DatabaseManagerPG();
     
+    // 写入连接池的大小，需要在initialize之前设置；大于1时样本按主机分片在多个连接上并行写入
+    void setPoolSize(std::size_t size);
+    void printPoolStats(std::ostream& out) const;
+    
     bool initialize();
+    
+    // 事务控制：供StorageSession将一轮的全部写入合并为一个事务
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+    
+    // 写入前的准备工作：在事务外为样本所在的日期创建分区
+    bool prepareWrite(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    
+    // 批量导入：期间关闭同步提交
+    bool beginBulkLoad();
+    bool endBulkLoad();
+    
     bool insertPingResult(const std::string& ip, const std::string& hostname, short delay, bool success, const std::string& timestamp);
     bool insertPingResults(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
-    void queryIPStatistics(const std::string& ip);
+    // 非阻塞接口：startAsyncCycle把一轮的样本和告警变更作为一个管道发出后立即返回，整轮在一个隐式事务中执行
+    // 调用方把socket()注册到epoll等事件循环中，监听可读事件（wantsWrite()为true时同时监听可写事件），
+    // 事件到达时调用processAsync，直到返回Done或Failed；异步写入进行期间不能调用其他数据库方法
+    int socket() const;
+    bool startAsyncCycle(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results,
+                         const std::vector<std::pair<std::string, std::string>>& newlyDown,  // (ip, hostname)
+                         const std::vector<std::string>& newlyUp);
+    bool wantsWrite() const;
+    AsyncStatus processAsync();
+    
+    // 查询统计；since/until非空时只统计[since, until)范围内的原始样本
+    // showRecent为false时只输出总计，不输出最近的记录（由运行中的实例提供）
+    void queryIPStatistics(const std::string& ip, const std::string& since = "", const std::string& until = "", bool showRecent = true);
     void cleanupOldData(int days = 30);
+    
+    // 把旧版本每个IP一张的ping_*表迁移到分区表samples，每张表一个事务，迁移后删除旧表
+    bool migrateLegacyTables();
+    
+    // 冷数据分层：把早于指定天数的样本移入段文件，并从样本表中删除
+    void tierColdData(int days);
+    
+    // 空间回收：每次最多回收maxPages个空闲页，以及打印空间与碎片统计
+    bool reclaimFreePages(int maxPages);
+    void printDatabaseStats();
     std::map<std::string, std::string> getAllHosts();
     
     // 告警表相关方法
     bool addAlert(const std::string& ip, const std::string& hostname);
     bool removeAlert(const std::string& ip);
+    
+    // 告警状态缓存：一次性加载处于告警中的主机，之后每轮只写入状态变化
+    bool loadAlertState();
+    bool isAlertActive(const std::string& ip) const;
+    bool applyAlertTransitions(const std::vector<std::pair<std::string, std::string>>& newlyDown,  // (ip, hostname)
+                               const std::vector<std::string>& newlyUp);
     std::vector<std::tuple<std::string, std::string, std::string>> getActiveAlerts(int days = -1);  // 返回指定天数内的告警，-1表示获取所有告警
     std::vector<std::tuple<std::string, std::string, std::string>> getActiveAlerts();  // 兼容旧接口
     
@@ -34,16 +123,47 @@ public:
     std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> getRecoveryRecords(int days = -1);  // 返回指定天数内的恢复记录，-1表示获取所有恢复记录
     std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> getRecoveryRecords();  // 兼容旧接口
     
+    // 游标式查询：以单行模式逐行回调，不在内存中保存整个结果，回调返回false时停止
+    // 键集分页：(afterTime, afterIP)/afterId为上一页最后一行的键，afterTime为空时从头开始，limit<0表示不限行数
+    bool forEachActiveAlert(int days, const std::string& afterTime, const std::string& afterIP, long long limit, const AlertVisitor& visit);
+    bool forEachRecoveryRecord(int days, long long afterId, long long limit, const RecoveryVisitor& visit);
+    
+    // 导出：遍历一台主机在[since, until)范围内的全部样本（空字符串表示不限），visit返回false时停止
+    bool forEachSample(const std::string& ip, const std::string& since, const std::string& until,
+                       const std::function<bool(const SegmentStore::Sample&)>& visit);
+    
 private:
     // 辅助方法
     bool validateIPs(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
-    bool createIPTables(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
-    bool insertHostsBatch(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
-    bool insertPingResultsBatch(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    int querySchemaVersion();
+    bool createSchema();
+    bool createSamplesTable();
+    bool loadSamplePartitions();
+    bool ensureSamplePartitions(std::chrono::sys_days first, std::chrono::sys_days last);
+    std::vector<std::pair<std::string, std::chrono::sys_days>> listSamplePartitions();
+    bool suppressNotices(PGconn* connection);
+    bool prepareSession(PGconn* connection);
+    bool writeSamples(PGconn* connection, const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    bool writeShards(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    std::vector<char> runOnShards(const std::function<std::string(std::size_t)>& statement);
+    bool finishShards(bool commit);
+    bool commitShards();
+    bool resolvePreparedCycles();
+    AsyncStatus finishAsync();
+    bool copyIncomingSamples(PGconn* connection, const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    bool insertHostsBatch(PGconn* connection);
+    bool insertPingResultsBatch(PGconn* connection);
     bool isValidIP(const std::string& ip);
     std::string escapeString(const std::string& str);
     bool executeQuery(const std::string& query);
+    bool executeQuery(PGconn* connection, const std::string& query);
     PGresult* executeQueryWithResult(const std::string& query);
+    bool streamQuery(const std::string& query, const std::vector<const char*>& params, const std::function<bool(PGresult*)>& visitRow);
+    bool executePrepared(const char* name, const std::vector<std::string>& params);
+    bool runPipeline(const std::vector<PipelineStatement>& statements, std::vector<PGresult*>* results = nullptr);
+    bool createRollupTables();
+    bool backfillRollups();
+    bool updateRollups(PGconn* connection);
 };
 
 #endif // DATABASE_MANAGER_PG_H
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include "live_state.h"
+#include <algorithm>
+#include <charconv>
+#include <type_traits>
+#include <ctime>
+
+namespace {
+
+// 按空格切分请求
+std::vector<std::string_view> splitRequest(std::string_view request) {
+    std::vector<std::string_view> tokens;
+    std::size_t start = 0;
+    while (start < request.size()) {
+        std::size_t end = request.find(' ', start);
+        if (end == std::string_view::npos) {
+            end = request.size();
+        }
+        if (end > start) {
+            tokens.push_back(request.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return tokens;
+}
+
+// 取出 key=value 形式的参数，未指定时返回空
+std::string_view option(const std::vector<std::string_view>& args, std::string_view key) {
+    for (auto arg : args) {
+        if (arg.size() > key.size() && arg.starts_with(key) && arg[key.size()] == '=') {
+            return arg.substr(key.size() + 1);
+        }
+    }
+    return {};
+}
+
+// 解析非负整数参数，未指定时使用默认值
+bool parseCount(std::string_view text, long long fallback, long long& value) {
+    if (text.empty()) {
+        value = fallback;
+        return true;
+    }
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && end == text.data() + text.size() && value >= 0;
+}
+
+// 当前本地时间的民用时间秒数，与样本时间戳的表示一致
+std::int64_t localCivilNow() {
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&now, &local);
+    return static_cast<std::int64_t>(now) + local.tm_gmtoff;
+}
+
+// 定点小数字段
+struct Fixed {
+    double value;
+    int precision;
+};
+
+void appendField(std::string& body, std::string_view text) {
+    body += text;
+}
+
+void appendField(std::string& body, Fixed number) {
+    char buffer[64];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), number.value, std::chars_format::fixed, number.precision);
+    body.append(buffer, ec == std::errc() ? end : buffer);
+}
+
+template<typename Integer>
+    requires std::is_integral_v<Integer>
+void appendField(std::string& body, Integer value) {
+    char buffer[24];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    body.append(buffer, end);
+}
+
+// 追加一条记录：字段以制表符分隔，以换行结束
+template<typename... Fields>
+void appendRecord(std::string& body, std::string_view kind, const Fields&... fields) {
+    body += kind;
+    ((body += '\t', appendField(body, fields)), ...);
+    body += '\n';
+}
+
+// 追加一个只有一个样本的指标
+template<typename Value>
+void appendMetric(std::string& body, std::string_view name, std::string_view type, std::string_view help, const Value& value) {
+    body += "# HELP ";
+    body += name;
+    body += ' ';
+    body += help;
+    body += "\n# TYPE ";
+    body += name;
+    body += ' ';
+    body += type;
+    body += '\n';
+    body += name;
+    body += ' ';
+    appendField(body, value);
+    body += '\n';
+}
+
+std::vector<std::pair<std::string, std::string>> hostLabels(const std::map<std::string, std::string>& hosts) {
+    return {hosts.begin(), hosts.end()};
+}
+
+} // namespace
+
+LiveState::LiveState(const std::map<std::string, std::string>& hosts, std::size_t depth)
+    : recentResults([&hosts] {
+          std::vector<std::string> ips;
+          ips.reserve(hosts.size());
+          for (const auto& [ip, hostname] : hosts) {
+              ips.push_back(ip);
+          }
+          return ips;
+      }(), depth),
+      metrics(hostLabels(hosts)),
+      started(std::chrono::steady_clock::now()),
+      hostnames(hosts) {}
+
+void LiveState::loadAlerts(const std::vector<std::tuple<std::string, std::string, std::string>>& activeAlerts) {
+    std::lock_guard<std::mutex> lock(mutex);
+    alerts.clear();
+    for (const auto& [ip, hostname, createdTime] : activeAlerts) {
+        alerts[ip] = {hostname, createdTime};
+    }
+}
+
+void LiveState::setAlertPolicy(const AlertPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    alertTracker.setPolicy(policy);
+}
+
+std::vector<AlertEvent> LiveState::applyCycle(const PingCycle& results, double seconds) {
+    // 指标的槽位与最近结果缓冲区一致，都按主机列表的顺序
+    std::size_t up = 0;
+    for (const auto& [ip, hostname, success, delay, timestamp] : results) {
+        if (auto slot = recentResults.slotOf(ip)) {
+            metrics.record(*slot, success, delay);
+        }
+        up += success ? 1 : 0;
+    }
+
+    std::string finished = SegmentStore::formatTimestamp(localCivilNow());
+    std::vector<AlertEvent> events;
+    std::lock_guard<std::mutex> lock(mutex);
+    hostsUp = up;
+    hostsDown = results.size() - up;
+    for (const auto& [ip, hostname, success, delay, timestamp] : results) {
+        hostnames[ip] = hostname;
+        auto transition = alertTracker.observe(ip, success, alerts.contains(ip));
+        if (transition == AlertTracker::Transition::RAISE) {
+            alerts.try_emplace(ip, hostname, timestamp);
+            events.push_back({true, ip, hostname, timestamp});
+        } else if (transition == AlertTracker::Transition::CLEAR) {
+            alerts.erase(ip);
+            events.push_back({false, ip, hostname, timestamp});
+        }
+    }
+    cycles++;
+    samples += results.size();
+    lastCycle = std::move(finished);
+    lastCycleSeconds = seconds;
+    return events;
+}
+
+AlertingHosts LiveState::alertingHosts() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    AlertingHosts hosts;
+    for (const auto& [ip, alert] : alerts) {
+        hosts.insert(ip);
+    }
+    return hosts;
+}
+
+bool LiveState::handle(std::string_view request, std::string& body) const {
+    auto tokens = splitRequest(request);
+    if (tokens.empty()) {
+        body = "empty request";
+        return false;
+    }
+    std::string_view command = tokens.front();
+    std::vector<std::string_view> args(tokens.begin() + 1, tokens.end());
+    if (command == "status") {
+        return handleStatus(args, body);
+    }
+    if (command == "alerts") {
+        return handleAlerts(args, body);
+    }
+    if (command == "hosts") {
+        handleHosts(body);
+        return true;
+    }
+    if (command == "stats") {
+        handleStats(body);
+        return true;
+    }
+    if (command == "metrics") {
+        handleMetrics(body);
+        return true;
+    }
+    body = "unknown command '" + std::string(command) + "'";
+    return false;
+}
+
+// 调用者持有mutex
+void LiveState::appendHost(const std::string& ip, const std::string& hostname, std::string& body) const {
+    std::string_view state = "unknown";
+    std::string lastTime = "-";
+    short lastDelay = 0;
+    recentResults.forEachRecent(ip, 1, [&](const SegmentStore::Sample& sample) {
+        state = sample.success ? "up" : "down";
+        lastTime = SegmentStore::formatTimestamp(sample.time);
+        lastDelay = sample.delay;
+        return false;
+    });
+    auto alert = alerts.find(ip);
+    appendRecord(body, "host", std::string_view(ip), std::string_view(hostname), state,
+                 std::string_view(alert == alerts.end() ? "-" : alert->second.second), std::string_view(lastTime), lastDelay);
+}
+
+bool LiveState::handleStatus(const std::vector<std::string_view>& args, std::string& body) const {
+    long long limit = 0;
+    if (args.empty() || args.front().find('=') != std::string_view::npos) {
+        body = "usage: status <ip> [limit=n]";
+        return false;
+    }
+    if (!parseCount(option(args, "limit"), DEFAULT_STATUS_SAMPLES, limit)) {
+        body = "invalid limit";
+        return false;
+    }
+    std::string ip(args.front());
+    if (!recentResults.slotOf(ip)) {
+        body = "unknown host " + ip;
+        return false;
+    }
+
+    // 统计覆盖内存中的全部样本，最近的limit个样本按从新到旧输出
+    std::vector<SegmentStore::Sample> recent;
+    long long total = 0;
+    long long successes = 0;
+    long long delaySum = 0;
+    short minDelay = 0;
+    short maxDelay = 0;
+    recentResults.forEachRecent(ip, recentResults.depth(), [&](const SegmentStore::Sample& sample) {
+        if (total++ < limit) {
+            recent.push_back(sample);
+        }
+        if (sample.success) {
+            minDelay = successes == 0 ? sample.delay : std::min(minDelay, sample.delay);
+            maxDelay = successes == 0 ? sample.delay : std::max(maxDelay, sample.delay);
+            delaySum += sample.delay;
+            successes++;
+        }
+        return true;
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = hostnames.find(ip);
+        appendHost(ip, it == hostnames.end() ? ip : it->second, body);
+    }
+    double average = successes > 0 ? static_cast<double>(delaySum) / successes : 0;
+    appendRecord(body, "summary", total, successes, Fixed{average, 2}, minDelay, maxDelay);
+    for (const auto& sample : recent) {
+        appendRecord(body, "sample", std::string_view(SegmentStore::formatTimestamp(sample.time)), sample.delay, sample.success ? 1 : 0);
+    }
+    return true;
+}
+
+bool LiveState::handleAlerts(const std::vector<std::string_view>& args, std::string& body) const {
+    long long days = 0;
+    long long limit = 0;
+    if (!parseCount(option(args, "days"), -1, days) || !parseCount(option(args, "limit"), -1, limit)) {
+        body = "invalid days or limit";
+        return false;
+    }
+    std::string afterTime;
+    std::string afterIP;
+    if (!option(args, "after").empty() && !parseAlertKey(option(args, "after"), afterTime, afterIP)) {
+        body = "invalid after";
+        return false;
+    }
+    std::string since = days >= 0 ? SegmentStore::formatTimestamp(localCivilNow() - days * 86400) : "";
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // 与数据库查询相同的顺序和分页键：(创建时间, IP)，after指定的告警已解除时也从同一位置继续
+    std::vector<std::tuple<std::string_view, std::string_view, std::string_view>> rows;
+    for (const auto& [ip, alert] : alerts) {
+        if (alert.second >= since) {
+            rows.emplace_back(alert.second, ip, alert.first);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+
+    std::pair<std::string_view, std::string_view> start(afterTime, afterIP);
+    long long count = 0;
+    for (const auto& [createdTime, ip, hostname] : rows) {
+        if (limit >= 0 && count >= limit) {
+            break;
+        }
+        if (!afterTime.empty() && std::pair(createdTime, ip) <= start) {
+            continue;
+        }
+        appendRecord(body, "alert", ip, hostname, createdTime);
+        count++;
+    }
+    return true;
+}
+
+void LiveState::handleHosts(std::string& body) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& ip : recentResults.hosts()) {
+        auto it = hostnames.find(ip);
+        appendHost(ip, it == hostnames.end() ? ip : it->second, body);
+    }
+}
+
+void LiveState::handleStats(std::string& body) const {
+    auto uptime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    appendRecord(body, "hosts", recentResults.hosts().size());
+    appendRecord(body, "up", hostsUp);
+    appendRecord(body, "down", hostsDown);
+    appendRecord(body, "alerts", alerts.size());
+    appendRecord(body, "cycles", cycles);
+    appendRecord(body, "samples", samples);
+    appendRecord(body, "last_cycle", std::string_view(lastCycle.empty() ? "-" : lastCycle));
+    appendRecord(body, "last_cycle_seconds", Fixed{lastCycleSeconds, 3});
+    appendRecord(body, "uptime_seconds", static_cast<long long>(uptime));
+    appendRecord(body, "history_depth", recentResults.depth());
+    appendRecord(body, "history_bytes", recentResults.memoryBytes());
+    appendRecord(body, "flapping", alertTracker.flappingCount());
+}
+
+// 主机指标直接从预先渲染的缓冲区复制，只有少量引擎指标在抓取时格式化
+void LiveState::handleMetrics(std::string& body) const {
+    scrapes++;
+    metrics.appendTo(body);
+
+    auto uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        appendMetric(body, "mping_hosts", "gauge", "Hosts probed by this instance.", recentResults.hosts().size());
+        appendMetric(body, "mping_hosts_up", "gauge", "Hosts whose probe succeeded in the last cycle.", hostsUp);
+        appendMetric(body, "mping_hosts_down", "gauge", "Hosts whose probe failed in the last cycle.", hostsDown);
+        appendMetric(body, "mping_active_alerts", "gauge", "Hosts with an active alert.", alerts.size());
+        appendMetric(body, "mping_hosts_flapping", "gauge", "Hosts whose alert state is held because they are flapping.",
+                     alertTracker.flappingCount());
+        appendMetric(body, "mping_cycles_total", "counter", "Ping cycles completed.", cycles);
+        appendMetric(body, "mping_samples_total", "counter", "Ping results collected.", samples);
+        appendMetric(body, "mping_last_cycle_duration_seconds", "gauge", "Duration of the last ping cycle.", Fixed{lastCycleSeconds, 6});
+    }
+    appendMetric(body, "mping_uptime_seconds", "gauge", "Seconds since the instance started.", Fixed{uptime, 3});
+    appendMetric(body, "mping_history_bytes", "gauge", "Bytes reserved for recent results in memory.", recentResults.memoryBytes());
+    appendMetric(body, "mping_metrics_buffer_bytes", "gauge", "Bytes of the pre-rendered host metrics.", metrics.size());
+    appendMetric(body, "mping_scrapes_total", "counter", "Metrics requests served.", scrapes.load());
+    if (extraMetrics) {
+        extraMetrics(body);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef LIVE_STATE_H
+#define LIVE_STATE_H
+
+#include "recent_results.h"
+#include "metrics_exposition.h"
+#include "alert_tracker.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+// 常驻模式（--serve）在内存中维护的状态：每台主机的最近结果、活动告警和整体统计，
+// 并以紧凑的文本协议回答查询，查询不访问数据库
+//
+// 请求为一行：命令后跟空格分隔的参数，可选参数写作 key=value
+//   status <ip> [limit=n]          主机状态、内存中样本的统计和最近n个样本（默认10）
+//   alerts [days=n] [after=key] [limit=n]  活动告警，按创建时间和IP排序，与-a的分页规则和分页键相同
+//   hosts                          全部主机的当前状态
+//   stats                          整体统计
+//   metrics                        Prometheus文本格式的主机指标和引擎指标
+// 响应每行一条记录，字段以制表符分隔，第一个字段是记录类型：
+//   host    <ip> <主机名> <up|down|unknown> <告警创建时间或-> <最近时间戳或-> <最近延迟>
+//   summary <样本数> <成功数> <平均延迟> <最小延迟> <最大延迟>
+//   sample  <时间戳> <延迟> <1|0>
+//   alert   <ip> <主机名> <创建时间>
+//   stats命令的每行为 <名称> <值>，其中flapping为处于抖动状态的主机数
+class LiveState {
+public:
+    using PingCycle = std::vector<std::tuple<std::string, std::string, bool, short, std::string>>;
+
+    static constexpr std::size_t DEFAULT_STATUS_SAMPLES = 10;
+
+private:
+    RecentResults recentResults;
+    MetricsExposition metrics;
+    std::chrono::steady_clock::time_point started;
+    mutable std::atomic<std::uint64_t> scrapes{0};
+    std::function<void(std::string&)> extraMetrics;
+
+    // 以下字段由探测线程更新、查询线程读取，由mutex保护
+    mutable std::mutex mutex;
+    std::map<std::string, std::string> hostnames;
+    std::map<std::string, std::pair<std::string, std::string>> alerts;  // IP -> (主机名, 创建时间)
+    AlertTracker alertTracker;
+    std::uint64_t cycles = 0;
+    std::uint64_t samples = 0;
+    std::size_t hostsUp = 0;  // 最近一轮成功和失败的主机数
+    std::size_t hostsDown = 0;
+    std::string lastCycle;  // 最近一轮完成的时间
+    double lastCycleSeconds = 0;
+
+    bool handleStatus(const std::vector<std::string_view>& args, std::string& body) const;
+    bool handleAlerts(const std::vector<std::string_view>& args, std::string& body) const;
+    void handleHosts(std::string& body) const;
+    void handleStats(std::string& body) const;
+    void handleMetrics(std::string& body) const;
+    void appendHost(const std::string& ip, const std::string& hostname, std::string& body) const;
+
+public:
+    LiveState(const std::map<std::string, std::string>& hosts, std::size_t depth = RecentResults::DEFAULT_DEPTH);
+
+    LiveState(const LiveState&) = delete;
+    LiveState& operator=(const LiveState&) = delete;
+
+    // 探测时每个结果直接写入的缓冲区
+    RecentResults& recent() { return recentResults; }
+
+    // 启动时载入数据库中的活动告警 (IP, 主机名, 创建时间)
+    void loadAlerts(const std::vector<std::tuple<std::string, std::string, std::string>>& activeAlerts);
+
+    // 告警的确认规则；常驻模式中只在这里确认，存储目标按alertingHosts同步
+    void setAlertPolicy(const AlertPolicy& policy);
+
+    // 一轮结束后更新告警、统计和主机指标；返回本轮确认的告警变化
+    std::vector<AlertEvent> applyCycle(const PingCycle& results, double seconds);
+
+    // 当前处于告警中的主机，随本轮结果交给存储目标
+    AlertingHosts alertingHosts() const;
+
+    // 追加到metrics响应末尾的其他指标（如存储目标的写入计数），在查询线程中调用
+    void setExtraMetrics(std::function<void(std::string&)> append) { extraMetrics = std::move(append); }
+
+    // 处理一行请求；成功时body为响应记录，失败时body为错误信息
+    bool handle(std::string_view request, std::string& body) const;
+};
+
+#endif // LIVE_STATE_H
@@ -3,14 +3,35 @@
 #ifdef USE_POSTGRESQL
 #include "database_manager_pg.h"
 #endif
+#include "ring_log_manager.h"
 #include "ping_manager.h"
+#include "recent_results.h"
+#include "live_state.h"
+#include "query_server.h"
+#include "storage_sink.h"
+#include "alert_notifier.h"
+#include "result_output.h"
+#include "sample_export.h"
+#include "sample_import.h"
 #include "utils.h"
 #include <iostream>
 #include <print>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <map>
+#include <set>
+#include <memory>
 #include <exception>
+#include <type_traits>
+#include <functional>
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <charconv>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
 
 // 模板函数：处理数据库操作的通用模式
 template<typename DatabaseType>
@@ -24,12 +45,13 @@ bool initializeDatabase(const std::string& databasePath, DatabaseType& db) {
 
 // 模板函数：查询IP统计信息
 template<typename DatabaseType>
-void queryIPStatistics(const std::string& databasePath, const std::string& queryIP) {
+void queryIPStatistics(const std::string& databasePath, const std::string& queryIP,
+                       const std::string& since, const std::string& until, bool showRecent) {
     DatabaseType db(databasePath);
     if (!initializeDatabase(databasePath, db)) {
         return;
     }
-    db.queryIPStatistics(queryIP);
+    db.queryIPStatistics(queryIP, since, until, showRecent);
 }
 
 // 模板函数：清理旧数据
@@ -42,121 +64,627 @@ void cleanupOldData(const std::string& databasePath, int cleanupDays) {
     db.cleanupOldData(cleanupDays);
 }
 
-// 模板函数：查询活动告警
+// 模板函数：把冷数据移入段文件
 template<typename DatabaseType>
-void queryActiveAlerts(const std::string& databasePath, int queryAlerts) {
+void tierColdData(const std::string& databasePath, int tierDays) {
     DatabaseType db(databasePath);
     if (!initializeDatabase(databasePath, db)) {
         return;
     }
-    
-    auto alerts = db.getActiveAlerts(queryAlerts);
-    if (alerts.empty()) {
-        if (queryAlerts >= 0) {
-            std::println(std::cout, "No active alerts within the last {} days.", queryAlerts);
-        } else {
-            std::println(std::cout, "No active alerts.");
-        }
-    } else {
-        if (queryAlerts >= 0) {
-            std::println(std::cout, "Active alerts within the last {} days:", queryAlerts);
-        } else {
-            std::println(std::cout, "Active alerts:");
+    db.tierColdData(tierDays);
+}
+
+// 模板函数：显示数据库空间统计
+template<typename DatabaseType>
+void showDatabaseStats(const std::string& databasePath) {
+    DatabaseType db(databasePath);
+    if (!initializeDatabase(databasePath, db)) {
+        return;
+    }
+    db.printDatabaseStats();
+}
+
+// -a的输出，数据库和运行中的实例共用：逐行输出，limit>=0时只输出一页，并提示下一页的--after参数
+class AlertListing {
+private:
+    int days;
+    long long limit;
+    long long count = 0;
+    std::string lastKey;
+
+public:
+    AlertListing(int days, long long limit) : days(days), limit(limit) {}
+
+    bool row(std::string_view ip, std::string_view hostname, std::string_view createdTime) {
+        if (count++ == 0) {
+            if (days >= 0) {
+                std::println(std::cout, "Active alerts within the last {} days:", days);
+            } else {
+                std::println(std::cout, "Active alerts:");
+            }
+            std::println(std::cout, "IP Address\tHostname\tCreated Time");
+            std::println(std::cout, "------------------------------------------------");
         }
-        std::println(std::cout, "IP Address\tHostname\tCreated Time");
-        std::println(std::cout, "------------------------------------------------");
-        for (const auto& [ip, hostname, createdTime] : alerts) {
-            std::println(std::cout, "{}\t{}\t{}", ip, hostname, createdTime);
+        std::println(std::cout, "{}\t{}\t{}", ip, hostname, createdTime);
+        lastKey = formatAlertKey(createdTime, ip);
+        return static_cast<bool>(std::cout);
+    }
+
+    void finish() {
+        if (count == 0) {
+            if (days >= 0) {
+                std::println(std::cout, "No active alerts within the last {} days.", days);
+            } else {
+                std::println(std::cout, "No active alerts.");
+            }
+        } else if (count == limit) {
+            std::println(std::cout, "-- {} alerts shown, continue with --after {}", count, lastKey);
         }
     }
+};
+
+// 模板函数：查询活动告警
+template<typename DatabaseType>
+bool queryActiveAlerts(const std::string& databasePath, int queryAlerts, const std::string& afterTime, const std::string& afterIP,
+                       long long limit) {
+    DatabaseType db(databasePath);
+    if (!initializeDatabase(databasePath, db)) {
+        return false;
+    }
+    
+    AlertListing listing(queryAlerts, limit);
+    bool success = db.forEachActiveAlert(queryAlerts, afterTime, afterIP, limit, [&](std::string_view ip, std::string_view hostname, std::string_view createdTime) {
+        return listing.row(ip, hostname, createdTime);
+    });
+    listing.finish();
+    return success;
 }
 
-// 模板函数：查询恢复记录
+// 模板函数：查询恢复记录，逐行读取并输出；limit>=0时只输出一页，并提示下一页的--after参数
 template<typename DatabaseType>
-void queryRecoveryRecords(const std::string& databasePath, int queryRecoveryRecords) {
+bool queryRecoveryRecords(const std::string& databasePath, int queryRecoveryRecords, long long after, long long limit) {
     DatabaseType db(databasePath);
     if (!initializeDatabase(databasePath, db)) {
-        return;
+        return false;
     }
     
-    auto records = db.getRecoveryRecords(queryRecoveryRecords);
-    if (records.empty()) {
+    long long count = 0;
+    long long lastId = 0;
+    bool success = db.forEachRecoveryRecord(queryRecoveryRecords, after, limit, [&](long long id, std::string_view ip, std::string_view hostname,
+                                                                                   std::string_view alertTime, std::string_view recoveryTime) {
+        if (count++ == 0) {
+            if (queryRecoveryRecords >= 0) {
+                std::println(std::cout, "Recovery records within the last {} days:", queryRecoveryRecords);
+            } else {
+                std::println(std::cout, "Recovery records:");
+            }
+            std::println(std::cout, "ID\tIP Address\tHostname\tAlert Time\t\tRecovery Time");
+            std::println(std::cout, "------------------------------------------------------------------------------------------------");
+        }
+        std::println(std::cout, "{}\t{}\t\t{}\t\t{}\t{}", id, ip, hostname, alertTime, recoveryTime);
+        lastId = id;
+        return static_cast<bool>(std::cout);
+    });
+    
+    if (count == 0) {
         if (queryRecoveryRecords >= 0) {
             std::println(std::cout, "No recovery records within the last {} days.", queryRecoveryRecords);
         } else {
             std::println(std::cout, "No recovery records.");
         }
-    } else {
-        if (queryRecoveryRecords >= 0) {
-            std::println(std::cout, "Recovery records within the last {} days:", queryRecoveryRecords);
-        } else {
-            std::println(std::cout, "Recovery records:");
+    } else if (count == limit) {
+        std::println(std::cout, "-- {} recovery records shown, continue with --after {}", count, lastId);
+    }
+    return success;
+}
+
+// 查询套接字路径：--socket指定的路径，否则为数据库文件路径加.sock；
+// PostgreSQL的-d是连接串而不是文件路径，按连接串的散列值放在/tmp下
+std::string querySocketPath(const ConfigManager::Config& config) {
+    if (!config.socketPath.empty()) {
+        return config.socketPath;
+    }
+#ifdef USE_POSTGRESQL
+    if (config.usePostgreSQL) {
+        char digest[16];
+        auto [end, ec] = std::to_chars(digest, digest + sizeof(digest), std::hash<std::string>{}(config.databasePath), 16);
+        return "/tmp/mping-" + std::string(digest, end) + ".sock";
+    }
+#endif
+    return config.databasePath + ".sock";
+}
+
+// 逐行遍历运行中实例返回的记录，字段以制表符分隔
+void forEachRecord(std::string_view response, const std::function<void(const std::vector<std::string_view>&)>& visit) {
+    std::vector<std::string_view> fields;
+    while (!response.empty()) {
+        std::string_view line = response.substr(0, response.find('\n'));
+        response.remove_prefix(std::min(response.size(), line.size() + 1));
+        fields.clear();
+        while (true) {
+            std::size_t tab = line.find('\t');
+            fields.push_back(line.substr(0, tab));
+            if (tab == std::string_view::npos) {
+                break;
+            }
+            line.remove_prefix(tab + 1);
         }
-        std::println(std::cout, "ID\tIP Address\tHostname\tAlert Time\t\tRecovery Time");
-        std::println(std::cout, "------------------------------------------------------------------------------------------------");
-        for (const auto& [id, ip, hostname, alertTime, recoveryTime] : records) {
-            std::println(std::cout, "{}\t{}\t\t{}\t\t{}\t{}", id, ip, hostname, alertTime, recoveryTime);
+        visit(fields);
+    }
+}
+
+// 通过运行中的实例补充-q的当前状态和最近样本；总计始终来自数据库，因为实例内存中只保留每台主机最近的样本
+// 没有实例或实例不认识该主机时返回false
+bool queryRunningStatus(const ConfigManager::Config& config, std::string& response) {
+    if (!QueryServer::request(querySocketPath(config), "status " + config.queryIP, response)) {
+        return false;
+    }
+    bool known = false;
+    forEachRecord(response, [&](const std::vector<std::string_view>& fields) {
+        known = known || (fields[0] == "host" && fields.size() >= 7);
+    });
+    return known;
+}
+
+// 输出运行中实例返回的主机状态和最近样本，接在数据库的总计之后
+void printRunningStatus(std::string_view response) {
+    std::vector<std::string_view> host;
+    std::vector<std::vector<std::string_view>> samples;
+    forEachRecord(response, [&](const std::vector<std::string_view>& fields) {
+        if (fields[0] == "host" && fields.size() >= 7) {
+            host = fields;
+        } else if (fields[0] == "sample" && fields.size() >= 4) {
+            samples.push_back(fields);
         }
+    });
+    
+    std::println(std::cout, "\nFrom the running instance:");
+    if (host[4] != "-") {
+        std::println(std::cout, "Current status: {} (alert since {})", host[3], host[4]);
+    } else {
+        std::println(std::cout, "Current status: {}", host[3]);
+    }
+    std::println(std::cout, "\nRecent ping records (last {}):", samples.size());
+    std::println(std::cout, "Timestamp           \tDelay\tStatus");
+    std::println(std::cout, "--------------------------------------------------------");
+    for (const auto& sample : samples) {
+        std::println(std::cout, "{}\t{}ms\t{}", sample[1], sample[2], sample[3] == "1" ? "Success" : "Failed");
     }
 }
 
-// 模板函数：获取所有主机
-template<typename DatabaseType>
-std::map<std::string, std::string> getAllHosts(const std::string& databasePath) {
-    DatabaseType db(databasePath);
-    if (!initializeDatabase(databasePath, db)) {
-        return {};
+// 通过运行中的实例回答-a，告警状态来自实例内存；没有实例时返回false
+bool queryRunningAlerts(const ConfigManager::Config& config) {
+    std::string request = "alerts";
+    if (config.queryAlerts >= 0) {
+        request += " days=" + std::to_string(config.queryAlerts);
+    }
+    if (!config.queryAfter.empty()) {
+        request += " after=" + config.queryAfter;
+    }
+    if (config.queryLimit >= 0) {
+        request += " limit=" + std::to_string(config.queryLimit);
+    }
+    std::string response;
+    if (!QueryServer::request(querySocketPath(config), request, response)) {
+        return false;
     }
-    return db.getAllHosts();
+    
+    AlertListing listing(config.queryAlerts, config.queryLimit);
+    forEachRecord(response, [&](const std::vector<std::string_view>& fields) {
+        if (fields[0] == "alert" && fields.size() >= 4) {
+            listing.row(fields[1], fields[2], fields[3]);
+        }
+    });
+    listing.finish();
+    return true;
 }
 
-// 模板函数：插入ping结果
+// 模板函数：导出样本；每个工作线程打开自己的后端连接，并行读取各主机的样本
 template<typename DatabaseType>
-bool insertPingResults(const std::string& databasePath, 
-                      const std::vector<std::tuple<std::string, std::string, bool, short, std::string>>& allResults) {
-    DatabaseType db(databasePath);
-    if (!initializeDatabase(databasePath, db)) {
+bool exportSamples(const ConfigManager::Config& config) {
+    std::vector<std::string> hosts = config.exportHosts;
+    {
+        // 读取主机列表的连接在导出开始前关闭：环形日志文件以独占锁打开
+        DatabaseType db(config.databasePath);
+        if (!initializeDatabase(config.databasePath, db)) {
+            return false;
+        }
+        if (hosts.empty()) {
+            for (const auto& [ip, hostname] : db.getAllHosts()) {
+                hosts.push_back(ip);
+            }
+        }
+    }
+    
+    std::string path = config.exportPath.empty() ? "ping_export." + config.exportFormat : config.exportPath;
+    bool toStdout = path == "-";
+    std::FILE* out = toStdout ? stdout : std::fopen(path.c_str(), "wb");
+    if (!out) {
+        std::println(std::cerr, "Failed to open export file {}", path);
         return false;
     }
     
-    // 将结果转换为数据库所需的格式并批量插入
-    std::vector<std::tuple<std::string, std::string, short, bool, std::string>> dbResults;
-    dbResults.reserve(allResults.size());
+    // 环形日志只能由一个连接打开
+    std::size_t jobs = std::is_same_v<DatabaseType, RingLogManager> ? 1 : static_cast<std::size_t>(config.exportJobs);
+    auto writer = SampleWriter::create(config.exportFormat, out);
+    SampleExporter exporter(*writer, jobs);
+    bool success = exporter.run(hosts, [&config]() -> SampleExporter::HostReader {
+        auto db = std::make_shared<DatabaseType>(config.databasePath);
+        if (!initializeDatabase(config.databasePath, *db)) {
+            return nullptr;
+        }
+        return [db, &config](const std::string& ip, const SampleExporter::SampleVisitor& visit) {
+            return db->forEachSample(ip, config.querySince, config.queryUntil, visit);
+        };
+    });
+    if (!toStdout && std::fclose(out) != 0) {
+        std::println(std::cerr, "Failed to close export file {}", path);
+        success = false;
+    }
+    
+    // 导出到标准输出时摘要写到标准错误，不混入导出数据
+    const auto& stats = exporter.getStats();
+    std::println(toStdout ? std::cerr : std::cout, "Exported {} samples from {} hosts in {} batches to {}",
+                 stats.samples, stats.hosts, stats.batches, toStdout ? "standard output" : path);
+    return success;
+}
+
+// 结果输出：每个结果完成时写入输出缓冲区，每轮结束时整块写出一次；
+// 静默模式下只有明确指定了--output时才输出
+std::unique_ptr<ResultWriter> openResultWriter(const ConfigManager::Config& config) {
+    if (config.outputFormat.empty() && config.silentMode) {
+        return nullptr;
+    }
+    auto format = ResultWriter::parseFormat(config.outputFormat.empty() ? "text" : config.outputFormat);
+    return std::make_unique<ResultWriter>(format.value_or(ResultWriter::Format::TEXT), stdout);
+}
+
+// 机器可读的结果占用标准输出时，其他提示信息写到标准错误
+std::ostream& messageStream(const ConfigManager::Config& config) {
+    return config.outputFormat.empty() || config.outputFormat == "text" ? std::cout : std::cerr;
+}
+
+// 后端特有的设置：打开之前设置环形日志容量和连接池大小，打开之后设置SQLite的样本分区、样本布局和数据块写入阈值，
+// 写入结束后输出连接池统计
+template<typename DatabaseType>
+typename SessionSink<DatabaseType>::Hooks backendHooks(const ConfigManager::Config& config) {
+    typename SessionSink<DatabaseType>::Hooks hooks;
+    
+    // 环形日志的容量只在新建文件时使用，需要在打开之前设置
+    if constexpr (std::is_same_v<DatabaseType, RingLogManager>) {
+        hooks.beforeOpen = [&config](RingLogManager& db) {
+            if (config.ringCapacity > 0) {
+                db.setSampleCapacity(static_cast<std::uint64_t>(config.ringCapacity));
+            }
+            return true;
+        };
+    }
     
-    for (const auto& [ip, hostname, result, delay, timestamp] : allResults) {
-        dbResults.emplace_back(ip, hostname, delay, result, timestamp);
+#ifdef USE_POSTGRESQL
+    // 写入连接池在打开会话时建立，之后在整个进程中复用
+    if constexpr (std::is_same_v<DatabaseType, DatabaseManagerPG>) {
+        hooks.beforeOpen = [&config](DatabaseManagerPG& db) {
+            db.setPoolSize(static_cast<std::size_t>(config.poolSize));
+            return true;
+        };
+        hooks.report = [](DatabaseManagerPG& db, std::ostream& out) {
+            db.printPoolStats(out);
+        };
     }
+#endif
     
-    return db.insertPingResults(dbResults);
+    // 样本分区和样本布局只适用于SQLite，设置会保存在数据库中供后续运行沿用；
+    // 数据块的写入阈值只作用于本进程
+    if constexpr (std::is_same_v<DatabaseType, DatabaseManager>) {
+        hooks.afterOpen = [&config](DatabaseManager& db) {
+            db.setChunkFlushThreshold(static_cast<std::size_t>(config.chunkFlush));
+            if (!config.partitionPeriod.empty() && !db.setPartitionPeriod(config.partitionPeriod)) {
+                return false;
+            }
+            return config.sampleStore.empty() || db.setSampleStore(config.sampleStore);
+        };
+    }
+    return hooks;
 }
 
-// 模板函数：处理告警逻辑
+// 模板函数：批量导入样本，按与-d写入相同的后端设置打开数据库
 template<typename DatabaseType>
-bool processAlerts(const std::string& databasePath,
-                  const std::vector<std::tuple<std::string, std::string, bool, short, std::string>>& allResults) {
-    DatabaseType db(databasePath);
-    if (!initializeDatabase(databasePath, db)) {
+bool importSamples(const ConfigManager::Config& config) {
+    auto reader = SampleReader::open(config.importPath);
+    if (!reader) {
         return false;
     }
     
-    // 处理告警：主机状态不通时记录到告警表，主机状态正常时从告警表移除
-    bool success = true;
-    for (const auto& [ip, hostname, successFlag, delay, timestamp] : allResults) {
-        if (!successFlag) {
-            // 主机状态不通，添加到告警表
-            if (!db.addAlert(ip, hostname)) {
-                std::println(std::cerr, "Failed to add alert for IP: {}", ip);
-                success = false;
-            }
-        } else {
-            // 主机状态正常，从告警表移除
-            db.removeAlert(ip);
-        }
+    auto hooks = backendHooks<DatabaseType>(config);
+    DatabaseType db(config.databasePath);
+    if ((hooks.beforeOpen && !hooks.beforeOpen(db)) || !initializeDatabase(config.databasePath, db) ||
+        (hooks.afterOpen && !hooks.afterOpen(db))) {
+        return false;
     }
     
+    SampleImporter<DatabaseType> importer(db);
+    bool success = importer.run(*reader);
+    const auto& stats = importer.getStats();
+    double rate = stats.seconds > 0 ? static_cast<double>(stats.rows) / stats.seconds : 0;
+    std::println(std::cout, "Imported {} samples for {} hosts in {} transactions ({:.2f}s, {:.0f} rows/s), skipped {} rows",
+                 stats.rows, stats.hosts, stats.transactions, stats.seconds, rate, stats.skipped);
     return success;
 }
 
+// 告警的确认规则，全部存储目标和常驻模式的内存状态使用同一规则
+AlertPolicy alertPolicy(const ConfigManager::Config& config) {
+    AlertPolicy policy;
+    policy.failuresToAlert = config.alertAfter;
+    policy.successesToRecover = config.recoverAfter;
+    policy.flapWindow = config.flapWindow;
+    policy.flapThreshold = config.flapThreshold;
+    return policy;
+}
+
+// 注册全部内置存储后端，--sink和-d都通过注册表创建存储目标
+StorageSinkRegistry builtinSinks(const ConfigManager::Config& config) {
+    StorageSinkRegistry registry;
+    registry.add("sqlite", [&config](const std::string& target) -> std::unique_ptr<StorageSink> {
+        return std::make_unique<SessionSink<DatabaseManager>>(target, backendHooks<DatabaseManager>(config));
+    });
+    registry.add("ring", [&config](const std::string& target) -> std::unique_ptr<StorageSink> {
+        return std::make_unique<SessionSink<RingLogManager>>(target, backendHooks<RingLogManager>(config));
+    });
+#ifdef USE_POSTGRESQL
+    registry.add("postgresql", [&config](const std::string& target) -> std::unique_ptr<StorageSink> {
+        return std::make_unique<SessionSink<DatabaseManagerPG>>(target, backendHooks<DatabaseManagerPG>(config));
+    });
+#endif
+    return registry;
+}
+
+// -d指定的主存储目标，类型由--ring-log和-P决定
+std::string primarySink(const ConfigManager::Config& config) {
+    if (config.useRingLog) {
+        return "ring:" + config.databasePath;
+    }
+#ifdef USE_POSTGRESQL
+    if (config.usePostgreSQL) {
+        return "postgresql:" + config.databasePath;
+    }
+#endif
+    return "sqlite:" + config.databasePath;
+}
+
+// 创建并打开-d和--sink指定的全部存储目标，至少有一个目标打开时返回true
+bool openSinks(const ConfigManager::Config& config, SinkFanout& fanout) {
+    StorageSinkRegistry registry = builtinSinks(config);
+    std::vector<std::string> specs;
+    if (config.enableDatabase) {
+        specs.push_back(primarySink(config));
+    }
+    specs.insert(specs.end(), config.sinks.begin(), config.sinks.end());
+    
+    for (const auto& spec : specs) {
+        auto sink = registry.create(spec);
+        if (!sink) {
+            return false;
+        }
+        fanout.add(spec, std::move(sink));
+    }
+    return fanout.open() > 0;
+}
+
+// 如果指定了文件名（通过-f参数或命令行参数），则从文件读取主机列表，否则从第一个存储目标的hosts表读取
+std::map<std::string, std::string> loadHosts(const ConfigManager::Config& config, SinkFanout& fanout) {
+    std::map<std::string, std::string> hosts = config.filename.empty()
+        ? fanout.getAllHosts()
+        : readHostsFromFile(config.filename);
+    
+    if (hosts.empty()) {
+        std::println(std::cerr, "No hosts to ping. Please check the input file or database.");
+    }
+    return hosts;
+}
+
+// 创建--notify指定的全部通知目标并启动调度线程；没有指定目标时不启动线程
+bool openNotifier(const ConfigManager::Config& config, AlertNotifier& notifier) {
+    for (const auto& spec : config.notifyTargets) {
+        auto sink = createNotificationSink(spec);
+        if (!sink) {
+            return false;
+        }
+        // 只记录类型，webhook地址和命令中可能包含令牌
+        notifier.add(spec.substr(0, spec.find(':')), std::move(sink));
+    }
+    if (notifier.size() > 0) {
+        notifier.start();
+    }
+    return true;
+}
+
+// 单次运行的告警变化：按写入前第一个存储目标中的活动告警判断，与存储会话使用同一规则
+std::vector<AlertEvent> detectAlertEvents(const ConfigManager::Config& config, SinkFanout& fanout, const PingCycle& results) {
+    std::set<std::string> alerting;
+    for (const auto& [ip, hostname, createdTime] : fanout.getActiveAlerts()) {
+        alerting.insert(ip);
+    }
+    AlertTracker tracker(alertPolicy(config));
+    std::vector<AlertEvent> events;
+    for (const auto& [ip, hostname, success, delay, timestamp] : results) {
+        auto transition = tracker.observe(ip, success, alerting.contains(ip));
+        if (transition != AlertTracker::Transition::NONE) {
+            events.push_back({transition == AlertTracker::Transition::RAISE, ip, hostname, timestamp});
+        }
+    }
+    return events;
+}
+
+// 读取主机、执行ping，并把结果同时写入-d和--sink指定的全部存储目标
+// 每个目标在自己的线程中写入，其中一个目标缓慢或失败不影响探测和其他目标
+int runPingCycle(const ConfigManager::Config& config) {
+    SinkFanout fanout;
+    if (!openSinks(config, fanout)) {
+        return 1;
+    }
+    
+    std::map<std::string, std::string> hosts = loadHosts(config, fanout);
+    if (hosts.empty()) {
+        return 1;
+    }
+    
+    // 单次运行之后没有读取者，不分配最近结果缓冲区（由常驻模式的LiveState持有）
+    auto output = openResultWriter(config);
+    PingManager pingManager;
+    pingManager.setResultWriter(output.get());
+    auto allResults = pingManager.performPing(hosts, config.pingCount, config.timeoutSeconds);
+    
+    // 告警变化要在目标写入本轮之前判断
+    AlertNotifier notifier(AlertNotifier::Options{.coalesceWindow = std::chrono::seconds(config.notifyWindow)});
+    if (!openNotifier(config, notifier)) {
+        return 1;
+    }
+    if (notifier.size() > 0) {
+        notifier.submit(detectAlertEvents(config, fanout, allResults));
+    }
+    
+    // 每个目标在各自的事务中写入样本、主机信息、告警和恢复记录
+    fanout.submit(allResults);
+    
+    if (output) {
+        output->flush();
+    }
+    
+    bool stored = fanout.close();
+    notifier.close();
+    if (!config.silentMode) {
+        fanout.printStats(messageStream(config));
+        if (notifier.size() > 0) {
+            notifier.printStats(messageStream(config));
+        }
+    }
+    if (!stored) {
+        std::println(std::cerr, "Failed to store ping results in database");
+        return 1;
+    }
+    return 0;
+}
+
+// 常驻模式：每隔--interval秒探测一轮并写入全部存储目标，同时在查询套接字上用内存中的状态回答查询
+// 主机列表在启动时读取一次；SIGINT和SIGTERM在所有线程中屏蔽，由主线程在两轮之间等待，收到后写完已提交的轮次再退出
+int runServe(const ConfigManager::Config& config) {
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+    
+    SinkFanout fanout;
+    if (!openSinks(config, fanout)) {
+        return 1;
+    }
+    std::map<std::string, std::string> hosts = loadHosts(config, fanout);
+    if (hosts.empty()) {
+        return 1;
+    }
+    
+    LiveState state(hosts, static_cast<std::size_t>(config.historyDepth));
+    state.setAlertPolicy(alertPolicy(config));
+    state.loadAlerts(fanout.getActiveAlerts());
+    // 存储目标按序号和类型标识，不输出目标参数（PostgreSQL连接串可能包含密码）
+    state.setExtraMetrics([&fanout](std::string& out) {
+        out += "# HELP mping_sink_cycles_total Ping cycles handed to each storage sink, by outcome.\n"
+               "# TYPE mping_sink_cycles_total counter\n";
+        for (std::size_t i = 0; i < fanout.size(); i++) {
+            auto stats = fanout.stats(i);
+            std::string labels = "{sink=\"" + std::to_string(i) + "\",type=\"" + fanout.name(i).substr(0, fanout.name(i).find(':')) + "\",result=\"";
+            out += "mping_sink_cycles_total" + labels + "written\"} " + std::to_string(stats.written) + "\n";
+            out += "mping_sink_cycles_total" + labels + "failed\"} " + std::to_string(stats.failed) + "\n";
+            out += "mping_sink_cycles_total" + labels + "dropped\"} " + std::to_string(stats.dropped) + "\n";
+        }
+    });
+    
+    AlertNotifier notifier(AlertNotifier::Options{.coalesceWindow = std::chrono::seconds(config.notifyWindow)});
+    if (!openNotifier(config, notifier)) {
+        return 1;
+    }
+    
+    std::string socketPath = querySocketPath(config);
+    QueryServer server([&state](std::string_view request, std::string& body) {
+        return state.handle(request, body);
+    });
+    if (!server.listenUnix(socketPath) || (config.httpPort > 0 && !server.listenHttp(config.httpPort)) || !server.start()) {
+        return 1;
+    }
+    if (!config.silentMode) {
+        std::println(messageStream(config), "Serving {} hosts on {}, pinging every {}s", hosts.size(), socketPath, config.serveInterval);
+        if (config.httpPort > 0) {
+            std::println(messageStream(config), "HTTP queries on http://127.0.0.1:{}/", config.httpPort);
+        }
+    }
+    
+    auto output = openResultWriter(config);
+    PingManager pingManager;
+    pingManager.setRecentResults(&state.recent());
+    pingManager.setResultWriter(output.get());
+    const auto interval = std::chrono::seconds(config.serveInterval);
+    auto next = std::chrono::steady_clock::now();
+    bool stopping = false;
+    while (!stopping) {
+        auto started = std::chrono::steady_clock::now();
+        auto results = pingManager.performPing(hosts, config.pingCount, config.timeoutSeconds);
+        auto events = state.applyCycle(results, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+        if (notifier.size() > 0) {
+            notifier.submit(events);
+        }
+        // 告警只在内存状态中确认一次，每个存储目标按同一个告警主机集合同步
+        fanout.submit(results, std::make_shared<const AlertingHosts>(state.alertingHosts()));
+        if (output) {
+            output->flush();
+        }
+        
+        // 一轮超过间隔时立即开始下一轮，不补跑错过的轮次
+        next = std::max(next + interval, std::chrono::steady_clock::now());
+        do {
+            auto remaining = std::max(next - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration::zero());
+            auto wholeSeconds = std::chrono::duration_cast<std::chrono::seconds>(remaining);
+            timespec timeout{static_cast<time_t>(wholeSeconds.count()),
+                             static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(remaining - wholeSeconds).count())};
+            int signal = sigtimedwait(&stopSignals, nullptr, &timeout);
+            if (signal > 0) {
+                stopping = true;
+            } else if (signal < 0 && errno != EAGAIN && errno != EINTR) {
+                std::println(std::cerr, "Failed to wait for the next cycle: {}", std::strerror(errno));
+                stopping = true;
+            }
+        } while (!stopping && std::chrono::steady_clock::now() < next);
+    }
+    
+    server.stop();
+    bool stored = fanout.close();
+    notifier.close();
+    if (!config.silentMode) {
+        fanout.printStats(messageStream(config));
+        if (notifier.size() > 0) {
+            notifier.printStats(messageStream(config));
+        }
+    }
+    if (!stored) {
+        std::println(std::cerr, "Failed to store some ping results");
+        return 1;
+    }
+    return 0;
+}
+
+// 按配置选择存储后端（环形日志、PostgreSQL或SQLite），以后端类型调用action
+template<typename Action>
+auto withDatabaseBackend(const ConfigManager::Config& config, Action&& action) {
+    if (config.useRingLog) {
+        return action.template operator()<RingLogManager>();
+    }
+#ifdef USE_POSTGRESQL
+    if (config.usePostgreSQL) {
+        return action.template operator()<DatabaseManagerPG>();
+    }
+#endif
+    return action.template operator()<DatabaseManager>();
+}
+
 int main(int argc, char* argv[]) {
     try {
         // 创建配置管理器并解析命令行参数
@@ -174,15 +702,21 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             
-#ifdef USE_POSTGRESQL
-            if (config.usePostgreSQL) {
-                queryIPStatistics<DatabaseManagerPG>(config.databasePath, config.queryIP);
+            // 总计来自数据库的汇总；没有指定时间范围且有运行中的实例时，当前状态和最近样本由实例提供
+            std::string runningStatus;
+            bool running = config.querySince.empty() && config.queryUntil.empty() && queryRunningStatus(config, runningStatus);
+            if (running && config.useRingLog) {
+                // 环形日志文件由运行中的实例独占锁定，打开它会一直等到实例退出
+                std::println(std::cout, "Statistics for IP: {}", config.queryIP);
+                std::println(std::cout, "Totals are not available while a running instance holds the ring log.");
             } else {
-#endif
-                queryIPStatistics<DatabaseManager>(config.databasePath, config.queryIP);
-#ifdef USE_POSTGRESQL
+                withDatabaseBackend(config, [&]<typename DatabaseType>() {
+                    queryIPStatistics<DatabaseType>(config.databasePath, config.queryIP, config.querySince, config.queryUntil, !running);
+                });
+            }
+            if (running) {
+                printRunningStatus(runningStatus);
             }
-#endif
             return 0;
         }
         
@@ -193,15 +727,77 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             
+            withDatabaseBackend(config, [&]<typename DatabaseType>() {
+                cleanupOldData<DatabaseType>(config.databasePath, config.cleanupDays);
+            });
+            return 0;
+        }
+        
+        // 如果请求执行冷数据分层
+        if (config.tierDays >= 0) {
+            if (!config.enableDatabase) {
+                std::println(std::cerr, "Database must be enabled to tier data. Use -d option to specify database path.");
+                return 1;
+            }
+            
+            withDatabaseBackend(config, [&]<typename DatabaseType>() {
+                tierColdData<DatabaseType>(config.databasePath, config.tierDays);
+            });
+            return 0;
+        }
+        
 #ifdef USE_POSTGRESQL
-            if (config.usePostgreSQL) {
-                cleanupOldData<DatabaseManagerPG>(config.databasePath, config.cleanupDays);
-            } else {
-#endif
-                cleanupOldData<DatabaseManager>(config.databasePath, config.cleanupDays);
-#ifdef USE_POSTGRESQL
+        // 如果请求迁移旧版PostgreSQL样本表
+        if (config.migrateLegacyTables) {
+            if (!config.enableDatabase) {
+                std::println(std::cerr, "Database must be enabled to migrate tables. Use -d option to specify database path.");
+                return 1;
             }
+            
+            DatabaseManagerPG db(config.databasePath);
+            if (!initializeDatabase(config.databasePath, db)) {
+                return 1;
+            }
+            return db.migrateLegacyTables() ? 0 : 1;
+        }
 #endif
+        
+        // 如果请求导入样本
+        if (!config.importPath.empty()) {
+            if (!config.enableDatabase) {
+                std::println(std::cerr, "Database must be enabled to import samples. Use -d option to specify database path.");
+                return 1;
+            }
+            
+            bool success = withDatabaseBackend(config, [&]<typename DatabaseType>() {
+                return importSamples<DatabaseType>(config);
+            });
+            return success ? 0 : 1;
+        }
+        
+        // 如果请求导出样本
+        if (!config.exportFormat.empty()) {
+            if (!config.enableDatabase) {
+                std::println(std::cerr, "Database must be enabled to export samples. Use -d option to specify database path.");
+                return 1;
+            }
+            
+            bool success = withDatabaseBackend(config, [&]<typename DatabaseType>() {
+                return exportSamples<DatabaseType>(config);
+            });
+            return success ? 0 : 1;
+        }
+        
+        // 如果请求显示数据库统计信息
+        if (config.showDatabaseStats) {
+            if (!config.enableDatabase) {
+                std::println(std::cerr, "Database must be enabled to show statistics. Use -d option to specify database path.");
+                return 1;
+            }
+            
+            withDatabaseBackend(config, [&]<typename DatabaseType>() {
+                showDatabaseStats<DatabaseType>(config.databasePath);
+            });
             return 0;
         }
         
@@ -212,16 +808,22 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             
-#ifdef USE_POSTGRESQL
-            if (config.usePostgreSQL) {
-                queryActiveAlerts<DatabaseManagerPG>(config.databasePath, config.queryAlerts);
-            } else {
-#endif
-                queryActiveAlerts<DatabaseManager>(config.databasePath, config.queryAlerts);
-#ifdef USE_POSTGRESQL
+            std::string afterTime;
+            std::string afterIP;
+            if (!config.queryAfter.empty() && !parseAlertKey(config.queryAfter, afterTime, afterIP)) {
+                std::println(std::cerr, "Invalid value for after: {} (expected the key printed by the previous page)", config.queryAfter);
+                return 1;
             }
-#endif
-            return 0;
+            
+            // 有运行中的实例时由它回答，不打开数据库
+            if (queryRunningAlerts(config)) {
+                return 0;
+            }
+            
+            bool success = withDatabaseBackend(config, [&]<typename DatabaseType>() {
+                return queryActiveAlerts<DatabaseType>(config.databasePath, config.queryAlerts, afterTime, afterIP, config.queryLimit);
+            });
+            return success ? 0 : 1;
         }
         
         // 如果请求查询恢复记录，则只显示恢复记录信息，不执行ping操作
@@ -231,96 +833,53 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             
-#ifdef USE_POSTGRESQL
-            if (config.usePostgreSQL) {
-                queryRecoveryRecords<DatabaseManagerPG>(config.databasePath, config.queryRecoveryRecords);
-            } else {
-#endif
-                queryRecoveryRecords<DatabaseManager>(config.databasePath, config.queryRecoveryRecords);
-#ifdef USE_POSTGRESQL
+            // 恢复记录的分页键是记录ID
+            long long afterId = 0;
+            if (!config.queryAfter.empty()) {
+                try {
+                    afterId = std::stoll(config.queryAfter);
+                } catch (const std::exception& e) {
+                    std::println(std::cerr, "Invalid value for after: {} (expected a recovery record ID)", config.queryAfter);
+                    return 1;
+                }
             }
-#endif
-            return 0;
+            
+            bool success = withDatabaseBackend(config, [&]<typename DatabaseType>() {
+                return queryRecoveryRecords<DatabaseType>(config.databasePath, config.queryRecoveryRecords, afterId, config.queryLimit);
+            });
+            return success ? 0 : 1;
         }
         
-        // 读取主机列表
-        std::map<std::string, std::string> hosts;
-        
-        // 如果指定了文件名（通过-f参数或命令行参数），则从文件读取主机列表
-        // 否则如果启用了数据库，则从数据库的hosts表读取主机列表
-        // 如果两者都没有指定，则默认从ip.txt文件读取
-        if (!config.filename.empty()) {
-            hosts = readHostsFromFile(config.filename);
-        } else if (config.enableDatabase) {
-#ifdef USE_POSTGRESQL
-            if (config.usePostgreSQL) {
-                hosts = getAllHosts<DatabaseManagerPG>(config.databasePath);
-            } else {
-#endif
-                hosts = getAllHosts<DatabaseManager>(config.databasePath);
-#ifdef USE_POSTGRESQL
+        // 常驻模式需要至少一个存储目标
+        if (config.serve) {
+            if (!config.enableDatabase && config.sinks.empty()) {
+                std::println(std::cerr, "--serve requires a database (-d) or a sink (--sink).");
+                return 1;
             }
-#endif
-        } else {
-            // 默认从ip.txt文件读取
-            hosts = readHostsFromFile("ip.txt");
+            return runServe(config);
+        }
+        
+        // 如果启用了数据库或指定了存储目标，则通过存储目标完成整轮操作
+        if (config.enableDatabase || !config.sinks.empty()) {
+            return runPingCycle(config);
         }
         
+        // 未启用数据库时，从指定文件读取主机列表，未指定则默认从ip.txt文件读取
+        std::map<std::string, std::string> hosts = readHostsFromFile(config.filename.empty() ? "ip.txt" : config.filename);
+        
         if (hosts.empty()) {
             std::println(std::cerr, "No hosts to ping. Please check the input file or database.");
             return 1;
         }
         
-        // 创建ping管理器并执行ping操作
+        // 创建ping管理器并执行ping操作，每个结果完成时输出
+        auto output = openResultWriter(config);
         PingManager pingManager;
+        pingManager.setResultWriter(output.get());
         // 使用默认最大并发数执行ping操作
-        std::vector<std::tuple<std::string, std::string, bool, short, std::string>> allResults = 
-            pingManager.performPing(hosts, config.pingCount, config.timeoutSeconds);
-        
-        // 如果启用了数据库，则初始化数据库管理器并存储结果
-        if (config.enableDatabase) {
-#ifdef USE_POSTGRESQL
-            if (config.usePostgreSQL) {
-                if (!insertPingResults<DatabaseManagerPG>(config.databasePath, allResults)) {
-                    std::println(std::cerr, "Failed to insert ping results into PostgreSQL database");
-                    return 1;
-                }
-            } else {
-#endif
-                if (!insertPingResults<DatabaseManager>(config.databasePath, allResults)) {
-                    std::println(std::cerr, "Failed to insert ping results into database");
-                    return 1;
-                }
-#ifdef USE_POSTGRESQL
-            }
-#endif
-        }
-        
-        // 处理告警逻辑（仅在启用数据库时）
-        if (config.enableDatabase) {
-#ifdef USE_POSTGRESQL
-            if (config.usePostgreSQL) {
-                if (!processAlerts<DatabaseManagerPG>(config.databasePath, allResults)) {
-                    return 1;
-                }
-            } else {
-#endif
-                if (!processAlerts<DatabaseManager>(config.databasePath, allResults)) {
-                    return 1;
-                }
-#ifdef USE_POSTGRESQL
-            }
-#endif
-        }
-        
-        // 打印所有IP地址和结果（除非启用静默模式）
-        if (!config.silentMode) {
-            for (const auto& [ip, hostname, success, delay, timestamp] : allResults) {
-                std::println(std::cout, "{}\t{}\t{}\t{}ms", ip, hostname, (success ? "success" : "failed"), delay);
-            }
-        }
+        pingManager.performPing(hosts, config.pingCount, config.timeoutSeconds);
         
-        return 0;
+        return !output || output->flush() ? 0 : 1;
     } catch (const std::exception& e) {
         std::println(std::cerr, "Exception occurred: {}", e.what());
         return 1;
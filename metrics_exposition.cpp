@@ -0,0 +1,173 @@
+#include "metrics_exposition.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+// 标签值中的反斜杠、双引号和换行需要转义
+std::string escapeLabel(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void appendFamily(std::string& text, const char* name, const char* type, const char* help) {
+    text += "# HELP ";
+    text += name;
+    text += ' ';
+    text += help;
+    text += "\n# TYPE ";
+    text += name;
+    text += ' ';
+    text += type;
+    text += '\n';
+}
+
+} // namespace
+
+// 值字段的宽度：计数器留12位，延迟和为15位，直方图之外的字段按取值范围
+std::size_t MetricsExposition::fieldWidth(std::size_t field) {
+    switch (field) {
+        case UP:
+            return 1;
+        case LAST_RTT:
+            return 5;
+        case LOSS_RATIO:
+            return 6;
+        case RTT_SUM:
+            return 15;
+        default:
+            return 12;
+    }
+}
+
+MetricsExposition::MetricsExposition(const std::vector<std::pair<std::string, std::string>>& hosts)
+    : fieldOffsets(hosts.size() * FIELD_COUNT), states(hosts.size()) {
+    std::vector<std::string> labels;
+    labels.reserve(hosts.size());
+    for (const auto& [ip, hostname] : hosts) {
+        labels.push_back("ip=\"" + escapeLabel(ip) + "\",hostname=\"" + escapeLabel(hostname) + "\"");
+    }
+
+    // 一行：<指标>{<标签>} <定宽的值字段>，字段的初始值为0
+    auto appendLine = [&](std::size_t slot, std::size_t field, const char* name, const std::string& extraLabel) {
+        text += name;
+        text += '{';
+        text += labels[slot];
+        text += extraLabel;
+        text += "} ";
+        fieldOffsets[slot * FIELD_COUNT + field] = text.size();
+        if (field == LOSS_RATIO) {
+            text += "0.0000";
+        } else {
+            text.append(fieldWidth(field) - 1, ' ');
+            text += '0';
+        }
+        text += '\n';
+    };
+
+    struct Gauge {
+        std::size_t field;
+        const char* name;
+        const char* type;
+        const char* help;
+    };
+    const Gauge perHost[] = {
+        {UP, "mping_host_up", "gauge", "Whether the last probe of the host succeeded."},
+        {LAST_RTT, "mping_host_last_rtt_milliseconds", "gauge", "Delay of the last successful probe in milliseconds."},
+        {LOSS_RATIO, "mping_host_loss_ratio", "gauge", "Share of failed probes among the last 64 probes."},
+        {PROBES, "mping_host_probes_total", "counter", "Probes sent to the host since the instance started."},
+        {FAILURES, "mping_host_failures_total", "counter", "Failed probes of the host since the instance started."},
+    };
+    for (const auto& gauge : perHost) {
+        appendFamily(text, gauge.name, gauge.type, gauge.help);
+        for (std::size_t slot = 0; slot < hosts.size(); slot++) {
+            appendLine(slot, gauge.field, gauge.name, "");
+        }
+    }
+
+    appendFamily(text, "mping_host_rtt_milliseconds", "histogram", "Delay of successful probes in milliseconds.");
+    for (std::size_t slot = 0; slot < hosts.size(); slot++) {
+        for (std::size_t bucket = 0; bucket <= RTT_BUCKETS.size(); bucket++) {
+            std::string le = bucket < RTT_BUCKETS.size() ? std::to_string(RTT_BUCKETS[bucket]) : "+Inf";
+            appendLine(slot, BUCKET_FIRST + bucket, "mping_host_rtt_milliseconds_bucket", ",le=\"" + le + "\"");
+        }
+        appendLine(slot, RTT_SUM, "mping_host_rtt_milliseconds_sum", "");
+        appendLine(slot, RTT_COUNT, "mping_host_rtt_milliseconds_count", "");
+    }
+    text.shrink_to_fit();
+}
+
+// 调用者持有mutex；超出字段宽度的值按字段能表示的最大值写入
+void MetricsExposition::writeField(std::size_t slot, std::size_t field, std::uint64_t value) {
+    std::size_t width = fieldWidth(field);
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    std::size_t length = static_cast<std::size_t>(end - digits);
+    if (length > width) {
+        std::fill(digits, digits + width, '9');
+        length = width;
+    }
+    char* target = text.data() + fieldOffsets[slot * FIELD_COUNT + field];
+    std::memset(target, ' ', width - length);
+    std::memcpy(target + width - length, digits, length);
+}
+
+void MetricsExposition::writeRatio(std::size_t slot, std::size_t field, double value) {
+    char digits[16];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), std::clamp(value, 0.0, 1.0), std::chars_format::fixed, 4);
+    std::memcpy(text.data() + fieldOffsets[slot * FIELD_COUNT + field], digits, static_cast<std::size_t>(end - digits));
+}
+
+void MetricsExposition::record(std::size_t slot, bool success, short delay) {
+    std::lock_guard<std::mutex> lock(mutex);
+    HostState& state = states[slot];
+    state.probes++;
+    state.outcomes = (state.outcomes << 1) | (success ? 0 : 1);
+    std::size_t window = static_cast<std::size_t>(std::min<std::uint64_t>(state.probes, LOSS_WINDOW));
+    std::uint64_t mask = window == LOSS_WINDOW ? ~std::uint64_t{0} : (std::uint64_t{1} << window) - 1;
+
+    writeField(slot, UP, success ? 1 : 0);
+    writeField(slot, PROBES, state.probes);
+    writeRatio(slot, LOSS_RATIO, static_cast<double>(std::popcount(state.outcomes & mask)) / static_cast<double>(window));
+    if (!success) {
+        state.failures++;
+        writeField(slot, FAILURES, state.failures);
+        return;
+    }
+
+    // 只有成功的探测进入直方图；桶计数在改写时累加成Prometheus要求的累计值
+    std::uint64_t rtt = static_cast<std::uint64_t>(std::max<short>(delay, 0));
+    std::size_t bucket = static_cast<std::size_t>(
+        std::lower_bound(RTT_BUCKETS.begin(), RTT_BUCKETS.end(), static_cast<int>(rtt)) - RTT_BUCKETS.begin());
+    state.buckets[bucket]++;
+    state.rttSum += rtt;
+
+    writeField(slot, LAST_RTT, rtt);
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < state.buckets.size(); i++) {
+        cumulative += state.buckets[i];
+        if (i >= bucket) {
+            writeField(slot, BUCKET_FIRST + i, cumulative);
+        }
+    }
+    writeField(slot, RTT_SUM, state.rttSum);
+    writeField(slot, RTT_COUNT, cumulative);
+}
+
+void MetricsExposition::appendTo(std::string& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out += text;
+}
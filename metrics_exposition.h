@@ -0,0 +1,76 @@
+#ifndef METRICS_EXPOSITION_H
+#define METRICS_EXPOSITION_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <utility>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+// 每台主机的Prometheus指标，以文本格式预先渲染在一块缓冲区中
+//
+// 构造时按主机列表一次性生成全部行（指标名、标签和定宽的值字段），之后每个结果只改写该主机各个值字段中的数字，
+// 抓取时整块复制，不再逐行格式化；值字段右对齐、左侧以空格填充，Prometheus文本格式允许指标和值之间有多个空格
+//
+// 每台主机的指标：
+//   mping_host_up                         最近一次探测是否成功
+//   mping_host_last_rtt_milliseconds      最近一次成功探测的延迟
+//   mping_host_loss_ratio                 最近64次探测中失败的比例
+//   mping_host_probes_total / mping_host_failures_total   探测和失败次数
+//   mping_host_rtt_milliseconds           成功探测延迟的直方图（_bucket、_sum、_count）
+class MetricsExposition {
+public:
+    // 直方图桶的上界（毫秒），另有+Inf桶
+    static constexpr std::array<int, 12> RTT_BUCKETS = {1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000};
+    static constexpr std::size_t LOSS_WINDOW = 64;
+
+private:
+    // 每台主机的值字段，按在缓冲区中出现的顺序
+    enum Field : std::size_t {
+        UP,
+        LAST_RTT,
+        LOSS_RATIO,
+        PROBES,
+        FAILURES,
+        BUCKET_FIRST,
+        RTT_SUM = BUCKET_FIRST + RTT_BUCKETS.size() + 1,
+        RTT_COUNT,
+        FIELD_COUNT
+    };
+
+    struct HostState {
+        std::uint64_t probes = 0;
+        std::uint64_t failures = 0;
+        std::uint64_t outcomes = 0;  // 最近64次探测的结果，最低位为最近一次，1表示失败
+        std::uint64_t rttSum = 0;
+        std::array<std::uint64_t, RTT_BUCKETS.size() + 1> buckets{};  // 非累计的桶计数，最后一个为+Inf
+    };
+
+    mutable std::mutex mutex;
+    std::string text;
+    std::vector<std::size_t> fieldOffsets;  // 主机数 × FIELD_COUNT
+    std::vector<HostState> states;
+
+    static std::size_t fieldWidth(std::size_t field);
+    void writeField(std::size_t slot, std::size_t field, std::uint64_t value);
+    void writeRatio(std::size_t slot, std::size_t field, double value);
+
+public:
+    // 主机顺序即槽位顺序，与最近结果缓冲区的槽位一致
+    explicit MetricsExposition(const std::vector<std::pair<std::string, std::string>>& hosts);
+
+    MetricsExposition(const MetricsExposition&) = delete;
+    MetricsExposition& operator=(const MetricsExposition&) = delete;
+
+    // 记录一个探测结果并改写该主机的值字段
+    void record(std::size_t slot, bool success, short delay);
+
+    // 把预先渲染的主机指标追加到out
+    void appendTo(std::string& out) const;
+
+    std::size_t size() const { return text.size(); }
+};
+
+#endif // METRICS_EXPOSITION_H
@@ -0,0 +1,138 @@
+#include "pg_connection_pool.h"
+#include <iostream>
+#include <print>
+#include <iomanip>
+#include <algorithm>
+#include <utility>
+
+PgConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool(std::exchange(other.pool, nullptr)), slot(other.slot) {}
+
+PgConnectionPool::Lease& PgConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = std::exchange(other.pool, nullptr);
+        slot = other.slot;
+    }
+    return *this;
+}
+
+PgConnectionPool::Lease::~Lease() {
+    release();
+}
+
+PGconn* PgConnectionPool::Lease::get() const {
+    // 借出期间只有持有者访问该槽位，无需加锁
+    return pool ? pool->slots[slot].conn : nullptr;
+}
+
+void PgConnectionPool::Lease::release() {
+    if (pool) {
+        pool->release(slot);
+        pool = nullptr;
+    }
+}
+
+PgConnectionPool::PgConnectionPool(const std::string& connectionInfo, std::size_t size, std::function<bool(PGconn*)> setup)
+    : connInfo(connectionInfo), setup(std::move(setup)), slots(size) {}
+
+PgConnectionPool::~PgConnectionPool() {
+    for (auto& slot : slots) {
+        if (slot.conn) {
+            PQfinish(slot.conn);
+        }
+    }
+}
+
+bool PgConnectionPool::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& slot : slots) {
+        if (slot.conn) {
+            continue;
+        }
+        slot.conn = PQconnectdb(connInfo.c_str());
+        if (PQstatus(slot.conn) != CONNECTION_OK) {
+            std::println(std::cerr, "Failed to open pooled connection: {}", PQerrorMessage(slot.conn));
+            return false;
+        }
+        if (!setup(slot.conn)) {
+            std::println(std::cerr, "Failed to set up pooled connection");
+            return false;
+        }
+    }
+    return true;
+}
+
+// 连接断开时用PQreset按原参数重连，并重新创建会话级的临时表和预编译语句
+bool PgConnectionPool::ensureConnected(Slot& slot) {
+    if (slot.conn && PQstatus(slot.conn) == CONNECTION_OK) {
+        return true;
+    }
+    if (slot.conn) {
+        PQreset(slot.conn);
+    } else {
+        slot.conn = PQconnectdb(connInfo.c_str());
+    }
+    if (PQstatus(slot.conn) != CONNECTION_OK) {
+        std::println(std::cerr, "Failed to reconnect pooled connection: {}", PQerrorMessage(slot.conn));
+        return false;
+    }
+    slot.stats.reconnects++;
+    return setup(slot.conn);
+}
+
+PgConnectionPool::Lease PgConnectionPool::acquire(std::size_t index) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [&] { return !slots[index].leased; });
+
+    auto waited = std::chrono::steady_clock::now() - start;
+    acquisitions++;
+    totalWait += waited;
+    maxWait = std::max(maxWait, waited);
+
+    Slot& slot = slots[index];
+    slot.leased = true;
+    lock.unlock();
+
+    // 重连可能耗时较长，在锁外进行；槽位已标记为借出，其他使用者不会访问它
+    if (!ensureConnected(slot)) {
+        release(index);
+        return {};
+    }
+    return Lease(this, index);
+}
+
+void PgConnectionPool::release(std::size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slots[index].leased = false;
+    }
+    available.notify_all();
+}
+
+void PgConnectionPool::recordBatch(std::size_t index, std::size_t samples, std::chrono::steady_clock::duration busy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ConnectionStats& stats = slots[index].stats;
+    stats.batches++;
+    stats.samples += samples;
+    stats.busyTime += busy;
+}
+
+void PgConnectionPool::printStats(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    double averageWait = acquisitions > 0 ? Milliseconds(totalWait).count() / acquisitions : 0;
+
+    out << "Connection pool: " << slots.size() << " connections, " << acquisitions << " acquisitions, "
+        << std::fixed << std::setprecision(2) << "average wait " << averageWait << "ms, "
+        << "max wait " << Milliseconds(maxWait).count() << "ms" << std::endl;
+    for (std::size_t i = 0; i < slots.size(); i++) {
+        const ConnectionStats& stats = slots[i].stats;
+        double busySeconds = std::chrono::duration<double>(stats.busyTime).count();
+        double throughput = busySeconds > 0 ? stats.samples / busySeconds : 0;
+        out << "  #" << i << ": " << stats.batches << " batches, " << stats.samples << " samples, "
+            << std::fixed << std::setprecision(2) << Milliseconds(stats.busyTime).count() << "ms busy, "
+            << std::setprecision(0) << throughput << " samples/s, " << stats.reconnects << " reconnects" << std::endl;
+    }
+}
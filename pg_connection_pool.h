@@ -0,0 +1,91 @@
+#ifndef PG_CONNECTION_POOL_H
+#define PG_CONNECTION_POOL_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+#include <libpq-fe.h>
+
+// 固定大小的PostgreSQL连接池：连接在open时一次性建立，在进程生命周期内复用
+// 每个连接同一时间只借给一个使用者；借出时检查连接状态，断开的连接先重连并重新执行会话初始化
+class PgConnectionPool {
+public:
+    // 单个连接的吞吐统计
+    struct ConnectionStats {
+        std::uint64_t batches = 0;
+        std::uint64_t samples = 0;
+        std::chrono::steady_clock::duration busyTime{};
+        int reconnects = 0;
+    };
+
+    // 借出的连接，析构时自动归还
+    class Lease {
+    private:
+        PgConnectionPool* pool = nullptr;
+        std::size_t slot = 0;
+
+    public:
+        Lease() = default;
+        Lease(PgConnectionPool* pool, std::size_t slot) : pool(pool), slot(slot) {}
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        explicit operator bool() const { return pool != nullptr; }
+        PGconn* get() const;
+        std::size_t index() const { return slot; }
+        void release();
+    };
+
+private:
+    struct Slot {
+        PGconn* conn = nullptr;
+        bool leased = false;
+        ConnectionStats stats;
+    };
+
+    std::string connInfo;
+    std::function<bool(PGconn*)> setup;  // 每个新连接（包括重连后）执行的会话初始化
+    std::vector<Slot> slots;
+    mutable std::mutex mutex;
+    std::condition_variable available;
+
+    // 等待统计：从请求到拿到连接的时间
+    std::uint64_t acquisitions = 0;
+    std::chrono::steady_clock::duration totalWait{};
+    std::chrono::steady_clock::duration maxWait{};
+
+public:
+    PgConnectionPool(const std::string& connectionInfo, std::size_t size, std::function<bool(PGconn*)> setup);
+    ~PgConnectionPool();
+
+    PgConnectionPool(const PgConnectionPool&) = delete;
+    PgConnectionPool& operator=(const PgConnectionPool&) = delete;
+
+    // 建立全部连接，任一连接失败则返回false
+    bool open();
+    std::size_t size() const { return slots.size(); }
+
+    // 借出指定下标的连接（分片写入时每个分片固定使用同一个连接），连接被占用时等待
+    // 连接已断开且无法重连时返回空的Lease
+    Lease acquire(std::size_t index);
+
+    // 记录一个连接完成的一批写入
+    void recordBatch(std::size_t index, std::size_t samples, std::chrono::steady_clock::duration busy);
+
+    void printStats(std::ostream& out) const;
+
+private:
+    void release(std::size_t index);
+    bool ensureConnected(Slot& slot);
+};
+
+#endif // PG_CONNECTION_POOL_H
@@ -85,6 +85,12 @@ std::vector<std::tuple<std::string, std::string, bool, short, std::string>> Ping
         
         for (auto& f : futures) {
             allResults.push_back(f.get());
+            if (recentResults) {
+                recentResults->record(allResults.back());
+            }
+            if (resultWriter) {
+                resultWriter->write(allResults.back());
+            }
         }
         
         return allResults;
@@ -134,6 +140,12 @@ std::vector<std::tuple<std::string, std::string, bool, short, std::string>> Ping
                 
                 // 执行ping操作
                 auto result = pingHost(host.first, host.second, pingCount, timeoutSeconds);
+                if (recentResults) {
+                    recentResults->record(result);
+                }
+                if (resultWriter) {
+                    resultWriter->write(result);
+                }
                 
                 // 将结果添加到结果容器中
                 {
@@ -13,13 +13,24 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include "recent_results.h"
+#include "result_output.h"
 
 class PingManager {
 private:
     // 默认最大并发数
     static const size_t DEFAULT_MAX_CONCURRENT = 50;
     
+    RecentResults* recentResults = nullptr;
+    ResultWriter* resultWriter = nullptr;
+    
 public:
+    // 每个结果完成时写入该主机的最近结果缓冲区（同一台主机的结果由同一个线程写入）
+    void setRecentResults(RecentResults* recent) { recentResults = recent; }
+    // 每个结果完成时追加到输出缓冲区，调用者在一轮结束后刷新
+    void setResultWriter(ResultWriter* writer) { resultWriter = writer; }
+    
+
     // 执行ping操作，返回结果列表
     std::vector<std::tuple<std::string, std::string, bool, short, std::string>> performPing(
         const std::map<std::string, std::string>& hosts, 
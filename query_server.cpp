@@ -0,0 +1,303 @@
+#include "query_server.h"
+#include <iostream>
+#include <print>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+bool makeUnixAddress(const std::string& path, sockaddr_un& address) {
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+void setTimeouts(int fd, int seconds) {
+    timeval timeout{seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+// 读取直到出现结束标记、对端关闭、超时或达到上限
+std::string readUntil(int fd, std::string_view terminator, std::size_t maxBytes) {
+    std::string data;
+    char buffer[4096];
+    while (data.size() < maxBytes) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+        data.append(buffer, static_cast<std::size_t>(received));
+        if (!terminator.empty() && data.find(terminator) != std::string::npos) {
+            break;
+        }
+    }
+    return data;
+}
+
+bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+    return true;
+}
+
+// 连接套接字路径，没有实例在监听时返回-1
+int connectUnix(const std::string& path) {
+    sockaddr_un address;
+    if (!makeUnixAddress(path, address)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+QueryServer::QueryServer(Handler handler) : handler(std::move(handler)) {}
+
+QueryServer::~QueryServer() {
+    stop();
+}
+
+bool QueryServer::listenUnix(const std::string& path) {
+    sockaddr_un address;
+    if (!makeUnixAddress(path, address)) {
+        std::println(std::cerr, "Invalid socket path: {}", path);
+        return false;
+    }
+
+    // 能连上说明另一个实例正在服务；连不上的套接字文件是上次异常退出留下的，可以替换
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            std::println(std::cerr, "Refusing to replace {}: not a socket", path);
+            return false;
+        }
+        int existing = connectUnix(path);
+        if (existing >= 0) {
+            close(existing);
+            std::println(std::cerr, "Another instance is already serving on {}", path);
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    unixFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (unixFd < 0 || bind(unixFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(unixFd, SOMAXCONN) != 0) {
+        std::println(std::cerr, "Failed to listen on {}: {}", path, std::strerror(errno));
+        if (unixFd >= 0) {
+            close(unixFd);
+            unixFd = -1;
+        }
+        return false;
+    }
+    socketPath = path;
+    return true;
+}
+
+bool QueryServer::listenHttp(int port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    httpFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (httpFd < 0 || setsockopt(httpFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        bind(httpFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(httpFd, SOMAXCONN) != 0) {
+        std::println(std::cerr, "Failed to listen on 127.0.0.1:{}: {}", port, std::strerror(errno));
+        if (httpFd >= 0) {
+            close(httpFd);
+            httpFd = -1;
+        }
+        return false;
+    }
+    socklen_t length = sizeof(address);
+    getsockname(httpFd, reinterpret_cast<sockaddr*>(&address), &length);
+    boundHttpPort = ntohs(address.sin_port);
+    return true;
+}
+
+bool QueryServer::start() {
+    if (pipe2(wakePipe, O_CLOEXEC) != 0) {
+        std::println(std::cerr, "Failed to create wake-up pipe: {}", std::strerror(errno));
+        return false;
+    }
+    worker = std::thread([this] { run(); });
+    return true;
+}
+
+void QueryServer::stop() {
+    if (worker.joinable()) {
+        char wake = 0;
+        if (write(wakePipe[1], &wake, 1) < 0) {
+            std::println(std::cerr, "Failed to wake query server: {}", std::strerror(errno));
+        }
+        worker.join();
+    }
+    for (int* fd : {&unixFd, &httpFd, &wakePipe[0], &wakePipe[1]}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    if (!socketPath.empty()) {
+        unlink(socketPath.c_str());
+        socketPath.clear();
+    }
+}
+
+void QueryServer::run() {
+    pollfd fds[3] = {{wakePipe[0], POLLIN, 0}, {unixFd, POLLIN, 0}, {httpFd, POLLIN, 0}};
+    while (true) {
+        // 未监听的描述符为-1，poll会忽略
+        if (poll(fds, 3, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::println(std::cerr, "Query server poll failed: {}", std::strerror(errno));
+            return;
+        }
+        if (fds[0].revents) {
+            return;
+        }
+        for (int i = 1; i < 3; i++) {
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            int client = accept4(fds[i].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                continue;
+            }
+            setTimeouts(client, IO_TIMEOUT_SECONDS);
+            if (i == 1) {
+                serveUnix(client);
+            } else {
+                serveHttp(client);
+            }
+            close(client);
+        }
+    }
+}
+
+void QueryServer::serveUnix(int client) {
+    std::string line = readUntil(client, "\n", MAX_REQUEST_BYTES);
+    line = line.substr(0, line.find('\n'));
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+
+    body.clear();
+    if (handler(line, body)) {
+        writeAll(client, "ok\n");
+        writeAll(client, body);
+    } else {
+        writeAll(client, "error " + body + "\n");
+    }
+}
+
+void QueryServer::serveHttp(int client) {
+    std::string head = readUntil(client, "\r\n\r\n", MAX_REQUEST_BYTES);
+    std::string_view requestLine(head);
+    requestLine = requestLine.substr(0, requestLine.find("\r\n"));
+
+    // 请求行：GET <目标> HTTP/1.x
+    std::size_t methodEnd = requestLine.find(' ');
+    std::size_t targetEnd = methodEnd == std::string_view::npos ? methodEnd : requestLine.find(' ', methodEnd + 1);
+    body.clear();
+    const char* status = "404 Not Found";
+    const char* contentType = "text/plain; charset=utf-8";
+    if (targetEnd == std::string_view::npos || !requestLine.substr(targetEnd + 1).starts_with("HTTP/")) {
+        status = "400 Bad Request";
+        body = "malformed request";
+    } else if (requestLine.substr(0, methodEnd) != "GET") {
+        status = "405 Method Not Allowed";
+        body = "only GET is supported";
+    } else {
+        // /status/10.0.0.1?limit=5 -> "status 10.0.0.1 limit=5"
+        std::string command(requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1));
+        for (char& c : command) {
+            if (c == '/' || c == '?' || c == '&') {
+                c = ' ';
+            }
+        }
+        command.erase(0, command.find_first_not_of(' '));
+        if (handler(command, body)) {
+            status = "200 OK";
+            if (command == "metrics" || command.starts_with("metrics ")) {
+                contentType = "text/plain; version=0.0.4; charset=utf-8";
+            }
+        }
+    }
+    if (status[0] != '2') {
+        body += '\n';
+    }
+
+    std::string header = "HTTP/1.1 ";
+    header += status;
+    header += "\r\nContent-Type: ";
+    header += contentType;
+    header += "\r\nContent-Length: ";
+    header += std::to_string(body.size());
+    header += "\r\nConnection: close\r\n\r\n";
+    if (writeAll(client, header)) {
+        writeAll(client, body);
+    }
+}
+
+bool QueryServer::request(const std::string& path, std::string_view line, std::string& response) {
+    int fd = connectUnix(path);
+    if (fd < 0) {
+        return false;
+    }
+    // 实例可能正在回答其他客户端，等待时间比服务端单个连接的超时略长
+    setTimeouts(fd, IO_TIMEOUT_SECONDS * 3);
+    std::string message(line);
+    message += '\n';
+    std::string reply;
+    if (writeAll(fd, message)) {
+        shutdown(fd, SHUT_WR);
+        reply = readUntil(fd, "", static_cast<std::size_t>(-1));
+    }
+    close(fd);
+
+    if (reply.starts_with("ok\n")) {
+        response = reply.substr(3);
+        return true;
+    }
+    if (reply.starts_with("error ")) {
+        response = reply.substr(6, reply.find('\n') - 6);
+    }
+    return false;
+}
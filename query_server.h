@@ -0,0 +1,61 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <thread>
+
+// 常驻模式的查询服务：在Unix域套接字（以及可选的本机HTTP端口）上接收请求，交给处理函数回答
+//
+// 套接字协议：客户端发送一行请求，服务端回复 "ok\n" 加响应记录，或 "error <信息>\n"，然后关闭连接
+// HTTP：GET /<命令>/<参数>?<key=value>&... 转换为同样的一行请求（如 /status/10.0.0.1?limit=5），
+// 成功返回200和响应记录，失败返回404和错误信息；/metrics以Prometheus文本格式的内容类型返回
+//
+// 所有连接在一个线程中依次处理；每个连接的读写有超时，一个缓慢的客户端最多阻塞其他客户端几秒
+class QueryServer {
+public:
+    // 处理一行请求；成功时body为响应，失败时body为错误信息
+    using Handler = std::function<bool(std::string_view request, std::string& body)>;
+
+    static constexpr int IO_TIMEOUT_SECONDS = 2;
+    static constexpr std::size_t MAX_REQUEST_BYTES = 8192;
+
+private:
+    Handler handler;
+    std::string socketPath;
+    int unixFd = -1;
+    int httpFd = -1;
+    int boundHttpPort = 0;
+    int wakePipe[2] = {-1, -1};
+    std::thread worker;
+    std::string body;  // 响应缓冲区，在连接之间复用，大的响应（如metrics）不必每次重新分配
+
+    void run();
+    void serveUnix(int client);
+    void serveHttp(int client);
+
+public:
+    explicit QueryServer(Handler handler);
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // 在套接字路径上监听；路径上已有正在服务的实例时失败，残留的套接字文件会被替换
+    bool listenUnix(const std::string& path);
+    // 在127.0.0.1的指定端口上接受HTTP请求，端口为0时由系统分配
+    bool listenHttp(int port);
+    int httpPort() const { return boundHttpPort; }
+
+    // 启动服务线程
+    bool start();
+    // 停止服务线程并删除套接字文件（重复调用无副作用）
+    void stop();
+
+    // 客户端：向套接字上运行中的实例发送一行请求；没有实例在服务时返回false且不输出任何信息，
+    // 实例返回错误时也返回false，错误信息写入response
+    static bool request(const std::string& path, std::string_view line, std::string& response);
+};
+
+#endif // QUERY_SERVER_H
@@ -0,0 +1,118 @@
+#include "recent_results.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <limits>
+
+namespace {
+
+// 每个样本打包为一个64位整数，读写都是单次原子操作：
+// 低32位为时间（民用时间秒数，无符号），之后16位为延迟，第48位为成功标志
+std::uint64_t packSample(std::int64_t time, short delay, bool success) {
+    auto seconds = static_cast<std::uint32_t>(std::clamp<std::int64_t>(time, 0, std::numeric_limits<std::uint32_t>::max()));
+    return seconds | (static_cast<std::uint64_t>(static_cast<std::uint16_t>(delay)) << 32) |
+           (success ? std::uint64_t{1} << 48 : 0);
+}
+
+SegmentStore::Sample unpackSample(std::uint64_t packed) {
+    return {static_cast<std::int64_t>(packed & 0xffffffff), static_cast<short>(static_cast<std::uint16_t>(packed >> 32)),
+            ((packed >> 48) & 1) != 0};
+}
+
+} // namespace
+
+RecentResults::RecentResults(const std::vector<std::string>& hosts, std::size_t depth)
+    : ringDepth(std::clamp<std::size_t>(depth, 1, MAX_DEPTH)) {
+    for (const auto& ip : hosts) {
+        if (slots.emplace(ip, hostList.size()).second) {
+            hostList.push_back(ip);
+        }
+    }
+
+    std::size_t bytes = sizeof(RingHeader) + ringDepth * sizeof(std::uint64_t);
+    blockSize = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    if (hostList.empty()) {
+        return;
+    }
+    slab = static_cast<std::byte*>(::operator new(hostList.size() * blockSize, std::align_val_t{CACHE_LINE}));
+    for (std::size_t slot = 0; slot < hostList.size(); slot++) {
+        new (slab + slot * blockSize) RingHeader{0, 0};
+    }
+}
+
+RecentResults::~RecentResults() {
+    if (slab) {
+        ::operator delete(slab, std::align_val_t{CACHE_LINE});
+    }
+}
+
+RecentResults::RingHeader& RecentResults::header(std::size_t slot) const {
+    return *std::launder(reinterpret_cast<RingHeader*>(slab + slot * blockSize));
+}
+
+std::uint64_t* RecentResults::entries(std::size_t slot) const {
+    return reinterpret_cast<std::uint64_t*>(slab + slot * blockSize + sizeof(RingHeader));
+}
+
+std::optional<std::size_t> RecentResults::slotOf(const std::string& ip) const {
+    auto it = slots.find(ip);
+    if (it == slots.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+// 写入顺序：先递增begun，再写样本，最后递增written；
+// 读取者看到新样本时，读取之后的acquire栅栏保证它也能看到递增后的begun
+void RecentResults::record(std::size_t slot, std::int64_t time, short delay, bool success) {
+    RingHeader& ring = header(slot);
+    std::atomic_ref<std::uint64_t> written(ring.written);
+    std::uint64_t index = written.load(std::memory_order_relaxed);
+    std::atomic_ref<std::uint64_t>(ring.begun).store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::atomic_ref<std::uint64_t>(entries(slot)[index % ringDepth]).store(packSample(time, delay, success), std::memory_order_relaxed);
+    written.store(index + 1, std::memory_order_release);
+}
+
+bool RecentResults::record(const std::tuple<std::string, std::string, bool, short, std::string>& result) {
+    const auto& [ip, hostname, success, delay, timestamp] = result;
+    auto slot = slotOf(ip);
+    auto time = SegmentStore::parseTimestamp(timestamp);
+    if (!slot || !time) {
+        return false;
+    }
+    record(*slot, *time, delay, success);
+    return true;
+}
+
+bool RecentResults::forEachRecent(const std::string& ip, std::size_t limit, const SampleVisitor& visit) const {
+    auto slot = slotOf(ip);
+    if (!slot) {
+        return false;
+    }
+    RingHeader& ring = header(*slot);
+    std::uint64_t* values = entries(*slot);
+
+    // 先复制样本，再根据begun丢弃复制期间可能已被覆盖的样本（下标 + 深度 < begun）
+    std::uint64_t written = std::atomic_ref<std::uint64_t>(ring.written).load(std::memory_order_acquire);
+    std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>({written, ringDepth, limit}));
+    std::vector<std::uint64_t> copied(count);
+    for (std::size_t i = 0; i < count; i++) {
+        copied[i] = std::atomic_ref<std::uint64_t>(values[(written - 1 - i) % ringDepth]).load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::uint64_t begun = std::atomic_ref<std::uint64_t>(ring.begun).load(std::memory_order_relaxed);
+    std::uint64_t oldestValid = begun > ringDepth ? begun - ringDepth : 0;
+
+    for (std::size_t i = 0; i < count && written - 1 - i >= oldestValid; i++) {
+        if (!visit(unpackSample(copied[i]))) {
+            break;
+        }
+    }
+    return true;
+}
+
+std::uint64_t RecentResults::recorded(const std::string& ip) const {
+    auto slot = slotOf(ip);
+    return slot ? std::atomic_ref<std::uint64_t>(header(*slot).written).load(std::memory_order_acquire) : 0;
+}
@@ -0,0 +1,70 @@
+#ifndef RECENT_RESULTS_H
+#define RECENT_RESULTS_H
+
+#include "segment_store.h"
+#include <string>
+#include <vector>
+#include <tuple>
+#include <atomic>
+#include <optional>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// 每台主机最近结果的内存环形缓冲区：全部主机的环放在一块按缓存行对齐的连续内存中，
+// 每台主机占 ceil((16 + 深度 × 8) / 64) 个缓存行，总内存 ≈ 主机数 × 深度 × 8字节，在构造时一次分配，
+// 实际占用的物理内存随写入的样本增长，不超过这个上限
+// 每个环只有一个写入者（同一台主机的结果依次写入），读取者不加锁：读取期间被覆盖的样本会被丢弃，不会读到混合的数据
+// 主机集合在构造时确定，主机列表变化时重新创建
+class RecentResults {
+public:
+    static constexpr std::size_t DEFAULT_DEPTH = 1024;
+    static constexpr std::size_t MAX_DEPTH = 65536;
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    using SampleVisitor = std::function<bool(const SegmentStore::Sample&)>;
+
+private:
+    // 每台主机环的头部：begun在写入样本之前递增，written在写入之后递增，读取者据此判断样本是否在读取期间被覆盖
+    // 头部和样本都是普通整数，通过std::atomic_ref访问；样本区不需要初始化，未写入的内存页不占用物理内存
+    struct RingHeader {
+        std::uint64_t begun;
+        std::uint64_t written;
+    };
+
+    std::vector<std::string> hostList;
+    std::unordered_map<std::string, std::size_t> slots;
+    std::size_t ringDepth;
+    std::size_t blockSize;  // 每台主机占用的字节数，为缓存行的整数倍
+    std::byte* slab = nullptr;
+
+    RingHeader& header(std::size_t slot) const;
+    std::uint64_t* entries(std::size_t slot) const;
+
+public:
+    RecentResults(const std::vector<std::string>& hosts, std::size_t depth = DEFAULT_DEPTH);
+    ~RecentResults();
+
+    RecentResults(const RecentResults&) = delete;
+    RecentResults& operator=(const RecentResults&) = delete;
+
+    std::size_t depth() const { return ringDepth; }
+    const std::vector<std::string>& hosts() const { return hostList; }
+    std::size_t memoryBytes() const { return hostList.size() * blockSize; }
+
+    // 主机在缓冲区中的位置，未知主机返回nullopt
+    std::optional<std::size_t> slotOf(const std::string& ip) const;
+
+    // 写入一个结果；time为本地时间的民用时间秒数（1970年至2106年），delay为毫秒
+    void record(std::size_t slot, std::int64_t time, short delay, bool success);
+    // 写入一轮ping结果 (IP, 主机名, 成功, 延迟, 时间戳)；未知主机和无法解析的时间戳被忽略
+    bool record(const std::tuple<std::string, std::string, bool, short, std::string>& result);
+
+    // 从新到旧遍历一台主机最近的样本，最多limit个；visit返回false时停止；未知主机返回false
+    bool forEachRecent(const std::string& ip, std::size_t limit, const SampleVisitor& visit) const;
+    // 已写入的样本总数（包括已被覆盖的），未知主机返回0
+    std::uint64_t recorded(const std::string& ip) const;
+};
+
+#endif // RECENT_RESULTS_H
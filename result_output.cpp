@@ -0,0 +1,167 @@
+#include "result_output.h"
+#include <iostream>
+#include <print>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+char* appendText(char* cursor, std::string_view text) {
+    std::memcpy(cursor, text.data(), text.size());
+    return cursor + text.size();
+}
+
+// 主机名在各格式中转义后的最大长度：JSON中控制字符写作\u00XX
+std::size_t escapedBound(std::string_view hostname) {
+    return hostname.size() * 6 + 2;
+}
+
+} // namespace
+
+ResultWriter::ResultWriter(Format format, std::FILE* out) : format(format), out(out), buffer(BUFFER_SIZE) {
+    std::string_view header;
+    if (format == Format::TSV) {
+        header = "ip\thostname\ttimestamp\tdelay\tsuccess\n";
+    } else if (format == Format::CSV) {
+        header = "ip,hostname,timestamp,delay,success\n";
+    }
+    used = static_cast<std::size_t>(appendText(buffer.data(), header) - buffer.data());
+}
+
+ResultWriter::~ResultWriter() {
+    flush();
+}
+
+std::optional<ResultWriter::Format> ResultWriter::parseFormat(std::string_view name) {
+    if (name == "text") {
+        return Format::TEXT;
+    }
+    if (name == "tsv") {
+        return Format::TSV;
+    }
+    if (name == "csv") {
+        return Format::CSV;
+    }
+    if (name == "jsonl") {
+        return Format::JSONL;
+    }
+    return std::nullopt;
+}
+
+char* ResultWriter::appendHostname(char* cursor, std::string_view hostname) const {
+    switch (format) {
+        case Format::TEXT:
+            return appendText(cursor, hostname);
+        case Format::TSV:
+            for (char c : hostname) {
+                *cursor++ = (c == '\t' || c == '\n' || c == '\r') ? ' ' : c;
+            }
+            return cursor;
+        case Format::CSV:
+            // 含有逗号、引号或换行的字段加引号，引号写两次
+            if (hostname.find_first_of(",\"\r\n") == std::string_view::npos) {
+                return appendText(cursor, hostname);
+            }
+            *cursor++ = '"';
+            for (char c : hostname) {
+                if (c == '"') {
+                    *cursor++ = '"';
+                }
+                *cursor++ = c;
+            }
+            *cursor++ = '"';
+            return cursor;
+        case Format::JSONL:
+            *cursor++ = '"';
+            for (unsigned char c : hostname) {
+                if (c == '"' || c == '\\') {
+                    *cursor++ = '\\';
+                    *cursor++ = static_cast<char>(c);
+                } else if (c < 0x20) {
+                    static constexpr char HEX[] = "0123456789abcdef";
+                    cursor = appendText(cursor, "\\u00");
+                    *cursor++ = HEX[c >> 4];
+                    *cursor++ = HEX[c & 0xf];
+                } else {
+                    *cursor++ = static_cast<char>(c);
+                }
+            }
+            *cursor++ = '"';
+            return cursor;
+    }
+    return cursor;
+}
+
+void ResultWriter::write(const std::tuple<std::string, std::string, bool, short, std::string>& result) {
+    const auto& [ip, hostname, success, delay, timestamp] = result;
+    std::size_t bound = FIXED_ROW_SIZE + std::min<std::size_t>(ip.size(), 64) + escapedBound(hostname) +
+                        std::min<std::size_t>(timestamp.size(), 32);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (used + bound > buffer.size()) {
+        writeBuffer();
+        // 超长的主机名放不进缓冲区时扩大缓冲区
+        if (bound > buffer.size()) {
+            buffer.resize(bound);
+        }
+    }
+
+    std::string_view ipText(ip.data(), std::min<std::size_t>(ip.size(), 64));
+    std::string_view timeText(timestamp.data(), std::min<std::size_t>(timestamp.size(), 32));
+    char* cursor = buffer.data() + used;
+    switch (format) {
+        case Format::TEXT:
+            cursor = appendText(cursor, ipText);
+            *cursor++ = '\t';
+            cursor = appendHostname(cursor, hostname);
+            cursor = appendText(cursor, success ? "\tsuccess\t" : "\tfailed\t");
+            cursor = std::to_chars(cursor, cursor + 8, delay).ptr;
+            cursor = appendText(cursor, "ms\n");
+            break;
+        case Format::TSV:
+        case Format::CSV: {
+            char separator = format == Format::TSV ? '\t' : ',';
+            cursor = appendText(cursor, ipText);
+            *cursor++ = separator;
+            cursor = appendHostname(cursor, hostname);
+            *cursor++ = separator;
+            cursor = appendText(cursor, timeText);
+            *cursor++ = separator;
+            cursor = std::to_chars(cursor, cursor + 8, delay).ptr;
+            *cursor++ = separator;
+            *cursor++ = success ? '1' : '0';
+            *cursor++ = '\n';
+            break;
+        }
+        case Format::JSONL:
+            cursor = appendText(cursor, "{\"ip\":\"");
+            cursor = appendText(cursor, ipText);
+            cursor = appendText(cursor, "\",\"hostname\":");
+            cursor = appendHostname(cursor, hostname);
+            cursor = appendText(cursor, ",\"timestamp\":\"");
+            cursor = appendText(cursor, timeText);
+            cursor = appendText(cursor, "\",\"delay\":");
+            cursor = std::to_chars(cursor, cursor + 8, delay).ptr;
+            cursor = appendText(cursor, success ? ",\"success\":true}\n" : ",\"success\":false}\n");
+            break;
+    }
+    used = static_cast<std::size_t>(cursor - buffer.data());
+}
+
+// 调用者持有mutex
+bool ResultWriter::writeBuffer() {
+    if (used > 0 && std::fwrite(buffer.data(), 1, used, out) != used) {
+        if (!failed) {
+            std::println(std::cerr, "Failed to write ping results to the output");
+        }
+        failed = true;
+    }
+    used = 0;
+    return !failed;
+}
+
+bool ResultWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writeBuffer() && std::fflush(out) == 0;
+}
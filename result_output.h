@@ -0,0 +1,57 @@
+#ifndef RESULT_OUTPUT_H
+#define RESULT_OUTPUT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <optional>
+#include <mutex>
+#include <cstdio>
+#include <cstddef>
+
+// 逐个输出ping结果：每个结果完成时格式化到一块复用的大缓冲区，缓冲区将满时或一轮结束时整块写出一次
+// 数字用std::to_chars格式化，与区域设置无关；可以从多个探测线程同时调用write
+//
+// 格式：
+//   text   ip、主机名、success/failed、延迟（如12ms），以制表符分隔，供人阅读（默认）
+//   tsv    表头加 ip、hostname、timestamp、delay、success 五列，主机名中的制表符和换行替换为空格
+//   csv    同样的五列，按RFC 4180加引号，可以直接用--import导入
+//   jsonl  每行一个JSON对象：{"ip":..,"hostname":..,"timestamp":..,"delay":..,"success":true}
+class ResultWriter {
+public:
+    enum class Format { TEXT, TSV, CSV, JSONL };
+
+    static constexpr std::size_t BUFFER_SIZE = 1 << 20;
+
+private:
+    static constexpr std::size_t FIXED_ROW_SIZE = 160;  // 除主机名之外的字段和分隔符的上限
+
+    Format format;
+    std::FILE* out;
+    std::mutex mutex;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+    bool failed = false;
+
+    bool writeBuffer();
+    char* appendHostname(char* cursor, std::string_view hostname) const;
+
+public:
+    ResultWriter(Format format, std::FILE* out);
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    // 格式名：text、tsv、csv或jsonl
+    static std::optional<Format> parseFormat(std::string_view name);
+
+    // 追加一个结果 (IP, 主机名, 成功, 延迟, 时间戳)，缓冲区将满时先写出已有的内容
+    void write(const std::tuple<std::string, std::string, bool, short, std::string>& result);
+
+    // 写出缓冲区中的全部结果并刷新输出流；此前有写出失败时返回false
+    bool flush();
+};
+
+#endif // RESULT_OUTPUT_H
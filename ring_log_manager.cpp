@@ -0,0 +1,861 @@
+#include "ring_log_manager.h"
+#include "segment_store.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr char RING_LOG_MAGIC[4] = {'M', 'P', 'R', 'L'};
+constexpr std::uint32_t RING_LOG_VERSION = 1;
+constexpr std::size_t PAGE_SIZE = 4096;
+constexpr std::uint32_t NO_HOST = std::numeric_limits<std::uint32_t>::max();
+
+static_assert(sizeof(RingLogManager::Header) <= PAGE_SIZE);
+static_assert(sizeof(RingLogManager::HostEntry) == 128);
+static_assert(sizeof(RingLogManager::SampleRecord) == 16);
+static_assert(sizeof(RingLogManager::RecoveryRecord) == 16);
+
+std::size_t alignToPage(std::size_t bytes) {
+    return (bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+
+// 各区域在文件中的偏移，均按页对齐，使一轮写入只弄脏新记录所在的页
+struct Layout {
+    std::size_t hostsOffset;
+    std::size_t recoveriesOffset;
+    std::size_t samplesOffset;
+    std::size_t totalSize;
+};
+
+Layout computeLayout(std::uint32_t hostCapacity, std::uint32_t recoveryCapacity, std::uint64_t sampleCapacity) {
+    Layout layout;
+    layout.hostsOffset = PAGE_SIZE;
+    layout.recoveriesOffset = layout.hostsOffset + alignToPage(hostCapacity * sizeof(RingLogManager::HostEntry));
+    layout.samplesOffset = layout.recoveriesOffset + alignToPage(recoveryCapacity * sizeof(RingLogManager::RecoveryRecord));
+    layout.totalSize = layout.samplesOffset + alignToPage(sampleCapacity * sizeof(RingLogManager::SampleRecord));
+    return layout;
+}
+
+// 当前本地时间的民用时间秒数，与样本时间戳采用相同的表示
+std::uint32_t localNow() {
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&now, &local);
+    return static_cast<std::uint32_t>(now + local.tm_gmtoff);
+}
+
+std::string formatTime(std::uint32_t seconds) {
+    return SegmentStore::formatTimestamp(seconds);
+}
+
+void copyField(char* destination, std::size_t size, const std::string& value) {
+    std::memset(destination, 0, size);
+    std::memcpy(destination, value.data(), std::min(value.size(), size - 1));
+}
+
+}  // namespace
+
+RingLogManager::RingLogManager(const std::string& path) : path(path) {}
+
+RingLogManager::~RingLogManager() {
+    if (inTransaction) {
+        rollbackTransaction();
+    }
+    unmapFile();
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void RingLogManager::setSampleCapacity(std::uint64_t capacity) {
+    sampleCapacity = std::max<std::uint64_t>(capacity, 1);
+}
+
+bool RingLogManager::initialize() {
+    if (base) {
+        return true;
+    }
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Can't open ring log " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // 同一时间只允许一个进程访问日志文件
+    if (flock(fd, LOCK_EX) != 0) {
+        std::cerr << "Can't lock ring log " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Can't stat ring log " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (st.st_size == 0 && !createFile()) {
+        return false;
+    }
+    if (!mapFile()) {
+        return false;
+    }
+
+    // 文件头计数落后于主机表说明上次提交在同步文件头之前中断，按样本环重建主机索引
+    bool torn = false;
+    for (std::uint32_t i = 0; i < header->hostCapacity; ++i) {
+        if (hosts[i].inUse && hosts[i].lastSample > header->sampleCount) {
+            torn = true;
+            break;
+        }
+    }
+    if (torn) {
+        std::cerr << "Ring log was not closed cleanly, rebuilding host index" << std::endl;
+        rebuildHostIndex();
+    }
+
+    hostIds.clear();
+    for (std::uint32_t i = 0; i < header->hostCapacity; ++i) {
+        if (hosts[i].inUse) {
+            hostIds[hosts[i].ip] = i;
+        }
+    }
+
+    pendingSampleCount = header->sampleCount;
+    pendingRecoveryCount = header->recoveryCount;
+    return true;
+}
+
+// 新建日志文件：先写入全零的数据区，最后写入文件头
+bool RingLogManager::createFile() {
+    Layout layout = computeLayout(DEFAULT_HOST_CAPACITY, DEFAULT_RECOVERY_CAPACITY, sampleCapacity);
+    if (ftruncate(fd, static_cast<off_t>(layout.totalSize)) != 0) {
+        std::cerr << "Can't allocate ring log " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    Header initial{};
+    std::memcpy(initial.magic, RING_LOG_MAGIC, sizeof(initial.magic));
+    initial.version = RING_LOG_VERSION;
+    initial.hostCapacity = DEFAULT_HOST_CAPACITY;
+    initial.recoveryCapacity = DEFAULT_RECOVERY_CAPACITY;
+    initial.sampleCapacity = sampleCapacity;
+    if (pwrite(fd, &initial, sizeof(initial), 0) != static_cast<ssize_t>(sizeof(initial)) || fsync(fd) != 0) {
+        std::cerr << "Can't write ring log header " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RingLogManager::mapFile() {
+    Header fileHeader;
+    if (pread(fd, &fileHeader, sizeof(fileHeader), 0) != static_cast<ssize_t>(sizeof(fileHeader)) ||
+        std::memcmp(fileHeader.magic, RING_LOG_MAGIC, sizeof(fileHeader.magic)) != 0) {
+        std::cerr << "Not a ring log file: " << path << std::endl;
+        return false;
+    }
+    if (fileHeader.version != RING_LOG_VERSION) {
+        std::cerr << "Unsupported ring log version " << fileHeader.version << " in " << path << std::endl;
+        return false;
+    }
+    if (fileHeader.hostCapacity == 0 || fileHeader.hostCapacity > std::numeric_limits<std::uint16_t>::max() ||
+        fileHeader.recoveryCapacity == 0 || fileHeader.sampleCapacity == 0) {
+        std::cerr << "Corrupt ring log header in " << path << std::endl;
+        return false;
+    }
+
+    Layout layout = computeLayout(fileHeader.hostCapacity, fileHeader.recoveryCapacity, fileHeader.sampleCapacity);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < layout.totalSize) {
+        std::cerr << "Ring log " << path << " is truncated" << std::endl;
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, layout.totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Can't map ring log " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    base = static_cast<unsigned char*>(mapped);
+    mappedSize = layout.totalSize;
+    header = reinterpret_cast<Header*>(base);
+    hosts = reinterpret_cast<HostEntry*>(base + layout.hostsOffset);
+    recoveries = reinterpret_cast<RecoveryRecord*>(base + layout.recoveriesOffset);
+    samples = reinterpret_cast<SampleRecord*>(base + layout.samplesOffset);
+    sampleCapacity = header->sampleCapacity;
+    return true;
+}
+
+void RingLogManager::unmapFile() {
+    if (base) {
+        munmap(base, mappedSize);
+        base = nullptr;
+        header = nullptr;
+        hosts = nullptr;
+        recoveries = nullptr;
+        samples = nullptr;
+        mappedSize = 0;
+    }
+}
+
+bool RingLogManager::syncHeader() {
+    if (msync(base, PAGE_SIZE, MS_SYNC) != 0) {
+        std::cerr << "Failed to sync ring log header: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 按样本环中仍有效的记录重新计算每台主机的最新样本位置
+void RingLogManager::rebuildHostIndex() {
+    for (std::uint32_t i = 0; i < header->hostCapacity; ++i) {
+        hosts[i].lastSample = 0;
+    }
+    for (std::uint64_t sequence = firstValidSample(); sequence < header->sampleCount; ++sequence) {
+        const SampleRecord* record = sampleAt(sequence);
+        if (record && record->hostId < header->hostCapacity && hosts[record->hostId].inUse) {
+            hosts[record->hostId].lastSample = sequence + 1;
+        }
+    }
+    msync(base, mappedSize, MS_SYNC);
+}
+
+std::uint64_t RingLogManager::firstValidSample() const {
+    std::uint64_t wrapped = header->sampleCount > header->sampleCapacity ? header->sampleCount - header->sampleCapacity : 0;
+    return std::max(wrapped, header->oldestSample);
+}
+
+std::uint64_t RingLogManager::firstValidRecovery() const {
+    std::uint64_t wrapped = header->recoveryCount > header->recoveryCapacity ? header->recoveryCount - header->recoveryCapacity : 0;
+    return std::max(wrapped, header->oldestRecovery);
+}
+
+// 取出指定序号的样本；槽位已被覆盖或写入未完成时返回空
+const RingLogManager::SampleRecord* RingLogManager::sampleAt(std::uint64_t sequence) const {
+    const SampleRecord& record = samples[sequence % header->sampleCapacity];
+    if (record.lap != static_cast<std::uint16_t>(sequence / header->sampleCapacity)) {
+        return nullptr;
+    }
+    return &record;
+}
+
+bool RingLogManager::beginTransaction() {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    if (inTransaction) {
+        std::cerr << "Failed to begin transaction: a transaction is already active" << std::endl;
+        return false;
+    }
+    inTransaction = true;
+    pendingSampleCount = header->sampleCount;
+    pendingRecoveryCount = header->recoveryCount;
+    hostUndo.clear();
+    sampleUndo.clear();
+    recoveryUndo.clear();
+    return true;
+}
+
+// 提交：先把新记录和主机表落盘，再更新并同步文件头，文件头中的计数决定哪些记录可见
+bool RingLogManager::commitTransaction() {
+    if (!inTransaction) {
+        std::cerr << "Failed to commit transaction: no active transaction" << std::endl;
+        return false;
+    }
+    if (msync(base, mappedSize, MS_SYNC) != 0) {
+        std::cerr << "Failed to sync ring log: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    header->sampleCount = pendingSampleCount;
+    header->recoveryCount = pendingRecoveryCount;
+    if (!syncHeader()) {
+        return false;
+    }
+    inTransaction = false;
+    hostUndo.clear();
+    sampleUndo.clear();
+    recoveryUndo.clear();
+    return true;
+}
+
+// 回滚：恢复被修改的主机表项和被覆盖的槽位；进程在提交前退出时，
+// 新记录因文件头计数未推进而不可见，被覆盖的最旧记录通过lap校验失效
+bool RingLogManager::rollbackTransaction() {
+    if (!inTransaction) {
+        return true;
+    }
+    for (auto it = sampleUndo.rbegin(); it != sampleUndo.rend(); ++it) {
+        samples[it->first] = it->second;
+    }
+    for (auto it = recoveryUndo.rbegin(); it != recoveryUndo.rend(); ++it) {
+        recoveries[it->first] = it->second;
+    }
+    sampleUndo.clear();
+    recoveryUndo.clear();
+    for (const auto& [hostId, original] : hostUndo) {
+        hosts[hostId] = original;
+    }
+    hostUndo.clear();
+    hostIds.clear();
+    for (std::uint32_t i = 0; i < header->hostCapacity; ++i) {
+        if (hosts[i].inUse) {
+            hostIds[hosts[i].ip] = i;
+        }
+    }
+    pendingSampleCount = header->sampleCount;
+    pendingRecoveryCount = header->recoveryCount;
+    inTransaction = false;
+    return true;
+}
+
+bool RingLogManager::prepareWrite(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>&) {
+    return true;
+}
+
+bool RingLogManager::reclaimFreePages(int) {
+    return true;
+}
+
+bool RingLogManager::beginBulkLoad() {
+    return true;
+}
+
+bool RingLogManager::endBulkLoad() {
+    return true;
+}
+
+// 事务中修改主机表项前保存其原始内容
+RingLogManager::HostEntry& RingLogManager::modifyHost(std::uint32_t hostId) {
+    hostUndo.try_emplace(hostId, hosts[hostId]);
+    return hosts[hostId];
+}
+
+std::uint32_t RingLogManager::findOrCreateHost(const std::string& ip, const std::string& hostname) {
+    auto it = hostIds.find(ip);
+    if (it != hostIds.end()) {
+        HostEntry& entry = hosts[it->second];
+        if (!hostname.empty() && hostname.compare(0, sizeof(entry.hostname) - 1, entry.hostname) != 0) {
+            copyField(modifyHost(it->second).hostname, sizeof(entry.hostname), hostname);
+        }
+        return it->second;
+    }
+
+    if (ip.empty() || ip.size() >= sizeof(HostEntry::ip)) {
+        std::cerr << "Invalid IP address: " << ip << std::endl;
+        return NO_HOST;
+    }
+
+    for (std::uint32_t i = 0; i < header->hostCapacity; ++i) {
+        if (!hosts[i].inUse) {
+            HostEntry& entry = modifyHost(i);
+            std::memset(&entry, 0, sizeof(entry));
+            copyField(entry.ip, sizeof(entry.ip), ip);
+            copyField(entry.hostname, sizeof(entry.hostname), hostname);
+            entry.inUse = 1;
+            hostIds[ip] = i;
+            return i;
+        }
+    }
+
+    std::cerr << "Ring log host table is full (" << header->hostCapacity << " hosts), cannot add " << ip << std::endl;
+    return NO_HOST;
+}
+
+bool RingLogManager::appendSample(std::uint32_t hostId, std::uint32_t time, short delay, bool success) {
+    std::uint64_t sequence = pendingSampleCount;
+
+    // 本轮写入的样本覆盖了上一条同主机样本时不再链接到它
+    HostEntry& entry = modifyHost(hostId);
+    std::uint64_t distance = entry.lastSample ? sequence - (entry.lastSample - 1) : 0;
+    if (distance >= header->sampleCapacity) {
+        distance = 0;
+    }
+
+    std::uint64_t slot = sequence % header->sampleCapacity;
+    sampleUndo.emplace_back(slot, samples[slot]);
+    SampleRecord& record = samples[slot];
+    record.time = time;
+    record.prevDistance = static_cast<std::uint32_t>(distance);
+    record.hostId = static_cast<std::uint16_t>(hostId);
+    record.lap = static_cast<std::uint16_t>(sequence / header->sampleCapacity);
+    record.delay = delay;
+    record.success = success ? 1 : 0;
+    record.reserved = 0;
+
+    entry.lastSample = sequence + 1;
+    pendingSampleCount = sequence + 1;
+    return true;
+}
+
+bool RingLogManager::insertPingResult(const std::string& ip, const std::string& hostname, short delay, bool success, const std::string& timestamp) {
+    std::vector<std::tuple<std::string, std::string, short, bool, std::string>> results;
+    results.emplace_back(ip, hostname, delay, success, timestamp);
+    return insertPingResults(results);
+}
+
+bool RingLogManager::insertPingResults(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+
+    if (results.empty()) {
+        return true;
+    }
+
+    // 一批样本超过环容量时会覆盖本批次自身的样本
+    if (results.size() > header->sampleCapacity) {
+        std::cerr << "Batch of " << results.size() << " samples exceeds ring log capacity " << header->sampleCapacity << std::endl;
+        return false;
+    }
+
+    bool ownsTransaction = !inTransaction;
+    if (ownsTransaction && !beginTransaction()) {
+        return false;
+    }
+
+    bool success = true;
+    for (const auto& [ip, hostname, delay, successFlag, timestamp] : results) {
+        auto seconds = SegmentStore::parseTimestamp(timestamp);
+        if (!seconds || *seconds < 0 || *seconds > std::numeric_limits<std::uint32_t>::max()) {
+            std::cerr << "Invalid timestamp for IP " << ip << ": " << timestamp << std::endl;
+            success = false;
+            break;
+        }
+        std::uint32_t hostId = findOrCreateHost(ip, hostname);
+        if (hostId == NO_HOST) {
+            success = false;
+            break;
+        }
+        appendSample(hostId, static_cast<std::uint32_t>(*seconds), delay, successFlag);
+    }
+
+    if (ownsTransaction) {
+        if (success) {
+            success = commitTransaction();
+        } else {
+            rollbackTransaction();
+        }
+    }
+    return success;
+}
+
+void RingLogManager::queryIPStatistics(const std::string& ip, const std::string& since, const std::string& until, bool showRecent) {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return;
+    }
+
+    std::int64_t sinceTime;
+    std::int64_t untilTime;
+    if (!SegmentStore::parseTimeRange(since, until, sinceTime, untilTime)) {
+        return;
+    }
+
+    auto it = hostIds.find(ip);
+    std::string hostname = it != hostIds.end() ? hosts[it->second].hostname : "";
+
+    std::cout << "Statistics for IP: " << ip << " (" << hostname << ")" << std::endl;
+    if (!since.empty() || !until.empty()) {
+        std::cout << "Time range: [" << (since.empty() ? "-" : since) << ", " << (until.empty() ? "-" : until) << ")" << std::endl;
+    }
+    std::cout << "=========================================================" << std::endl;
+
+    SegmentStore::Summary stats;
+    std::vector<std::tuple<std::string, int, int>> recentRecords;  // (timestamp, delay, success)
+
+    // 沿主机索引从最新样本向前遍历，样本按时间追加，早于since即可停止
+    if (it != hostIds.end() && hosts[it->second].lastSample > 0) {
+        std::uint32_t hostId = it->second;
+        std::uint64_t first = firstValidSample();
+        std::uint64_t sequence = hosts[hostId].lastSample - 1;
+        while (sequence >= first && sequence < header->sampleCount) {
+            const SampleRecord* record = sampleAt(sequence);
+            if (!record || record->hostId != hostId || record->time < sinceTime) {
+                break;
+            }
+            if (record->time < untilTime) {
+                stats.add({record->time, record->delay, record->success != 0});
+                if (recentRecords.size() < 10) {
+                    recentRecords.emplace_back(formatTime(record->time), record->delay, record->success);
+                }
+            }
+            if (record->prevDistance == 0 || record->prevDistance > sequence) {
+                break;
+            }
+            sequence -= record->prevDistance;
+        }
+    }
+
+    long long totalRecords = stats.total;
+    long long successCount = stats.successes;
+
+    std::cout << "Total ping records: " << totalRecords << std::endl;
+
+    if (totalRecords == 0) {
+        std::cout << "No ping records found for this IP." << std::endl;
+        return;
+    }
+
+    long long failureCount = totalRecords - successCount;
+    double successRate = (double)successCount / totalRecords * 100;
+    double failureRate = (double)failureCount / totalRecords * 100;
+    double avgDelay = (successCount > 0) ? stats.delaySum / successCount : 0;
+
+    std::cout << "Successful pings: " << successCount << std::endl;
+    std::cout << "Failed pings: " << failureCount << std::endl;
+    std::cout << "Success rate: " << std::fixed << std::setprecision(2) << successRate << "%" << std::endl;
+    std::cout << "Failure rate: " << std::fixed << std::setprecision(2) << failureRate << "%" << std::endl;
+    std::cout << "Average delay (successful pings): " << std::fixed << std::setprecision(2) << avgDelay << "ms" << std::endl;
+    std::cout << "Maximum delay (successful pings): " << stats.maxDelay << "ms" << std::endl;
+    std::cout << "Minimum delay (successful pings): " << stats.minDelay << "ms" << std::endl;
+    if (!showRecent) {
+        return;
+    }
+
+    // 显示最近的10条记录
+    std::cout << "\nRecent ping records (last 10):" << std::endl;
+    std::cout << "Timestamp           \tDelay\tStatus" << std::endl;
+    std::cout << "--------------------------------------------------------" << std::endl;
+
+    for (const auto& [timestamp, delay, success] : recentRecords) {
+        std::cout << timestamp << "\t"
+                  << delay << "ms\t"
+                  << (success ? "Success" : "Failed") << std::endl;
+    }
+}
+
+// 清理只推进文件头中的保留起点：样本和恢复记录都按时间追加，二分查找第一条不早于截止时间的记录
+void RingLogManager::cleanupOldData(int days) {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return;
+    }
+
+    std::cout << "Cleaning up data older than " << days << " days..." << std::endl;
+    std::int64_t cutoff = static_cast<std::int64_t>(localNow()) - static_cast<std::int64_t>(days) * 86400;
+
+    std::uint64_t low = firstValidSample();
+    std::uint64_t high = header->sampleCount;
+    std::uint64_t previousOldest = low;
+    while (low < high) {
+        std::uint64_t middle = low + (high - low) / 2;
+        const SampleRecord* record = sampleAt(middle);
+        if (!record || record->time < cutoff) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    header->oldestSample = low;
+
+    std::uint64_t recoveryLow = firstValidRecovery();
+    std::uint64_t recoveryHigh = header->recoveryCount;
+    std::uint64_t previousOldestRecovery = recoveryLow;
+    while (recoveryLow < recoveryHigh) {
+        std::uint64_t middle = recoveryLow + (recoveryHigh - recoveryLow) / 2;
+        const RecoveryRecord& record = recoveries[middle % header->recoveryCapacity];
+        if (record.id != middle + 1 || record.recoveryTime < cutoff) {
+            recoveryLow = middle + 1;
+        } else {
+            recoveryHigh = middle;
+        }
+    }
+    header->oldestRecovery = recoveryLow;
+
+    // 没有剩余样本、没有告警、也没有被恢复记录引用的主机从主机表中移除
+    std::vector<bool> referenced(header->hostCapacity, false);
+    for (std::uint64_t sequence = firstValidRecovery(); sequence < header->recoveryCount; ++sequence) {
+        const RecoveryRecord& record = recoveries[sequence % header->recoveryCapacity];
+        if (record.id == sequence + 1 && record.hostId < header->hostCapacity) {
+            referenced[record.hostId] = true;
+        }
+    }
+    int deletedHosts = 0;
+    for (std::uint32_t i = 0; i < header->hostCapacity; ++i) {
+        HostEntry& entry = hosts[i];
+        if (!entry.inUse || entry.alertSince != 0 || referenced[i] ||
+            (entry.lastSample > 0 && entry.lastSample - 1 >= header->oldestSample)) {
+            continue;
+        }
+        hostIds.erase(entry.ip);
+        std::memset(&entry, 0, sizeof(entry));
+        deletedHosts++;
+    }
+
+    if (msync(base, mappedSize, MS_SYNC) != 0) {
+        std::cerr << "Failed to sync ring log: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    if (deletedHosts > 0) {
+        std::cout << "Deleted " << deletedHosts << " unused host records" << std::endl;
+    }
+    if (header->oldestRecovery > previousOldestRecovery) {
+        std::cout << "Released " << (header->oldestRecovery - previousOldestRecovery) << " old recovery records" << std::endl;
+    }
+    std::cout << "Total deleted records: " << (header->oldestSample - previousOldest) << std::endl;
+    std::cout << "Cleanup completed." << std::endl;
+}
+
+void RingLogManager::tierColdData(int) {
+    std::cout << "The ring log backend keeps no cold tier: samples expire when the ring wraps or through -C." << std::endl;
+}
+
+void RingLogManager::printDatabaseStats() {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return;
+    }
+
+    std::uint64_t first = firstValidSample();
+    std::uint64_t stored = header->sampleCount - first;
+    double usage = (double)stored / header->sampleCapacity * 100;
+    std::size_t hostCount = hostIds.size();
+    std::size_t alertCount = std::count_if(hostIds.begin(), hostIds.end(),
+                                           [&](const auto& entry) { return hosts[entry.second].alertSince != 0; });
+
+    std::cout << "Database statistics: " << path << std::endl;
+    std::cout << "=========================================================" << std::endl;
+    std::cout << "Storage: ring log (" << sizeof(SampleRecord) << " bytes per sample)" << std::endl;
+    std::cout << "File size: " << mappedSize << " bytes" << std::endl;
+    std::cout << "Sample capacity: " << header->sampleCapacity << std::endl;
+    std::cout << "Stored samples: " << stored << " (" << std::fixed << std::setprecision(2) << usage << "%)" << std::endl;
+    std::cout << "Samples written: " << header->sampleCount << std::endl;
+    if (stored > 0) {
+        const SampleRecord* oldest = sampleAt(first);
+        const SampleRecord* newest = sampleAt(header->sampleCount - 1);
+        if (oldest && newest) {
+            std::cout << "Time span: " << formatTime(oldest->time) << " - " << formatTime(newest->time) << std::endl;
+        }
+    }
+    std::cout << "Hosts: " << hostCount << " / " << header->hostCapacity << std::endl;
+    std::cout << "Active alerts: " << alertCount << std::endl;
+    std::cout << "Recovery records: " << (header->recoveryCount - firstValidRecovery()) << " / " << header->recoveryCapacity << std::endl;
+}
+
+std::map<std::string, std::string> RingLogManager::getAllHosts() {
+    std::map<std::string, std::string> result;
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return result;
+    }
+    for (const auto& [ip, hostId] : hostIds) {
+        result[ip] = hosts[hostId].hostname;
+    }
+    return result;
+}
+
+// 告警状态直接保存在主机表中，无需额外加载
+bool RingLogManager::loadAlertState() {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RingLogManager::isAlertActive(const std::string& ip) const {
+    auto it = hostIds.find(ip);
+    return it != hostIds.end() && hosts[it->second].alertSince != 0;
+}
+
+bool RingLogManager::applyAlertTransitions(const std::vector<std::pair<std::string, std::string>>& newlyDown,
+                                           const std::vector<std::string>& newlyUp) {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+
+    if (newlyDown.empty() && newlyUp.empty()) {
+        return true;
+    }
+
+    bool ownsTransaction = !inTransaction;
+    if (ownsTransaction && !beginTransaction()) {
+        return false;
+    }
+
+    std::uint32_t now = localNow();
+    bool success = true;
+
+    // 新出现的告警
+    for (const auto& [ip, hostname] : newlyDown) {
+        std::uint32_t hostId = findOrCreateHost(ip, hostname);
+        if (hostId == NO_HOST) {
+            success = false;
+            break;
+        }
+        if (hosts[hostId].alertSince == 0) {
+            modifyHost(hostId).alertSince = now;
+        }
+    }
+
+    // 已恢复的主机：写入恢复记录并清除告警
+    for (const auto& ip : newlyUp) {
+        if (!success) {
+            break;
+        }
+        auto it = hostIds.find(ip);
+        if (it == hostIds.end() || hosts[it->second].alertSince == 0) {
+            continue;
+        }
+        std::uint64_t sequence = pendingRecoveryCount++;
+        std::uint64_t slot = sequence % header->recoveryCapacity;
+        recoveryUndo.emplace_back(slot, recoveries[slot]);
+        RecoveryRecord& record = recoveries[slot];
+        record.id = static_cast<std::uint32_t>(sequence + 1);
+        record.hostId = it->second;
+        record.alertTime = hosts[it->second].alertSince;
+        record.recoveryTime = now;
+        modifyHost(it->second).alertSince = 0;
+    }
+
+    if (ownsTransaction) {
+        if (success) {
+            success = commitTransaction();
+        } else {
+            rollbackTransaction();
+        }
+    }
+    return success;
+}
+
+// 告警保存在主机表中，数量不超过主机表容量；按(告警时间, IP)排序后逐行回调
+bool RingLogManager::forEachActiveAlert(int days, const std::string& afterTime, const std::string& afterIP, long long limit,
+                                        const AlertVisitor& visit) {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+    std::optional<std::int64_t> afterSince;
+    if (!afterTime.empty() && !(afterSince = SegmentStore::parseTimestamp(afterTime))) {
+        std::cerr << "Invalid alert page key time: " << afterTime << std::endl;
+        return false;
+    }
+
+    std::int64_t cutoff = days >= 0 ? static_cast<std::int64_t>(localNow()) - static_cast<std::int64_t>(days) * 86400 : 0;
+    std::vector<std::uint32_t> alerting;
+    for (std::uint32_t i = 0; i < header->hostCapacity; ++i) {
+        if (hosts[i].inUse && hosts[i].alertSince != 0 && hosts[i].alertSince >= cutoff) {
+            alerting.push_back(i);
+        }
+    }
+    auto key = [&](std::uint32_t hostId) {
+        return std::make_tuple(static_cast<std::int64_t>(hosts[hostId].alertSince), std::string_view(hosts[hostId].ip));
+    };
+    std::sort(alerting.begin(), alerting.end(), [&](std::uint32_t a, std::uint32_t b) { return key(a) < key(b); });
+
+    // 键集分页：从上一页最后一行的(告警时间, IP)之后继续，该告警已解除时也不受影响
+    auto begin = alerting.begin();
+    if (afterSince) {
+        auto start = std::make_tuple(*afterSince, std::string_view(afterIP));
+        begin = std::upper_bound(alerting.begin(), alerting.end(), start,
+                                 [&](const auto& value, std::uint32_t hostId) { return value < key(hostId); });
+    }
+    for (auto it = begin; it != alerting.end() && (limit < 0 || it - begin < limit); ++it) {
+        if (!visit(hosts[*it].ip, hosts[*it].hostname, formatTime(hosts[*it].alertSince))) {
+            break;
+        }
+    }
+    return true;
+}
+
+// 恢复记录按序号追加，序号顺序即恢复时间顺序；从afterId之后的序号开始读取
+bool RingLogManager::forEachRecoveryRecord(int days, long long afterId, long long limit, const RecoveryVisitor& visit) {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+
+    std::int64_t cutoff = days >= 0 ? static_cast<std::int64_t>(localNow()) - static_cast<std::int64_t>(days) * 86400 : 0;
+    std::uint64_t first = std::max(firstValidRecovery(), static_cast<std::uint64_t>(std::max(afterId, 0LL)));
+    long long visited = 0;
+    for (std::uint64_t sequence = first; sequence < header->recoveryCount && (limit < 0 || visited < limit); ++sequence) {
+        const RecoveryRecord& record = recoveries[sequence % header->recoveryCapacity];
+        if (record.id != sequence + 1 || record.recoveryTime < cutoff || record.hostId >= header->hostCapacity) {
+            continue;
+        }
+        const HostEntry& entry = hosts[record.hostId];
+        visited++;
+        if (!visit(record.id, entry.ip, entry.hostname, formatTime(record.alertTime), formatTime(record.recoveryTime))) {
+            break;
+        }
+    }
+    return true;
+}
+
+std::vector<std::tuple<std::string, std::string, std::string>> RingLogManager::getActiveAlerts(int days) {
+    std::vector<std::tuple<std::string, std::string, std::string>> alerts;
+    forEachActiveAlert(days, "", "", -1, [&](std::string_view ip, std::string_view hostname, std::string_view createdTime) {
+        alerts.emplace_back(ip, hostname, createdTime);
+        return true;
+    });
+    return alerts;
+}
+
+std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> RingLogManager::getRecoveryRecords(int days) {
+    std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> records;
+    forEachRecoveryRecord(days, 0, -1, [&](long long id, std::string_view ip, std::string_view hostname,
+                                           std::string_view alertTime, std::string_view recoveryTime) {
+        records.emplace_back(static_cast<int>(id), ip, hostname, alertTime, recoveryTime);
+        return true;
+    });
+    return records;
+}
+
+// 主机索引只能倒序遍历：先沿索引收集范围内的样本序号，再按时间顺序回调
+bool RingLogManager::forEachSample(const std::string& ip, const std::string& since, const std::string& until,
+                                   const std::function<bool(const SegmentStore::Sample&)>& visit) {
+    if (!base) {
+        std::cerr << "Database not initialized" << std::endl;
+        return false;
+    }
+
+    auto it = hostIds.find(ip);
+    if (it == hostIds.end() || hosts[it->second].lastSample == 0) {
+        return true;
+    }
+
+    std::int64_t sinceTime;
+    std::int64_t untilTime;
+    if (!SegmentStore::parseTimeRange(since, until, sinceTime, untilTime)) {
+        return false;
+    }
+
+    std::uint32_t hostId = it->second;
+    std::uint64_t first = firstValidSample();
+    std::uint64_t sequence = hosts[hostId].lastSample - 1;
+    std::vector<std::uint64_t> sequences;
+    while (sequence >= first && sequence < header->sampleCount) {
+        const SampleRecord* record = sampleAt(sequence);
+        if (!record || record->hostId != hostId || record->time < sinceTime) {
+            break;
+        }
+        if (record->time < untilTime) {
+            sequences.push_back(sequence);
+        }
+        if (record->prevDistance == 0 || record->prevDistance > sequence) {
+            break;
+        }
+        sequence -= record->prevDistance;
+    }
+
+    for (auto position = sequences.rbegin(); position != sequences.rend(); ++position) {
+        const SampleRecord* record = sampleAt(*position);
+        if (!visit({record->time, record->delay, record->success != 0})) {
+            break;
+        }
+    }
+    return true;
+}
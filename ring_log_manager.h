@@ -0,0 +1,149 @@
+#ifndef RING_LOG_MANAGER_H
+#define RING_LOG_MANAGER_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <vector>
+#include <tuple>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "segment_store.h"
+
+// 环形日志存储后端：单个内存映射文件，包含文件头、主机表、恢复记录环和样本环
+// 样本为16字节的定长记录，只追加写入，写满后覆盖最旧的记录，因此保留期由容量决定，从不执行DELETE
+// 每条样本记录保存同一主机上一条样本的距离，主机表保存每台主机最新样本的位置，构成按主机倒序遍历的索引
+// 面向嵌入式和边缘设备：每轮只写入新记录所在的页和文件头，没有B树和日志带来的写放大
+class RingLogManager {
+public:
+    // 新建日志文件时的默认容量
+    static constexpr std::uint64_t DEFAULT_SAMPLE_CAPACITY = 1 << 20;  // 16 MB样本环
+    static constexpr std::uint32_t DEFAULT_HOST_CAPACITY = 1024;
+    static constexpr std::uint32_t DEFAULT_RECOVERY_CAPACITY = 1 << 16;
+
+    // 逐行查询的回调：(IP, 主机名, 告警时间) 和 (ID, IP, 主机名, 告警时间, 恢复时间)
+    using AlertVisitor = std::function<bool(std::string_view, std::string_view, std::string_view)>;
+    using RecoveryVisitor = std::function<bool(long long, std::string_view, std::string_view, std::string_view, std::string_view)>;
+
+#pragma pack(push, 1)
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t hostCapacity;
+        std::uint32_t recoveryCapacity;
+        std::uint64_t sampleCapacity;
+        std::uint64_t sampleCount;    // 已写入的样本总数（下一条样本的序号）
+        std::uint64_t oldestSample;   // 清理后仍保留的最旧样本序号
+        std::uint64_t recoveryCount;  // 已写入的恢复记录总数
+        std::uint64_t oldestRecovery;
+    };
+
+    struct HostEntry {
+        char ip[48];
+        char hostname[64];
+        std::uint64_t lastSample;  // 最新样本序号+1，0表示没有样本
+        std::uint32_t alertSince;  // 告警开始时间，0表示没有告警
+        std::uint32_t inUse;
+    };
+
+    struct SampleRecord {
+        std::uint32_t time;          // 本地时间的民用时间秒数
+        std::uint32_t prevDistance;  // 与同一主机上一条样本的序号差，0表示没有
+        std::uint16_t hostId;
+        std::uint16_t lap;           // 序号/容量的低16位，用于识别被覆盖或未提交的槽位
+        std::int16_t delay;
+        std::uint8_t success;
+        std::uint8_t reserved;
+    };
+
+    struct RecoveryRecord {
+        std::uint32_t id;  // 序号+1，与槽位不符表示记录无效
+        std::uint32_t hostId;
+        std::uint32_t alertTime;
+        std::uint32_t recoveryTime;
+    };
+#pragma pack(pop)
+
+private:
+    std::string path;
+    std::uint64_t sampleCapacity = DEFAULT_SAMPLE_CAPACITY;
+    int fd = -1;
+    unsigned char* base = nullptr;
+    std::size_t mappedSize = 0;
+    Header* header = nullptr;
+    HostEntry* hosts = nullptr;
+    RecoveryRecord* recoveries = nullptr;
+    SampleRecord* samples = nullptr;
+    std::unordered_map<std::string, std::uint32_t> hostIds;  // ip -> 主机表下标
+
+    // 事务：新记录先写入槽位，提交时同步数据页后再更新文件头中的计数
+    bool inTransaction = false;
+    std::uint64_t pendingSampleCount = 0;
+    std::uint64_t pendingRecoveryCount = 0;
+    std::map<std::uint32_t, HostEntry> hostUndo;  // 事务中被修改的主机表项的原始内容
+    std::vector<std::pair<std::uint64_t, SampleRecord>> sampleUndo;  // 事务中被覆盖的样本槽位的原始内容
+    std::vector<std::pair<std::uint64_t, RecoveryRecord>> recoveryUndo;
+
+public:
+    explicit RingLogManager(const std::string& path);
+    ~RingLogManager();
+
+    RingLogManager(const RingLogManager&) = delete;
+    RingLogManager& operator=(const RingLogManager&) = delete;
+
+    // 新建日志文件时使用的样本容量（已存在的文件保持原容量）
+    void setSampleCapacity(std::uint64_t capacity);
+
+    bool initialize();
+
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+
+    // 与SQL后端保持相同的接口；环形日志无需在事务外准备存储，也没有空闲页需要回收
+    bool prepareWrite(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    bool reclaimFreePages(int maxPages);
+    bool beginBulkLoad();
+    bool endBulkLoad();
+
+    bool insertPingResult(const std::string& ip, const std::string& hostname, short delay, bool success, const std::string& timestamp);
+    bool insertPingResults(const std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+    // 沿主机索引倒序遍历样本；since/until非空时只统计[since, until)范围内的样本
+    // showRecent为false时只输出总计，不输出最近的记录（由运行中的实例提供）
+    void queryIPStatistics(const std::string& ip, const std::string& since = "", const std::string& until = "", bool showRecent = true);
+    // 推进保留起点，不移动也不删除任何数据
+    void cleanupOldData(int days = 30);
+    void tierColdData(int days);
+    void printDatabaseStats();
+    std::map<std::string, std::string> getAllHosts();
+
+    bool loadAlertState();
+    bool isAlertActive(const std::string& ip) const;
+    bool applyAlertTransitions(const std::vector<std::pair<std::string, std::string>>& newlyDown,  // (ip, hostname)
+                               const std::vector<std::string>& newlyUp);
+    std::vector<std::tuple<std::string, std::string, std::string>> getActiveAlerts(int days = -1);
+    std::vector<std::tuple<int, std::string, std::string, std::string, std::string>> getRecoveryRecords(int days = -1);
+    // 与SQL后端相同的游标式查询和键集分页
+    bool forEachActiveAlert(int days, const std::string& afterTime, const std::string& afterIP, long long limit, const AlertVisitor& visit);
+    bool forEachRecoveryRecord(int days, long long afterId, long long limit, const RecoveryVisitor& visit);
+    // 导出：按时间顺序遍历一台主机在[since, until)范围内的样本，visit返回false时停止
+    bool forEachSample(const std::string& ip, const std::string& since, const std::string& until,
+                       const std::function<bool(const SegmentStore::Sample&)>& visit);
+
+private:
+    bool createFile();
+    bool mapFile();
+    void unmapFile();
+    bool syncHeader();
+    void rebuildHostIndex();
+    std::uint64_t firstValidSample() const;
+    std::uint64_t firstValidRecovery() const;
+    const SampleRecord* sampleAt(std::uint64_t sequence) const;
+    std::uint32_t findOrCreateHost(const std::string& ip, const std::string& hostname);
+    HostEntry& modifyHost(std::uint32_t hostId);
+    bool appendSample(std::uint32_t hostId, std::uint32_t time, short delay, bool success);
+};
+
+#endif // RING_LOG_MANAGER_H
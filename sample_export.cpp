@@ -0,0 +1,578 @@
+#include "sample_export.h"
+#include <iostream>
+#include <print>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+// Arrow IPC和下面的CSV格式化都直接写出内存中的整数表示
+static_assert(std::endian::native == std::endian::little, "Sample export assumes a little-endian host");
+
+void SampleBatch::append(const SegmentStore::Sample& sample) {
+    times.push_back(sample.time);
+    delays.push_back(sample.delay);
+    successes.push_back(sample.success ? 1 : 0);
+}
+
+void SampleBatch::clear() {
+    ip.clear();
+    times.clear();
+    delays.clear();
+    successes.clear();
+}
+
+namespace {
+
+// 把value按固定宽度写成十进制数字，位数不足时补0
+char* writeDigits(char* out, unsigned value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return out + width;
+}
+
+// CSV：ip,timestamp,delay,success，时间戳与数据库中的文本格式相同
+// 每行直接格式化到输出缓冲区；同一天的样本复用日期部分
+class CsvSampleWriter : public SampleWriter {
+private:
+    static constexpr std::size_t BUFFER_SIZE = 1 << 20;
+    static constexpr std::size_t MAX_ROW_SIZE = 128;  // IP最长45字节，其余字段定长
+
+    std::FILE* out;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+    std::int64_t cachedDay = std::numeric_limits<std::int64_t>::min();
+    char datePrefix[11];  // "YYYY-MM-DD "
+
+public:
+    explicit CsvSampleWriter(std::FILE* out) : out(out), buffer(BUFFER_SIZE) {}
+
+    bool begin() override {
+        static constexpr std::string_view HEADER = "ip,timestamp,delay,success\n";
+        std::memcpy(buffer.data(), HEADER.data(), HEADER.size());
+        used = HEADER.size();
+        return true;
+    }
+
+    bool write(const SampleBatch& batch) override {
+        std::size_t ipLength = std::min<std::size_t>(batch.ip.size(), 64);
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            if (used + MAX_ROW_SIZE > buffer.size() && !flush()) {
+                return false;
+            }
+            char* cursor = buffer.data() + used;
+            std::memcpy(cursor, batch.ip.data(), ipLength);
+            cursor += ipLength;
+            *cursor++ = ',';
+            cursor = writeTimestamp(cursor, batch.times[i]);
+            *cursor++ = ',';
+            cursor = std::to_chars(cursor, cursor + 8, batch.delays[i]).ptr;
+            *cursor++ = ',';
+            *cursor++ = batch.successes[i] ? '1' : '0';
+            *cursor++ = '\n';
+            used = static_cast<std::size_t>(cursor - buffer.data());
+        }
+        return true;
+    }
+
+    bool finish() override {
+        return flush() && std::fflush(out) == 0;
+    }
+
+private:
+    bool flush() {
+        if (used > 0 && std::fwrite(buffer.data(), 1, used, out) != used) {
+            return false;
+        }
+        used = 0;
+        return true;
+    }
+
+    char* writeTimestamp(char* cursor, std::int64_t seconds) {
+        std::int64_t day = seconds / 86400 - (seconds % 86400 < 0 ? 1 : 0);
+        auto secondOfDay = static_cast<unsigned>(seconds - day * 86400);
+        if (day != cachedDay) {
+            std::chrono::year_month_day date{std::chrono::sys_days{std::chrono::days{day}}};
+            char* prefix = writeDigits(datePrefix, static_cast<unsigned>(static_cast<int>(date.year())), 4);
+            *prefix++ = '-';
+            prefix = writeDigits(prefix, static_cast<unsigned>(date.month()), 2);
+            *prefix++ = '-';
+            prefix = writeDigits(prefix, static_cast<unsigned>(date.day()), 2);
+            *prefix = ' ';
+            cachedDay = day;
+        }
+        std::memcpy(cursor, datePrefix, sizeof(datePrefix));
+        cursor += sizeof(datePrefix);
+        cursor = writeDigits(cursor, secondOfDay / 3600, 2);
+        *cursor++ = ':';
+        cursor = writeDigits(cursor, secondOfDay / 60 % 60, 2);
+        *cursor++ = ':';
+        return writeDigits(cursor, secondOfDay % 60, 2);
+    }
+};
+
+// 最小的FlatBuffers构造器，只用于写出Arrow IPC的元数据
+// 对象按写出顺序排列：父对象在前，子对象在后，因此引用（uoffset）总是向后指向；
+// 写父对象时先留出引用字段，子对象写好后再用link回填；每个表的vtable紧挨在表之前
+class FlatBuilder {
+public:
+    // 表中的一个字段：size为1、2、4或8字节，引用字段为4字节，值在link时写入
+    struct Field {
+        std::uint16_t id;
+        std::uint8_t size;
+        std::uint64_t value;
+    };
+
+    std::string data = std::string(4, '\0');  // 开头是指向根表的引用
+
+    // 写一个表并返回其位置；fieldPositions按fields的顺序返回每个字段在缓冲区中的位置
+    std::size_t table(const std::vector<Field>& fields, std::vector<std::size_t>* fieldPositions = nullptr) {
+        std::uint16_t slotCount = 0;
+        std::size_t inlineSize = 4;  // 表开头是指向vtable的soffset
+        std::vector<std::size_t> offsets;
+        for (const Field& field : fields) {
+            slotCount = std::max<std::uint16_t>(slotCount, field.id + 1);
+            inlineSize = (inlineSize + field.size - 1) / field.size * field.size;
+            offsets.push_back(inlineSize);
+            inlineSize += field.size;
+        }
+
+        std::vector<std::uint16_t> vtable(2 + slotCount, 0);
+        vtable[0] = static_cast<std::uint16_t>(vtable.size() * sizeof(std::uint16_t));
+        vtable[1] = static_cast<std::uint16_t>(inlineSize);
+        for (std::size_t i = 0; i < fields.size(); i++) {
+            vtable[2 + fields[i].id] = static_cast<std::uint16_t>(offsets[i]);
+        }
+        pad(2);
+        std::size_t vtablePosition = data.size();
+        data.append(reinterpret_cast<const char*>(vtable.data()), vtable.size() * sizeof(std::uint16_t));
+
+        // 表按8字节对齐，表内的字段按各自的大小对齐
+        pad(8);
+        std::size_t tablePosition = data.size();
+        data.resize(tablePosition + inlineSize, '\0');
+        auto vtableDistance = static_cast<std::int32_t>(tablePosition - vtablePosition);
+        std::memcpy(&data[tablePosition], &vtableDistance, sizeof(vtableDistance));
+        for (std::size_t i = 0; i < fields.size(); i++) {
+            std::memcpy(&data[tablePosition + offsets[i]], &fields[i].value, fields[i].size);
+            if (fieldPositions) {
+                fieldPositions->push_back(tablePosition + offsets[i]);
+            }
+        }
+        return tablePosition;
+    }
+
+    std::size_t string(std::string_view text) {
+        pad(4);
+        std::size_t position = data.size();
+        appendScalar(static_cast<std::uint32_t>(text.size()));
+        data.append(text);
+        data.push_back('\0');
+        return position;
+    }
+
+    // 引用数组：第i个元素位于 返回值 + 4 + 4*i，由link回填
+    std::size_t offsetVector(std::size_t count) {
+        pad(4);
+        std::size_t position = data.size();
+        appendScalar(static_cast<std::uint32_t>(count));
+        data.resize(data.size() + count * sizeof(std::uint32_t), '\0');
+        return position;
+    }
+
+    // 结构体数组：长度之后的元素按8字节对齐
+    std::size_t structVector(const void* items, std::size_t count, std::size_t itemSize) {
+        pad(8, 4);
+        std::size_t position = data.size();
+        appendScalar(static_cast<std::uint32_t>(count));
+        if (count > 0) {
+            data.append(static_cast<const char*>(items), count * itemSize);
+        }
+        return position;
+    }
+
+    void link(std::size_t from, std::size_t to) {
+        auto distance = static_cast<std::uint32_t>(to - from);
+        std::memcpy(&data[from], &distance, sizeof(distance));
+    }
+
+    // 根引用指向第一个表；IPC消息要求元数据长度为8的倍数
+    std::string finish(std::size_t root) {
+        link(0, root);
+        pad(8);
+        return std::move(data);
+    }
+
+private:
+    void pad(std::size_t alignment, std::size_t offset = 0) {
+        while ((data.size() + offset) % alignment != 0) {
+            data.push_back('\0');
+        }
+    }
+
+    template<typename T>
+    void appendScalar(T value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+};
+
+// Arrow IPC文件格式（Feather V2），pandas.read_feather、pyarrow和DuckDB可直接读取：
+// 魔数、Schema消息、每批样本一条RecordBatch消息、流结束标记、Footer（记录每条RecordBatch的位置）和魔数
+// 列为 ip utf8、timestamp timestamp[s]（无时区，即本地时间）、delay int16、success bool，都没有空值
+// 每条消息为 0xFFFFFFFF、元数据长度、FlatBuffers元数据、消息体，消息体中的每个缓冲区按8字节对齐
+class ArrowSampleWriter : public SampleWriter {
+private:
+    // Schema.fbs / Message.fbs 中的枚举值和联合类型编号
+    static constexpr std::uint64_t METADATA_V5 = 4;
+    static constexpr std::uint64_t HEADER_SCHEMA = 1;
+    static constexpr std::uint64_t HEADER_RECORD_BATCH = 3;
+    static constexpr std::uint64_t TYPE_INT = 2;
+    static constexpr std::uint64_t TYPE_UTF8 = 5;
+    static constexpr std::uint64_t TYPE_BOOL = 6;
+    static constexpr std::uint64_t TYPE_TIMESTAMP = 10;
+    static constexpr std::uint64_t UNIT_SECOND = 0;
+
+    struct FieldNode {
+        std::int64_t length;
+        std::int64_t nullCount;
+    };
+
+    struct Buffer {
+        std::int64_t offset;
+        std::int64_t length;
+    };
+
+    struct Block {
+        std::int64_t offset;
+        std::int32_t metaDataLength;
+        std::int32_t padding;
+        std::int64_t bodyLength;
+    };
+
+    std::FILE* out;
+    std::uint64_t position = 0;
+    std::vector<Block> blocks;
+    // 每批复用的列缓冲区：字符串偏移、重复的IP文本和按位存放的成功标志
+    std::vector<std::int32_t> ipOffsets;
+    std::string ipData;
+    std::vector<std::uint8_t> successBits;
+
+public:
+    explicit ArrowSampleWriter(std::FILE* out) : out(out) {}
+
+    bool begin() override {
+        static const char MAGIC[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+        if (!writeBytes(MAGIC, sizeof(MAGIC))) {
+            return false;
+        }
+        FlatBuilder builder;
+        std::vector<std::size_t> slots;
+        std::size_t message = builder.table({{0, 2, METADATA_V5}, {1, 1, HEADER_SCHEMA}, {2, 4, 0}, {3, 8, 0}}, &slots);
+        builder.link(slots[2], writeSchema(builder));
+        return writeMessage(builder.finish(message));
+    }
+
+    bool write(const SampleBatch& batch) override {
+        std::size_t rows = batch.size();
+        if (rows == 0) {
+            return true;
+        }
+
+        ipOffsets.resize(rows + 1);
+        ipData.clear();
+        for (std::size_t i = 0; i <= rows; i++) {
+            ipOffsets[i] = static_cast<std::int32_t>(i * batch.ip.size());
+        }
+        for (std::size_t i = 0; i < rows; i++) {
+            ipData.append(batch.ip);
+        }
+        successBits.assign((rows + 7) / 8, 0);
+        for (std::size_t i = 0; i < rows; i++) {
+            successBits[i / 8] |= static_cast<std::uint8_t>((batch.successes[i] ? 1 : 0) << (i % 8));
+        }
+
+        // 每列一个有效位图（没有空值，长度为0）和数据缓冲区，字符串列另有偏移缓冲区
+        std::vector<std::pair<const void*, std::size_t>> bodyParts = {
+            {nullptr, 0}, {ipOffsets.data(), ipOffsets.size() * sizeof(std::int32_t)}, {ipData.data(), ipData.size()},
+            {nullptr, 0}, {batch.times.data(), rows * sizeof(std::int64_t)},
+            {nullptr, 0}, {batch.delays.data(), rows * sizeof(std::int16_t)},
+            {nullptr, 0}, {successBits.data(), successBits.size()},
+        };
+        std::vector<Buffer> buffers;
+        std::int64_t bodyLength = 0;
+        for (const auto& [data, length] : bodyParts) {
+            buffers.push_back({bodyLength, static_cast<std::int64_t>(length)});
+            bodyLength += static_cast<std::int64_t>(padded(length));
+        }
+        std::vector<FieldNode> nodes(4, {static_cast<std::int64_t>(rows), 0});
+
+        FlatBuilder builder;
+        std::vector<std::size_t> messageSlots;
+        std::size_t message = builder.table({{0, 2, METADATA_V5}, {1, 1, HEADER_RECORD_BATCH}, {2, 4, 0},
+                                             {3, 8, static_cast<std::uint64_t>(bodyLength)}}, &messageSlots);
+        std::vector<std::size_t> batchSlots;
+        std::size_t recordBatch = builder.table({{0, 8, rows}, {1, 4, 0}, {2, 4, 0}}, &batchSlots);
+        builder.link(messageSlots[2], recordBatch);
+        builder.link(batchSlots[1], builder.structVector(nodes.data(), nodes.size(), sizeof(FieldNode)));
+        builder.link(batchSlots[2], builder.structVector(buffers.data(), buffers.size(), sizeof(Buffer)));
+        std::string metadata = builder.finish(message);
+
+        Block block{static_cast<std::int64_t>(position), static_cast<std::int32_t>(8 + metadata.size()), 0, bodyLength};
+        if (!writeMessage(metadata)) {
+            return false;
+        }
+        for (const auto& [data, length] : bodyParts) {
+            if (!writeBytes(data, length) || !writePadding(length)) {
+                return false;
+            }
+        }
+        blocks.push_back(block);
+        return true;
+    }
+
+    bool finish() override {
+        // 流结束标记，之后是Footer、Footer长度和魔数
+        static const std::uint32_t END_OF_STREAM[2] = {0xFFFFFFFF, 0};
+        if (!writeBytes(END_OF_STREAM, sizeof(END_OF_STREAM))) {
+            return false;
+        }
+
+        FlatBuilder builder;
+        std::vector<std::size_t> slots;
+        std::size_t footer = builder.table({{0, 2, METADATA_V5}, {1, 4, 0}, {2, 4, 0}, {3, 4, 0}}, &slots);
+        builder.link(slots[1], writeSchema(builder));
+        builder.link(slots[2], builder.structVector(nullptr, 0, sizeof(Block)));
+        builder.link(slots[3], builder.structVector(blocks.data(), blocks.size(), sizeof(Block)));
+        std::string metadata = builder.finish(footer);
+
+        auto footerLength = static_cast<std::int32_t>(metadata.size());
+        return writeBytes(metadata.data(), metadata.size()) &&
+               writeBytes(&footerLength, sizeof(footerLength)) &&
+               writeBytes("ARROW1", 6) &&
+               std::fflush(out) == 0;
+    }
+
+private:
+    static std::size_t padded(std::size_t length) {
+        return (length + 7) / 8 * 8;
+    }
+
+    // Schema表：四个字段，每个字段有名称、类型和空的子字段列表
+    static std::size_t writeSchema(FlatBuilder& builder) {
+        struct Column {
+            const char* name;
+            std::uint64_t typeId;
+            std::vector<FlatBuilder::Field> type;
+        };
+        const Column columns[] = {
+            {"ip", TYPE_UTF8, {}},
+            {"timestamp", TYPE_TIMESTAMP, {{0, 2, UNIT_SECOND}}},
+            {"delay", TYPE_INT, {{0, 4, 16}, {1, 1, 1}}},  // bitWidth, is_signed
+            {"success", TYPE_BOOL, {}},
+        };
+
+        std::vector<std::size_t> schemaSlots;
+        std::size_t schema = builder.table({{1, 4, 0}}, &schemaSlots);
+        std::size_t fields = builder.offsetVector(std::size(columns));
+        builder.link(schemaSlots[0], fields);
+        for (std::size_t i = 0; i < std::size(columns); i++) {
+            // name, nullable, type_type, type, children
+            std::vector<std::size_t> slots;
+            std::size_t field = builder.table({{0, 4, 0}, {1, 1, 0}, {2, 1, columns[i].typeId}, {3, 4, 0}, {5, 4, 0}}, &slots);
+            builder.link(fields + 4 + 4 * i, field);
+            builder.link(slots[0], builder.string(columns[i].name));
+            builder.link(slots[3], builder.table(columns[i].type));
+            builder.link(slots[4], builder.offsetVector(0));
+        }
+        return schema;
+    }
+
+    bool writeMessage(const std::string& metadata) {
+        const std::uint32_t prefix[2] = {0xFFFFFFFF, static_cast<std::uint32_t>(metadata.size())};
+        return writeBytes(prefix, sizeof(prefix)) && writeBytes(metadata.data(), metadata.size());
+    }
+
+    bool writePadding(std::size_t length) {
+        static const char ZEROS[8] = {};
+        return writeBytes(ZEROS, padded(length) - length);
+    }
+
+    bool writeBytes(const void* data, std::size_t length) {
+        if (length > 0 && std::fwrite(data, 1, length, out) != length) {
+            return false;
+        }
+        position += length;
+        return true;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<SampleWriter> SampleWriter::create(const std::string& format, std::FILE* out) {
+    if (format == "csv") {
+        return std::make_unique<CsvSampleWriter>(out);
+    }
+    if (format == "arrow") {
+        return std::make_unique<ArrowSampleWriter>(out);
+    }
+    return nullptr;
+}
+
+SampleExporter::SampleExporter(SampleWriter& writer, std::size_t workers, std::size_t batchSize)
+    : writer(writer), workers(std::max<std::size_t>(workers, 1)), batchSize(std::max<std::size_t>(batchSize, 1)) {}
+
+bool SampleExporter::run(const std::vector<std::string>& hosts, const ReaderFactory& openReader) {
+    stats = Stats{};
+    if (!writer.begin()) {
+        std::println(std::cerr, "Failed to write export header");
+        return false;
+    }
+
+    std::size_t workerCount = std::min(workers, std::max<std::size_t>(hosts.size(), 1));
+    std::size_t queueCapacity = workerCount * 2;
+
+    // 队列、空闲批次和停止标志由mutex保护；写出失败或读取失败后工作线程不再放入新的批次
+    std::mutex mutex;
+    std::condition_variable batchReady;
+    std::condition_variable slotFree;
+    std::deque<std::unique_ptr<SampleBatch>> queue;
+    std::vector<std::unique_ptr<SampleBatch>> spare;
+    std::size_t running = workerCount;
+    bool stopped = false;
+    bool failed = false;
+    std::atomic<std::size_t> nextHost{0};
+    std::atomic<std::uint64_t> hostsRead{0};
+
+    auto stop = [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        failed = true;
+        slotFree.notify_all();
+    };
+
+    auto takeBatch = [&](const std::string& ip) {
+        std::unique_ptr<SampleBatch> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!spare.empty()) {
+                batch = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        if (!batch) {
+            batch = std::make_unique<SampleBatch>();
+            batch->times.reserve(batchSize);
+            batch->delays.reserve(batchSize);
+            batch->successes.reserve(batchSize);
+        }
+        batch->ip = ip;
+        return batch;
+    };
+
+    // 队列满时等待写出线程取走批次
+    auto push = [&](std::unique_ptr<SampleBatch> batch) {
+        std::unique_lock<std::mutex> lock(mutex);
+        slotFree.wait(lock, [&] { return queue.size() < queueCapacity || stopped; });
+        if (stopped) {
+            return false;
+        }
+        queue.push_back(std::move(batch));
+        batchReady.notify_one();
+        return true;
+    };
+
+    auto work = [&] {
+        HostReader reader = openReader();
+        if (!reader) {
+            stop();
+        }
+        while (reader) {
+            std::size_t index = nextHost++;
+            if (index >= hosts.size()) {
+                break;
+            }
+            const std::string& ip = hosts[index];
+            auto batch = takeBatch(ip);
+            bool pushed = true;
+            bool read = reader(ip, [&](const SegmentStore::Sample& sample) {
+                batch->append(sample);
+                if (batch->size() < batchSize) {
+                    return true;
+                }
+                pushed = push(std::move(batch));
+                batch = takeBatch(ip);
+                return pushed;
+            });
+            if (!read) {
+                std::println(std::cerr, "Failed to export samples for IP {}", ip);
+                stop();
+            }
+            if (!read || !pushed || (batch->size() > 0 && !push(std::move(batch)))) {
+                break;
+            }
+            hostsRead++;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        running--;
+        batchReady.notify_one();
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < workerCount; i++) {
+        threads.emplace_back(work);
+    }
+
+    // 写出线程：按到达顺序写出批次，写完的批次放回空闲列表供工作线程复用
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        batchReady.wait(lock, [&] { return !queue.empty() || running == 0; });
+        if (queue.empty()) {
+            break;
+        }
+        auto batch = std::move(queue.front());
+        queue.pop_front();
+        slotFree.notify_one();
+        bool skip = stopped;
+        lock.unlock();
+
+        bool written = skip || writer.write(*batch);
+        if (!skip) {
+            stats.samples += batch->size();
+            stats.batches++;
+        }
+        batch->clear();
+
+        lock.lock();
+        spare.push_back(std::move(batch));
+        if (!written) {
+            std::println(std::cerr, "Failed to write exported samples");
+            stopped = true;
+            failed = true;
+            slotFree.notify_all();
+        }
+    }
+    lock.unlock();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    stats.hosts = hostsRead;
+
+    if (!failed && !writer.finish()) {
+        std::println(std::cerr, "Failed to finish export");
+        return false;
+    }
+    return !failed;
+}
@@ -0,0 +1,72 @@
+#ifndef SAMPLE_EXPORT_H
+#define SAMPLE_EXPORT_H
+
+#include "segment_store.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+// 导出的一批样本：同一台主机按时间顺序的一段样本，按列存放，写出时不需要为每行构造字符串
+struct SampleBatch {
+    std::string ip;
+    std::vector<std::int64_t> times;  // 本地时间的民用时间秒数
+    std::vector<std::int16_t> delays;
+    std::vector<std::uint8_t> successes;
+
+    std::size_t size() const { return times.size(); }
+    void append(const SegmentStore::Sample& sample);
+    void clear();  // 保留已分配的容量，批次对象在导出过程中循环使用
+};
+
+// 导出格式：begin写文件头，每批样本调用一次write，finish写文件尾
+class SampleWriter {
+public:
+    virtual ~SampleWriter() = default;
+
+    virtual bool begin() = 0;
+    virtual bool write(const SampleBatch& batch) = 0;
+    virtual bool finish() = 0;
+
+    // 支持csv和arrow（Arrow IPC文件格式，即Feather V2），格式未知时返回nullptr
+    static std::unique_ptr<SampleWriter> create(const std::string& format, std::FILE* out);
+};
+
+// 并行导出：每个工作线程打开自己的后端连接，从主机列表中依次领取主机读取样本，
+// 样本按批放入有界队列，由调用run的线程按到达顺序写出；同一主机的批次保持时间顺序，不同主机的批次交错出现
+// 同时存在的批次不超过 队列容量 + 工作线程数 + 1 个，内存占用与导出的数据量无关
+class SampleExporter {
+public:
+    using SampleVisitor = std::function<bool(const SegmentStore::Sample&)>;
+    // 读取一台主机的全部样本，visit返回false时停止；读取失败时返回false
+    using HostReader = std::function<bool(const std::string& ip, const SampleVisitor& visit)>;
+    // 在工作线程中调用，为该线程打开独立的连接；打开失败时返回空函数
+    using ReaderFactory = std::function<HostReader()>;
+
+    static constexpr std::size_t DEFAULT_BATCH_SIZE = 65536;
+
+    struct Stats {
+        std::uint64_t hosts = 0;
+        std::uint64_t samples = 0;
+        std::uint64_t batches = 0;
+    };
+
+private:
+    SampleWriter& writer;
+    std::size_t workers;
+    std::size_t batchSize;
+    Stats stats;
+
+public:
+    SampleExporter(SampleWriter& writer, std::size_t workers, std::size_t batchSize = DEFAULT_BATCH_SIZE);
+
+    // 导出全部主机；任一主机读取失败或写出失败时停止并返回false
+    bool run(const std::vector<std::string>& hosts, const ReaderFactory& openReader);
+
+    const Stats& getStats() const { return stats; }
+};
+
+#endif // SAMPLE_EXPORT_H
@@ -0,0 +1,962 @@
+#include "sample_import.h"
+#include "segment_store.h"
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <optional>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Arrow IPC的元数据和数据缓冲区都按小端序存放，直接读取内存中的整数表示
+static_assert(std::endian::native == std::endian::little, "Sample import assumes a little-endian host");
+
+std::uint32_t SampleReader::internHost(std::string_view ip, std::string_view hostname) {
+    auto [it, inserted] = hostIndex.try_emplace(std::string(ip), static_cast<std::uint32_t>(hosts.size()));
+    if (inserted) {
+        hosts.push_back({std::string(ip), std::string(hostname)});
+    } else if (hosts[it->second].hostname.empty() && !hostname.empty()) {
+        hosts[it->second].hostname = hostname;
+    }
+    return it->second;
+}
+
+namespace {
+
+constexpr std::int64_t SECONDS_PER_DAY = 86400;
+constexpr std::size_t MAX_REPORTED_ROWS = 5;  // 只打印前几行无法导入的原因，其余只计数
+
+// 只读映射整个导入文件，读取器直接在映射的内存上解析，不逐行复制
+class MappedFile {
+private:
+    const char* data = nullptr;
+    std::size_t length = 0;
+    bool opened = false;
+
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            length = static_cast<std::size_t>(st.st_size);
+            if (length == 0) {
+                opened = true;
+            } else {
+                void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    madvise(mapped, length, MADV_SEQUENTIAL);
+                    data = static_cast<const char*>(mapped);
+                    opened = true;
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) {
+            munmap(const_cast<char*>(data), length);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool valid() const { return opened; }
+    const char* begin() const { return data; }
+    std::size_t size() const { return length; }
+};
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+unsigned digitsAt(std::string_view text, std::size_t position, std::size_t count) {
+    unsigned value = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        value = value * 10 + static_cast<unsigned>(text[position + i] - '0');
+    }
+    return value;
+}
+
+// 解析时间戳为民用时间秒数：常见的 "YYYY-MM-DD HH:MM:SS"（或以T分隔的ISO 8601）按固定位置解析，
+// 小数秒和时区后缀被忽略；其余格式交给SegmentStore::parseTimestamp
+std::optional<std::int64_t> parseCivilTime(std::string_view text) {
+    static constexpr std::size_t DIGITS[] = {0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18};
+    bool fixedLayout = text.size() >= 19 && text[4] == '-' && text[7] == '-' && (text[10] == ' ' || text[10] == 'T') &&
+                       text[13] == ':' && text[16] == ':' &&
+                       std::all_of(std::begin(DIGITS), std::end(DIGITS), [&](std::size_t i) { return isDigit(text[i]); });
+    if (!fixedLayout) {
+        std::string copy(text);
+        if (copy.size() > 10 && copy[10] == 'T') {
+            copy[10] = ' ';
+        }
+        return SegmentStore::parseTimestamp(copy);
+    }
+
+    std::chrono::year_month_day date{std::chrono::year{static_cast<int>(digitsAt(text, 0, 4))},
+                                     std::chrono::month{digitsAt(text, 5, 2)}, std::chrono::day{digitsAt(text, 8, 2)}};
+    unsigned hour = digitsAt(text, 11, 2), minute = digitsAt(text, 14, 2), second = digitsAt(text, 17, 2);
+    if (!date.ok() || hour > 23 || minute > 59 || second > 60) {
+        return std::nullopt;
+    }
+    return std::chrono::sys_days{date}.time_since_epoch().count() * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+}
+
+std::int16_t clampDelay(long long value) {
+    return static_cast<std::int16_t>(std::clamp<long long>(value, std::numeric_limits<std::int16_t>::min(),
+                                                            std::numeric_limits<std::int16_t>::max()));
+}
+
+// 延迟为整数毫秒，也接受带小数的值（四舍五入）；空值视为0
+std::optional<std::int16_t> parseDelay(std::string_view text) {
+    if (text.empty()) {
+        return 0;
+    }
+    long long value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec == std::errc() && end == text.data() + text.size()) {
+        return clampDelay(value);
+    }
+    double real = 0;
+    auto [realEnd, realEc] = std::from_chars(text.data(), text.data() + text.size(), real);
+    if (realEc != std::errc() || realEnd != text.data() + text.size() || !std::isfinite(real)) {
+        return std::nullopt;
+    }
+    return clampDelay(std::llround(real));
+}
+
+std::optional<bool> parseFlag(std::string_view text) {
+    static constexpr std::string_view TRUE_VALUES[] = {"1", "true", "t", "yes", "success"};
+    static constexpr std::string_view FALSE_VALUES[] = {"0", "false", "f", "no", "failed"};
+    std::string lower(text);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (std::find(std::begin(TRUE_VALUES), std::end(TRUE_VALUES), lower) != std::end(TRUE_VALUES)) {
+        return true;
+    }
+    if (std::find(std::begin(FALSE_VALUES), std::end(FALSE_VALUES), lower) != std::end(FALSE_VALUES)) {
+        return false;
+    }
+    return std::nullopt;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool isIPv4(std::string_view ip) {
+    char text[INET_ADDRSTRLEN];
+    if (ip.empty() || ip.size() >= sizeof(text)) {
+        return false;
+    }
+    std::memcpy(text, ip.data(), ip.size());
+    text[ip.size()] = '\0';
+    in_addr address;
+    return inet_pton(AF_INET, text, &address) == 1;
+}
+
+// 导入列名不区分大小写；除主机名外都必须存在
+enum class Role { Ip, Hostname, Timestamp, Delay, Success, Ignored };
+
+Role columnRole(std::string_view name) {
+    std::string lower(trim(name));
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (lower == "ip") return Role::Ip;
+    if (lower == "hostname") return Role::Hostname;
+    if (lower == "timestamp") return Role::Timestamp;
+    if (lower == "delay") return Role::Delay;
+    if (lower == "success") return Role::Success;
+    return Role::Ignored;
+}
+
+constexpr std::size_t NO_COLUMN = std::numeric_limits<std::size_t>::max();
+
+// CSV：第一行为表头，至少包含ip、timestamp、delay、success四列（顺序不限），可选hostname列
+// 字段可以用双引号括起，引号内的""表示一个引号；无法解析的行跳过并计数
+class CsvSampleReader : public SampleReader {
+private:
+    std::unique_ptr<MappedFile> file;
+    std::size_t position = 0;
+    std::uint64_t lineNumber = 0;
+    std::vector<std::string_view> fields;
+    std::vector<std::string> unescaped;  // 含有""转义的字段，按列复用
+    std::size_t columns[5] = {NO_COLUMN, NO_COLUMN, NO_COLUMN, NO_COLUMN, NO_COLUMN};  // 按Role索引
+    std::string lastIP;
+    std::uint32_t lastHost = 0;
+    bool lastValid = false;
+
+public:
+    explicit CsvSampleReader(std::unique_ptr<MappedFile> mapped) : file(std::move(mapped)) {}
+
+    bool readHeader() {
+        if (!nextRecord()) {
+            std::println(std::cerr, "Import file is empty");
+            return false;
+        }
+        for (std::size_t i = 0; i < fields.size(); i++) {
+            Role role = columnRole(fields[i]);
+            if (role != Role::Ignored && columns[static_cast<int>(role)] == NO_COLUMN) {
+                columns[static_cast<int>(role)] = i;
+            }
+        }
+        for (Role role : {Role::Ip, Role::Timestamp, Role::Delay, Role::Success}) {
+            if (columns[static_cast<int>(role)] == NO_COLUMN) {
+                std::println(std::cerr, "CSV header must contain ip, timestamp, delay and success columns");
+                return false;
+            }
+        }
+        unescaped.resize(fields.size());
+        return true;
+    }
+
+    bool read(std::vector<ImportedSample>& rows, std::size_t maxRows) override {
+        std::size_t target = rows.size() + maxRows;
+        while (rows.size() < target && nextRecord()) {
+            if (fields.size() == 1 && trim(fields[0]).empty()) {
+                continue;  // 空行
+            }
+            auto row = parseRow();
+            if (row) {
+                rows.push_back(*row);
+            }
+        }
+        return true;
+    }
+
+private:
+    std::string_view column(Role role) const {
+        std::size_t index = columns[static_cast<int>(role)];
+        return index < fields.size() ? trim(fields[index]) : std::string_view();
+    }
+
+    std::optional<ImportedSample> parseRow() {
+        std::size_t required = std::max({columns[0], columns[2], columns[3], columns[4]});
+        if (fields.size() <= required) {
+            return reject("missing columns");
+        }
+
+        std::string_view ip = column(Role::Ip);
+        if (!lastValid || ip != lastIP) {
+            if (!isIPv4(ip)) {
+                return reject("invalid IP address");
+            }
+            lastIP = ip;
+            lastHost = internHost(ip, column(Role::Hostname));
+            lastValid = true;
+        }
+        auto time = parseCivilTime(column(Role::Timestamp));
+        if (!time) {
+            return reject("invalid timestamp");
+        }
+        auto delay = parseDelay(column(Role::Delay));
+        if (!delay) {
+            return reject("invalid delay");
+        }
+        auto success = parseFlag(column(Role::Success));
+        if (!success) {
+            return reject("invalid success flag");
+        }
+        return ImportedSample{lastHost, *time, *delay, *success};
+    }
+
+    std::optional<ImportedSample> reject(const char* reason) {
+        if (skipped++ < MAX_REPORTED_ROWS) {
+            std::println(std::cerr, "Skipping line {}: {}", lineNumber, reason);
+        }
+        return std::nullopt;
+    }
+
+    // 读取一条记录的全部字段；引号内的逗号和换行属于字段内容
+    bool nextRecord() {
+        const char* data = file->begin();
+        std::size_t size = file->size();
+        if (position >= size) {
+            return false;
+        }
+        fields.clear();
+        lineNumber++;
+        while (true) {
+            std::size_t columnIndex = fields.size();
+            if (data[position] == '"') {
+                std::size_t start = ++position;
+                bool escaped = false;
+                while (position < size) {
+                    if (data[position] == '"') {
+                        if (position + 1 < size && data[position + 1] == '"') {
+                            escaped = true;
+                            position += 2;
+                            continue;
+                        }
+                        break;
+                    }
+                    if (data[position] == '\n') {
+                        lineNumber++;
+                    }
+                    position++;
+                }
+                std::string_view raw(data + start, position - start);
+                if (position < size) {
+                    position++;  // 结束引号
+                }
+                if (escaped && columnIndex < unescaped.size()) {
+                    std::string& text = unescaped[columnIndex];
+                    text.clear();
+                    for (std::size_t i = 0; i < raw.size(); i++) {
+                        text.push_back(raw[i]);
+                        if (raw[i] == '"') {
+                            i++;
+                        }
+                    }
+                    raw = text;
+                }
+                fields.push_back(raw);
+                while (position < size && data[position] != ',' && data[position] != '\n') {
+                    position++;
+                }
+            } else {
+                const char* start = data + position;
+                const char* end = data + size;
+                const char* stop = start;
+                while (stop < end && *stop != ',' && *stop != '\n') {
+                    stop++;
+                }
+                fields.emplace_back(start, static_cast<std::size_t>(stop - start));
+                position = static_cast<std::size_t>(stop - data);
+            }
+
+            if (position >= size) {
+                return true;
+            }
+            if (data[position++] == '\n') {
+                return true;
+            }
+            if (position >= size) {
+                fields.emplace_back();  // 以逗号结尾的最后一行
+                return true;
+            }
+        }
+    }
+};
+
+// 只读的FlatBuffers访问器，用于解析Arrow IPC消息的元数据；任何越界访问都使valid()为false并返回0
+class FlatView {
+private:
+    const char* data;
+    std::size_t size;
+    bool ok = true;
+
+public:
+    FlatView(const char* data, std::size_t size) : data(data), size(size) {}
+
+    bool valid() const { return ok; }
+
+    template<typename T>
+    T load(std::size_t at) {
+        T value{};
+        if (at > size || sizeof(T) > size - at) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data + at, sizeof(T));
+        return value;
+    }
+
+    std::size_t root() {
+        return load<std::uint32_t>(0);
+    }
+
+    // 字段在缓冲区中的位置，字段不存在时返回0
+    std::size_t field(std::size_t table, int id) {
+        auto vtable = static_cast<std::int64_t>(table) - load<std::int32_t>(table);
+        if (vtable < 0) {
+            ok = false;
+            return 0;
+        }
+        auto vtableSize = load<std::uint16_t>(static_cast<std::size_t>(vtable));
+        std::size_t slot = 4 + 2 * static_cast<std::size_t>(id);
+        if (slot + 2 > vtableSize) {
+            return 0;
+        }
+        auto offset = load<std::uint16_t>(static_cast<std::size_t>(vtable) + slot);
+        return offset ? table + offset : 0;
+    }
+
+    template<typename T>
+    T scalar(std::size_t table, int id, T fallback = T{}) {
+        std::size_t at = field(table, id);
+        return at ? load<T>(at) : fallback;
+    }
+
+    // 引用字段指向的对象位置，字段不存在时返回0
+    std::size_t ref(std::size_t table, int id) {
+        std::size_t at = field(table, id);
+        return at ? at + load<std::uint32_t>(at) : 0;
+    }
+
+    std::uint32_t length(std::size_t vector) {
+        return vector ? load<std::uint32_t>(vector) : 0;
+    }
+
+    std::size_t element(std::size_t vector, std::size_t index, std::size_t itemSize) {
+        return vector + 4 + index * itemSize;
+    }
+
+    // 引用数组的第index个元素指向的对象
+    std::size_t refAt(std::size_t vector, std::size_t index) {
+        std::size_t at = element(vector, index, 4);
+        return at + load<std::uint32_t>(at);
+    }
+
+    std::string_view string(std::size_t at) {
+        if (!at) {
+            return {};
+        }
+        std::uint32_t count = load<std::uint32_t>(at);
+        if (!ok || at + 4 > size || count > size - at - 4) {
+            ok = false;
+            return {};
+        }
+        return {data + at + 4, count};
+    }
+};
+
+// Arrow IPC文件格式（Feather V2）或流格式：逐条读取消息，不依赖文件末尾的Footer
+// 列按名称识别：ip和hostname为utf8/large_utf8；timestamp为任意精度的timestamp（带时区时换算为本机本地时间）或文本；
+// delay为整数或浮点数；success为bool或整数。ip、timestamp或success为空值的行跳过，delay为空值时记为0
+// 不支持字典编码和压缩的消息体
+class ArrowSampleReader : public SampleReader {
+private:
+    // Schema.fbs / Message.fbs 中的类型和消息编号
+    static constexpr std::uint8_t TYPE_NULL = 1, TYPE_INT = 2, TYPE_FLOAT = 3, TYPE_BINARY = 4, TYPE_UTF8 = 5, TYPE_BOOL = 6,
+                                  TYPE_DECIMAL = 7, TYPE_DATE = 8, TYPE_TIME = 9, TYPE_TIMESTAMP = 10, TYPE_INTERVAL = 11,
+                                  TYPE_FIXED_BINARY = 15, TYPE_DURATION = 18, TYPE_LARGE_BINARY = 19, TYPE_LARGE_UTF8 = 20;
+    static constexpr std::uint8_t HEADER_SCHEMA = 1, HEADER_DICTIONARY = 2, HEADER_RECORD_BATCH = 3;
+
+    struct Column {
+        std::uint8_t type = 0;
+        std::size_t firstBuffer = 0;
+        std::size_t node = 0;
+        int bitWidth = 0;          // 整数位数；浮点数为32或64
+        bool isSigned = true;
+        std::int64_t unitDivisor = 1;  // 时间戳换算为秒的除数
+        bool utc = false;          // 带时区的时间戳为UTC时刻
+        // 当前批次中的缓冲区
+        const std::uint8_t* validity = nullptr;
+        const char* values = nullptr;
+        std::size_t valuesLength = 0;
+        const char* text = nullptr;
+        std::size_t textLength = 0;
+    };
+
+    std::unique_ptr<MappedFile> file;
+    std::size_t position = 0;
+    bool finished = false;
+    bool hasSchema = false;
+    std::size_t columnIndex[5] = {NO_COLUMN, NO_COLUMN, NO_COLUMN, NO_COLUMN, NO_COLUMN};  // 按Role索引到columns
+    std::vector<Column> columns;
+    std::size_t bufferCount = 0;
+    std::int64_t batchRows = 0;
+    std::int64_t cursor = 0;
+    std::string lastIP;
+    std::uint32_t lastHost = 0;
+    bool lastValid = false;
+    std::int64_t zoneHour = std::numeric_limits<std::int64_t>::min();  // 带时区的时间戳按小时缓存本地时区偏移
+    long zoneOffset = 0;
+
+public:
+    explicit ArrowSampleReader(std::unique_ptr<MappedFile> mapped) : file(std::move(mapped)) {
+        // 文件格式以8字节的魔数开头，流格式直接从第一条消息开始
+        if (file->size() >= 8 && std::memcmp(file->begin(), "ARROW1", 6) == 0) {
+            position = 8;
+        }
+    }
+
+    bool readSchema() {
+        while (!hasSchema) {
+            if (finished || !nextMessage()) {
+                if (finished) {
+                    std::println(std::cerr, "Arrow file has no schema");
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool read(std::vector<ImportedSample>& rows, std::size_t maxRows) override {
+        std::size_t target = rows.size() + maxRows;
+        while (rows.size() < target) {
+            if (cursor >= batchRows) {
+                if (finished) {
+                    return true;
+                }
+                if (!nextMessage()) {
+                    return false;
+                }
+                continue;
+            }
+            for (; cursor < batchRows && rows.size() < target; cursor++) {
+                auto row = readRow(static_cast<std::size_t>(cursor));
+                if (!row) {
+                    return false;
+                }
+                if (row->host != INVALID_HOST) {
+                    rows.push_back(*row);
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr std::uint32_t INVALID_HOST = std::numeric_limits<std::uint32_t>::max();
+
+    Column* columnFor(Role role) {
+        std::size_t index = columnIndex[static_cast<int>(role)];
+        return index == NO_COLUMN ? nullptr : &columns[index];
+    }
+
+    static bool isNull(const Column& column, std::size_t row) {
+        return column.validity && !((column.validity[row / 8] >> (row % 8)) & 1);
+    }
+
+    bool corrupt(const char* what) {
+        std::println(std::cerr, "Invalid Arrow file: {}", what);
+        return false;
+    }
+
+    bool nextMessage() {
+        const char* data = file->begin();
+        std::size_t size = file->size();
+        if (position + 4 > size) {
+            finished = true;  // 没有流结束标记的流格式文件
+            return true;
+        }
+        std::uint32_t marker;
+        std::memcpy(&marker, data + position, 4);
+        std::uint32_t metadataLength = marker;
+        position += 4;
+        if (marker == 0xFFFFFFFF) {
+            if (position + 4 > size) {
+                return corrupt("truncated message");
+            }
+            std::memcpy(&metadataLength, data + position, 4);
+            position += 4;
+        }
+        if (metadataLength == 0) {
+            finished = true;
+            return true;
+        }
+        if (metadataLength > size - position) {
+            return corrupt("truncated message metadata");
+        }
+
+        FlatView view(data + position, metadataLength);
+        std::size_t message = view.root();
+        auto headerType = view.scalar<std::uint8_t>(message, 1);
+        std::size_t header = view.ref(message, 2);
+        auto bodyLength = view.scalar<std::int64_t>(message, 3);
+        std::size_t bodyStart = position + metadataLength;
+        if (!view.valid() || bodyLength < 0 || static_cast<std::uint64_t>(bodyLength) > size - bodyStart) {
+            return corrupt("truncated message body");
+        }
+        position = bodyStart + static_cast<std::size_t>(bodyLength);
+
+        switch (headerType) {
+            case HEADER_SCHEMA:
+                return parseSchema(view, header);
+            case HEADER_RECORD_BATCH:
+                return parseBatch(view, header, data + bodyStart, static_cast<std::size_t>(bodyLength));
+            case HEADER_DICTIONARY:
+                std::println(std::cerr, "Dictionary-encoded Arrow columns are not supported; decode them before importing");
+                return false;
+            default:
+                return corrupt("unexpected message type");
+        }
+    }
+
+    bool parseSchema(FlatView& view, std::size_t schema) {
+        if (hasSchema) {
+            return corrupt("repeated schema");
+        }
+        if (view.scalar<std::int16_t>(schema, 0) != 0) {
+            std::println(std::cerr, "Big-endian Arrow files are not supported");
+            return false;
+        }
+        std::size_t fields = view.ref(schema, 1);
+        std::uint32_t count = view.length(fields);
+        for (std::uint32_t i = 0; i < count && view.valid(); i++) {
+            std::size_t field = view.refAt(fields, i);
+            std::string_view name = view.string(view.ref(field, 0));
+            Column column;
+            column.type = view.scalar<std::uint8_t>(field, 2);
+            std::size_t type = view.ref(field, 3);
+            column.node = i;
+            column.firstBuffer = bufferCount;
+            if (view.ref(field, 4) != 0) {
+                std::println(std::cerr, "Dictionary-encoded Arrow column {} is not supported", name);
+                return false;
+            }
+
+            switch (column.type) {
+                case TYPE_NULL:
+                    break;
+                case TYPE_INT:
+                    column.bitWidth = view.scalar<std::int32_t>(type, 0);
+                    column.isSigned = view.scalar<std::uint8_t>(type, 1) != 0;
+                    if (column.bitWidth != 8 && column.bitWidth != 16 && column.bitWidth != 32 && column.bitWidth != 64) {
+                        return corrupt("invalid integer width");
+                    }
+                    bufferCount += 2;
+                    break;
+                case TYPE_FLOAT: {
+                    auto precision = view.scalar<std::int16_t>(type, 0);  // HALF, SINGLE, DOUBLE
+                    column.bitWidth = precision == 1 ? 32 : precision == 2 ? 64 : 16;
+                    bufferCount += 2;
+                    break;
+                }
+                case TYPE_TIMESTAMP: {
+                    static constexpr std::int64_t DIVISORS[] = {1, 1000, 1000000, 1000000000};
+                    auto unit = view.scalar<std::int16_t>(type, 0);
+                    column.unitDivisor = DIVISORS[std::clamp<int>(unit, 0, 3)];
+                    column.utc = !view.string(view.ref(type, 1)).empty();
+                    bufferCount += 2;
+                    break;
+                }
+                case TYPE_BOOL: case TYPE_DECIMAL: case TYPE_DATE: case TYPE_TIME: case TYPE_INTERVAL:
+                case TYPE_FIXED_BINARY: case TYPE_DURATION:
+                    bufferCount += 2;
+                    break;
+                case TYPE_BINARY: case TYPE_UTF8: case TYPE_LARGE_BINARY: case TYPE_LARGE_UTF8:
+                    bufferCount += 3;
+                    break;
+                default:
+                    std::println(std::cerr, "Arrow column {} has an unsupported type; only flat columns can be imported", name);
+                    return false;
+            }
+
+            Role role = columnRole(name);
+            if (role != Role::Ignored && columnIndex[static_cast<int>(role)] == NO_COLUMN) {
+                columnIndex[static_cast<int>(role)] = columns.size();
+            }
+            columns.push_back(column);
+        }
+        if (!view.valid()) {
+            return corrupt("malformed schema");
+        }
+
+        auto expect = [&](Role role, std::initializer_list<std::uint8_t> types, const char* name) {
+            Column* column = columnFor(role);
+            if (column && std::find(types.begin(), types.end(), column->type) == types.end()) {
+                std::println(std::cerr, "Arrow column {} has an unsupported type", name);
+                return false;
+            }
+            return true;
+        };
+        for (Role role : {Role::Ip, Role::Timestamp, Role::Delay, Role::Success}) {
+            if (!columnFor(role)) {
+                std::println(std::cerr, "Arrow schema must contain ip, timestamp, delay and success columns");
+                return false;
+            }
+        }
+        if (!expect(Role::Ip, {TYPE_UTF8, TYPE_LARGE_UTF8}, "ip") ||
+            !expect(Role::Hostname, {TYPE_UTF8, TYPE_LARGE_UTF8}, "hostname") ||
+            !expect(Role::Timestamp, {TYPE_TIMESTAMP, TYPE_UTF8, TYPE_LARGE_UTF8}, "timestamp") ||
+            !expect(Role::Delay, {TYPE_INT, TYPE_FLOAT}, "delay") ||
+            !expect(Role::Success, {TYPE_BOOL, TYPE_INT}, "success")) {
+            return false;
+        }
+        Column* delay = columnFor(Role::Delay);
+        if (delay->type == TYPE_FLOAT && delay->bitWidth == 16) {
+            std::println(std::cerr, "Arrow column delay uses half-precision floats, which are not supported");
+            return false;
+        }
+        hasSchema = true;
+        return true;
+    }
+
+    bool parseBatch(FlatView& view, std::size_t batch, const char* body, std::size_t bodyLength) {
+        if (!hasSchema) {
+            return corrupt("record batch before schema");
+        }
+        if (view.ref(batch, 3) != 0) {
+            std::println(std::cerr, "Compressed Arrow record batches are not supported; write the file without compression");
+            return false;
+        }
+        auto rows = view.scalar<std::int64_t>(batch, 0);
+        std::size_t nodes = view.ref(batch, 1);
+        std::size_t buffers = view.ref(batch, 2);
+        if (!view.valid() || rows < 0 || view.length(nodes) != columns.size() || view.length(buffers) != bufferCount) {
+            return corrupt("record batch does not match the schema");
+        }
+        auto rowCount = static_cast<std::size_t>(rows);
+
+        auto buffer = [&](std::size_t index, const char*& start, std::size_t& length) {
+            auto offset = view.load<std::int64_t>(view.element(buffers, index, 16));
+            auto size = view.load<std::int64_t>(view.element(buffers, index, 16) + 8);
+            if (offset < 0 || size < 0 || static_cast<std::uint64_t>(offset) > bodyLength ||
+                static_cast<std::uint64_t>(size) > bodyLength - static_cast<std::uint64_t>(offset)) {
+                return false;
+            }
+            start = body + offset;
+            length = static_cast<std::size_t>(size);
+            return true;
+        };
+
+        for (auto& column : columns) {
+            if (column.type == TYPE_NULL) {
+                continue;
+            }
+            auto nullCount = view.load<std::int64_t>(view.element(nodes, column.node, 16) + 8);
+            const char* validity;
+            std::size_t validityLength;
+            if (!buffer(column.firstBuffer, validity, validityLength) ||
+                !buffer(column.firstBuffer + 1, column.values, column.valuesLength)) {
+                return corrupt("buffer out of range");
+            }
+            column.validity = (nullCount > 0 && validityLength > 0) ? reinterpret_cast<const std::uint8_t*>(validity) : nullptr;
+            if (column.validity && validityLength < (rowCount + 7) / 8) {
+                return corrupt("validity bitmap too short");
+            }
+
+            // 定长列的数据缓冲区必须容纳整个批次；字符串列的偏移数组多一个元素，文本在访问时检查
+            std::size_t required = 0;
+            switch (column.type) {
+                case TYPE_BOOL: required = (rowCount + 7) / 8; break;
+                case TYPE_INT: case TYPE_FLOAT: required = rowCount * static_cast<std::size_t>(column.bitWidth / 8); break;
+                case TYPE_TIMESTAMP: required = rowCount * 8; break;
+                case TYPE_UTF8: required = (rowCount + 1) * 4; break;
+                case TYPE_LARGE_UTF8: required = (rowCount + 1) * 8; break;
+                default: break;
+            }
+            if (column.type == TYPE_UTF8 || column.type == TYPE_LARGE_UTF8) {
+                if (!buffer(column.firstBuffer + 2, column.text, column.textLength)) {
+                    return corrupt("buffer out of range");
+                }
+            }
+            if (column.valuesLength < required) {
+                return corrupt("column buffer too short");
+            }
+        }
+        if (!view.valid()) {
+            return corrupt("malformed record batch");
+        }
+        batchRows = rows;
+        cursor = 0;
+        return true;
+    }
+
+    std::optional<std::string_view> stringAt(const Column& column, std::size_t row) {
+        std::uint64_t start, end;
+        if (column.type == TYPE_UTF8) {
+            std::int32_t offsets[2];
+            std::memcpy(offsets, column.values + row * 4, sizeof(offsets));
+            start = static_cast<std::uint64_t>(offsets[0]);
+            end = static_cast<std::uint64_t>(offsets[1]);
+        } else {
+            std::int64_t offsets[2];
+            std::memcpy(offsets, column.values + row * 8, sizeof(offsets));
+            start = static_cast<std::uint64_t>(offsets[0]);
+            end = static_cast<std::uint64_t>(offsets[1]);
+        }
+        if (start > end || end > column.textLength) {
+            corrupt("string offset out of range");
+            return std::nullopt;
+        }
+        return std::string_view(column.text + start, end - start);
+    }
+
+    std::int64_t integerAt(const Column& column, std::size_t row) {
+        const char* at = column.values + row * static_cast<std::size_t>(column.bitWidth / 8);
+        switch (column.bitWidth) {
+            case 8: { std::int8_t v; std::uint8_t u; std::memcpy(&v, at, 1); std::memcpy(&u, at, 1); return column.isSigned ? v : u; }
+            case 16: { std::int16_t v; std::uint16_t u; std::memcpy(&v, at, 2); std::memcpy(&u, at, 2); return column.isSigned ? v : u; }
+            case 32: { std::int32_t v; std::uint32_t u; std::memcpy(&v, at, 4); std::memcpy(&u, at, 4); return column.isSigned ? v : static_cast<std::int64_t>(u); }
+            default: { std::int64_t v; std::memcpy(&v, at, 8); return v; }
+        }
+    }
+
+    double floatAt(const Column& column, std::size_t row) {
+        if (column.bitWidth == 32) {
+            float value;
+            std::memcpy(&value, column.values + row * 4, 4);
+            return value;
+        }
+        double value;
+        std::memcpy(&value, column.values + row * 8, 8);
+        return value;
+    }
+
+    // 带时区的时间戳是UTC时刻，换算为本机时区的民用时间，与ping写入的本地时间一致
+    std::int64_t toLocal(std::int64_t utcSeconds) {
+        std::int64_t hour = utcSeconds / 3600 - (utcSeconds % 3600 < 0 ? 1 : 0);
+        if (hour != zoneHour) {
+            auto instant = static_cast<std::time_t>(utcSeconds);
+            std::tm local;
+            localtime_r(&instant, &local);
+            zoneOffset = local.tm_gmtoff;
+            zoneHour = hour;
+        }
+        return utcSeconds + zoneOffset;
+    }
+
+    std::optional<std::int64_t> timeAt(const Column& column, std::size_t row, bool& valid) {
+        if (column.type != TYPE_TIMESTAMP) {
+            auto text = stringAt(column, row);
+            if (!text) {
+                valid = false;
+                return std::nullopt;
+            }
+            return parseCivilTime(*text);
+        }
+        std::int64_t value;
+        std::memcpy(&value, column.values + row * 8, 8);
+        std::int64_t seconds = value / column.unitDivisor - (value % column.unitDivisor < 0 ? 1 : 0);
+        return column.utc ? toLocal(seconds) : seconds;
+    }
+
+    // 返回一行样本；无法导入的行返回host为INVALID_HOST的样本，文件损坏时返回nullopt
+    std::optional<ImportedSample> readRow(std::size_t row) {
+        const Column& ipColumn = *columnFor(Role::Ip);
+        const Column& timeColumn = *columnFor(Role::Timestamp);
+        const Column& delayColumn = *columnFor(Role::Delay);
+        const Column& successColumn = *columnFor(Role::Success);
+        ImportedSample skippedRow{INVALID_HOST, 0, 0, false};
+
+        if (isNull(ipColumn, row) || isNull(timeColumn, row) || isNull(successColumn, row)) {
+            return reject(skippedRow, "null ip, timestamp or success");
+        }
+        auto ip = stringAt(ipColumn, row);
+        if (!ip) {
+            return std::nullopt;
+        }
+        if (!lastValid || *ip != lastIP) {
+            if (!isIPv4(*ip)) {
+                return reject(skippedRow, "invalid IP address");
+            }
+            std::string_view hostname;
+            const Column* hostnameColumn = columnFor(Role::Hostname);
+            if (hostnameColumn && !isNull(*hostnameColumn, row)) {
+                auto text = stringAt(*hostnameColumn, row);
+                if (!text) {
+                    return std::nullopt;
+                }
+                hostname = *text;
+            }
+            lastIP = *ip;
+            lastHost = internHost(*ip, hostname);
+            lastValid = true;
+        }
+
+        bool valid = true;
+        auto time = timeAt(timeColumn, row, valid);
+        if (!valid) {
+            return std::nullopt;
+        }
+        if (!time) {
+            return reject(skippedRow, "invalid timestamp");
+        }
+
+        std::int16_t delay = 0;
+        if (!isNull(delayColumn, row)) {
+            if (delayColumn.type == TYPE_FLOAT) {
+                double value = floatAt(delayColumn, row);
+                delay = std::isfinite(value) ? clampDelay(std::llround(value)) : 0;
+            } else {
+                delay = clampDelay(integerAt(delayColumn, row));
+            }
+        }
+        bool success = successColumn.type == TYPE_BOOL
+            ? ((reinterpret_cast<const std::uint8_t*>(successColumn.values)[row / 8] >> (row % 8)) & 1) != 0
+            : integerAt(successColumn, row) != 0;
+        return ImportedSample{lastHost, *time, delay, success};
+    }
+
+    ImportedSample reject(const ImportedSample& row, const char* reason) {
+        if (skipped++ < MAX_REPORTED_ROWS) {
+            std::println(std::cerr, "Skipping row: {}", reason);
+        }
+        return row;
+    }
+};
+
+// 把value按固定宽度写成十进制数字，位数不足时补0
+char* writeDigits(char* out, unsigned value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return out + width;
+}
+
+} // namespace
+
+std::unique_ptr<SampleReader> SampleReader::open(const std::string& path) {
+    auto file = std::make_unique<MappedFile>(path);
+    if (!file->valid()) {
+        std::println(std::cerr, "Failed to open import file {}", path);
+        return nullptr;
+    }
+    static const char STREAM_MARKER[4] = {'\xff', '\xff', '\xff', '\xff'};
+    bool isArrow = (file->size() >= 8 && std::memcmp(file->begin(), "ARROW1", 6) == 0) ||
+                   (file->size() >= 8 && std::memcmp(file->begin(), STREAM_MARKER, 4) == 0);
+    if (isArrow) {
+        auto reader = std::make_unique<ArrowSampleReader>(std::move(file));
+        return reader->readSchema() ? std::move(reader) : nullptr;
+    }
+    auto reader = std::make_unique<CsvSampleReader>(std::move(file));
+    return reader->readHeader() ? std::move(reader) : nullptr;
+}
+
+void toPingResults(std::span<const ImportedSample> rows, const std::vector<std::string>& ips,
+                   const std::vector<std::string>& hostnames,
+                   std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results) {
+    results.resize(rows.size());
+    std::int64_t cachedDay = std::numeric_limits<std::int64_t>::min();
+    char datePrefix[11];  // "YYYY-MM-DD "
+    for (std::size_t i = 0; i < rows.size(); i++) {
+        const ImportedSample& row = rows[i];
+        auto& [ip, hostname, delay, success, timestamp] = results[i];
+        ip.assign(ips[row.host]);
+        hostname.assign(hostnames[row.host]);
+        delay = row.delay;
+        success = row.success;
+
+        // 同一天的样本复用日期部分，时间戳直接写入复用的字符串缓冲区
+        std::int64_t day = row.time / SECONDS_PER_DAY - (row.time % SECONDS_PER_DAY < 0 ? 1 : 0);
+        auto secondOfDay = static_cast<unsigned>(row.time - day * SECONDS_PER_DAY);
+        if (day != cachedDay) {
+            std::chrono::year_month_day date{std::chrono::sys_days{std::chrono::days{day}}};
+            char* prefix = writeDigits(datePrefix, static_cast<unsigned>(static_cast<int>(date.year())), 4);
+            *prefix++ = '-';
+            prefix = writeDigits(prefix, static_cast<unsigned>(date.month()), 2);
+            *prefix++ = '-';
+            prefix = writeDigits(prefix, static_cast<unsigned>(date.day()), 2);
+            *prefix = ' ';
+            cachedDay = day;
+        }
+        timestamp.resize(19);
+        char* cursor = timestamp.data();
+        std::memcpy(cursor, datePrefix, sizeof(datePrefix));
+        cursor = writeDigits(cursor + sizeof(datePrefix), secondOfDay / 3600, 2);
+        *cursor++ = ':';
+        cursor = writeDigits(cursor, secondOfDay / 60 % 60, 2);
+        *cursor++ = ':';
+        writeDigits(cursor, secondOfDay % 60, 2);
+    }
+}
@@ -0,0 +1,184 @@
+#ifndef SAMPLE_IMPORT_H
+#define SAMPLE_IMPORT_H
+
+#include <iostream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// 导入的一行样本：主机以编号表示（对应SampleReader::getHosts()中的下标），排序时不需要比较字符串
+struct ImportedSample {
+    std::uint32_t host;
+    std::int64_t time;  // 本地时间的民用时间秒数
+    std::int16_t delay;
+    bool success;
+};
+
+// 导入文件读取器：每次读取一块样本，主机IP和主机名只在字典中保存一份
+class SampleReader {
+public:
+    struct Host {
+        std::string ip;
+        std::string hostname;  // 文件中没有主机名列时为空
+    };
+
+    virtual ~SampleReader() = default;
+
+    // 读取最多maxRows行追加到rows，读到文件末尾时不再追加；文件格式错误时返回false
+    virtual bool read(std::vector<ImportedSample>& rows, std::size_t maxRows) = 0;
+
+    const std::vector<Host>& getHosts() const { return hosts; }
+    std::uint64_t getSkipped() const { return skipped; }
+
+    // 按文件内容识别格式：以ARROW1开头（文件格式）或0xFFFFFFFF开头（流格式）的是Arrow IPC，其余按CSV读取
+    // 打开失败或表头无法识别时返回nullptr
+    static std::unique_ptr<SampleReader> open(const std::string& path);
+
+protected:
+    std::vector<Host> hosts;
+    std::unordered_map<std::string, std::uint32_t> hostIndex;
+    std::uint64_t skipped = 0;  // 缺少IP、时间戳无效等无法导入的行
+
+    // 返回主机编号，新主机加入字典；已知主机的主机名为空时用本行的主机名补上
+    std::uint32_t internHost(std::string_view ip, std::string_view hostname);
+};
+
+// 把一段已排序的样本转换为insertPingResults的参数；results中已有的元素和字符串缓冲区被复用
+void toPingResults(std::span<const ImportedSample> rows, const std::vector<std::string>& ips,
+                   const std::vector<std::string>& hostnames,
+                   std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& results);
+
+// 批量导入：按块读取文件，每块按 (7天窗口, 主机, 时间) 排序后，每个窗口在一个事务中分批写入
+// 按主机和时间排序让SQLite的每张样本表顺序追加、汇总表的同一时间桶合并为一次累加；
+// 一个窗口最多涉及7个日分区（或2个周分区），不会超过SQLite同时ATTACH的数据库个数
+// 写入期间后端处于批量导入模式（SQLite新建的表推迟建索引，PostgreSQL关闭同步提交）
+template<typename DatabaseType>
+class SampleImporter {
+public:
+    static constexpr std::size_t CHUNK_ROWS = 4 << 20;     // 每次读取并排序的行数
+    static constexpr std::size_t BATCH_ROWS = 65536;       // 每次insertPingResults的行数
+    static constexpr std::int64_t WINDOW_DAYS = 7;
+
+    struct Stats {
+        std::uint64_t rows = 0;
+        std::uint64_t skipped = 0;
+        std::uint64_t hosts = 0;
+        std::uint64_t transactions = 0;
+        double seconds = 0;
+    };
+
+private:
+    DatabaseType& db;
+    std::size_t chunkRows;
+    Stats stats;
+
+public:
+    explicit SampleImporter(DatabaseType& db, std::size_t chunkRows = CHUNK_ROWS) : db(db), chunkRows(chunkRows) {}
+
+    bool run(SampleReader& reader) {
+        auto started = std::chrono::steady_clock::now();
+        if (!db.beginBulkLoad()) {
+            return false;
+        }
+
+        // 文件中没有主机名时沿用数据库中已有的主机名，新主机以IP作为主机名
+        std::map<std::string, std::string> knownHosts = db.getAllHosts();
+        std::vector<std::string> ips, hostnames;
+        std::vector<ImportedSample> rows;
+        std::vector<std::tuple<std::string, std::string, short, bool, std::string>> batch, days;
+        bool success = true;
+
+        while (success) {
+            rows.clear();
+            if (!reader.read(rows, chunkRows)) {
+                success = false;
+                break;
+            }
+            if (rows.empty()) {
+                break;
+            }
+
+            const auto& hosts = reader.getHosts();
+            for (std::size_t i = ips.size(); i < hosts.size(); i++) {
+                ips.push_back(hosts[i].ip);
+                auto known = knownHosts.find(hosts[i].ip);
+                hostnames.push_back(!hosts[i].hostname.empty() ? hosts[i].hostname :
+                                    known != knownHosts.end() ? known->second : hosts[i].ip);
+            }
+
+            std::sort(rows.begin(), rows.end(), [](const ImportedSample& a, const ImportedSample& b) {
+                return std::tuple(window(a.time), a.host, a.time) < std::tuple(window(b.time), b.host, b.time);
+            });
+
+            for (std::size_t begin = 0; success && begin < rows.size();) {
+                std::size_t end = begin;
+                while (end < rows.size() && window(rows[end].time) == window(rows[begin].time)) {
+                    end++;
+                }
+                success = writeWindow(std::span(rows).subspan(begin, end - begin), ips, hostnames, batch, days);
+                begin = end;
+            }
+        }
+
+        // 无论成功与否都结束批量导入模式，已提交的窗口补建索引
+        if (!db.endBulkLoad()) {
+            success = false;
+        }
+        stats.skipped = reader.getSkipped();
+        stats.hosts = reader.getHosts().size();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return success;
+    }
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    static std::int64_t window(std::int64_t time) {
+        std::int64_t day = time / 86400 - (time % 86400 < 0 ? 1 : 0);
+        return day / WINDOW_DAYS - (day % WINDOW_DAYS < 0 ? 1 : 0);
+    }
+
+    // 一个窗口的样本：事务外按窗口内出现的日期准备分区，之后在一个事务中分批写入
+    bool writeWindow(std::span<const ImportedSample> rows, const std::vector<std::string>& ips,
+                     const std::vector<std::string>& hostnames,
+                     std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& batch,
+                     std::vector<std::tuple<std::string, std::string, short, bool, std::string>>& days) {
+        std::vector<ImportedSample> dayRows;
+        for (const auto& row : rows) {
+            if (std::none_of(dayRows.begin(), dayRows.end(),
+                             [&](const ImportedSample& day) { return day.time / 86400 == row.time / 86400; })) {
+                dayRows.push_back(row);
+            }
+        }
+        toPingResults(dayRows, ips, hostnames, days);
+        if (!db.prepareWrite(days) || !db.beginTransaction()) {
+            return false;
+        }
+
+        for (std::size_t offset = 0; offset < rows.size(); offset += BATCH_ROWS) {
+            toPingResults(rows.subspan(offset, std::min(BATCH_ROWS, rows.size() - offset)), ips, hostnames, batch);
+            if (!db.insertPingResults(batch)) {
+                db.rollbackTransaction();
+                return false;
+            }
+        }
+        if (!db.commitTransaction()) {
+            return false;
+        }
+        stats.rows += rows.size();
+        stats.transactions++;
+        return true;
+    }
+};
+
+#endif // SAMPLE_IMPORT_H
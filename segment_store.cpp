@@ -0,0 +1,564 @@
+#include "segment_store.h"
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char SEGMENT_MAGIC[4] = {'M', 'P', 'S', 'G'};
+constexpr std::uint32_t SEGMENT_VERSION = 1;
+constexpr std::int64_t SECONDS_PER_DAY = 86400;
+
+// 段文件头，之后依次是时间戳、延迟和成功标志三个列数据块（按本机字节序存放）
+struct SegmentHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::int64_t dayStart;
+    std::int64_t firstTime;
+    std::int64_t lastTime;
+    std::int64_t delaySum;      // 成功样本的延迟之和
+    std::uint32_t count;
+    std::uint32_t successes;
+    std::int32_t minDelay;      // 成功样本的最小/最大延迟，没有成功样本时为0
+    std::int32_t maxDelay;
+    std::uint32_t timeBytes;
+    std::uint32_t delayBytes;
+    std::uint32_t flagBytes;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(SegmentHeader) == 72, "segment header layout must stay stable");
+
+std::uint64_t zigzagEncode(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t zigzagDecode(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+void putVarint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline bool getVarint(const std::uint8_t*& pos, const std::uint8_t* end, std::uint64_t& value) {
+    value = 0;
+    for (int shift = 0; pos < end && shift < 64; shift += 7) {
+        std::uint8_t byte = *pos++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::int64_t daySeconds(std::chrono::sys_days day) {
+    return static_cast<std::int64_t>(day.time_since_epoch().count()) * SECONDS_PER_DAY;
+}
+
+std::string formatDay(std::chrono::sys_days day) {
+    std::chrono::year_month_day ymd{day};
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", static_cast<int>(ymd.year()),
+                  static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()));
+    return buffer;
+}
+
+// 只读映射一个段文件；析构时解除映射
+class MappedSegment {
+private:
+    void* data = MAP_FAILED;
+    std::size_t size = 0;
+    SegmentHeader segmentHeader{};
+    bool ok = false;
+
+public:
+    explicit MappedSegment(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(SegmentHeader)) {
+            size = static_cast<std::size_t>(st.st_size);
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (data == MAP_FAILED) {
+            return;
+        }
+        // 解码是从头到尾的顺序扫描
+        madvise(data, size, MADV_SEQUENTIAL);
+
+        std::memcpy(&segmentHeader, data, sizeof(SegmentHeader));
+        ok = std::memcmp(segmentHeader.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) == 0 &&
+             segmentHeader.version == SEGMENT_VERSION &&
+             sizeof(SegmentHeader) + static_cast<std::size_t>(segmentHeader.timeBytes) +
+                 segmentHeader.delayBytes + segmentHeader.flagBytes == size;
+    }
+
+    ~MappedSegment() {
+        if (data != MAP_FAILED) {
+            munmap(data, size);
+        }
+    }
+
+    MappedSegment(const MappedSegment&) = delete;
+    MappedSegment& operator=(const MappedSegment&) = delete;
+
+    bool valid() const {
+        return ok;
+    }
+
+    const SegmentHeader& header() const {
+        return segmentHeader;
+    }
+
+    const std::uint8_t* columns() const {
+        return static_cast<const std::uint8_t*>(data) + sizeof(SegmentHeader);
+    }
+};
+
+// 按时间顺序解码段内全部样本，visit返回false时停止；数据损坏时返回false
+template<typename Visit>
+bool decodeSegment(const MappedSegment& segment, Visit&& visit) {
+    const SegmentHeader& header = segment.header();
+    const std::uint8_t* timePos = segment.columns();
+    const std::uint8_t* timeEnd = timePos + header.timeBytes;
+    const std::uint8_t* delayPos = timeEnd;
+    const std::uint8_t* delayEnd = delayPos + header.delayBytes;
+    const std::uint8_t* flagPos = delayEnd;
+    const std::uint8_t* flagEnd = flagPos + header.flagBytes;
+
+    std::int64_t time = header.dayStart;
+    std::int64_t delta = 0;
+    std::int64_t delay = 0;
+    bool success = false;
+    std::uint64_t runLeft = 0;
+
+    for (std::uint32_t i = 0; i < header.count; ++i) {
+        std::uint64_t raw;
+        if (!getVarint(timePos, timeEnd, raw)) {
+            return false;
+        }
+        delta += zigzagDecode(raw);
+        time += delta;
+
+        if (!getVarint(delayPos, delayEnd, raw)) {
+            return false;
+        }
+        delay += zigzagDecode(raw);
+
+        // 游程交替表示成功和失败，第一段为成功（长度可以为0）
+        while (runLeft == 0) {
+            if (!getVarint(flagPos, flagEnd, runLeft)) {
+                return false;
+            }
+            success = !success;
+        }
+        runLeft--;
+
+        if (!visit(SegmentStore::Sample{time, static_cast<short>(delay), success})) {
+            return true;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void SegmentStore::Summary::add(const Sample& sample) {
+    total++;
+    if (!sample.success) {
+        return;
+    }
+    maxDelay = (successes == 0) ? sample.delay : std::max(maxDelay, static_cast<int>(sample.delay));
+    minDelay = (successes == 0) ? sample.delay : std::min(minDelay, static_cast<int>(sample.delay));
+    delaySum += sample.delay;
+    successes++;
+}
+
+void SegmentStore::Summary::merge(const Summary& other) {
+    total += other.total;
+    delaySum += other.delaySum;
+    if (other.successes > 0) {
+        maxDelay = (successes == 0) ? other.maxDelay : std::max(maxDelay, other.maxDelay);
+        minDelay = (successes == 0) ? other.minDelay : std::min(minDelay, other.minDelay);
+    }
+    successes += other.successes;
+}
+
+SegmentStore::SegmentStore(const std::string& directory) : directory(directory) {}
+
+const std::string& SegmentStore::getDirectory() const {
+    return directory;
+}
+
+void SegmentStore::setDirectory(const std::string& path) {
+    directory = path;
+}
+
+std::string SegmentStore::segmentPath(const std::string& ip, std::chrono::sys_days day) const {
+    return (std::filesystem::path(directory) / ip / (formatDay(day) + ".seg")).string();
+}
+
+std::optional<std::int64_t> SegmentStore::parseTimestamp(const std::string& timestamp) {
+    int year = 0;
+    unsigned month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    int fields = std::sscanf(timestamp.c_str(), "%d-%u-%u %u:%u:%u", &year, &month, &day, &hour, &minute, &second);
+    if (fields != 3 && fields != 5 && fields != 6) {
+        return std::nullopt;
+    }
+    std::chrono::year_month_day ymd{std::chrono::year{year}, std::chrono::month{month}, std::chrono::day{day}};
+    if (!ymd.ok() || hour > 23 || minute > 59 || second > 60) {
+        return std::nullopt;
+    }
+    return daySeconds(std::chrono::sys_days{ymd}) + hour * 3600 + minute * 60 + second;
+}
+
+bool SegmentStore::parseTimeRange(const std::string& since, const std::string& until, std::int64_t& sinceTime, std::int64_t& untilTime) {
+    auto sinceValue = since.empty() ? std::optional<std::int64_t>(std::numeric_limits<std::int64_t>::min()) : parseTimestamp(since);
+    auto untilValue = until.empty() ? std::optional<std::int64_t>(std::numeric_limits<std::int64_t>::max()) : parseTimestamp(until);
+    if (!sinceValue || !untilValue) {
+        std::cerr << "Invalid time range: " << since << " - " << until << std::endl;
+        return false;
+    }
+    sinceTime = *sinceValue;
+    untilTime = *untilValue;
+    return true;
+}
+
+std::string SegmentStore::formatTimestamp(std::int64_t seconds) {
+    std::int64_t days = seconds / SECONDS_PER_DAY;
+    std::int64_t rest = seconds % SECONDS_PER_DAY;
+    if (rest < 0) {
+        rest += SECONDS_PER_DAY;
+        days--;
+    }
+    std::chrono::year_month_day ymd{std::chrono::sys_days{std::chrono::days{days}}};
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u %02d:%02d:%02d", static_cast<int>(ymd.year()),
+                  static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()),
+                  static_cast<int>(rest / 3600), static_cast<int>(rest / 60 % 60), static_cast<int>(rest % 60));
+    return buffer;
+}
+
+bool SegmentStore::readDay(const std::string& ip, std::chrono::sys_days day, std::vector<Sample>& samples) const {
+    MappedSegment segment(segmentPath(ip, day));
+    if (!segment.valid()) {
+        std::cerr << "Invalid segment file: " << segmentPath(ip, day) << std::endl;
+        return false;
+    }
+    samples.reserve(samples.size() + segment.header().count);
+    return decodeSegment(segment, [&](const Sample& sample) {
+        samples.push_back(sample);
+        return true;
+    });
+}
+
+bool SegmentStore::writeDay(const std::string& ip, std::chrono::sys_days day, std::vector<Sample> samples) {
+    std::string path = segmentPath(ip, day);
+
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec) && !readDay(ip, day, samples)) {
+        return false;
+    }
+    if (samples.empty()) {
+        return true;
+    }
+
+    auto sampleKey = [](const Sample& sample) { return std::make_tuple(sample.time, sample.delay, sample.success); };
+    std::stable_sort(samples.begin(), samples.end(),
+                     [&](const Sample& a, const Sample& b) { return sampleKey(a) < sampleKey(b); });
+    samples.erase(std::unique(samples.begin(), samples.end(),
+                              [&](const Sample& a, const Sample& b) { return sampleKey(a) == sampleKey(b); }),
+                  samples.end());
+
+    // 按列编码
+    std::string times, delays, flags;
+    times.reserve(samples.size());
+    delays.reserve(samples.size());
+
+    SegmentHeader header{};
+    std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    header.version = SEGMENT_VERSION;
+    header.dayStart = daySeconds(day);
+    header.firstTime = samples.front().time;
+    header.lastTime = samples.back().time;
+    header.count = static_cast<std::uint32_t>(samples.size());
+
+    Summary summary;
+    std::int64_t previousTime = header.dayStart;
+    std::int64_t previousDelta = 0;
+    std::int64_t previousDelay = 0;
+    bool runValue = true;
+    std::uint64_t runLength = 0;
+
+    for (const auto& sample : samples) {
+        std::int64_t delta = sample.time - previousTime;
+        putVarint(times, zigzagEncode(delta - previousDelta));
+        previousDelta = delta;
+        previousTime = sample.time;
+
+        putVarint(delays, zigzagEncode(sample.delay - previousDelay));
+        previousDelay = sample.delay;
+
+        if (sample.success != runValue) {
+            putVarint(flags, runLength);
+            runValue = !runValue;
+            runLength = 0;
+        }
+        runLength++;
+
+        summary.add(sample);
+    }
+    putVarint(flags, runLength);
+
+    header.successes = static_cast<std::uint32_t>(summary.successes);
+    header.delaySum = static_cast<std::int64_t>(summary.delaySum);
+    header.minDelay = summary.minDelay;
+    header.maxDelay = summary.maxDelay;
+    header.timeBytes = static_cast<std::uint32_t>(times.size());
+    header.delayBytes = static_cast<std::uint32_t>(delays.size());
+    header.flagBytes = static_cast<std::uint32_t>(flags.size());
+
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    if (ec) {
+        std::cerr << "Failed to create segment directory for IP " << ip << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    // 先写临时文件并落盘，再原子替换，避免中断时留下不完整的段
+    std::string tempPath = path + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create segment file " << tempPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool written = true;
+    for (const auto& [buffer, length] : {std::pair<const void*, std::size_t>{&header, sizeof(header)},
+                                         std::pair<const void*, std::size_t>{times.data(), times.size()},
+                                         std::pair<const void*, std::size_t>{delays.data(), delays.size()},
+                                         std::pair<const void*, std::size_t>{flags.data(), flags.size()}}) {
+        const char* pos = static_cast<const char*>(buffer);
+        std::size_t left = length;
+        while (written && left > 0) {
+            ssize_t n = write(fd, pos, left);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                written = false;
+                break;
+            }
+            pos += n;
+            left -= static_cast<std::size_t>(n);
+        }
+    }
+    written = written && fsync(fd) == 0;
+    close(fd);
+
+    if (!written || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write segment file " << path << ": " << std::strerror(errno) << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::chrono::sys_days> SegmentStore::listDays(const std::string& ip) const {
+    std::vector<std::chrono::sys_days> days;
+    std::error_code ec;
+    std::filesystem::path hostDirectory = std::filesystem::path(directory) / ip;
+    if (!std::filesystem::is_directory(hostDirectory, ec)) {
+        return days;
+    }
+
+    for (const auto& entry : std::filesystem::directory_iterator(hostDirectory, ec)) {
+        if (entry.path().extension() != ".seg") {
+            continue;
+        }
+        auto seconds = parseTimestamp(entry.path().stem().string());
+        if (seconds) {
+            days.push_back(std::chrono::sys_days{std::chrono::days{*seconds / SECONDS_PER_DAY}});
+        }
+    }
+    std::sort(days.begin(), days.end());
+    return days;
+}
+
+bool SegmentStore::hasHost(const std::string& ip) const {
+    return !listDays(ip).empty();
+}
+
+bool SegmentStore::forEachSample(const std::string& ip, std::int64_t since, std::int64_t until,
+                                 const std::function<bool(const Sample&)>& visit) const {
+    for (auto day : listDays(ip)) {
+        std::int64_t dayStart = daySeconds(day);
+        if (dayStart + SECONDS_PER_DAY <= since || dayStart >= until) {
+            continue;
+        }
+        MappedSegment segment(segmentPath(ip, day));
+        if (!segment.valid()) {
+            std::cerr << "Invalid segment file: " << segmentPath(ip, day) << std::endl;
+            return false;
+        }
+        bool keepGoing = true;
+        bool decoded = decodeSegment(segment, [&](const Sample& sample) {
+            if (sample.time >= since && sample.time < until) {
+                keepGoing = visit(sample);
+            }
+            return keepGoing;
+        });
+        if (!decoded) {
+            std::cerr << "Corrupted segment file: " << segmentPath(ip, day) << std::endl;
+            return false;
+        }
+        if (!keepGoing) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool SegmentStore::summarize(const std::string& ip, const std::string& since, const std::string& until, Summary& summary,
+                             std::vector<std::tuple<std::string, int, int>>& recentRecords, std::size_t limit) const {
+    std::int64_t sinceTime = std::numeric_limits<std::int64_t>::min();
+    std::int64_t untilTime = std::numeric_limits<std::int64_t>::max();
+    if (!since.empty()) {
+        auto parsed = parseTimestamp(since);
+        if (!parsed) {
+            std::cerr << "Invalid time bound: " << since << std::endl;
+            return false;
+        }
+        sinceTime = *parsed;
+    }
+    if (!until.empty()) {
+        auto parsed = parseTimestamp(until);
+        if (!parsed) {
+            std::cerr << "Invalid time bound: " << until << std::endl;
+            return false;
+        }
+        untilTime = *parsed;
+    }
+
+    std::vector<std::chrono::sys_days> days = listDays(ip);
+    for (auto day : days) {
+        std::int64_t dayStart = daySeconds(day);
+        std::int64_t dayEnd = dayStart + SECONDS_PER_DAY;
+        if (dayEnd <= sinceTime || dayStart >= untilTime) {
+            continue;
+        }
+        MappedSegment segment(segmentPath(ip, day));
+        if (!segment.valid()) {
+            std::cerr << "Invalid segment file: " << segmentPath(ip, day) << std::endl;
+            return false;
+        }
+
+        // 整天都在范围内时直接使用文件头中的汇总，不需要解码
+        const SegmentHeader& header = segment.header();
+        if (header.firstTime >= sinceTime && header.lastTime < untilTime) {
+            Summary daySummary;
+            daySummary.total = header.count;
+            daySummary.successes = header.successes;
+            daySummary.delaySum = static_cast<double>(header.delaySum);
+            daySummary.minDelay = header.minDelay;
+            daySummary.maxDelay = header.maxDelay;
+            summary.merge(daySummary);
+            continue;
+        }
+
+        bool decoded = decodeSegment(segment, [&](const Sample& sample) {
+            if (sample.time >= sinceTime && sample.time < untilTime) {
+                summary.add(sample);
+            }
+            return sample.time < untilTime;
+        });
+        if (!decoded) {
+            std::cerr << "Corrupted segment file: " << segmentPath(ip, day) << std::endl;
+            return false;
+        }
+    }
+
+    // 最近的记录：从最新的一天往前解码，直到凑够limit条
+    std::size_t collected = 0;
+    for (auto it = days.rbegin(); it != days.rend() && collected < limit; ++it) {
+        std::int64_t dayStart = daySeconds(*it);
+        if (dayStart + SECONDS_PER_DAY <= sinceTime || dayStart >= untilTime) {
+            continue;
+        }
+        std::vector<Sample> daySamples;
+        if (!forEachSample(ip, std::max(sinceTime, dayStart), std::min(untilTime, dayStart + SECONDS_PER_DAY),
+                           [&](const Sample& sample) {
+                               daySamples.push_back(sample);
+                               return true;
+                           })) {
+            return false;
+        }
+        for (auto sample = daySamples.rbegin(); sample != daySamples.rend() && collected < limit; ++sample, ++collected) {
+            recentRecords.emplace_back(formatTimestamp(sample->time), sample->delay, sample->success ? 1 : 0);
+        }
+    }
+    return true;
+}
+
+int SegmentStore::removeBefore(std::chrono::sys_days cutoff) {
+    int removed = 0;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(directory, ec)) {
+        return 0;
+    }
+
+    std::vector<std::filesystem::path> hostDirectories;
+    for (const auto& hostEntry : std::filesystem::directory_iterator(directory, ec)) {
+        if (hostEntry.is_directory(ec)) {
+            hostDirectories.push_back(hostEntry.path());
+        }
+    }
+
+    for (const auto& hostDirectory : hostDirectories) {
+        std::string ip = hostDirectory.filename().string();
+        for (auto day : listDays(ip)) {
+            if (day >= cutoff) {
+                break;
+            }
+            if (std::filesystem::remove(segmentPath(ip, day), ec)) {
+                removed++;
+            }
+        }
+        // 目录为空时一并删除
+        if (std::filesystem::is_empty(hostDirectory, ec)) {
+            std::filesystem::remove(hostDirectory, ec);
+        }
+    }
+    return removed;
+}
+
+std::pair<std::uintmax_t, std::size_t> SegmentStore::diskUsage() const {
+    std::uintmax_t bytes = 0;
+    std::size_t files = 0;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(directory, ec)) {
+        return {0, 0};
+    }
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, ec)) {
+        if (entry.is_regular_file(ec) && entry.path().extension() == ".seg") {
+            bytes += entry.file_size(ec);
+            files++;
+        }
+    }
+    return {bytes, files};
+}
@@ -0,0 +1,79 @@
+#ifndef SEGMENT_STORE_H
+#define SEGMENT_STORE_H
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <functional>
+
+// 冷数据段存储：每台主机每天一个只读段文件 <directory>/<ip>/<YYYY-MM-DD>.seg
+// 段内按列压缩存放样本：时间戳为二阶差分（delta-of-delta）varint，延迟为差分zigzag varint，
+// 成功标志为游程编码；文件头保存当天的汇总统计，整天落在查询范围内时无需解码
+// 查询时通过mmap读取段文件
+class SegmentStore {
+public:
+    // 样本时间为本地时间的民用时间秒数（按UTC解释，与数据库中的TEXT时间戳一一对应）
+    struct Sample {
+        std::int64_t time;
+        short delay;
+        bool success;
+    };
+
+    struct Summary {
+        long long total = 0;
+        long long successes = 0;
+        double delaySum = 0;
+        int maxDelay = 0;
+        int minDelay = 0;
+
+        void add(const Sample& sample);
+        void merge(const Summary& other);
+    };
+
+private:
+    std::string directory;
+
+public:
+    explicit SegmentStore(const std::string& directory);
+
+    const std::string& getDirectory() const;
+    void setDirectory(const std::string& path);
+
+    // 写入一天的样本：与已有段合并、按时间排序并去掉完全相同的样本，
+    // 因此数据库删除前中断后重新执行分层不会产生重复数据
+    bool writeDay(const std::string& ip, std::chrono::sys_days day, std::vector<Sample> samples);
+
+    // 统计[since, until)范围内的样本（空字符串表示不限），并收集范围内最近的limit条记录 (timestamp, delay, success)
+    bool summarize(const std::string& ip, const std::string& since, const std::string& until, Summary& summary,
+                   std::vector<std::tuple<std::string, int, int>>& recentRecords, std::size_t limit = 10) const;
+
+    // 按时间顺序遍历[since, until)范围内的样本（秒数），visit返回false时停止
+    bool forEachSample(const std::string& ip, std::int64_t since, std::int64_t until,
+                       const std::function<bool(const Sample&)>& visit) const;
+
+    std::vector<std::chrono::sys_days> listDays(const std::string& ip) const;
+    bool hasHost(const std::string& ip) const;
+
+    // 删除早于cutoff的段文件，返回删除的文件数
+    int removeBefore(std::chrono::sys_days cutoff);
+
+    // 段文件占用的磁盘空间（字节）和段文件数量
+    std::pair<std::uintmax_t, std::size_t> diskUsage() const;
+
+    // 时间戳文本与秒数的转换；支持 YYYY-MM-DD、YYYY-MM-DD HH:MM 和 YYYY-MM-DD HH:MM:SS
+    static std::optional<std::int64_t> parseTimestamp(const std::string& timestamp);
+    static std::string formatTimestamp(std::int64_t seconds);
+
+    // 把查询范围的since/until转换为秒数，空字符串表示不限；任一端无法解析时输出错误并返回false
+    static bool parseTimeRange(const std::string& since, const std::string& until, std::int64_t& sinceTime, std::int64_t& untilTime);
+
+private:
+    std::string segmentPath(const std::string& ip, std::chrono::sys_days day) const;
+    bool readDay(const std::string& ip, std::chrono::sys_days day, std::vector<Sample>& samples) const;
+};
+
+#endif // SEGMENT_STORE_H
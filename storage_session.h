@@ -0,0 +1,135 @@
+#ifndef STORAGE_SESSION_H
+#define STORAGE_SESSION_H
+
+#include "alert_tracker.h"
+#include <iostream>
+#include <print>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <map>
+
+// 存储会话：一次打开数据库、只执行一次建表初始化，
+// 并把一轮ping的样本、主机信息、告警变更和恢复记录放在同一个事务中写入
+template<typename DatabaseType>
+class StorageSession {
+private:
+    // 每轮提交后最多回收的空闲页数，把清理留下的空闲空间分摊到多个周期
+    static constexpr int VACUUM_PAGES_PER_CYCLE = 256;
+
+    DatabaseType db;
+    AlertTracker alertTracker;
+    bool opened = false;
+
+public:
+    explicit StorageSession(const std::string& databasePath) : db(databasePath) {}
+
+    StorageSession(const StorageSession&) = delete;
+    StorageSession& operator=(const StorageSession&) = delete;
+
+    // 打开数据库并执行建表等初始化操作（重复调用不会重复初始化）
+    bool open() {
+        if (opened) {
+            return true;
+        }
+        if (!db.initialize()) {
+            std::println(std::cerr, "Failed to initialize database");
+            return false;
+        }
+        // 告警状态只在打开会话时加载一次，之后由每轮的状态变化增量维护
+        if (!db.loadAlertState()) {
+            std::println(std::cerr, "Failed to load alert state");
+            return false;
+        }
+        opened = true;
+        return true;
+    }
+
+    // 告警的确认规则（连续失败/成功轮数和抖动检测），默认一次失败即告警、一次成功即恢复
+    void setAlertPolicy(const AlertPolicy& policy) {
+        alertTracker.setPolicy(policy);
+    }
+
+    DatabaseType& database() {
+        return db;
+    }
+
+    std::map<std::string, std::string> getAllHosts() {
+        if (!open()) {
+            return {};
+        }
+        return db.getAllHosts();
+    }
+
+    // 在单个事务中写入一轮ping结果及其告警处理
+    // alerting非空时按其中确认的告警状态同步本轮主机的告警，不使用本会话的确认规则
+    bool writeCycle(const std::vector<std::tuple<std::string, std::string, bool, short, std::string>>& allResults,
+                    const AlertingHosts* alerting = nullptr) {
+        if (!open()) {
+            return false;
+        }
+
+        if (allResults.empty()) {
+            return true;
+        }
+
+        // 将结果转换为数据库所需的格式
+        std::vector<std::tuple<std::string, std::string, short, bool, std::string>> dbResults;
+        dbResults.reserve(allResults.size());
+        for (const auto& [ip, hostname, result, delay, timestamp] : allResults) {
+            dbResults.emplace_back(ip, hostname, delay, result, timestamp);
+        }
+
+        // 分区等需要在事务外完成的准备工作
+        if (!db.prepareWrite(dbResults) || !db.beginTransaction()) {
+            return false;
+        }
+
+        bool success = db.insertPingResults(dbResults);
+        if (!success) {
+            std::println(std::cerr, "Failed to insert ping results into database");
+        }
+
+        // 处理告警：只写入经过确认的状态变化（达到连续失败或成功轮数、且不在抖动中的主机）
+        if (success) {
+            std::vector<std::pair<std::string, std::string>> newlyDown;
+            std::vector<std::string> newlyUp;
+            for (const auto& [ip, hostname, successFlag, delay, timestamp] : allResults) {
+                if (alerting) {
+                    bool active = db.isAlertActive(ip);
+                    if (alerting->contains(ip) && !active) {
+                        newlyDown.emplace_back(ip, hostname);
+                    } else if (!alerting->contains(ip) && active) {
+                        newlyUp.push_back(ip);
+                    }
+                    continue;
+                }
+                auto transition = alertTracker.observe(ip, successFlag, db.isAlertActive(ip));
+                if (transition == AlertTracker::Transition::RAISE) {
+                    newlyDown.emplace_back(ip, hostname);
+                } else if (transition == AlertTracker::Transition::CLEAR) {
+                    newlyUp.push_back(ip);
+                }
+            }
+            success = db.applyAlertTransitions(newlyDown, newlyUp);
+            if (!success) {
+                std::println(std::cerr, "Failed to apply alert transitions");
+            }
+        }
+
+        if (success) {
+            if (db.commitTransaction()) {
+                db.reclaimFreePages(VACUUM_PAGES_PER_CYCLE);
+                return true;
+            }
+            db.loadAlertState();
+            return false;
+        }
+        db.rollbackTransaction();
+        // 事务回滚后内存中的告警状态可能与数据库不一致，重新加载
+        db.loadAlertState();
+        return false;
+    }
+};
+
+#endif // STORAGE_SESSION_H
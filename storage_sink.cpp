@@ -0,0 +1,185 @@
+#include "storage_sink.h"
+#include <iostream>
+#include <print>
+#include <utility>
+
+void StorageSinkRegistry::add(const std::string& type, Factory factory) {
+    factories[type] = std::move(factory);
+}
+
+bool StorageSinkRegistry::contains(const std::string& type) const {
+    return factories.contains(type);
+}
+
+std::vector<std::string> StorageSinkRegistry::types() const {
+    std::vector<std::string> names;
+    for (const auto& [type, factory] : factories) {
+        names.push_back(type);
+    }
+    return names;
+}
+
+std::unique_ptr<StorageSink> StorageSinkRegistry::create(const std::string& spec) const {
+    std::size_t separator = spec.find(':');
+    if (separator == std::string::npos || separator == 0 || separator + 1 == spec.size()) {
+        std::println(std::cerr, "Invalid sink '{}' (expected <type>:<target>)", spec);
+        return nullptr;
+    }
+    auto it = factories.find(spec.substr(0, separator));
+    if (it == factories.end()) {
+        std::println(std::cerr, "Unknown sink type '{}'", spec.substr(0, separator));
+        return nullptr;
+    }
+    return it->second(spec.substr(separator + 1));
+}
+
+SinkFanout::SinkFanout(std::size_t queueCapacity) : queueCapacity(queueCapacity) {}
+
+SinkFanout::~SinkFanout() {
+    close();
+}
+
+void SinkFanout::add(const std::string& name, std::unique_ptr<StorageSink> sink) {
+    auto channel = std::make_unique<Channel>();
+    channel->name = name;
+    channel->sink = std::move(sink);
+    channels.push_back(std::move(channel));
+}
+
+std::size_t SinkFanout::open() {
+    // 打开可能需要建立网络连接或执行建表，各目标并行进行
+    std::vector<std::thread> openers;
+    for (auto& channel : channels) {
+        openers.emplace_back([&channel] {
+            channel->opened = channel->sink->open();
+        });
+    }
+    for (auto& opener : openers) {
+        opener.join();
+    }
+
+    std::size_t openedCount = 0;
+    for (auto& channel : channels) {
+        if (!channel->opened) {
+            std::println(std::cerr, "Failed to open sink {}", channel->name);
+            continue;
+        }
+        openedCount++;
+        Channel& target = *channel;
+        channel->worker = std::thread([this, &target] { run(target); });
+    }
+    return openedCount;
+}
+
+std::map<std::string, std::string> SinkFanout::getAllHosts() {
+    // 写入线程只在队列非空时访问目标，第一次submit之前由调用者独占
+    for (auto& channel : channels) {
+        if (channel->opened) {
+            return channel->sink->getAllHosts();
+        }
+    }
+    return {};
+}
+
+std::vector<std::tuple<std::string, std::string, std::string>> SinkFanout::getActiveAlerts() {
+    for (auto& channel : channels) {
+        if (channel->opened) {
+            return channel->sink->getActiveAlerts();
+        }
+    }
+    return {};
+}
+
+void SinkFanout::submit(const PingCycle& cycle, std::shared_ptr<const AlertingHosts> alerting) {
+    for (auto& channel : channels) {
+        if (!channel->opened) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            if (channel->queue.size() >= queueCapacity) {
+                channel->queue.pop_front();
+                channel->stats.dropped++;
+            }
+            channel->queue.emplace_back(cycle, alerting);
+        }
+        channel->ready.notify_one();
+    }
+}
+
+void SinkFanout::flush() {
+    for (auto& channel : channels) {
+        std::unique_lock<std::mutex> lock(channel->mutex);
+        channel->idle.wait(lock, [&] { return channel->queue.empty() && !channel->busy; });
+    }
+}
+
+bool SinkFanout::close() {
+    for (auto& channel : channels) {
+        {
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            channel->closing = true;
+        }
+        channel->ready.notify_one();
+    }
+
+    bool success = true;
+    for (auto& channel : channels) {
+        if (channel->worker.joinable()) {
+            channel->worker.join();
+        }
+        success = success && channel->opened && channel->stats.failed == 0 && channel->stats.dropped == 0;
+    }
+    return success;
+}
+
+SinkFanout::SinkStats SinkFanout::stats(std::size_t index) {
+    std::lock_guard<std::mutex> lock(channels[index]->mutex);
+    return channels[index]->stats;
+}
+
+void SinkFanout::printStats(std::ostream& out) {
+    for (auto& channel : channels) {
+        if (channels.size() > 1) {
+            out << "Sink " << channel->name << ": "
+                << (channel->opened ? "" : "not opened, ")
+                << channel->stats.written << " cycles written, "
+                << channel->stats.failed << " failed, "
+                << channel->stats.dropped << " dropped" << std::endl;
+        }
+        if (channel->opened) {
+            channel->sink->printStats(out);
+        }
+    }
+}
+
+// 写入线程：依次取出队列中的轮次写入目标，关闭时先写完剩余的轮次
+void SinkFanout::run(Channel& channel) {
+    std::unique_lock<std::mutex> lock(channel.mutex);
+    while (true) {
+        channel.ready.wait(lock, [&] { return !channel.queue.empty() || channel.closing; });
+        if (channel.queue.empty()) {
+            return;
+        }
+        auto [cycle, alerting] = std::move(channel.queue.front());
+        channel.queue.pop_front();
+        channel.busy = true;
+        lock.unlock();
+
+        bool written = channel.sink->writeCycle(cycle, alerting.get());
+        if (!written) {
+            std::println(std::cerr, "Failed to store ping results in sink {}", channel.name);
+        }
+
+        lock.lock();
+        channel.busy = false;
+        if (written) {
+            channel.stats.written++;
+        } else {
+            channel.stats.failed++;
+        }
+        if (channel.queue.empty()) {
+            channel.idle.notify_all();
+        }
+    }
+}
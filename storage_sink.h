@@ -0,0 +1,174 @@
+#ifndef STORAGE_SINK_H
+#define STORAGE_SINK_H
+
+#include "storage_session.h"
+#include <string>
+#include <vector>
+#include <tuple>
+#include <map>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+
+// 一轮ping结果：(IP, 主机名, 是否成功, 延迟, 时间戳)
+using PingCycle = std::vector<std::tuple<std::string, std::string, bool, short, std::string>>;
+
+// 存储目标的运行时接口：每个后端通过SessionSink适配，由StorageSinkRegistry按名称创建
+class StorageSink {
+public:
+    virtual ~StorageSink() = default;
+
+    virtual bool open() = 0;
+    virtual std::map<std::string, std::string> getAllHosts() = 0;
+    // alerting为常驻模式确认后的告警主机（见AlertingHosts），为空时由目标按默认规则判断告警
+    virtual bool writeCycle(const PingCycle& cycle, const AlertingHosts* alerting) = 0;
+
+    // 目标中的活动告警 (IP, 主机名, 创建时间)，默认没有告警
+    virtual std::vector<std::tuple<std::string, std::string, std::string>> getActiveAlerts() { return {}; }
+
+    // 向out输出后端自身的统计信息（例如连接池），默认不输出
+    virtual void printStats(std::ostream&) {}
+};
+
+// 把StorageSession<DatabaseType>包装为StorageSink；后端特有的设置通过回调注入，
+// 使本头文件不依赖任何具体后端
+template<typename DatabaseType>
+class SessionSink : public StorageSink {
+public:
+    struct Hooks {
+        std::function<bool(DatabaseType&)> beforeOpen;  // 打开之前（如环形日志容量、连接池大小）
+        std::function<bool(DatabaseType&)> afterOpen;   // 打开之后（如分区周期、样本布局）
+        std::function<void(DatabaseType&, std::ostream&)> report;  // 输出统计信息
+    };
+
+private:
+    StorageSession<DatabaseType> session;
+    Hooks hooks;
+
+public:
+    SessionSink(const std::string& target, Hooks hooks) : session(target), hooks(std::move(hooks)) {}
+
+    bool open() override {
+        if (hooks.beforeOpen && !hooks.beforeOpen(session.database())) {
+            return false;
+        }
+        if (!session.open()) {
+            return false;
+        }
+        return !hooks.afterOpen || hooks.afterOpen(session.database());
+    }
+
+    std::map<std::string, std::string> getAllHosts() override {
+        return session.getAllHosts();
+    }
+
+    bool writeCycle(const PingCycle& cycle, const AlertingHosts* alerting) override {
+        return session.writeCycle(cycle, alerting);
+    }
+
+    std::vector<std::tuple<std::string, std::string, std::string>> getActiveAlerts() override {
+        if (!session.open()) {
+            return {};
+        }
+        return session.database().getActiveAlerts(-1);
+    }
+
+    void printStats(std::ostream& out) override {
+        if (hooks.report) {
+            hooks.report(session.database(), out);
+        }
+    }
+};
+
+// 存储目标注册表：类型名 -> 工厂函数，目标以"类型:参数"的形式指定（如 sqlite:buffer.db）
+class StorageSinkRegistry {
+public:
+    using Factory = std::function<std::unique_ptr<StorageSink>(const std::string& target)>;
+
+private:
+    std::map<std::string, Factory> factories;
+
+public:
+    void add(const std::string& type, Factory factory);
+    bool contains(const std::string& type) const;
+    std::vector<std::string> types() const;
+
+    // 按"类型:参数"创建存储目标，格式错误或类型未注册时返回nullptr
+    std::unique_ptr<StorageSink> create(const std::string& spec) const;
+};
+
+// 扇出写入：每个存储目标有自己的写入线程和有界队列
+// submit只把一轮结果放入各队列后立即返回，慢的目标不会阻塞探测，也不会阻塞其他目标
+// 队列满时丢弃最旧的一轮并计数；丢弃的轮次不会使目标的告警与内存状态不一致，
+// 因为每轮都带有完整的告警主机集合，下一轮写入时按它同步
+class SinkFanout {
+public:
+    // 每个目标的写入统计
+    struct SinkStats {
+        std::uint64_t written = 0;
+        std::uint64_t failed = 0;
+        std::uint64_t dropped = 0;
+    };
+
+private:
+    struct Channel {
+        std::string name;
+        std::unique_ptr<StorageSink> sink;
+        bool opened = false;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::condition_variable idle;
+        std::deque<std::pair<PingCycle, std::shared_ptr<const AlertingHosts>>> queue;
+        bool busy = false;
+        bool closing = false;
+        SinkStats stats;
+    };
+
+    std::size_t queueCapacity;
+    std::vector<std::unique_ptr<Channel>> channels;
+
+public:
+    explicit SinkFanout(std::size_t queueCapacity = 16);
+    ~SinkFanout();
+
+    SinkFanout(const SinkFanout&) = delete;
+    SinkFanout& operator=(const SinkFanout&) = delete;
+
+    void add(const std::string& name, std::unique_ptr<StorageSink> sink);
+    std::size_t size() const { return channels.size(); }
+
+    // 并行打开全部目标并启动写入线程，返回成功打开的目标数；打开失败的目标不再接收数据
+    std::size_t open();
+
+    // 从第一个成功打开的目标读取主机列表，只能在第一次submit之前调用
+    std::map<std::string, std::string> getAllHosts();
+    // 从第一个成功打开的目标读取活动告警，同样只能在第一次submit之前调用
+    std::vector<std::tuple<std::string, std::string, std::string>> getActiveAlerts();
+
+    // 把一轮结果和确认后的告警主机（单次运行时为空）放入每个已打开目标的队列，不等待写入
+    void submit(const PingCycle& cycle, std::shared_ptr<const AlertingHosts> alerting = nullptr);
+
+    // 等待所有队列写完
+    void flush();
+
+    // 写完队列中剩余的数据并停止写入线程（可重复调用）；全部目标都打开且没有失败和丢弃时返回true
+    bool close();
+
+    SinkStats stats(std::size_t index);
+    const std::string& name(std::size_t index) const { return channels[index]->name; }
+
+    // 输出每个目标的写入统计和后端自身的统计，只能在close之后调用
+    void printStats(std::ostream& out);
+
+private:
+    void run(Channel& channel);
+};
+
+#endif // STORAGE_SINK_H
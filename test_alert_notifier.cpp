@@ -0,0 +1,240 @@
+#include "alert_notifier.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// 本机的webhook替身：记录每个POST的正文，按给定的状态码依次应答，之后都回答200
+class WebhookStandIn {
+private:
+    int listener = -1;
+    std::thread worker;
+    std::vector<int> statuses;
+    std::chrono::milliseconds delay;
+
+public:
+    std::mutex mutex;
+    std::vector<std::string> bodies;
+    int port = 0;
+
+    WebhookStandIn(std::vector<int> statuses, std::chrono::milliseconds delay) : statuses(std::move(statuses)), delay(delay) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        listen(listener, 16);
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+        port = ntohs(address.sin_port);
+        worker = std::thread([this] { run(); });
+    }
+
+    ~WebhookStandIn() {
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+        worker.join();
+    }
+
+    void run() {
+        std::size_t served = 0;
+        while (true) {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) {
+                return;
+            }
+            std::string request;
+            char buffer[4096];
+            std::size_t headerEnd = std::string::npos;
+            std::size_t contentLength = 0;
+            while (headerEnd == std::string::npos || request.size() < headerEnd + 4 + contentLength) {
+                ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+                if (received <= 0) {
+                    break;
+                }
+                request.append(buffer, static_cast<std::size_t>(received));
+                if (headerEnd == std::string::npos && (headerEnd = request.find("\r\n\r\n")) != std::string::npos) {
+                    std::size_t field = request.find("Content-Length: ");
+                    contentLength = field < headerEnd ? std::stoul(request.substr(field + 16)) : 0;
+                }
+            }
+            std::this_thread::sleep_for(delay);
+            int status = served < statuses.size() ? statuses[served] : 200;
+            served++;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bodies.push_back(headerEnd == std::string::npos ? "" : request.substr(headerEnd + 4));
+            }
+            std::string response = "HTTP/1.1 " + std::to_string(status) + " X\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            send(client, response.data(), response.size(), MSG_NOSIGNAL);
+            close(client);
+        }
+    }
+};
+
+// Unix套接字接收端：每个连接读到对端关闭，记录收到的内容
+class SocketStandIn {
+private:
+    int listener = -1;
+    std::thread worker;
+    std::string path;
+
+public:
+    std::mutex mutex;
+    std::vector<std::string> lines;
+
+    explicit SocketStandIn(std::string socketPath) : path(std::move(socketPath)) {
+        unlink(path.c_str());
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        listen(listener, 16);
+        worker = std::thread([this] {
+            while (true) {
+                int client = accept(listener, nullptr, nullptr);
+                if (client < 0) {
+                    return;
+                }
+                std::string data;
+                char buffer[4096];
+                ssize_t received;
+                while ((received = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+                    data.append(buffer, static_cast<std::size_t>(received));
+                }
+                close(client);
+                std::lock_guard<std::mutex> lock(mutex);
+                lines.push_back(data);
+            }
+        });
+    }
+
+    ~SocketStandIn() {
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+        worker.join();
+        unlink(path.c_str());
+    }
+};
+
+static std::string readFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+int main() {
+    // 合并摘要：37台主机在10.2.0.0/16中故障，1台主机恢复
+    std::vector<AlertEvent> outage;
+    for (int i = 0; i < 37; i++) {
+        outage.push_back({true, "10.2." + std::to_string(i * 5) + "." + std::to_string(i + 1), "edge" + std::to_string(i),
+                          "2024-03-01 08:00:00"});
+    }
+    std::vector<AlertEvent> mixed = outage;
+    mixed.push_back({false, "10.0.0.1", "web \"1\"", "2024-03-01 08:00:00"});
+    std::string summary = AlertNotifier::summarize(mixed);
+    if (summary != "37 hosts down in 10.2.0.0/16; web \"1\" (10.0.0.1) up") {
+        std::cerr << "ERROR: Unexpected summary: " << summary << std::endl;
+        return 1;
+    }
+    std::string message = AlertNotifier::formatMessage({mixed.back()}, "web up");
+    if (message != "{\"summary\":\"web up\",\"down\":[],\"up\":[{\"ip\":\"10.0.0.1\",\"hostname\":\"web \\\"1\\\"\",\"timestamp\":\"2024-03-01 08:00:00\"}]}") {
+        std::cerr << "ERROR: Unexpected message: " << message << std::endl;
+        return 1;
+    }
+    std::cout << "Summary: " << summary << std::endl;
+
+    // 三个目标：第一次请求返回503并延迟300ms的webhook、Unix套接字和命令
+    WebhookStandIn webhook({503}, std::chrono::milliseconds(300));
+    SocketStandIn receiver("test_alert_notifier.sock");
+    std::remove("test_alert_notifier.exec");
+    AlertNotifier::Options options;
+    options.coalesceWindow = std::chrono::milliseconds(200);
+    options.initialBackoff = std::chrono::milliseconds(50);
+    options.maxAttempts = 3;
+    AlertNotifier notifier(options);
+    for (const auto& spec : {"webhook:http://127.0.0.1:" + std::to_string(webhook.port) + "/hook",
+                                   std::string("unix:test_alert_notifier.sock"),
+                                   std::string("exec:cat >> test_alert_notifier.exec; echo \"$MPING_ALERT_SUMMARY\" >> test_alert_notifier.exec")}) {
+        auto sink = createNotificationSink(spec);
+        if (!sink) {
+            std::cerr << "ERROR: Failed to create " << spec << std::endl;
+            return 1;
+        }
+        notifier.add(spec.substr(0, spec.find(':')), std::move(sink));
+    }
+    notifier.start();
+
+    // 窗口内分三次提交的变化合并为一条通知；发送和重试期间提交不等待
+    double slowest = 0;
+    auto timedSubmit = [&](const std::vector<AlertEvent>& events) {
+        auto start = std::chrono::steady_clock::now();
+        notifier.submit(events);
+        slowest = std::max(slowest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    };
+    timedSubmit({outage.begin(), outage.begin() + 10});
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    timedSubmit({outage.begin() + 10, outage.begin() + 20});
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    timedSubmit({outage.begin() + 20, outage.end()});
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    timedSubmit({mixed.back()});
+    if (!notifier.close()) {
+        std::cerr << "ERROR: Notifications were not delivered" << std::endl;
+        return 1;
+    }
+
+    auto stats = notifier.stats();
+    std::string executed = readFile("test_alert_notifier.exec");
+    bool expected = stats.events == 38 && stats.messages == 2 && stats.sent == 6 && stats.retries == 1 && stats.failed == 0 &&
+                    webhook.bodies.size() == 3 && webhook.bodies[0] == webhook.bodies[1] &&
+                    webhook.bodies[0].starts_with("{\"summary\":\"37 hosts down in 10.2.0.0/16\",\"down\":[{\"ip\":\"10.2.0.1\"") &&
+                    webhook.bodies[2].starts_with("{\"summary\":\"web \\\"1\\\" (10.0.0.1) up\"") &&
+                    receiver.lines.size() == 2 && receiver.lines[0] == webhook.bodies[0] + "\n" &&
+                    executed == webhook.bodies[0] + "\n37 hosts down in 10.2.0.0/16\n" + webhook.bodies[2] + "\nweb \"1\" (10.0.0.1) up\n";
+    if (!expected) {
+        std::cerr << "ERROR: Unexpected deliveries: " << stats.messages << " messages, " << stats.sent << " sent, "
+                  << stats.retries << " retries, " << webhook.bodies.size() << " webhook requests\n" << executed << std::endl;
+        return 1;
+    }
+    if (slowest > 50) {
+        std::cerr << "ERROR: submit blocked for " << slowest << " ms" << std::endl;
+        return 1;
+    }
+    std::cout << "Delivered 38 transitions in " << stats.messages << " messages to 3 targets, slowest submit "
+              << slowest << " ms" << std::endl;
+
+    // 无法送达的目标在重试次数用完后放弃，并在关闭时报告失败
+    AlertNotifier failing(options);
+    failing.add("unix", createNotificationSink("unix:test_alert_notifier.missing.sock"));
+    failing.start();
+    failing.submit({outage.front()});
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    if (failing.close() || failing.stats().failed != 1 || failing.stats().retries != 2) {
+        std::cerr << "ERROR: Undeliverable notification was not reported" << std::endl;
+        return 1;
+    }
+    if (createNotificationSink("webhook:https://example.com/") || createNotificationSink("pager:x") ||
+        createNotificationSink("webhook:http://host:99999/")) {
+        std::cerr << "ERROR: Invalid notification targets were accepted" << std::endl;
+        return 1;
+    }
+    std::cout << "Undeliverable and invalid targets are reported" << std::endl;
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "alert_tracker.h"
+#include "database_manager.h"
+#include "storage_session.h"
+#include "live_state.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <cstdio>
+
+using Transition = AlertTracker::Transition;
+
+// 按给定的结果序列驱动状态机，调用者按返回的变化维护告警状态；返回变化的次数
+static int drive(AlertTracker& tracker, const std::string& ip, const std::vector<bool>& results, bool& alerting) {
+    int transitions = 0;
+    for (bool success : results) {
+        auto transition = tracker.observe(ip, success, alerting);
+        if (transition != Transition::NONE) {
+            alerting = transition == Transition::RAISE;
+            transitions++;
+        }
+    }
+    return transitions;
+}
+
+int main() {
+    // 连续3次失败才告警，连续2次成功才恢复；中间的一次成功会打断连续失败
+    AlertTracker tracker({3, 2, 0, 5});
+    bool alerting = false;
+    if (drive(tracker, "10.0.0.1", {false, false, true, false, false}, alerting) != 0 || alerting ||
+        tracker.observe("10.0.0.1", false, false) != Transition::RAISE) {
+        std::cerr << "ERROR: Alert must need three consecutive failures" << std::endl;
+        return 1;
+    }
+    alerting = true;
+    if (drive(tracker, "10.0.0.1", {true, false, true}, alerting) != 0 ||
+        tracker.observe("10.0.0.1", true, true) != Transition::CLEAR) {
+        std::cerr << "ERROR: Recovery must need two consecutive successes" << std::endl;
+        return 1;
+    }
+    std::cout << "Hysteresis thresholds are applied" << std::endl;
+
+    // 抖动检测：10轮窗口内改变4次即进入抖动，之后交替的结果不再产生变化
+    AlertTracker flapTracker({1, 1, 10, 4});
+    alerting = false;
+    std::vector<bool> alternating;
+    for (int i = 0; i < 100; i++) {
+        alternating.push_back(i % 2 == 0);
+    }
+    int transitions = drive(flapTracker, "10.0.0.2", alternating, alerting);
+    if (transitions != 3 || !flapTracker.isFlapping("10.0.0.2") || flapTracker.flappingCount() != 1 || !alerting) {
+        std::cerr << "ERROR: Flapping host produced " << transitions << " transitions" << std::endl;
+        return 1;
+    }
+    // 结果稳定后窗口内的改变减少到阈值的一半以下，退出抖动并按连续成功恢复
+    transitions = drive(flapTracker, "10.0.0.2", std::vector<bool>(10, true), alerting);
+    if (transitions != 1 || alerting || flapTracker.isFlapping("10.0.0.2") || flapTracker.flappingCount() != 0) {
+        std::cerr << "ERROR: Host did not leave the flapping state" << std::endl;
+        return 1;
+    }
+    std::cout << "Flapping host held its state for " << alternating.size() << " alternating cycles" << std::endl;
+
+    // 存储会话只写入确认的变化：抖动的主机不产生告警和恢复记录
+    std::remove("test_alert_tracker.db");
+    StorageSession<DatabaseManager> session("test_alert_tracker.db");
+    session.setAlertPolicy({2, 2, 0, 5});
+    if (!session.open()) {
+        std::cerr << "ERROR: Failed to open storage session" << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < 20; i++) {
+        std::string timestamp = "2024-01-01 10:" + std::string(i < 10 ? "0" : "") + std::to_string(i) + ":00";
+        std::vector<std::tuple<std::string, std::string, bool, short, std::string>> cycle = {
+            {"192.168.1.1", "steady", i < 3 || i >= 5, 10, timestamp},  // 第3、4轮失败
+            {"192.168.1.2", "flappy", i % 2 == 0, 10, timestamp},
+        };
+        if (!session.writeCycle(cycle)) {
+            std::cerr << "ERROR: Failed to write cycle " << i << std::endl;
+            return 1;
+        }
+        bool alertExpected = i == 4 || i == 5;
+        if (session.database().isAlertActive("192.168.1.1") != alertExpected || session.database().isAlertActive("192.168.1.2")) {
+            std::cerr << "ERROR: Unexpected alert state after cycle " << i << std::endl;
+            return 1;
+        }
+    }
+    auto records = session.database().getRecoveryRecords();
+    if (records.size() != 1 || std::get<1>(records[0]) != "192.168.1.1") {
+        std::cerr << "ERROR: Expected one recovery record, found " << records.size() << std::endl;
+        return 1;
+    }
+    std::cout << "Only confirmed transitions were persisted" << std::endl;
+
+    // 常驻模式的内存告警使用同样的规则
+    LiveState state({{"10.0.0.3", "edge"}}, 8);
+    state.setAlertPolicy({2, 1, 8, 3});
+    std::string body;
+    state.applyCycle({{"10.0.0.3", "edge", false, 0, "2024-01-01 11:00:00"}}, 0.1);
+    if (!state.handle("alerts", body) || !body.empty()) {
+        std::cerr << "ERROR: One failure must not raise an alert in memory" << std::endl;
+        return 1;
+    }
+    state.applyCycle({{"10.0.0.3", "edge", false, 0, "2024-01-01 11:01:00"}}, 0.1);
+    if (!state.handle("alerts", body) || body != "alert\t10.0.0.3\tedge\t2024-01-01 11:01:00\n") {
+        std::cerr << "ERROR: Unexpected alerts in memory: " << body << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < 4; i++) {
+        state.applyCycle({{"10.0.0.3", "edge", i % 2 == 0, 0, "2024-01-01 11:02:00"}}, 0.1);
+    }
+    body.clear();
+    if (!state.handle("stats", body) || body.find("flapping\t1\n") == std::string::npos) {
+        std::cerr << "ERROR: Flapping host missing from stats:\n" << body << std::endl;
+        return 1;
+    }
+    std::cout << "Live state follows the same alert policy" << std::endl;
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
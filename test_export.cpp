@@ -0,0 +1,155 @@
+#include "database_manager.h"
+#include "sample_export.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <memory>
+#include <map>
+#include <vector>
+#include <tuple>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+// 以3个工作线程、每批7个样本导出，返回CSV中每台主机的 (时间戳, 延迟, 成功) 行
+static bool exportCsv(const std::vector<std::string>& hosts, const std::string& since,
+                      std::map<std::string, std::vector<std::tuple<std::string, int, int>>>& rows, SampleExporter::Stats& stats) {
+    std::FILE* out = std::fopen("test_export.csv", "wb");
+    auto writer = SampleWriter::create("csv", out);
+    SampleExporter exporter(*writer, 3, 7);
+    bool success = exporter.run(hosts, [&since]() -> SampleExporter::HostReader {
+        auto db = std::make_shared<DatabaseManager>("test_export.db");
+        if (!db->initialize()) {
+            return nullptr;
+        }
+        return [db, &since](const std::string& ip, const SampleExporter::SampleVisitor& visit) {
+            return db->forEachSample(ip, since, "", visit);
+        };
+    });
+    std::fclose(out);
+    stats = exporter.getStats();
+
+    std::ifstream in("test_export.csv");
+    std::string line;
+    std::getline(in, line);
+    if (line != "ip,timestamp,delay,success") {
+        std::cerr << "ERROR: Unexpected CSV header: " << line << std::endl;
+        return false;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string ip, timestamp, delay, successFlag;
+        std::getline(fields, ip, ',');
+        std::getline(fields, timestamp, ',');
+        std::getline(fields, delay, ',');
+        std::getline(fields, successFlag, ',');
+        rows[ip].emplace_back(timestamp, std::stoi(delay), std::stoi(successFlag));
+    }
+    return success;
+}
+
+int main() {
+    std::remove("test_export.db");
+    std::filesystem::remove_all("test_export.db.segments");
+
+    // 每台主机10个旧样本（分层到段文件）和20个原始样本
+    std::map<std::string, std::vector<std::tuple<std::string, int, int>>> expected;
+    {
+        DatabaseManager db("test_export.db");
+        if (!db.initialize()) {
+            std::cerr << "Failed to initialize database" << std::endl;
+            return 1;
+        }
+        std::vector<std::tuple<std::string, std::string, short, bool, std::string>> oldResults, newResults;
+        for (int host = 1; host <= 3; host++) {
+            std::string ip = "192.168.3." + std::to_string(host);
+            for (int minute = 0; minute < 30; minute++) {
+                char timestamp[32];
+                std::snprintf(timestamp, sizeof(timestamp), "%s 00:%02d:00", minute < 10 ? "2024-01-01" : "2099-01-01", minute);
+                short delay = static_cast<short>(host * 100 + minute);
+                bool success = minute % 3 != 0;
+                (minute < 10 ? oldResults : newResults).emplace_back(ip, "host" + std::to_string(host), delay, success, timestamp);
+                expected[ip].emplace_back(timestamp, delay, success ? 1 : 0);
+            }
+        }
+        if (!db.insertPingResults(oldResults)) {
+            std::cerr << "Failed to insert samples" << std::endl;
+            return 1;
+        }
+        db.tierColdData(30);
+        if (!db.insertPingResults(newResults)) {
+            std::cerr << "Failed to insert samples" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::string> hosts = {"192.168.3.1", "192.168.3.2", "192.168.3.3", "192.168.3.9"};
+    std::map<std::string, std::vector<std::tuple<std::string, int, int>>> rows;
+    SampleExporter::Stats stats;
+    if (!exportCsv(hosts, "", rows, stats)) {
+        std::cerr << "ERROR: Export failed" << std::endl;
+        return 1;
+    }
+    std::cout << "Exported " << stats.samples << " samples from " << stats.hosts << " hosts in " << stats.batches << " batches" << std::endl;
+    if (rows != expected || stats.samples != 90 || stats.hosts != 4) {
+        std::cerr << "ERROR: Exported rows do not match the inserted samples" << std::endl;
+        return 1;
+    }
+
+    // 时间范围：只导出原始样本中的后半部分
+    rows.clear();
+    if (!exportCsv(hosts, "2099-01-01 00:20:00", rows, stats) || stats.samples != 30 ||
+        rows["192.168.3.2"].front() != expected["192.168.3.2"][20]) {
+        std::cerr << "ERROR: Time range was not applied" << std::endl;
+        return 1;
+    }
+    std::cout << "Time range export returned " << stats.samples << " samples" << std::endl;
+
+    // Arrow IPC文件：以魔数开头和结尾，Footer长度位于末尾魔数之前
+    std::FILE* out = std::fopen("test_export.arrow", "wb");
+    auto writer = SampleWriter::create("arrow", out);
+    SampleExporter exporter(*writer, 2, 16);
+    bool exported = exporter.run(hosts, []() -> SampleExporter::HostReader {
+        auto db = std::make_shared<DatabaseManager>("test_export.db");
+        if (!db->initialize()) {
+            return nullptr;
+        }
+        return [db](const std::string& ip, const SampleExporter::SampleVisitor& visit) {
+            return db->forEachSample(ip, "", "", visit);
+        };
+    });
+    std::fclose(out);
+
+    std::ifstream arrowFile("test_export.arrow", std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(arrowFile)), std::istreambuf_iterator<char>());
+    std::int32_t footerLength = 0;
+    if (content.size() > 16) {
+        std::memcpy(&footerLength, content.data() + content.size() - 10, sizeof(footerLength));
+    }
+    if (!exported || content.compare(0, 6, "ARROW1") != 0 ||
+        content.compare(content.size() - 6, 6, "ARROW1") != 0 || footerLength <= 0 ||
+        static_cast<std::size_t>(footerLength) + 18 > content.size()) {
+        std::cerr << "ERROR: Invalid Arrow IPC file" << std::endl;
+        return 1;
+    }
+    std::cout << "Arrow export wrote " << content.size() << " bytes in " << exporter.getStats().batches << " record batches" << std::endl;
+
+    // 无法读取的主机使导出失败
+    std::FILE* failedOut = std::fopen("test_export.csv", "wb");
+    auto failedWriter = SampleWriter::create("csv", failedOut);
+    SampleExporter failing(*failedWriter, 2, 7);
+    bool failedExport = failing.run(hosts, []() -> SampleExporter::HostReader {
+        return [](const std::string& ip, const SampleExporter::SampleVisitor&) {
+            return ip != "192.168.3.2";
+        };
+    });
+    std::fclose(failedOut);
+    if (failedExport) {
+        std::cerr << "ERROR: Read failure was not reported" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
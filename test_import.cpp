@@ -0,0 +1,206 @@
+#include "database_manager.h"
+#include "sample_export.h"
+#include "sample_import.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <map>
+#include <vector>
+#include <tuple>
+#include <cstdio>
+
+using SampleRows = std::map<std::string, std::vector<std::tuple<std::int64_t, int, bool>>>;
+
+static void removeDatabase(const std::string& path) {
+    std::remove(path.c_str());
+    std::filesystem::remove_all(path + ".segments");
+    std::filesystem::remove_all(path + ".partitions");
+}
+
+static bool readSamples(DatabaseManager& db, const std::vector<std::string>& hosts, SampleRows& rows) {
+    for (const auto& ip : hosts) {
+        bool success = db.forEachSample(ip, "", "", [&](const SegmentStore::Sample& sample) {
+            rows[ip].emplace_back(sample.time, sample.delay, sample.success);
+            return true;
+        });
+        if (!success) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 统计数据库文件中样本表的覆盖索引个数
+static int countCoverIndexes(const std::string& path) {
+    sqlite3* db;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        return -1;
+    }
+    sqlite3_stmt* stmt;
+    int count = -1;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name LIKE '%_ts_cover'", -1, &stmt, 0) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return count;
+}
+
+static long long rollupCount(const std::string& path, const std::string& ip) {
+    sqlite3* db;
+    sqlite3_open(path.c_str(), &db);
+    sqlite3_stmt* stmt;
+    long long count = -1;
+    if (sqlite3_prepare_v2(db, "SELECT SUM(count) FROM rollup_day WHERE ip = ?", -1, &stmt, 0) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int64(stmt, 0);
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return count;
+}
+
+static bool importFile(const std::string& file, DatabaseManager& db, std::size_t chunkRows,
+                       SampleImporter<DatabaseManager>::Stats& stats) {
+    auto reader = SampleReader::open(file);
+    if (!reader) {
+        return false;
+    }
+    SampleImporter<DatabaseManager> importer(db, chunkRows);
+    bool success = importer.run(*reader);
+    stats = importer.getStats();
+    return success;
+}
+
+int main() {
+    removeDatabase("test_import.db");
+    removeDatabase("test_import_arrow.db");
+
+    // 乱序的CSV：列顺序与导出不同，带引号的主机名、ISO 8601时间戳、CRLF换行，以及两行无法导入的数据
+    {
+        std::ofstream csv("test_import.csv", std::ios::binary);
+        csv << "timestamp,ip,success,delay,hostname\r\n"
+            << "2024-03-09 10:00:00,10.0.0.2,1,12,\"db \"\"primary\"\", east\"\r\n"
+            << "2024-03-01 08:00:30,10.0.0.1,true,5,web\r\n"
+            << "2024-03-01T08:00:00,10.0.0.1,1,4,web\r\n"
+            << "2024-03-09 09:59:00,10.0.0.2,0,0,\r\n"
+            << "not-a-time,10.0.0.1,1,4,web\r\n"
+            << "2024-03-01 08:01:00,10.0.0.1,false,0,web\r\n"
+            << "2024-03-02 00:00:00,999.0.0.1,1,4,bad\r\n"
+            << "2024-03-02 23:59:59,10.0.0.1,1,7.6,web\r\n";
+    }
+
+    SampleRows expected = {
+        {"10.0.0.1", {{1709280000, 4, true}, {1709280030, 5, true}, {1709280060, 0, false}, {1709423999, 8, true}}},
+        {"10.0.0.2", {{1709978340, 0, false}, {1709978400, 12, true}}},
+    };
+    std::vector<std::string> hosts = {"10.0.0.1", "10.0.0.2"};
+
+    {
+        DatabaseManager db("test_import.db");
+        if (!db.initialize() || !db.setPartitionPeriod("day")) {
+            std::cerr << "Failed to initialize database" << std::endl;
+            return 1;
+        }
+        SampleImporter<DatabaseManager>::Stats stats;
+        // 每块3行，跨块、跨7天窗口和分区的样本都要按主机和时间写入
+        if (!importFile("test_import.csv", db, 3, stats)) {
+            std::cerr << "ERROR: CSV import failed" << std::endl;
+            return 1;
+        }
+        std::cout << "Imported " << stats.rows << " rows, skipped " << stats.skipped << ", "
+                  << stats.transactions << " transactions" << std::endl;
+        if (stats.rows != 6 || stats.skipped != 2 || stats.hosts != 2) {
+            std::cerr << "ERROR: Unexpected import statistics" << std::endl;
+            return 1;
+        }
+
+        SampleRows rows;
+        if (!readSamples(db, hosts, rows) || rows != expected) {
+            std::cerr << "ERROR: Imported samples do not match the CSV file" << std::endl;
+            return 1;
+        }
+        auto names = db.getAllHosts();
+        if (names["10.0.0.2"] != "db \"primary\", east" || names["10.0.0.1"] != "web") {
+            std::cerr << "ERROR: Hostnames were not imported: " << names["10.0.0.2"] << std::endl;
+            return 1;
+        }
+
+        // 推迟的索引在导入结束（或分区DETACH前）补建，每个分区文件中的样本表都有覆盖索引
+        int indexes = 0;
+        for (const auto& partition : db.listPartitions()) {
+            indexes += countCoverIndexes(partition.path);
+        }
+        if (indexes != 3) {
+            std::cerr << "ERROR: Expected 3 covering indexes after import, found " << indexes << std::endl;
+            return 1;
+        }
+    }
+    if (rollupCount("test_import.db", "10.0.0.1") != 4 || rollupCount("test_import.db", "10.0.0.2") != 2) {
+        std::cerr << "ERROR: Rollups do not match the imported samples" << std::endl;
+        return 1;
+    }
+    std::cout << "CSV import produced the expected samples, hostnames, indexes and rollups" << std::endl;
+
+    // Arrow往返：导出后导入到新数据库，样本应完全一致
+    {
+        std::FILE* out = std::fopen("test_import.arrow", "wb");
+        auto writer = SampleWriter::create("arrow", out);
+        SampleExporter exporter(*writer, 1, 2);
+        bool exported = exporter.run(hosts, []() -> SampleExporter::HostReader {
+            auto db = std::make_shared<DatabaseManager>("test_import.db");
+            if (!db->initialize()) {
+                return nullptr;
+            }
+            return [db](const std::string& ip, const SampleExporter::SampleVisitor& visit) {
+                return db->forEachSample(ip, "", "", visit);
+            };
+        });
+        std::fclose(out);
+        if (!exported) {
+            std::cerr << "ERROR: Arrow export failed" << std::endl;
+            return 1;
+        }
+    }
+    {
+        DatabaseManager db("test_import_arrow.db");
+        if (!db.initialize()) {
+            std::cerr << "Failed to initialize database" << std::endl;
+            return 1;
+        }
+        SampleImporter<DatabaseManager>::Stats stats;
+        SampleRows rows;
+        if (!importFile("test_import.arrow", db, SampleImporter<DatabaseManager>::CHUNK_ROWS, stats) ||
+            !readSamples(db, hosts, rows) || rows != expected || stats.skipped != 0) {
+            std::cerr << "ERROR: Arrow import does not match the exported samples" << std::endl;
+            return 1;
+        }
+        // 文件中没有主机名列时以IP作为新主机的主机名
+        if (db.getAllHosts()["10.0.0.1"] != "10.0.0.1") {
+            std::cerr << "ERROR: Missing hostname was not defaulted to the IP" << std::endl;
+            return 1;
+        }
+    }
+    if (countCoverIndexes("test_import_arrow.db") != 2) {
+        std::cerr << "ERROR: Covering indexes missing after Arrow import" << std::endl;
+        return 1;
+    }
+    std::cout << "Arrow round trip produced the expected samples" << std::endl;
+
+    // 缺少必需列的CSV无法打开
+    {
+        std::ofstream csv("test_import.csv");
+        csv << "ip,timestamp,delay\n10.0.0.1,2024-03-01 08:00:00,4\n";
+    }
+    if (SampleReader::open("test_import.csv")) {
+        std::cerr << "ERROR: CSV without a success column was accepted" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "live_state.h"
+#include "query_server.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cmath>
+
+// 用curl抓取本机HTTP端口上的/metrics，返回包括响应头的完整响应
+static std::string scrape(int port) {
+    std::string command = "curl -s -i http://127.0.0.1:" + std::to_string(port) + "/metrics";
+    std::FILE* pipe = popen(command.c_str(), "r");
+    std::string response;
+    if (!pipe) {
+        return response;
+    }
+    char buffer[4096];
+    std::size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        response.append(buffer, read);
+    }
+    pclose(pipe);
+    return response;
+}
+
+// 解析Prometheus文本格式：每个指标族的样本必须连续出现在其TYPE行之后，值前可以有多个空格
+static bool parseExposition(const std::string& text, std::map<std::string, double>& series) {
+    std::istringstream lines(text);
+    std::string line;
+    std::string family;
+    std::set<std::string> finished;
+    while (std::getline(lines, line)) {
+        if (line.starts_with("# TYPE ")) {
+            std::string name = line.substr(7, line.find(' ', 7) - 7);
+            if (!finished.insert(name).second) {
+                std::cerr << "Metric family repeated: " << name << std::endl;
+                return false;
+            }
+            family = name;
+            continue;
+        }
+        if (line.empty() || line.starts_with("#")) {
+            continue;
+        }
+        std::size_t end = line.find('}');
+        end = end == std::string::npos ? line.find(' ') : end + 1;
+        std::string key = line.substr(0, end);
+        std::string name = key.substr(0, key.find('{'));
+        if (name != family && !name.starts_with(family + "_")) {
+            std::cerr << "Sample outside its family: " << line << std::endl;
+            return false;
+        }
+        std::size_t valueStart = line.find_first_not_of(' ', end);
+        if (valueStart == std::string::npos || valueStart == end) {
+            std::cerr << "Malformed sample: " << line << std::endl;
+            return false;
+        }
+        series[key] = std::stod(line.substr(valueStart));
+    }
+    return true;
+}
+
+static bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-3;
+}
+
+int main() {
+    LiveState state({{"10.0.0.1", "web"}, {"10.0.0.2", "db \"primary\""}}, 8);
+    state.setExtraMetrics([](std::string& out) {
+        out += "# TYPE mping_test_extra gauge\nmping_test_extra 7\n";
+    });
+    QueryServer server([&state](std::string_view request, std::string& body) {
+        return state.handle(request, body);
+    });
+    if (!server.listenHttp(0) || !server.start()) {
+        std::cerr << "ERROR: Failed to start HTTP server" << std::endl;
+        return 1;
+    }
+
+    // 抓取前没有结果：全部值为0，缓冲区大小之后保持不变
+    std::map<std::string, double> series;
+    std::string response = scrape(server.httpPort());
+    std::size_t bodyStart = response.find("\r\n\r\n");
+    if (response.find("HTTP/1.1 200 OK\r\n") != 0 || response.find("Content-Type: text/plain; version=0.0.4") == std::string::npos ||
+        bodyStart == std::string::npos || !parseExposition(response.substr(bodyStart + 4), series)) {
+        std::cerr << "ERROR: Initial scrape failed:\n" << response << std::endl;
+        return 1;
+    }
+    double bufferBytes = series["mping_metrics_buffer_bytes"];
+    if (series["mping_host_up{ip=\"10.0.0.1\",hostname=\"web\"}"] != 0 || bufferBytes <= 0 ||
+        !series.contains("mping_host_up{ip=\"10.0.0.2\",hostname=\"db \\\"primary\\\"\"}")) {
+        std::cerr << "ERROR: Unexpected initial metrics" << std::endl;
+        return 1;
+    }
+
+    // 三轮：web延迟10、11、12ms；db两次成功一次失败
+    for (int i = 0; i < 3; i++) {
+        std::string timestamp = "2024-03-01 08:00:0" + std::to_string(i);
+        LiveState::PingCycle cycle = {
+            {"10.0.0.1", "web", true, static_cast<short>(10 + i), timestamp},
+            {"10.0.0.2", "db \"primary\"", i != 1, 300, timestamp},
+        };
+        state.applyCycle(cycle, 0.5);
+    }
+
+    series.clear();
+    response = scrape(server.httpPort());
+    bodyStart = response.find("\r\n\r\n");
+    if (bodyStart == std::string::npos || !parseExposition(response.substr(bodyStart + 4), series)) {
+        std::cerr << "ERROR: Scrape after three cycles failed" << std::endl;
+        return 1;
+    }
+    const std::string web = "ip=\"10.0.0.1\",hostname=\"web\"";
+    const std::string db = "ip=\"10.0.0.2\",hostname=\"db \\\"primary\\\"\"";
+    bool expected =
+        series["mping_host_up{" + web + "}"] == 1 && series["mping_host_up{" + db + "}"] == 1 &&
+        series["mping_host_last_rtt_milliseconds{" + web + "}"] == 12 &&
+        near(series["mping_host_loss_ratio{" + db + "}"], 0.3333) && series["mping_host_loss_ratio{" + web + "}"] == 0 &&
+        series["mping_host_probes_total{" + db + "}"] == 3 && series["mping_host_failures_total{" + db + "}"] == 1 &&
+        series["mping_host_rtt_milliseconds_bucket{" + web + ",le=\"10\"}"] == 1 &&
+        series["mping_host_rtt_milliseconds_bucket{" + web + ",le=\"25\"}"] == 3 &&
+        series["mping_host_rtt_milliseconds_bucket{" + web + ",le=\"+Inf\"}"] == 3 &&
+        series["mping_host_rtt_milliseconds_bucket{" + db + ",le=\"250\"}"] == 0 &&
+        series["mping_host_rtt_milliseconds_bucket{" + db + ",le=\"500\"}"] == 2 &&
+        series["mping_host_rtt_milliseconds_sum{" + web + "}"] == 33 &&
+        series["mping_host_rtt_milliseconds_count{" + db + "}"] == 2 &&
+        series["mping_cycles_total"] == 3 && series["mping_samples_total"] == 6 && series["mping_hosts_up"] == 2 &&
+        series["mping_scrapes_total"] == 2 && series["mping_test_extra"] == 7 &&
+        series["mping_metrics_buffer_bytes"] == bufferBytes;
+    if (!expected) {
+        std::cerr << "ERROR: Unexpected metrics after three cycles:\n" << response << std::endl;
+        return 1;
+    }
+    std::cout << "Scraped host and engine metrics over HTTP" << std::endl;
+
+    // 丢包率只统计最近64次探测
+    for (int i = 0; i < 100; i++) {
+        state.applyCycle({{"10.0.0.2", "db", i >= 36, 1, "2024-03-01 09:00:00"}}, 0.1);
+    }
+    series.clear();
+    response = scrape(server.httpPort());
+    bodyStart = response.find("\r\n\r\n");
+    if (bodyStart == std::string::npos || !parseExposition(response.substr(bodyStart + 4), series) ||
+        series["mping_host_loss_ratio{" + db + "}"] != 0 || series["mping_host_failures_total{" + db + "}"] != 37) {
+        std::cerr << "ERROR: Loss ratio window is wrong" << std::endl;
+        return 1;
+    }
+    std::cout << "Loss ratio covers the last " << MetricsExposition::LOSS_WINDOW << " probes" << std::endl;
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
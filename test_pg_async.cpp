@@ -0,0 +1,126 @@
+#include "database_manager_pg.h"
+#include <iostream>
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <ctime>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// 在epoll事件循环中完成一次异步写入；定时器代替探测套接字，统计写入期间事件循环处理的定时器事件
+static DatabaseManagerPG::AsyncStatus runEventLoop(DatabaseManagerPG& db, int& timerTicks) {
+    int epollFd = epoll_create1(0);
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    itimerspec interval{{0, 1000000}, {0, 1000000}};  // 每1ms触发一次
+    timerfd_settime(timerFd, 0, &interval, nullptr);
+
+    epoll_event timerEvent{EPOLLIN, {.fd = timerFd}};
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &timerEvent);
+    epoll_event dbEvent{static_cast<std::uint32_t>(EPOLLIN | (db.wantsWrite() ? static_cast<std::uint32_t>(EPOLLOUT) : 0u)), {.fd = db.socket()}};
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, db.socket(), &dbEvent);
+
+    auto status = DatabaseManagerPG::AsyncStatus::Pending;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (status == DatabaseManagerPG::AsyncStatus::Pending && std::chrono::steady_clock::now() < deadline) {
+        epoll_event events[2];
+        int count = epoll_wait(epollFd, events, 2, 100);
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == timerFd) {
+                std::uint64_t expirations;
+                if (read(timerFd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                    timerTicks += static_cast<int>(expirations);
+                }
+            } else {
+                status = db.processAsync();
+                if (status == DatabaseManagerPG::AsyncStatus::Pending) {
+                    dbEvent.events = EPOLLIN | (db.wantsWrite() ? static_cast<std::uint32_t>(EPOLLOUT) : 0u);
+                    epoll_ctl(epollFd, EPOLL_CTL_MOD, db.socket(), &dbEvent);
+                }
+            }
+        }
+    }
+
+    close(timerFd);
+    close(epollFd);
+    return status;
+}
+
+static std::string currentTimestamp() {
+    std::time_t now = std::time(nullptr);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+    return buffer;
+}
+
+int main() {
+    // PostgreSQL连接字符串，可以通过MPING_PG_CONNINFO环境变量覆盖
+    const char* envConnInfo = std::getenv("MPING_PG_CONNINFO");
+    std::string connInfo = envConnInfo ? envConnInfo : "host=localhost user=mping_user password=mping_pass dbname=mping_test";
+
+    DatabaseManagerPG db(connInfo);
+    if (!db.initialize() || !db.loadAlertState()) {
+        std::cerr << "Failed to initialize database" << std::endl;
+        return 1;
+    }
+
+    // 第一轮：192.168.10.2 不通，产生告警；其中一个样本落在尚未创建的日分区中
+    std::string now = currentTimestamp();
+    std::vector<std::tuple<std::string, std::string, short, bool, std::string>> results;
+    results.emplace_back("192.168.10.1", "async-host1", 10, true, now);
+    results.emplace_back("192.168.10.2", "async-\"quoted\"-host2", 3000, false, now);
+    results.emplace_back("192.168.10.1", "async-host1", 12, true, "2031-01-01 00:00:00");
+
+    auto start = std::chrono::steady_clock::now();
+    if (!db.startAsyncCycle(results, {{"192.168.10.2", "async-\"quoted\"-host2"}}, {})) {
+        std::cerr << "Failed to start asynchronous write" << std::endl;
+        return 1;
+    }
+    auto startDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    int timerTicks = 0;
+    if (runEventLoop(db, timerTicks) != DatabaseManagerPG::AsyncStatus::Done) {
+        std::cerr << "ERROR: Asynchronous write did not complete" << std::endl;
+        return 1;
+    }
+    std::cout << "Asynchronous write completed (start returned after " << startDuration.count() << "us, "
+              << timerTicks << " timer events handled meanwhile)" << std::endl;
+
+    if (!db.isAlertActive("192.168.10.2") || db.getAllHosts()["192.168.10.2"] != "async-\"quoted\"-host2") {
+        std::cerr << "ERROR: Alert or host was not written" << std::endl;
+        return 1;
+    }
+
+    // 第二轮：192.168.10.2 恢复，告警移入恢复记录
+    results.clear();
+    results.emplace_back("192.168.10.2", "async-\"quoted\"-host2", 15, true, currentTimestamp());
+    if (!db.startAsyncCycle(results, {}, {"192.168.10.2"}) ||
+        runEventLoop(db, timerTicks) != DatabaseManagerPG::AsyncStatus::Done) {
+        std::cerr << "ERROR: Second asynchronous write did not complete" << std::endl;
+        return 1;
+    }
+    bool recovered = false;
+    for (const auto& [id, ip, hostname, alertTime, recoveryTime] : db.getRecoveryRecords(-1)) {
+        recovered = recovered || ip == "192.168.10.2";
+    }
+    if (db.isAlertActive("192.168.10.2") || !recovered) {
+        std::cerr << "ERROR: Alert was not moved to recovery records" << std::endl;
+        return 1;
+    }
+
+    // 非法IP在发送前即被拒绝，不会进入管道
+    results.clear();
+    results.emplace_back("not-an-ip", "bad", 1, true, currentTimestamp());
+    if (db.startAsyncCycle(results, {}, {})) {
+        std::cerr << "ERROR: Invalid IP was accepted" << std::endl;
+        return 1;
+    }
+
+    std::cout << "\n--- Querying statistics for 192.168.10.1 ---" << std::endl;
+    db.queryIPStatistics("192.168.10.1");
+
+    std::cout << "Asynchronous PostgreSQL test passed!" << std::endl;
+    return 0;
+}
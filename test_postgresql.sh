@@ -18,6 +18,7 @@ EOF
 echo "Testing PostgreSQL connection..."
 cd /home/code/mping/build
 ./test_pg
+./test_pg_async
 
 # 清理测试数据库和用户
 echo "Cleaning up test database and user..."
@@ -3,6 +3,8 @@
 #include <cassert>
 #include <vector>
 #include <tuple>
+#include <cstdio>
+#include <string_view>
 
 int main() {
     try {
@@ -36,6 +38,83 @@ int main() {
                       << ", Alert Time: " << alertTime << ", Recovery Time: " << recoveryTime << std::endl;
         }
         
+        // 键集分页：每页2条，逐页拼接的结果应与一次读取全部记录一致
+        std::cout << "\nTesting paginated recovery cursor..." << std::endl;
+        std::remove("test_query_recovery_pages.db");
+        DatabaseManager pagedDb("test_query_recovery_pages.db");
+        if (!pagedDb.initialize() || !pagedDb.loadAlertState()) {
+            std::cerr << "Failed to initialize paging database" << std::endl;
+            return 1;
+        }
+        std::vector<std::pair<std::string, std::string>> down;
+        std::vector<std::string> up;
+        for (int i = 1; i <= 5; i++) {
+            down.emplace_back("10.0.0." + std::to_string(i), "host" + std::to_string(i));
+            up.push_back("10.0.0." + std::to_string(i));
+        }
+        if (!pagedDb.applyAlertTransitions(down, {}) || !pagedDb.applyAlertTransitions({}, up)) {
+            std::cerr << "Failed to create recovery records" << std::endl;
+            return 1;
+        }
+        
+        std::vector<long long> allIds;
+        pagedDb.forEachRecoveryRecord(-1, 0, -1, [&](long long id, std::string_view, std::string_view, std::string_view, std::string_view) {
+            allIds.push_back(id);
+            return true;
+        });
+        
+        std::vector<long long> pagedIds;
+        long long after = 0;
+        int pages = 0;
+        while (true) {
+            std::size_t before = pagedIds.size();
+            if (!pagedDb.forEachRecoveryRecord(-1, after, 2, [&](long long id, std::string_view, std::string_view, std::string_view, std::string_view) {
+                    pagedIds.push_back(id);
+                    return true;
+                })) {
+                std::cerr << "ERROR: Paginated query failed" << std::endl;
+                return 1;
+            }
+            if (pagedIds.size() == before) {
+                break;
+            }
+            after = pagedIds.back();
+            pages++;
+        }
+        std::cout << "Read " << pagedIds.size() << " records in " << pages << " pages" << std::endl;
+        if (allIds.size() != 5 || pagedIds != allIds || pages != 3) {
+            std::cerr << "ERROR: Pages do not match the full result" << std::endl;
+            return 1;
+        }
+        
+        // 告警按(创建时间, IP)分页，回调返回false时提前停止
+        if (!pagedDb.applyAlertTransitions(down, {})) {
+            std::cerr << "Failed to create alerts" << std::endl;
+            return 1;
+        }
+        int visited = 0;
+        std::string lastTime;
+        std::string lastIP;
+        pagedDb.forEachActiveAlert(-1, "", "", 3, [&](std::string_view ip, std::string_view, std::string_view createdTime) {
+            lastTime = createdTime;
+            lastIP = ip;
+            return ++visited < 2;
+        });
+        // 上一页最后一条告警在两页之间解除，下一页仍从它之后继续，不会回到第一页
+        if (!pagedDb.applyAlertTransitions({}, {lastIP})) {
+            std::cerr << "Failed to resolve alert" << std::endl;
+            return 1;
+        }
+        int remaining = 0;
+        pagedDb.forEachActiveAlert(-1, lastTime, lastIP, -1, [&](std::string_view, std::string_view, std::string_view) {
+            remaining++;
+            return true;
+        });
+        if (visited != 2 || remaining != 3) {
+            std::cerr << "ERROR: Alert cursor did not stop or resume correctly" << std::endl;
+            return 1;
+        }
+        
         std::cout << "All tests completed successfully!" << std::endl;
         
     } catch (const std::exception& e) {
@@ -0,0 +1,139 @@
+#include "live_state.h"
+#include "query_server.h"
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// 通过本机HTTP端口发送一个请求，返回完整的响应
+static std::string httpGet(int port, const std::string& target) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::string response;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        std::string request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        send(fd, request.data(), request.size(), 0);
+        char buffer[4096];
+        ssize_t received;
+        while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, static_cast<std::size_t>(received));
+        }
+    }
+    close(fd);
+    return response;
+}
+
+int main() {
+    LiveState state({{"10.0.0.1", "web"}, {"10.0.0.2", "db"}, {"10.0.0.3", "cache"}}, 16);
+    state.loadAlerts({{"10.0.0.3", "cache", "2024-03-01 07:00:00"}});
+
+    // 三轮结果：10.0.0.1一直成功，10.0.0.2最后一轮失败，10.0.0.3恢复
+    for (int i = 0; i < 3; i++) {
+        std::string timestamp = "2024-03-01 08:00:0" + std::to_string(i);
+        LiveState::PingCycle cycle = {
+            {"10.0.0.1", "web", true, static_cast<short>(10 + i), timestamp},
+            {"10.0.0.2", "db", i < 2, static_cast<short>(i < 2 ? 5 : 0), timestamp},
+            {"10.0.0.3", "cache", i == 2, 1, timestamp},
+        };
+        for (const auto& result : cycle) {
+            state.recent().record(result);
+        }
+        state.applyCycle(cycle, 0.25);
+    }
+
+    std::string body;
+    if (!state.handle("status 10.0.0.1 limit=2", body) ||
+        body != "host\t10.0.0.1\tweb\tup\t-\t2024-03-01 08:00:02\t12\n"
+                "summary\t3\t3\t11.00\t10\t12\n"
+                "sample\t2024-03-01 08:00:02\t12\t1\n"
+                "sample\t2024-03-01 08:00:01\t11\t1\n") {
+        std::cerr << "ERROR: Unexpected status response:\n" << body << std::endl;
+        return 1;
+    }
+    body.clear();
+    if (!state.handle("alerts", body) || body != "alert\t10.0.0.2\tdb\t2024-03-01 08:00:02\n") {
+        std::cerr << "ERROR: Alerts were not updated by the cycles:\n" << body << std::endl;
+        return 1;
+    }
+    body.clear();
+    if (state.handle("status 10.9.9.9", body) || state.handle("reboot", body)) {
+        std::cerr << "ERROR: Unknown hosts and commands must be rejected" << std::endl;
+        return 1;
+    }
+    std::cout << "Live state answers status and alert requests" << std::endl;
+
+    // 告警分页与-a相同：按(创建时间, IP)排序，after之后继续
+    LiveState paged({{"10.0.0.1", "a"}, {"10.0.0.2", "b"}, {"10.0.0.3", "c"}}, 4);
+    paged.loadAlerts({{"10.0.0.3", "c", "2024-03-01 07:00:00"}, {"10.0.0.1", "a", "2024-03-01 09:00:00"},
+                      {"10.0.0.2", "b", "2024-03-01 07:00:00"}});
+    body.clear();
+    paged.handle("alerts limit=2", body);
+    // 分页键是完整的(创建时间, IP)：上一页最后一条告警在两页之间解除，下一页仍从同一位置继续
+    paged.applyCycle({{"10.0.0.3", "c", true, 5, "2024-03-01 10:00:00"}}, 0.1);
+    std::string secondPage;
+    paged.handle("alerts after=" + formatAlertKey("2024-03-01 07:00:00", "10.0.0.3") + " limit=2", secondPage);
+    if (body != "alert\t10.0.0.2\tb\t2024-03-01 07:00:00\nalert\t10.0.0.3\tc\t2024-03-01 07:00:00\n" ||
+        secondPage != "alert\t10.0.0.1\ta\t2024-03-01 09:00:00\n" || formatAlertKey("2024-03-01 07:00:00", "10.0.0.3") != "2024-03-01T07:00:00,10.0.0.3" ||
+        paged.handle("alerts after=10.0.0.3", secondPage)) {
+        std::cerr << "ERROR: Alert pages do not match the database order:\n" << body << secondPage << std::endl;
+        return 1;
+    }
+    std::cout << "Alert pagination matches the database order" << std::endl;
+
+    // 套接字和HTTP上的请求
+    const std::string path = "test_query_server.sock";
+    std::string response;
+    if (QueryServer::request(path, "stats", response)) {
+        std::cerr << "ERROR: Request succeeded without a running instance" << std::endl;
+        return 1;
+    }
+    {
+        QueryServer server([&state](std::string_view request, std::string& reply) {
+            return state.handle(request, reply);
+        });
+        if (!server.listenUnix(path) || !server.listenHttp(0) || !server.start()) {
+            std::cerr << "ERROR: Failed to start query server" << std::endl;
+            return 1;
+        }
+
+        QueryServer second([](std::string_view, std::string&) { return true; });
+        if (second.listenUnix(path)) {
+            std::cerr << "ERROR: A second instance replaced a live socket" << std::endl;
+            return 1;
+        }
+
+        if (!QueryServer::request(path, "stats", response) || response.find("hosts\t3\nup\t2\ndown\t1\nalerts\t1\ncycles\t3\n") != 0) {
+            std::cerr << "ERROR: Unexpected stats over the socket:\n" << response << std::endl;
+            return 1;
+        }
+        if (QueryServer::request(path, "status 10.9.9.9", response) || response != "unknown host 10.9.9.9") {
+            std::cerr << "ERROR: Socket error response not reported: " << response << std::endl;
+            return 1;
+        }
+
+        std::string http = httpGet(server.httpPort(), "/status/10.0.0.2?limit=1");
+        if (http.find("HTTP/1.1 200 OK\r\n") != 0 || !http.ends_with("\r\n\r\nhost\t10.0.0.2\tdb\tdown\t2024-03-01 08:00:02\t2024-03-01 08:00:02\t0\n"
+                                                                        "summary\t3\t2\t5.00\t5\t5\n"
+                                                                        "sample\t2024-03-01 08:00:02\t0\t0\n")) {
+            std::cerr << "ERROR: Unexpected HTTP status response:\n" << http << std::endl;
+            return 1;
+        }
+        if (httpGet(server.httpPort(), "/nothing").find("HTTP/1.1 404 Not Found\r\n") != 0) {
+            std::cerr << "ERROR: Unknown HTTP path was not rejected" << std::endl;
+            return 1;
+        }
+    }
+    if (access(path.c_str(), F_OK) == 0 || QueryServer::request(path, "stats", response)) {
+        std::cerr << "ERROR: Socket was not removed when the server stopped" << std::endl;
+        return 1;
+    }
+    std::cout << "Socket and HTTP queries are answered by the running server" << std::endl;
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "recent_results.h"
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+static std::vector<SegmentStore::Sample> recent(const RecentResults& results, const std::string& ip, std::size_t limit) {
+    std::vector<SegmentStore::Sample> samples;
+    results.forEachRecent(ip, limit, [&](const SegmentStore::Sample& sample) {
+        samples.push_back(sample);
+        return true;
+    });
+    return samples;
+}
+
+int main() {
+    // 深度为5：每台主机占 16 + 5 × 8 = 56 字节，对齐到一个缓存行
+    RecentResults results({"10.0.0.1", "10.0.0.2", "10.0.0.1"}, 5);
+    if (results.hosts().size() != 2 || results.memoryBytes() != 2 * RecentResults::CACHE_LINE) {
+        std::cerr << "ERROR: Unexpected slab layout: " << results.memoryBytes() << " bytes" << std::endl;
+        return 1;
+    }
+
+    // 写满之后覆盖最旧的样本，读取从新到旧
+    auto slot = results.slotOf("10.0.0.1");
+    for (int i = 0; i < 8; i++) {
+        results.record(*slot, 1700000000 + i, static_cast<short>(i * 10), i % 3 != 0);
+    }
+    auto samples = recent(results, "10.0.0.1", 100);
+    if (samples.size() != 5 || samples.front().time != 1700000007 || samples.back().time != 1700000003 ||
+        samples.front().delay != 70 || samples.front().success != true || samples[1].success != false) {
+        std::cerr << "ERROR: Ring buffer did not keep the 5 newest samples" << std::endl;
+        return 1;
+    }
+    if (recent(results, "10.0.0.1", 2).size() != 2 || results.recorded("10.0.0.1") != 8 ||
+        !recent(results, "10.0.0.2", 10).empty() || results.forEachRecent("10.9.9.9", 10, [](const auto&) { return true; })) {
+        std::cerr << "ERROR: Limits or unknown hosts were not handled" << std::endl;
+        return 1;
+    }
+
+    // 一轮ping结果中的时间戳按本地民用时间解析，未知主机被忽略
+    if (!results.record({"10.0.0.2", "host2", false, 3000, "2024-01-01 00:00:05"}) ||
+        results.record({"10.0.0.9", "host9", true, 1, "2024-01-01 00:00:05"}) ||
+        recent(results, "10.0.0.2", 1).front().time != *SegmentStore::parseTimestamp("2024-01-01 00:00:05")) {
+        std::cerr << "ERROR: Cycle results were not recorded" << std::endl;
+        return 1;
+    }
+    std::cout << "Ring buffer keeps the newest samples per host" << std::endl;
+
+    // 一个写入线程不停覆盖，读取线程看到的样本必须是连续递减的完整样本（延迟与时间一一对应）
+    RecentResults shared({"10.0.0.1"}, 64);
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        std::size_t writerSlot = *shared.slotOf("10.0.0.1");
+        for (int i = 0; i < 2000000; i++) {
+            shared.record(writerSlot, i, static_cast<short>(i % 30000), i % 2 == 0);
+        }
+        done = true;
+    });
+    std::uint64_t snapshots = 0;
+    bool consistent = true;
+    while (!done && consistent) {
+        auto snapshot = recent(shared, "10.0.0.1", 64);
+        for (std::size_t i = 0; i < snapshot.size(); i++) {
+            const auto& sample = snapshot[i];
+            if (sample.delay != sample.time % 30000 || sample.success != (sample.time % 2 == 0) ||
+                (i > 0 && sample.time != snapshot[i - 1].time - 1)) {
+                consistent = false;
+            }
+        }
+        snapshots++;
+    }
+    writer.join();
+    if (!consistent) {
+        std::cerr << "ERROR: Reader observed a torn or overwritten sample" << std::endl;
+        return 1;
+    }
+    std::cout << "Concurrent reads stayed consistent over " << snapshots << " snapshots" << std::endl;
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
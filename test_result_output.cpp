@@ -0,0 +1,109 @@
+#include "result_output.h"
+#include "sample_import.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+using Result = std::tuple<std::string, std::string, bool, short, std::string>;
+
+// 以指定格式写出结果并读回文件内容
+static std::string render(ResultWriter::Format format, const std::vector<Result>& results, const std::string& path) {
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    {
+        ResultWriter writer(format, out);
+        for (const auto& result : results) {
+            writer.write(result);
+        }
+        writer.flush();
+    }
+    std::fclose(out);
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+int main() {
+    std::vector<Result> results = {
+        {"10.0.0.1", "web", true, 12, "2024-03-01 08:00:00"},
+        {"10.0.0.2", "db \"primary\", east", false, 3000, "2024-03-01 08:00:01"},
+        {"10.0.0.3", "tab\there", true, 0, "2024-03-01 08:00:02"},
+    };
+
+    std::string text = render(ResultWriter::Format::TEXT, results, "test_result_output.txt");
+    if (text != "10.0.0.1\tweb\tsuccess\t12ms\n10.0.0.2\tdb \"primary\", east\tfailed\t3000ms\n10.0.0.3\ttab\there\tsuccess\t0ms\n") {
+        std::cerr << "ERROR: Unexpected text output:\n" << text << std::endl;
+        return 1;
+    }
+    std::string tsv = render(ResultWriter::Format::TSV, results, "test_result_output.tsv");
+    if (tsv != "ip\thostname\ttimestamp\tdelay\tsuccess\n"
+               "10.0.0.1\tweb\t2024-03-01 08:00:00\t12\t1\n"
+               "10.0.0.2\tdb \"primary\", east\t2024-03-01 08:00:01\t3000\t0\n"
+               "10.0.0.3\ttab here\t2024-03-01 08:00:02\t0\t1\n") {
+        std::cerr << "ERROR: Unexpected TSV output:\n" << tsv << std::endl;
+        return 1;
+    }
+    std::string jsonl = render(ResultWriter::Format::JSONL, results, "test_result_output.jsonl");
+    if (jsonl != "{\"ip\":\"10.0.0.1\",\"hostname\":\"web\",\"timestamp\":\"2024-03-01 08:00:00\",\"delay\":12,\"success\":true}\n"
+                 "{\"ip\":\"10.0.0.2\",\"hostname\":\"db \\\"primary\\\", east\",\"timestamp\":\"2024-03-01 08:00:01\",\"delay\":3000,\"success\":false}\n"
+                 "{\"ip\":\"10.0.0.3\",\"hostname\":\"tab\\u0009here\",\"timestamp\":\"2024-03-01 08:00:02\",\"delay\":0,\"success\":true}\n") {
+        std::cerr << "ERROR: Unexpected JSON Lines output:\n" << jsonl << std::endl;
+        return 1;
+    }
+
+    // CSV输出可以直接导入：主机名中的引号和逗号按RFC 4180转义
+    render(ResultWriter::Format::CSV, results, "test_result_output.csv");
+    auto reader = SampleReader::open("test_result_output.csv");
+    std::vector<ImportedSample> rows;
+    if (!reader || !reader->read(rows, 100) || rows.size() != 3 || reader->getSkipped() != 0 ||
+        reader->getHosts()[rows[1].host].hostname != "db \"primary\", east" || rows[1].delay != 3000 || rows[1].success) {
+        std::cerr << "ERROR: CSV output could not be imported back" << std::endl;
+        return 1;
+    }
+    std::cout << "Text, TSV, CSV and JSON Lines outputs are correct" << std::endl;
+
+    // 多个线程同时写入，超过缓冲区大小的输出分多次写出，每一行都完整
+    constexpr int THREADS = 8;
+    constexpr int PER_THREAD = 25000;
+    std::FILE* out = std::fopen("test_result_output.jsonl", "wb");
+    auto start = std::chrono::steady_clock::now();
+    {
+        ResultWriter writer(ResultWriter::Format::JSONL, out);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&writer, t]() {
+                for (int i = 0; i < PER_THREAD; i++) {
+                    writer.write({"10.1." + std::to_string(t) + "." + std::to_string(i % 250), "host", i % 7 != 0,
+                                  static_cast<short>(i % 1000), "2024-03-01 08:00:00"});
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        writer.flush();
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::fclose(out);
+
+    std::ifstream in("test_result_output.jsonl");
+    std::string line;
+    long long lines = 0;
+    bool complete = true;
+    while (std::getline(in, line)) {
+        lines++;
+        complete = complete && line.starts_with("{\"ip\":\"10.1.") && line.ends_with("}");
+    }
+    if (!complete || lines != THREADS * PER_THREAD) {
+        std::cerr << "ERROR: Concurrent output lost or interleaved lines (" << lines << " lines)" << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << lines << " JSON lines from " << THREADS << " threads in " << milliseconds << " ms" << std::endl;
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "ring_log_manager.h"
+#include "storage_session.h"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <vector>
+#include <tuple>
+
+// 捕获queryIPStatistics的输出
+static std::string captureStatistics(RingLogManager& db, const std::string& ip,
+                                     const std::string& since = "", const std::string& until = "") {
+    std::ostringstream output;
+    std::streambuf* original = std::cout.rdbuf(output.rdbuf());
+    db.queryIPStatistics(ip, since, until);
+    std::cout.rdbuf(original);
+    return output.str();
+}
+
+int main() {
+    const char* path = "test_ring_log.ring";
+    std::remove(path);
+
+    {
+        StorageSession<RingLogManager> session(path);
+        session.database().setSampleCapacity(8);
+        if (!session.open()) {
+            std::cerr << "Failed to open ring log" << std::endl;
+            return 1;
+        }
+
+        // 第一轮：192.168.1.2 不通，应产生一条告警
+        std::vector<std::tuple<std::string, std::string, bool, short, std::string>> cycle;
+        cycle.emplace_back("192.168.1.1", "host1", true, 10, "2024-01-01 10:00:00");
+        cycle.emplace_back("192.168.1.2", "host2", false, 3000, "2024-01-01 10:00:00");
+        if (!session.writeCycle(cycle) || !session.database().isAlertActive("192.168.1.2") ||
+            session.database().getActiveAlerts().size() != 1) {
+            std::cerr << "ERROR: Expected one alert for 192.168.1.2" << std::endl;
+            return 1;
+        }
+
+        // 第二轮：192.168.1.2 恢复，告警应移入恢复记录
+        cycle.clear();
+        cycle.emplace_back("192.168.1.1", "host1", true, 11, "2024-01-01 10:01:00");
+        cycle.emplace_back("192.168.1.2", "host2", true, 12, "2024-01-01 10:01:00");
+        if (!session.writeCycle(cycle)) {
+            std::cerr << "Failed to write second cycle" << std::endl;
+            return 1;
+        }
+        auto records = session.database().getRecoveryRecords();
+        if (!session.database().getActiveAlerts().empty() || records.size() != 1 || std::get<1>(records[0]) != "192.168.1.2") {
+            std::cerr << "ERROR: Expected the alert to be moved to recovery records" << std::endl;
+            return 1;
+        }
+        std::cout << "Alert and recovery OK" << std::endl;
+    }
+
+    // 重新打开后数据仍在；继续写入使环形缓冲区回绕，只保留最新的8条样本
+    {
+        StorageSession<RingLogManager> session(path);
+        if (!session.open() || session.getAllHosts().size() != 2 || session.database().getRecoveryRecords().size() != 1) {
+            std::cerr << "ERROR: Data was not persisted" << std::endl;
+            return 1;
+        }
+        for (int minute = 2; minute < 10; ++minute) {
+            std::vector<std::tuple<std::string, std::string, bool, short, std::string>> cycle;
+            std::string timestamp = "2024-01-01 10:0" + std::to_string(minute) + ":00";
+            cycle.emplace_back("192.168.1.1", "host1", true, static_cast<short>(minute), timestamp);
+            cycle.emplace_back("192.168.1.2", "host2", minute % 2 == 0, 20, timestamp);
+            if (!session.writeCycle(cycle)) {
+                std::cerr << "Failed to write cycle " << minute << std::endl;
+                return 1;
+            }
+        }
+
+        std::string output = captureStatistics(session.database(), "192.168.1.1");
+        if (output.find("Total ping records: 4") == std::string::npos ||
+            output.find("2024-01-01 10:09:00\t9ms\tSuccess") == std::string::npos ||
+            output.find("10:05:00") != std::string::npos) {
+            std::cerr << "ERROR: Unexpected statistics after wrap-around:\n" << output << std::endl;
+            return 1;
+        }
+
+        output = captureStatistics(session.database(), "192.168.1.2", "2024-01-01 10:07", "2024-01-01 10:09");
+        if (output.find("Total ping records: 2") == std::string::npos || output.find("Successful pings: 1") == std::string::npos) {
+            std::cerr << "ERROR: Unexpected range statistics:\n" << output << std::endl;
+            return 1;
+        }
+        std::cout << "Wrap-around and range query OK" << std::endl;
+
+        // 回滚的样本不可见
+        RingLogManager& db = session.database();
+        std::vector<std::tuple<std::string, std::string, short, bool, std::string>> rolledBack;
+        rolledBack.emplace_back("192.168.1.3", "host3", 5, true, "2024-01-01 10:10:00");
+        if (!db.beginTransaction() || !db.insertPingResults(rolledBack) || !db.rollbackTransaction() ||
+            db.getAllHosts().contains("192.168.1.3") ||
+            captureStatistics(db, "192.168.1.1").find("Total ping records: 4") == std::string::npos) {
+            std::cerr << "ERROR: Rolled back samples are visible" << std::endl;
+            return 1;
+        }
+        std::cout << "Rollback OK" << std::endl;
+    }
+
+    std::remove(path);
+    std::cout << "Ring log test passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "segment_store.h"
+#include <iostream>
+#include <filesystem>
+#include <limits>
+#include <vector>
+
+int main() {
+    const std::string directory = "test_segment_store.segments";
+    std::filesystem::remove_all(directory);
+    SegmentStore store(directory);
+
+    auto day = std::chrono::sys_days{std::chrono::year{2024} / 1 / 1};
+    auto dayStart = SegmentStore::parseTimestamp("2024-01-01");
+    if (!dayStart || SegmentStore::formatTimestamp(*dayStart + 3661) != "2024-01-01 01:01:01") {
+        std::cerr << "ERROR: Timestamp conversion failed" << std::endl;
+        return 1;
+    }
+
+    // 一天的样本：以失败开头，间隔不固定，包含超时产生的大延迟
+    std::vector<SegmentStore::Sample> samples;
+    SegmentStore::Summary expected;
+    for (int i = 0; i < 1440; ++i) {
+        std::int64_t time = *dayStart + i * 60 + (i % 7 == 0 ? 1 : 0);
+        bool success = !(i < 3 || (i >= 700 && i < 720));
+        short delay = success ? static_cast<short>(10 + i % 13) : 3000;
+        samples.push_back({time, delay, success});
+        expected.add(samples.back());
+    }
+
+    if (!store.writeDay("192.168.1.1", day, samples)) {
+        std::cerr << "ERROR: Failed to write segment" << std::endl;
+        return 1;
+    }
+
+    // 解码结果必须与写入的样本完全一致
+    std::vector<SegmentStore::Sample> decoded;
+    store.forEachSample("192.168.1.1", std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max(),
+                        [&](const SegmentStore::Sample& sample) {
+                            decoded.push_back(sample);
+                            return true;
+                        });
+    bool same = decoded.size() == samples.size();
+    for (std::size_t i = 0; same && i < samples.size(); ++i) {
+        same = decoded[i].time == samples[i].time && decoded[i].delay == samples[i].delay &&
+               decoded[i].success == samples[i].success;
+    }
+    if (!same) {
+        std::cerr << "ERROR: Decoded samples differ from written samples" << std::endl;
+        return 1;
+    }
+    std::cout << "Round trip of " << decoded.size() << " samples OK" << std::endl;
+
+    // 重复写入同一天：完全相同的样本被去重，新样本被合并
+    std::vector<SegmentStore::Sample> again(samples.begin(), samples.begin() + 10);
+    again.push_back({*dayStart + 86399, 42, true});
+    expected.add(again.back());
+    if (!store.writeDay("192.168.1.1", day, again)) {
+        std::cerr << "ERROR: Failed to merge segment" << std::endl;
+        return 1;
+    }
+
+    SegmentStore::Summary summary;
+    std::vector<std::tuple<std::string, int, int>> recent;
+    if (!store.summarize("192.168.1.1", "", "", summary, recent)) {
+        std::cerr << "ERROR: Failed to summarize segments" << std::endl;
+        return 1;
+    }
+    std::cout << "Full range: " << summary.total << " samples, " << summary.successes << " successes" << std::endl;
+    if (summary.total != expected.total || summary.successes != expected.successes ||
+        summary.delaySum != expected.delaySum || summary.minDelay != expected.minDelay ||
+        summary.maxDelay != expected.maxDelay) {
+        std::cerr << "ERROR: Summary does not match the written samples" << std::endl;
+        return 1;
+    }
+    if (recent.size() != 10 || std::get<0>(recent[0]) != "2024-01-01 23:59:59" || std::get<1>(recent[0]) != 42) {
+        std::cerr << "ERROR: Unexpected recent records" << std::endl;
+        return 1;
+    }
+
+    // 部分范围需要解码：11:40到12:00之间是20个失败样本
+    SegmentStore::Summary partial;
+    recent.clear();
+    if (!store.summarize("192.168.1.1", "2024-01-01 11:40:00", "2024-01-01 12:00", partial, recent) ||
+        partial.total != 20 || partial.successes != 0) {
+        std::cerr << "ERROR: Unexpected partial range summary (" << partial.total << " samples)" << std::endl;
+        return 1;
+    }
+    std::cout << "Partial range: " << partial.total << " samples, " << partial.successes << " successes" << std::endl;
+
+    // 压缩后每个样本只占几个字节
+    auto [bytes, files] = store.diskUsage();
+    std::cout << "Segment size: " << bytes << " bytes for " << summary.total << " samples" << std::endl;
+    if (files != 1 || bytes > static_cast<std::uintmax_t>(summary.total) * 4) {
+        std::cerr << "ERROR: Segment is larger than expected" << std::endl;
+        return 1;
+    }
+
+    // 按天删除
+    if (store.removeBefore(day + std::chrono::days{1}) != 1 || store.hasHost("192.168.1.1")) {
+        std::cerr << "ERROR: Failed to remove old segments" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::remove_all(directory);
+    std::cout << "Segment store test passed!" << std::endl;
+    return 0;
+}
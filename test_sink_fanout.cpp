@@ -0,0 +1,134 @@
+#include "database_manager.h"
+#include "storage_sink.h"
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+// 模拟缓慢的远程存储：每轮写入都阻塞到测试放行为止，之后交给内部的SQLite目标
+class BlockedSink : public StorageSink {
+private:
+    std::unique_ptr<StorageSink> inner;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool isReleased = false;
+    bool writing = false;
+
+public:
+    int cycles = 0;
+
+    explicit BlockedSink(std::unique_ptr<StorageSink> inner) : inner(std::move(inner)) {}
+
+    bool open() override { return inner->open(); }
+    std::map<std::string, std::string> getAllHosts() override { return {}; }
+
+    bool writeCycle(const PingCycle& cycle, const AlertingHosts* alerting) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        writing = true;
+        changed.notify_all();
+        changed.wait(lock, [&] { return isReleased; });
+        cycles++;
+        return inner->writeCycle(cycle, alerting);
+    }
+
+    // 等待写入线程进入第一轮写入
+    void waitUntilWriting() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return writing; });
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isReleased = true;
+        }
+        changed.notify_all();
+    }
+};
+
+int main() {
+    std::remove("test_sink_fanout.db");
+    std::remove("test_sink_fanout_remote.db");
+
+    BlockedSink* blocked = nullptr;
+    StorageSinkRegistry registry;
+    registry.add("sqlite", [](const std::string& target) -> std::unique_ptr<StorageSink> {
+        return std::make_unique<SessionSink<DatabaseManager>>(target, SessionSink<DatabaseManager>::Hooks{});
+    });
+    registry.add("blocked", [&blocked](const std::string& target) -> std::unique_ptr<StorageSink> {
+        auto sink = std::make_unique<BlockedSink>(std::make_unique<SessionSink<DatabaseManager>>(target, SessionSink<DatabaseManager>::Hooks{}));
+        blocked = sink.get();
+        return sink;
+    });
+
+    if (registry.create("sqlite") || registry.create("unknown:x")) {
+        std::cerr << "ERROR: Invalid sink specs must be rejected" << std::endl;
+        return 1;
+    }
+
+    SinkFanout fanout(2);
+    fanout.add("sqlite:test_sink_fanout.db", registry.create("sqlite:test_sink_fanout.db"));
+    fanout.add("blocked:test_sink_fanout_remote.db", registry.create("blocked:test_sink_fanout_remote.db"));
+    if (fanout.open() != 2) {
+        std::cerr << "ERROR: Failed to open sinks" << std::endl;
+        return 1;
+    }
+
+    // 慢目标阻塞期间submit立即返回，本地SQLite照常写完每一轮
+    // 第1轮失败产生告警，之后的成功轮次中告警按内存状态的规则保持（例如要求连续多轮成功才恢复），
+    // 目标自己的默认规则会在第2轮就解除告警
+    for (int i = 0; i < 4; i++) {
+        PingCycle cycle;
+        cycle.emplace_back("192.168.2.1", "host1", i != 1, static_cast<short>(10 + i), "2024-01-01 10:0" + std::to_string(i) + ":00");
+        auto alerting = std::make_shared<const AlertingHosts>(i == 0 ? AlertingHosts{} : AlertingHosts{"192.168.2.1"});
+        auto start = std::chrono::steady_clock::now();
+        fanout.submit(cycle, alerting);
+        bool returnedImmediately = std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500);
+        if (i == 0) {
+            blocked->waitUntilWriting();
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (fanout.stats(0).written < static_cast<std::uint64_t>(i + 1) && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (!returnedImmediately || fanout.stats(0).written != static_cast<std::uint64_t>(i + 1)) {
+            std::cerr << "ERROR: SQLite sink was stalled by the blocked sink" << std::endl;
+            blocked->release();
+            return 1;
+        }
+    }
+    std::cout << "SQLite sink wrote 4 cycles while the blocked sink was stalled" << std::endl;
+
+    // 慢目标的队列容量为2：一轮正在写入，其余三轮中最旧的一轮（产生告警的第1轮）被丢弃
+    blocked->release();
+    bool complete = fanout.close();
+    auto blockedStats = fanout.stats(1);
+    std::cout << "Blocked sink: " << blockedStats.written << " written, " << blockedStats.dropped << " dropped" << std::endl;
+    if (complete || blockedStats.written != 3 || blockedStats.dropped != 1 || blocked->cycles != 3) {
+        std::cerr << "ERROR: Expected the oldest queued cycle to be dropped" << std::endl;
+        return 1;
+    }
+
+    DatabaseManager db("test_sink_fanout.db");
+    if (!db.initialize() || db.getAllHosts()["192.168.2.1"] != "host1") {
+        std::cerr << "ERROR: SQLite sink did not store the host" << std::endl;
+        return 1;
+    }
+
+    // 两个目标的告警都与内存状态一致，包括丢弃了产生告警那一轮的慢目标
+    for (const char* path : {"test_sink_fanout.db", "test_sink_fanout_remote.db"}) {
+        DatabaseManager store(path);
+        if (!store.initialize() || !store.loadAlertState() || !store.isAlertActive("192.168.2.1") || !store.getRecoveryRecords().empty()) {
+            std::cerr << "ERROR: Alert state of " << path << " differs from the confirmed state" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Both sinks follow the confirmed alert state despite the dropped cycle" << std::endl;
+
+    std::cout << "All tests completed successfully!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "database_manager.h"
+#include "storage_session.h"
+#include <iostream>
+#include <cstdio>
+#include <vector>
+#include <tuple>
+#include <ctime>
+
+// 本地时间daysAgo天前的日期加上给定的时刻
+static std::string localTimestamp(int daysAgo, const char* timeOfDay) {
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&now, &local);
+    local.tm_mday -= daysAgo;
+    local.tm_hour = 12;
+    std::mktime(&local);
+    char buffer[16];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", &local);
+    return std::string(buffer) + " " + timeOfDay;
+}
+
+static long long sumRollup(const std::string& path, const std::string& table) {
+    sqlite3* db;
+    sqlite3_open(path.c_str(), &db);
+    sqlite3_stmt* stmt;
+    long long count = -1;
+    std::string sql = "SELECT COALESCE(SUM(count), 0) FROM " + table + ";";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, 0) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return count;
+}
+
+int main() {
+    try {
+        std::remove("test_storage_session.db");
+        StorageSession<DatabaseManager> session("test_storage_session.db");
+        
+        if (!session.open()) {
+            std::cerr << "Failed to open storage session" << std::endl;
+            return 1;
+        }
+        
+        std::cout << "Storage session opened successfully" << std::endl;
+        
+        // 第一轮：192.168.1.2 不通，应产生一条告警
+        std::vector<std::tuple<std::string, std::string, bool, short, std::string>> cycle1;
+        cycle1.emplace_back("192.168.1.1", "host1", true, 10, "2024-01-01 10:00:00");
+        cycle1.emplace_back("192.168.1.2", "host2", false, 3000, "2024-01-01 10:00:00");
+        
+        if (!session.writeCycle(cycle1)) {
+            std::cerr << "Failed to write first cycle" << std::endl;
+            return 1;
+        }
+        
+        auto alerts = session.database().getActiveAlerts();
+        std::cout << "After first cycle, found " << alerts.size() << " active alerts" << std::endl;
+        if (alerts.size() != 1 || !session.database().isAlertActive("192.168.1.2")) {
+            std::cerr << "ERROR: Expected one alert for 192.168.1.2" << std::endl;
+            return 1;
+        }
+        
+        // 第二轮：192.168.1.2 恢复，告警应移入恢复记录
+        std::vector<std::tuple<std::string, std::string, bool, short, std::string>> cycle2;
+        cycle2.emplace_back("192.168.1.1", "host1", true, 11, "2024-01-01 10:01:00");
+        cycle2.emplace_back("192.168.1.2", "host2", true, 12, "2024-01-01 10:01:00");
+        
+        if (!session.writeCycle(cycle2)) {
+            std::cerr << "Failed to write second cycle" << std::endl;
+            return 1;
+        }
+        
+        alerts = session.database().getActiveAlerts();
+        auto records = session.database().getRecoveryRecords();
+        std::cout << "After second cycle, found " << alerts.size() << " active alerts and "
+                  << records.size() << " recovery records" << std::endl;
+        if (!alerts.empty() || records.size() != 1 || std::get<1>(records[0]) != "192.168.1.2") {
+            std::cerr << "ERROR: Expected the alert to be moved to recovery_records" << std::endl;
+            return 1;
+        }
+        
+        // 第三轮：全部正常，不应产生新的恢复记录
+        if (!session.writeCycle(cycle2) || session.database().getRecoveryRecords().size() != 1) {
+            std::cerr << "ERROR: Healthy hosts must not create recovery records" << std::endl;
+            return 1;
+        }
+        
+        // 回滚的事务中新建的样本表随之撤销，下次写入该主机时必须重新建表
+        DatabaseManager& db = session.database();
+        std::vector<std::tuple<std::string, std::string, short, bool, std::string>> newHost;
+        newHost.emplace_back("192.168.1.3", "host3", 13, true, "2024-01-01 10:02:00");
+        if (!db.beginTransaction() || !db.insertPingResults(newHost) || !db.rollbackTransaction()) {
+            std::cerr << "ERROR: Failed to write and roll back a new host" << std::endl;
+            return 1;
+        }
+        if (!db.insertPingResults(newHost)) {
+            std::cerr << "ERROR: Sample table was not recreated after rollback" << std::endl;
+            return 1;
+        }
+        
+        // 重新打开已是当前模式版本的数据库：跳过建表，已知主机直接写入
+        DatabaseManager reopened("test_storage_session.db");
+        newHost[0] = {"192.168.1.3", "host3", 14, true, "2024-01-01 10:03:00"};
+        if (!reopened.initialize() || !reopened.insertPingResults(newHost)) {
+            std::cerr << "ERROR: Failed to write after reopening the database" << std::endl;
+            return 1;
+        }
+        
+        // chunked布局：每台主机累积2个样本再写入数据块；回滚的事务中写入数据块的尾部样本回到内存，
+        // 本事务追加的样本丢弃，下次写入时与后续样本一起写入
+        std::remove("test_storage_session_chunked.db");
+        DatabaseManager chunked("test_storage_session_chunked.db");
+        chunked.setChunkFlushThreshold(2);
+        if (!chunked.initialize() || !chunked.setSampleStore("chunked")) {
+            std::cerr << "ERROR: Failed to open the chunked database" << std::endl;
+            return 1;
+        }
+        auto chunkSample = [](short delay, const std::string& timestamp) {
+            return std::vector<std::tuple<std::string, std::string, short, bool, std::string>>{
+                {"192.168.1.4", "host4", delay, true, timestamp}};
+        };
+        // 仍在尾部的样本不计入汇总，写入数据块时才累加
+        if (!chunked.insertPingResults(chunkSample(21, "2024-01-01 10:00:00")) ||
+            sumRollup("test_storage_session_chunked.db", "rollup_day") != 0) {
+            std::cerr << "ERROR: Buffered chunk samples were counted in the rollups" << std::endl;
+            return 1;
+        }
+        if (!chunked.beginTransaction() ||
+            !chunked.insertPingResults(chunkSample(22, "2024-01-01 10:01:00")) || !chunked.rollbackTransaction() ||
+            !chunked.insertPingResults(chunkSample(23, "2024-01-01 10:02:00")) ||
+            // 同一小时的下一次写入按缓存的最后一个数据块直接追加
+            !chunked.insertPingResults(chunkSample(24, "2024-01-01 10:03:00")) ||
+            !chunked.insertPingResults(chunkSample(25, "2024-01-01 10:04:00"))) {
+            std::cerr << "ERROR: Failed to write chunked samples" << std::endl;
+            return 1;
+        }
+        std::vector<short> delays;
+        chunked.forEachSample("192.168.1.4", "", "", [&delays](const SegmentStore::Sample& sample) {
+            delays.push_back(sample.delay);
+            return true;
+        });
+        if (delays != std::vector<short>{21, 23, 24, 25} || sumRollup("test_storage_session_chunked.db", "rollup_minute") != 4 ||
+            sumRollup("test_storage_session_chunked.db", "rollup_day") != 4) {
+            std::cerr << "ERROR: Expected the chunked samples 21, 23, 24 and 25, found " << delays.size() << " samples" << std::endl;
+            return 1;
+        }
+
+        // -C 30：截止日为30天前的0点，原始行和分钟汇总在同一截止日过期，截止日当天的样本全部保留；
+        // 天汇总保留，-q的总计仍包括已删除的样本
+        std::remove("test_storage_session_cleanup.db");
+        {
+            DatabaseManager expiring("test_storage_session_cleanup.db");
+            std::vector<std::tuple<std::string, std::string, short, bool, std::string>> aged = {
+                {"192.168.1.5", "host5", 31, true, localTimestamp(31, "23:00:00")},
+                {"192.168.1.5", "host5", 32, true, localTimestamp(30, "00:00:30")},
+                {"192.168.1.5", "host5", 33, true, localTimestamp(30, "23:59:00")},
+            };
+            if (!expiring.initialize() || !expiring.insertPingResults(aged)) {
+                std::cerr << "ERROR: Failed to write aged samples" << std::endl;
+                return 1;
+            }
+            expiring.cleanupOldData(30);
+            std::vector<short> kept;
+            expiring.forEachSample("192.168.1.5", "", "", [&kept](const SegmentStore::Sample& sample) {
+                kept.push_back(sample.delay);
+                return true;
+            });
+            if (kept != std::vector<short>{32, 33}) {
+                std::cerr << "ERROR: Expected the samples of the cutoff day to be kept, found " << kept.size() << std::endl;
+                return 1;
+            }
+        }
+        if (sumRollup("test_storage_session_cleanup.db", "rollup_minute") != 2 ||
+            sumRollup("test_storage_session_cleanup.db", "rollup_day") != 3) {
+            std::cerr << "ERROR: Unexpected rollups after cleanup" << std::endl;
+            return 1;
+        }
+
+        std::cout << "All tests completed successfully!" << std::endl;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}